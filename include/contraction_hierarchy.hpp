@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "routing_graph.hpp"
+
+namespace hdmap {
+
+// Contraction hierarchy over a RoutingGraph.
+// Preprocessing contracts lanes in importance order and adds shortcut edges;
+// queries then run a bidirectional Dijkstra that only moves upwards in the
+// order, settling a few hundred lanes even on city-scale graphs.
+class ContractionHierarchy {
+ public:
+  ContractionHierarchy() = default;
+
+  // Preprocess the graph (lane ids and edge costs are taken as-is)
+  void build(const RoutingGraph& graph);
+  void clear();
+
+  bool empty() const {
+    return rank_.empty();
+  }
+  size_t shortcutCount() const {
+    return shortcutCount_;
+  }
+
+  // Binary persistence; load() rejects files built from a different graph
+  bool save(const std::string& filepath) const;
+  bool load(const std::string& filepath, const RoutingGraph& graph);
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+  // Same result as RoutingGraph::aStar on the graph the hierarchy was built on
+  std::optional<Route> route(const RoutingGraph& graph, uint64_t fromLaneId,
+                             uint64_t toLaneId) const;
+
+  // Identifies a graph's topology and costs
+  static uint64_t fingerprint(const RoutingGraph& graph);
+
+ private:
+  struct Edge {
+    uint32_t target;
+    uint32_t middle;  // contracted lane a shortcut bypasses, or kNoMiddle
+    double cost;
+  };
+
+  // Node order; higher rank was contracted later
+  IndexVector<uint32_t> rank_;
+  // Edges to higher ranked lanes, per lane (CSR)
+  IndexVector<uint32_t> upOffsets_;
+  IndexVector<Edge> upEdges_;
+  // Reversed edges from higher ranked lanes, per lane (CSR)
+  IndexVector<uint32_t> downOffsets_;
+  IndexVector<Edge> downEdges_;
+  size_t shortcutCount_{0};
+  uint64_t fingerprint_{0};
+  std::string lastError_;
+
+  const Edge* findEdge(uint32_t from, uint32_t to) const;
+  void unpack(uint32_t from, uint32_t to, std::vector<uint32_t>& path) const;
+};
+
+}  // namespace hdmap
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "map_server.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// MapServer calls a drive trace can contain
+enum class TraceQueryType : uint8_t {
+  RADIUS,          // queryRadius(point, radius)
+  CLOSEST_LANE,    // getClosestLane(point)
+  NEARBY_LANES,    // getNearbyLanes(point, radius)
+  REGION,          // queryRegion(region)
+  LANE,            // getLaneById(laneId)
+  TRAFFIC_LIGHTS,  // getTrafficLightsForLane(laneId)
+  TRAFFIC_SIGNS,   // getTrafficSignsForLane(laneId)
+  PROJECT,         // project(laneId, point)
+};
+constexpr size_t kTraceQueryTypeCount = 8;
+
+const char* traceQueryName(TraceQueryType type);
+
+struct TraceQuery {
+  double timestamp;  // seconds since the start of the drive
+  TraceQueryType type;
+  Point2D point;
+  double radius;
+  BoundingBox region;
+  uint64_t laneId;
+
+  TraceQuery()
+      : timestamp{0.0}, type{TraceQueryType::CLOSEST_LANE}, radius{0.0},
+        laneId{0} {
+  }
+};
+
+// Parameters of a synthesized drive
+struct DriveConfig {
+  double duration;      // seconds
+  double speed;         // m/s along lane centerlines
+  double queryRate;     // query rounds per second
+  double lookupRadius;  // for RADIUS queries
+  uint64_t seed;        // start lane and turns
+
+  DriveConfig()
+      : duration{60.0}, speed{13.89}, queryRate{10.0}, lookupRadius{50.0},
+        seed{42} {
+  }
+};
+
+// Time-ordered MapServer queries of one drive. Stored as CSV, one query
+// per line, '#' starts a comment:
+//   timestamp,radius,x,y,radius
+//   timestamp,closest,x,y
+//   timestamp,nearby,x,y,radius
+//   timestamp,region,minX,minY,maxX,maxY
+//   timestamp,lane|lights|signs,laneId
+//   timestamp,project,laneId,x,y
+class DriveTrace {
+ public:
+  bool load(const std::string& filepath);
+  bool save(const std::string& filepath) const;
+
+  // Vehicle following lane successors through the loaded map. Every round
+  // it localizes (closest lane, projection), looks around (radius query)
+  // and checks the current lane's lights and signs.
+  static DriveTrace synthesize(const MapServer& server,
+                               const DriveConfig& config);
+
+  std::vector<TraceQuery>& queries() {
+    return queries_;
+  }
+  const std::vector<TraceQuery>& queries() const {
+    return queries_;
+  }
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  std::vector<TraceQuery> queries_;
+  std::string lastError_;
+};
+
+// Latency distribution of one query type, nanoseconds
+struct LatencySummary {
+  size_t count;
+  uint64_t p50;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t max;
+  double mean;
+
+  LatencySummary() : count{0}, p50{0}, p99{0}, p999{0}, max{0}, mean{0.0} {
+  }
+};
+
+struct ReplayReport {
+  // Service time: from the start of each call to its return
+  std::array<LatencySummary, kTraceQueryTypeCount> byType;
+  LatencySummary all;
+  // Real time only, over all types: how late each call started after it
+  // was due, and due time to return (queueing plus service)
+  LatencySummary queueing;
+  LatencySummary response;
+  double wallSeconds{0.0};
+  size_t results{0};  // elements returned, keeps the work observable
+
+  const LatencySummary& operator[](TraceQueryType type) const {
+    return byType[static_cast<size_t>(type)];
+  }
+};
+
+// Issues a trace's queries against a server and times each call.
+// With realTime the original spacing is kept (scaled by 1/speedup), and the
+// wait behind slow predecessors is reported as queueing next to the
+// per-type service times rather than charged to whichever type waited;
+// otherwise queries run back to back.
+class TraceReplayer {
+ public:
+  static ReplayReport replay(const MapServer& server, const DriveTrace& trace,
+                             bool realTime = false, double speedup = 1.0);
+
+  // Runs one query; returns the number of elements it produced
+  static size_t execute(const MapServer& server, const TraceQuery& query);
+};
+
+}  // namespace hdmap
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+// Position relative to a lane centerline
+struct FrenetPoint {
+  double s;        // arc length along the centerline (m)
+  double d;        // signed lateral offset, positive to the left (m)
+  size_t segment;  // index of the closest centerline segment
+
+  FrenetPoint() : s{0.0}, d{0.0}, segment{0} {
+  }
+};
+
+// Point on a centerline with its direction of travel
+struct LanePose {
+  Point2D point;
+  double heading;  // radians, counter-clockwise from +x
+
+  LanePose() : heading{0.0} {
+  }
+};
+
+// Cumulative arc-length table over a lane centerline.
+// Only the arc length at each vertex is stored, as float when the lane
+// geometry is compact; vertices are read from the lane in whichever
+// GeometryMode it holds them. interpolate() binary searches the table.
+class ArcLengthTable {
+ public:
+  ArcLengthTable() = default;
+  // Keeps the lane alive; its centerline must not change afterwards
+  explicit ArcLengthTable(std::shared_ptr<const Lane> lane);
+
+  double length() const {
+    return vertexCount() == 0 ? 0.0 : arcLength(vertexCount() - 1);
+  }
+  size_t segmentCount() const {
+    return vertexCount() == 0 ? 0 : vertexCount() - 1;
+  }
+
+  // Closest point on the centerline expressed as (s, d)
+  FrenetPoint project(const Point2D& point) const;
+
+  // Project many points at once; results is resized to points.size()
+  void project(const std::vector<Point2D>& points,
+               std::vector<FrenetPoint>& results) const;
+
+  // Point and heading at arc length s, clamped to [0, length()]
+  LanePose interpolate(double s) const;
+
+ private:
+  std::shared_ptr<const Lane> lane_;
+  bool compact_{false};
+  // Arc length at each vertex; only the one matching the lane's mode is used
+  IndexVector<double> s_;
+  TrackedVector<float, MemoryCategory::INDICES> compactS_;
+
+  size_t vertexCount() const {
+    return compact_ ? compactS_.size() : s_.size();
+  }
+  double arcLength(size_t vertex) const {
+    return compact_ ? static_cast<double>(compactS_[vertex]) : s_[vertex];
+  }
+  Point2D vertex(size_t index) const {
+    return compact_ ? lane_->compactCenterline.at(index)
+                    : lane_->centerline[index];
+  }
+
+  // Squared distance from (px, py) to each segment, written to distances
+  void segmentDistances(double px, double py,
+                        std::vector<double>& distances) const;
+  FrenetPoint frenetOnSegment(double px, double py, size_t segment) const;
+};
+
+}  // namespace hdmap
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+// Closest pair of points between two segments
+struct SegmentClosestPoints {
+  Point2D onFirst;
+  Point2D onSecond;
+  double distance;
+
+  SegmentClosestPoints() : distance{0.0} {
+  }
+};
+
+// Distance from a point to segment [a, b]
+double pointSegmentDistance(const Point2D& point, const Point2D& a,
+                            const Point2D& b);
+
+// Closest points between segments [a0, a1] and [b0, b1]
+SegmentClosestPoints closestPoints(const Point2D& a0, const Point2D& a1,
+                                   const Point2D& b0, const Point2D& b1);
+
+// Distance from a point to a box, 0 inside
+double pointBoxDistance(const Point2D& point, const BoundingBox& box);
+
+// Distance from segment [a, b] to a box, 0 if they touch
+double segmentBoxDistance(const Point2D& a, const Point2D& b,
+                          const BoundingBox& box);
+
+// Bounding box of a polyline grown by margin on every side
+BoundingBox polylineBounds(const std::vector<Point2D>& points, double margin);
+
+// Convex polygon for region queries, tested with the separating axis
+// theorem. Edge normals and the polygon's extent along each of them are
+// cached at construction so node tests are a few dot products.
+class ConvexPolygon {
+ public:
+  ConvexPolygon() = default;
+  // Vertices of a convex polygon in either winding order
+  explicit ConvexPolygon(std::vector<Point2D> vertices);
+
+  // Field-of-view sector; fov is clamped to pi to stay convex
+  static ConvexPolygon sector(const Point2D& apex, double radius,
+                              double heading, double fov,
+                              size_t arcSegments = 8);
+
+  const std::vector<Point2D>& vertices() const {
+    return vertices_;
+  }
+  const BoundingBox& bounds() const {
+    return bounds_;
+  }
+
+  bool contains(const Point2D& point) const;
+  bool intersects(const BoundingBox& box) const;
+  bool intersectsSegment(const Point2D& a, const Point2D& b) const;
+
+ private:
+  std::vector<Point2D> vertices_;  // counter-clockwise
+  std::vector<Point2D> normals_;   // outward edge normals
+  std::vector<double> maxProjection_;  // max of vertices along each normal
+  std::vector<double> minProjection_;  // min of vertices along each normal
+  BoundingBox bounds_;
+};
+
+// Rectangle rotated by heading around its centre
+struct OrientedBox {
+  Point2D center;
+  double halfLength;  // along heading
+  double halfWidth;   // across heading
+  double heading;     // radians, counter-clockwise from +x
+
+  OrientedBox() : halfLength{0.0}, halfWidth{0.0}, heading{0.0} {
+  }
+  OrientedBox(const Point2D& center, double halfLength, double halfWidth,
+              double heading)
+      : center{center},
+        halfLength{halfLength},
+        halfWidth{halfWidth},
+        heading{heading} {
+  }
+
+  ConvexPolygon toPolygon() const;
+};
+
+}  // namespace hdmap
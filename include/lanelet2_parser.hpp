@@ -2,12 +2,24 @@
 
 #include <string>
 
+#include "load_stats.hpp"
 #include "map_server.hpp"
+#include "projection.hpp"
 #include "types.hpp"
 
 namespace hdmap {
 
-// Parser for Lanelet2 XML format
+// Node id -> map-frame position, alive only while parsing
+using NodeTable =
+    TrackedMap<uint64_t, Point2D, MemoryCategory::PARSER_SCRATCH>;
+
+// Parser for Lanelet2 XML format. Elements and scratch tables are charged
+// to the current MemoryAccount (see MemoryAccount::Scope) and the map
+// server's MemoryConstraints are checked as they grow, so an oversized map
+// fails before it is fully materialized. Only lanes, traffic lights and
+// signs overlapping the server's load region are kept; nodes are decoded
+// and held in full while parsing, so the region bounds the loaded map but
+// not the parser's scratch.
 class Lanelet2Parser {
  public:
   Lanelet2Parser() = default;
@@ -19,18 +31,30 @@ class Lanelet2Parser {
   const std::string& getLastError() const {
     return lastError_;
   }
+  // Stage timings of the last parse(), including a failed one
+  const LoadStats& getStats() const {
+    return stats_;
+  }
+  // Sample process and tracked memory after every stage of parse()
+  void setMemoryProfiling(bool enabled) {
+    profileMemory_ = enabled;
+  }
 
  private:
   std::string lastError_;
+  LoadStats stats_;
+  bool profileMemory_{false};
 
   // Helper parsing methods
-  bool parseNodes(const std::string& content,
-                  std::unordered_map<uint64_t, Point2D>& nodes);
+  bool parseNodes(const std::string& content, NodeTable& nodes,
+                  MapServer& mapServer);
   bool parseLanelets(const std::string& content,
-                     const std::unordered_map<uint64_t, Point2D>& nodes,
+                     const NodeTable& nodes,
                      MapServer& mapServer);
   bool parseRegulatoryElements(const std::string& content,
-                               MapServer& mapServer);
+                               const NodeTable& nodes, MapServer& mapServer);
+  // Current bytes and element counts against the server's constraints
+  bool withinBudget(const MapServer& mapServer);
 };
 
 }  // namespace hdmap
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "memory_profile.hpp"
+
+namespace hdmap {
+
+// Wall time of one load stage and what it processed
+struct LoadStage {
+  std::string name;
+  double seconds;
+  size_t bytes;           // input bytes the stage scanned, 0 if none
+  size_t elements;        // elements decoded, resolved or indexed
+  int64_t trackedBytes;   // change in the MemoryAccount, scratch included
+  MemorySample memory;    // at the end of the stage, if profiling memory
+
+  LoadStage() : seconds{0.0}, bytes{0}, elements{0}, trackedBytes{0} {
+  }
+};
+
+// Stages of one MapServer::loadFromFile in execution order
+struct LoadStats {
+  std::vector<LoadStage> stages;
+  size_t fileBytes{0};
+  bool profileMemory{false};
+  MemorySample baseline;  // before the first stage, if profiling memory
+
+  // Samples memory now and after every following stage. Costs a read of
+  // /proc per stage, outside the stage's timing.
+  void startMemoryProfile();
+
+  double totalSeconds() const;
+  // nullptr if the stage did not run
+  const LoadStage* find(const std::string& name) const;
+};
+
+// Times a stage from construction to stop() or destruction, whichever
+// comes first, and appends it to stats. Memory is read from
+// MemoryAccount::current() at both ends, and sampled in full at the end
+// when stats.profileMemory is set.
+class StageTimer {
+ public:
+  StageTimer(LoadStats& stats, std::string name, size_t bytes = 0);
+  ~StageTimer();
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+  void setElements(size_t elements) {
+    stage_.elements = elements;
+  }
+  void stop();
+
+ private:
+  static int64_t trackedNow();
+
+  LoadStats& stats_;
+  LoadStage stage_;
+  std::chrono::steady_clock::time_point start_;
+  bool stopped_{false};
+};
+
+}  // namespace hdmap
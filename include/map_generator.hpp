@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+// Street layout of a synthetic city
+enum class CityLayout : uint8_t { GRID, RADIAL };
+
+struct CityConfig {
+  CityLayout layout;
+  size_t laneCount;            // exact number of lanes written
+  double laneLength;           // meters between intersections
+  size_t pointsPerLane;        // centerline vertices including both ends
+  double curvature;            // max lateral bend as a fraction of laneLength
+  double trafficLightDensity;  // chance of a light at the end of a lane
+  double trafficSignDensity;   // chance of a sign at the start of a lane
+  uint64_t seed;
+
+  CityConfig()
+      : layout{CityLayout::GRID}, laneCount{1000}, laneLength{50.0},
+        pointsPerLane{5}, curvature{0.01}, trafficLightDensity{0.25},
+        trafficSignDensity{0.1}, seed{42} {
+  }
+};
+
+struct CityStats {
+  size_t nodes;
+  size_t lanes;
+  size_t trafficLights;
+  size_t trafficSigns;
+  BoundingBox bounds;
+
+  CityStats() : nodes{0}, lanes{0}, trafficLights{0}, trafficSigns{0} {
+  }
+};
+
+// Deterministic Lanelet2-style OSM writer for benchmarks and tests.
+// Streets run in both directions, one lane each way, and lanes meeting at
+// an intersection share its node so the parser derives connectivity.
+// Lights and signs are regulatory element relations with a "refers" node
+// (position) and a "lanelet" way (controlled lane). Coordinates are metric
+// and meant for ProjectionType::NONE. The same config always produces the
+// same bytes; output is streamed in three passes, so memory does not grow
+// with the map.
+class CityGenerator {
+ public:
+  explicit CityGenerator(const CityConfig& config);
+
+  bool writeOsm(const std::string& filepath);
+
+  // Counts and bounds of the last written map
+  const CityStats& stats() const {
+    return stats_;
+  }
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  CityConfig config_;
+  CityStats stats_;
+  std::string lastError_;
+};
+
+}  // namespace hdmap
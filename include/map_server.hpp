@@ -1,12 +1,23 @@
 #ifndef MAP_SERVER_HPP
 #define MAP_SERVER_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
 
+#include "contraction_hierarchy.hpp"
+#include "frenet.hpp"
+#include "geometry.hpp"
+#include "load_stats.hpp"
+#include "point_index.hpp"
+#include "projection.hpp"
+#include "query_cache.hpp"
+#include "query_metrics.hpp"
+#include "routing_graph.hpp"
 #include "rtree.hpp"
 #include "types.hpp"
 
@@ -18,6 +29,11 @@ namespace hdmap {
 // modern cpp review
 // Docker Environment setup
 
+// Search radii of getClosestLane: the first, then the second if nothing
+// is that close
+constexpr double kClosestLaneRadius = 50.0;      // meters
+constexpr double kClosestLaneMaxRadius = 200.0;  // meters
+
 struct MemoryConstraints {
   size_t maxTotalMemory;  // bytes
   size_t maxLanes;
@@ -37,14 +53,32 @@ struct MemoryConstraints {
     return {128 * 1024 * 1024,  // 128 MB
             20000, 10000, 10000};
   }
+
+  bool operator==(const MemoryConstraints& other) const {
+    return maxTotalMemory == other.maxTotalMemory &&
+           maxLanes == other.maxLanes &&
+           maxTrafficLights == other.maxTrafficLights &&
+           maxTrafficSigns == other.maxTrafficSigns;
+  }
+  bool operator!=(const MemoryConstraints& other) const {
+    return !(*this == other);
+  }
 };
 
-// Main HD Map Server API
+// Main HD Map Server API. Instances are independent: each owns its map,
+// indices, memory account and constraints, so a fresh map can be loaded
+// next to the one being served and swapped in afterwards.
 class MapServer {
  public:
+  explicit MapServer(const MemoryConstraints& constraints =
+                         MemoryConstraints::defaultConstraints());
+
+  // Optional process-wide instance, created on first use. Constraints only
+  // take effect on that first call; a later call asking for different ones
+  // gets the existing instance and a warning.
+  static std::shared_ptr<MapServer> getInstance();
   static std::shared_ptr<MapServer> getInstance(
-      const MemoryConstraints& constraints =
-          MemoryConstraints::defaultConstraints());
+      const MemoryConstraints& constraints);
 
   ~MapServer();
 
@@ -57,10 +91,77 @@ class MapServer {
   // Load map from file
   bool loadFromFile(std::string filepath);
 
+  // Select how lane geometry is stored; applied on the next load.
+  // COMPACT_FLOAT keeps centerlines as float offsets from per-tile origins,
+  // Lane::centerlinePoints() converts back to doubles at the boundary.
+  void setGeometryMode(GeometryMode mode, double tileSize = kDefaultTileSize);
+  GeometryMode getGeometryMode() const {
+    return geometryMode_;
+  }
+
+  // Select the index used for traffic lights and signs; rebuilds them
+  // immediately
+  void setPointIndexType(PointIndexType type);
+  PointIndexType getPointIndexType() const {
+    return trafficLightIndex_.type();
+  }
+
+  // Select the lon/lat -> local metric projection; applied on the next load.
+  // With ProjectionType::NONE coordinates stay in raw degrees.
+  void setProjection(const ProjectionConfig& config);
+  const Projector& getProjector() const {
+    return projector_;
+  }
+  Projector& getProjectorMutable() {
+    return projector_;
+  }
+
+  // Only materialize lanes, traffic lights and signs overlapping region
+  // (map frame, i.e. after projection) on the next load; std::nullopt loads
+  // everything. Every node of the file is still decoded, so parser scratch
+  // does not shrink with the region.
+  void setLoadRegion(std::optional<BoundingBox> region) {
+    loadRegion_ = region;
+  }
+  const std::optional<BoundingBox>& getLoadRegion() const {
+    return loadRegion_;
+  }
+
+  // Stage timings of the last loadFromFile, including a failed one
+  const LoadStats& getLastLoadStats() const {
+    return lastLoadStats_;
+  }
+  // Record RSS/PSS, allocator and per-category memory after every load
+  // stage (LoadStage::memory); applied on the next load
+  void setMemoryProfiling(bool enabled) {
+    memoryProfiling_ = enabled;
+  }
+
+  // Enforced while parsing and again once indices are built
+  const MemoryConstraints& getConstraints() const {
+    return constraints_;
+  }
+
+  // Convert a map-frame point back to Point2D{lon, lat}
+  Point2D toGeodetic(const Point2D& local) const {
+    return projector_.inverse(local);
+  }
+
   // Query API - main interface for autonomous driving
   QueryResult queryRegion(const BoundingBox& region) const;
   QueryResult queryRadius(const Point2D& center, double radius) const;
 
+  // Elements within halfWidth of a path, found in one traversal per index.
+  // Each result list is ordered by arc length of closest approach along the
+  // path.
+  QueryResult queryCorridor(const std::vector<Point2D>& polyline,
+                            double halfWidth) const;
+
+  // Region queries beyond axis-aligned boxes, e.g. a sensor field of view.
+  // R-tree nodes are pruned with SAT and elements are tested exactly.
+  QueryResult queryPolygon(const ConvexPolygon& polygon) const;
+  QueryResult queryOrientedBox(const OrientedBox& box) const;
+
   std::optional<std::shared_ptr<Lane>> getLaneById(uint64_t laneId) const;
   std::optional<std::shared_ptr<TrafficLight>> getTrafficLightById(
       uint64_t id) const;
@@ -75,6 +176,39 @@ class MapServer {
   std::optional<std::shared_ptr<Lane>> getClosestLane(
       const Point2D& position) const;
 
+  // Optional per-thread LRU for getNearbyLanes/getClosestLane. Positions
+  // are quantized to cellSize (map units); each entry holds the lane
+  // candidates for a whole cell, so results stay exact. Each server has its
+  // own cache on every thread; entries from an older map generation are
+  // purged on the thread's next lookup, and a destroyed server's caches
+  // once the thread caches for another server. Configure before querying
+  // from multiple threads.
+  void enableQueryCache(double cellSize = kDefaultQueryCacheCellSize,
+                        size_t capacity = kDefaultQueryCacheCapacity);
+  void disableQueryCache();
+  bool isQueryCacheEnabled() const {
+    return queryCacheCapacity_ > 0;
+  }
+  // Counters of the calling thread's cache
+  QueryCacheStats getQueryCacheStats() const;
+  void resetQueryCacheStats() const;
+
+  // Per-API call counts, latency and result size histograms and R-tree
+  // nodes visited, summed over all threads. Only recorded when built with
+  // HDMAP_ENABLE_METRICS; otherwise the snapshot is empty. Nested calls
+  // (e.g. getClosestLane -> getNearbyLanes) are recorded at each level.
+  MetricsSnapshot getQueryMetrics() const {
+    return queryMetrics_.snapshot();
+  }
+  void resetQueryMetrics() {
+    queryMetrics_.reset();
+  }
+
+  // Changes whenever the loaded map does (load, clear)
+  uint64_t getGeneration() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
   // Get traffic lights controlling a specific lane
   std::vector<std::shared_ptr<TrafficLight>> getTrafficLightsForLane(
       uint64_t laneId) const;
@@ -83,6 +217,34 @@ class MapServer {
   std::vector<std::shared_ptr<TrafficSign>> getTrafficSignsForLane(
       uint64_t laneId) const;
 
+  // Frenet frame services over per-lane arc-length tables built at load
+  std::optional<FrenetPoint> project(uint64_t laneId,
+                                     const Point2D& point) const;
+  std::optional<LanePose> interpolate(uint64_t laneId, double s) const;
+  // Batched projection onto one lane; false if the lane does not exist
+  bool projectBatch(uint64_t laneId, const std::vector<Point2D>& points,
+                    std::vector<FrenetPoint>& results) const;
+  std::optional<double> getLaneLength(uint64_t laneId) const;
+
+  // Fastest lane sequence between two lanes. Uses the contraction
+  // hierarchy when one is available, A* over the routing graph otherwise.
+  std::optional<Route> route(uint64_t fromLaneId, uint64_t toLaneId) const;
+  const RoutingGraph& getRoutingGraph() const {
+    return routingGraph_;
+  }
+
+  // Optional routing preprocessing. loadFromFile picks up a hierarchy saved
+  // next to the map (<map>.ch) if it matches the loaded lane graph.
+  void buildRoutingHierarchy();
+  bool saveRoutingHierarchy(const std::string& filepath) const;
+  bool loadRoutingHierarchy(const std::string& filepath);
+  bool hasRoutingHierarchy() const {
+    return !routingHierarchy_.empty();
+  }
+  static std::string routingHierarchyPathFor(const std::string& mapPath) {
+    return mapPath + ".ch";
+  }
+
   // Statistics and memory usage
   size_t getLaneCount() const {
     return lanes_.size();
@@ -93,28 +255,37 @@ class MapServer {
   size_t getTrafficSignCount() const {
     return trafficSigns_.size();
   }
-  size_t getMemoryUsage() const;
-  const std::unordered_map<uint64_t, std::shared_ptr<Lane>>& getLanes() const {
+  // Bytes this server allocated that are still alive, counted by its
+  // containers' allocators. Elements callers still hold from an earlier
+  // load count until they are released.
+  size_t getMemoryUsage() const {
+    return memoryAccount_->breakdown().total();
+  }
+  MemoryBreakdown getMemoryBreakdown() const {
+    return memoryAccount_->breakdown();
+  }
+  // Account to charge when building elements for this server, e.g. with
+  // MemoryAccount::Scope and makeTracked
+  MemoryAccount* getMemoryAccount() const {
+    return memoryAccount_.get();
+  }
+  const LaneMap& getLanes() const {
     return lanes_;
   }
-  const std::unordered_map<uint64_t, std::shared_ptr<TrafficLight>>&
-  getTrafficLights() const {
+  const TrafficLightMap& getTrafficLights() const {
     return trafficLights_;
   }
-  const std::unordered_map<uint64_t, std::shared_ptr<TrafficSign>>&
-  getTrafficSigns() const {
+  const TrafficSignMap& getTrafficSigns() const {
     return trafficSigns_;
   }
 
-  std::unordered_map<uint64_t, std::shared_ptr<Lane>>& getLanesMutable() {
+  LaneMap& getLanesMutable() {
     return lanes_;
   }
-  std::unordered_map<uint64_t, std::shared_ptr<TrafficLight>>&
-  getTrafficLightsMutable() {
+  TrafficLightMap& getTrafficLightsMutable() {
     return trafficLights_;
   }
-  std::unordered_map<uint64_t, std::shared_ptr<TrafficSign>>&
-  getTrafficSignsMutable() {
+  TrafficSignMap& getTrafficSignsMutable() {
     return trafficSigns_;
   }
 
@@ -122,27 +293,57 @@ class MapServer {
   void clear();
 
  private:
-  explicit MapServer(const MemoryConstraints& constraints =
-                         MemoryConstraints::defaultConstraints());
-
   static std::shared_ptr<MapServer> instance;
   static std::mutex mutex_lock;
 
   // Helper methods
   bool checkMemoryConstraints() const;
+  // Replaces all storage with empty containers bound to memoryAccount_
+  void resetStorage();
   void buildSpatialIndices();
+  void bumpGeneration();
+  // The calling thread's cache for this server, purged of older maps
+  QueryCache& threadQueryCache() const;
+  const QueryCache::Candidates& cachedLaneCandidates(const Point2D& position,
+                                                    double radius,
+                                                    CachedQuery query) const;
 
   MemoryConstraints constraints_;
+  MemoryAccountHandle memoryAccount_;
+  GeometryMode geometryMode_{GeometryMode::DOUBLE};
+  double tileSize_{kDefaultTileSize};
+  Projector projector_;
+  std::optional<BoundingBox> loadRegion_;
+  LoadStats lastLoadStats_;
+  bool memoryProfiling_{false};
 
   // Map data storage
-  std::unordered_map<uint64_t, std::shared_ptr<Lane>> lanes_;
-  std::unordered_map<uint64_t, std::shared_ptr<TrafficLight>> trafficLights_;
-  std::unordered_map<uint64_t, std::shared_ptr<TrafficSign>> trafficSigns_;
+  LaneMap lanes_;
+  TrafficLightMap trafficLights_;
+  TrafficSignMap trafficSigns_;
 
   // Spatial indices for fast queries
   RTree laneIndex_;
-  RTree trafficLightIndex_;
-  RTree trafficSignIndex_;
+  PointIndex<TrafficLight> trafficLightIndex_;
+  PointIndex<TrafficSign> trafficSignIndex_;
+
+  // Arc-length tables for Frenet queries, keyed by lane id
+  TrackedMap<uint64_t, ArcLengthTable, MemoryCategory::INDICES>
+      arcLengthTables_;
+
+  // Lane connectivity for routing
+  RoutingGraph routingGraph_;
+  ContractionHierarchy routingHierarchy_;
+
+  // Query cache configuration; the caches themselves are thread_local,
+  // keyed by serverId_ and dropped once queryCacheOwner_ expires
+  double queryCacheCellSize_{kDefaultQueryCacheCellSize};
+  size_t queryCacheCapacity_{0};
+  uint64_t serverId_;
+  std::shared_ptr<const bool> queryCacheOwner_;
+  std::atomic<uint64_t> generation_{0};
+
+  mutable QueryMetrics queryMetrics_;
 };
 
 }  // namespace hdmap
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+// What an allocation is for. Categories are a property of the container
+// type, so every container of a kind is charged the same way.
+enum class MemoryCategory : uint8_t {
+  LANES,
+  TRAFFIC_ELEMENTS,
+  GEOMETRY,
+  INDICES,
+  PARSER_SCRATCH
+};
+
+constexpr size_t kMemoryCategoryCount = 5;
+
+// Bytes currently allocated per category
+struct MemoryBreakdown {
+  size_t lanes;             // lane objects, control blocks, lane map, id lists
+  size_t trafficElements;   // traffic light and sign objects and their maps
+  size_t geometry;          // centerlines and boundaries
+  size_t indices;           // spatial indices, routing graphs, Frenet tables
+  size_t parserScratch;     // parser temporaries still alive
+  size_t parserScratchPeak; // high-water mark of the last load
+
+  MemoryBreakdown()
+      : lanes{0}, trafficElements{0}, geometry{0}, indices{0},
+        parserScratch{0}, parserScratchPeak{0} {
+  }
+
+  // Steady-state footprint; parser scratch is transient
+  size_t total() const {
+    return lanes + trafficElements + geometry + indices;
+  }
+};
+
+class MemoryAccount;
+
+struct ReleaseMemoryAccount {
+  void operator()(MemoryAccount* account) const;
+};
+
+// Owning handle to a pooled account, see MemoryAccount::acquire()
+using MemoryAccountHandle =
+    std::unique_ptr<MemoryAccount, ReleaseMemoryAccount>;
+
+// Byte counters fed by TrackingAllocator. Shared by every container of one
+// MapServer; counters are atomic so elements may be released on any thread.
+// Allocators hold a plain pointer, so an account must outlive everything
+// charged to it: maps take theirs from acquire(), whose accounts are never
+// freed.
+class MemoryAccount {
+ public:
+  MemoryAccount();
+
+  // An idle account from the process-wide pool. After the handle is
+  // released the account is reused only once everything charged to it,
+  // e.g. elements a caller kept from an unloaded map, has been freed.
+  static MemoryAccountHandle acquire();
+
+  void allocate(MemoryCategory category, size_t bytes);
+  void deallocate(MemoryCategory category, size_t bytes);
+
+  size_t used(MemoryCategory category) const {
+    return bytes_[index(category)].load(std::memory_order_relaxed);
+  }
+  size_t peak(MemoryCategory category) const {
+    return peaks_[index(category)].load(std::memory_order_relaxed);
+  }
+  void resetPeak(MemoryCategory category);
+
+  // Current usage per category, parser scratch with its peak
+  MemoryBreakdown breakdown() const;
+
+  // The account of the innermost Scope on this thread, null outside any
+  static MemoryAccount* current();
+  // Charged by tracking containers default-constructed outside any Scope,
+  // e.g. standalone indices and elements decoded by a QueryClient, so no
+  // allocation goes uncounted
+  static MemoryAccount& unscoped();
+
+  // Makes an account current on this thread while alive
+  class Scope {
+   public:
+    explicit Scope(MemoryAccount* account);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    MemoryAccount* previous_;
+  };
+
+ private:
+  static size_t index(MemoryCategory category) {
+    return static_cast<size_t>(category);
+  }
+
+  std::array<std::atomic<size_t>, kMemoryCategoryCount> bytes_;
+  std::array<std::atomic<size_t>, kMemoryCategoryCount> peaks_;
+};
+
+// Charges bytes held outside tracked containers, e.g. a raw file buffer,
+// for as long as it is alive. A null account makes it a no-op.
+class MemoryCharge {
+ public:
+  MemoryCharge(MemoryAccount* account, MemoryCategory category, size_t bytes);
+  ~MemoryCharge();
+
+  MemoryCharge(const MemoryCharge&) = delete;
+  MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+ private:
+  MemoryAccount* account_;
+  MemoryCategory category_;
+  size_t bytes_;
+};
+
+// Stateful allocator charging a MemoryAccount. A default-constructed one
+// binds to MemoryAccount::current(), or unscoped() outside any Scope, so
+// containers nested in elements built inside a Scope are counted without
+// threading the account through every constructor.
+template <typename T, MemoryCategory Category>
+class TrackingAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = TrackingAllocator<U, Category>;
+  };
+
+  TrackingAllocator() : account_{MemoryAccount::current()} {
+    if (account_ == nullptr) {
+      account_ = &MemoryAccount::unscoped();
+    }
+  }
+  explicit TrackingAllocator(MemoryAccount* account) : account_{account} {
+    assert(account_ != nullptr);
+  }
+  template <typename U>
+  TrackingAllocator(const TrackingAllocator<U, Category>& other)
+      : account_{other.account()} {
+  }
+
+  T* allocate(size_t count) {
+    const size_t bytes{count * sizeof(T)};
+    T* result{static_cast<T*>(::operator new(bytes))};
+    account_->allocate(Category, bytes);
+    return result;
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    account_->deallocate(Category, count * sizeof(T));
+    ::operator delete(pointer);
+  }
+
+  MemoryAccount* account() const {
+    return account_;
+  }
+
+  template <typename U>
+  bool operator==(const TrackingAllocator<U, Category>& other) const {
+    return account_ == other.account();
+  }
+  template <typename U>
+  bool operator!=(const TrackingAllocator<U, Category>& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  MemoryAccount* account_;
+};
+
+template <typename T, MemoryCategory Category>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Category>>;
+
+template <typename Key, typename Value, MemoryCategory Category>
+using TrackedMap = std::unordered_map<
+    Key, Value, std::hash<Key>, std::equal_to<Key>,
+    TrackingAllocator<std::pair<const Key, Value>, Category>>;
+
+template <typename T>
+using IndexVector = TrackedVector<T, MemoryCategory::INDICES>;
+
+// Element and control block in one counted allocation
+template <typename T, MemoryCategory Category = MemoryCategory::LANES,
+          typename... Args>
+std::shared_ptr<T> makeTracked(Args&&... args) {
+  return std::allocate_shared<T>(TrackingAllocator<T, Category>{},
+                                 std::forward<Args>(args)...);
+}
+
+}  // namespace hdmap
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include "memory_account.hpp"
+
+namespace hdmap {
+
+// Memory of this process as the kernel sees it, in bytes. Read from
+// /proc/self/smaps_rollup, or /proc/self/status on kernels before 4.14,
+// which have no PSS.
+struct ProcessMemory {
+  size_t rss{0};
+  size_t pss{0};        // resident pages divided among their sharers
+  size_t anonymous{0};  // heap, stacks and other private mappings
+  size_t swap{0};
+  bool available{false};  // false outside Linux
+
+  static ProcessMemory read();
+};
+
+// What malloc holds, in bytes; glibc only
+struct AllocatorStats {
+  size_t inUse{0};    // handed out to the program, mmapped blocks included
+  size_t free{0};     // kept in the arenas for reuse
+  size_t mmapped{0};  // large blocks served by mmap
+  bool available{false};
+
+  static AllocatorStats read();
+};
+
+// Process, allocator and per-category tracked memory at one point in time
+struct MemorySample {
+  ProcessMemory process;
+  AllocatorStats allocator;
+  MemoryBreakdown tracked;  // zero without an account
+
+  // Reads all three; account may be null
+  static MemorySample take(const MemoryAccount* account);
+};
+
+}  // namespace hdmap
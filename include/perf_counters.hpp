@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace hdmap {
+
+// Counters read through Linux perf_event_open
+enum class PerfEvent : uint8_t {
+  CYCLES,
+  INSTRUCTIONS,
+  L1D_MISSES,     // L1 data cache read misses
+  LLC_MISSES,     // last-level cache misses
+  BRANCH_MISSES,
+  PAGE_FAULTS,    // software event, available without a PMU
+};
+constexpr size_t kPerfEventCount = 6;
+
+const char* perfEventName(PerfEvent event);
+
+// Counts accumulated while the counters were running
+struct PerfSample {
+  std::array<uint64_t, kPerfEventCount> values{};
+  std::array<bool, kPerfEventCount> valid{};
+
+  uint64_t operator[](PerfEvent event) const {
+    return values[static_cast<size_t>(event)];
+  }
+  bool has(PerfEvent event) const {
+    return valid[static_cast<size_t>(event)];
+  }
+};
+
+// User-space hardware and software counters of the calling thread. Events
+// the kernel or CPU does not offer (VMs often have no PMU, and
+// perf_event_paranoid may forbid them) are left out rather than failing,
+// so available() may be false. When more events are requested than the
+// PMU has slots, the kernel multiplexes them and counts are scaled by the
+// fraction of time each ran. Everything is a no-op outside Linux.
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // At least one event opened
+  bool available() const;
+  // Why the first unavailable event could not be opened
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+  void start();
+  void stop();
+  // Zeroes the counts; keeps them running or stopped
+  void reset();
+  PerfSample read() const;
+
+ private:
+  std::array<int, kPerfEventCount> fds_;
+  std::string lastError_;
+};
+
+}  // namespace hdmap
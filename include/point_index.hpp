@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "rtree.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// Backing structure for point elements (traffic lights, signs)
+enum class PointIndexType : uint8_t { RTREE, GRID };
+
+// Target average occupancy of a grid cell
+constexpr double kPointsPerGridCell = 2.0;
+
+// Spatial index for elements with a single `position`. GRID buckets points
+// into a uniform grid stored in CSR form (one offset per cell, positions and
+// elements sorted by cell), so there are no splits, no variant payloads and
+// a query only touches the cells it overlaps. RTREE keeps the general index
+// for comparison.
+template <typename Element>
+class PointIndex {
+ public:
+  using Pointer = std::shared_ptr<Element>;
+  using ElementMap =
+      TrackedMap<uint64_t, Pointer, MemoryCategory::TRAFFIC_ELEMENTS>;
+
+  explicit PointIndex(PointIndexType type = PointIndexType::GRID)
+      : type_{type} {
+  }
+
+  PointIndexType type() const {
+    return type_;
+  }
+  // Switching type drops the current contents; call build() again
+  void setType(PointIndexType type) {
+    clear();
+    type_ = type;
+  }
+
+  void build(const ElementMap& elements) {
+    clear();
+    if (type_ == PointIndexType::RTREE) {
+      for (const auto& [id, element] : elements) {
+        rtree_.insert(BoundingBox{element->position, element->position},
+                      element);
+      }
+      return;
+    }
+    buildGrid(elements);
+  }
+
+  void clear() {
+    rtree_.clear();
+    cellOffsets_.clear();
+    positions_.clear();
+    elements_.clear();
+    cellsX_ = 0;
+    cellsY_ = 0;
+  }
+
+  size_t size() const {
+    return type_ == PointIndexType::RTREE ? rtree_.size() : elements_.size();
+  }
+
+  // Elements inside the box (inclusive)
+  void query(const BoundingBox& bbox, std::vector<Pointer>& results) const {
+    if (type_ == PointIndexType::RTREE) {
+      std::vector<Data> found;
+      rtree_.query(bbox, found);
+      appendRTreeResults(found, results);
+      return;
+    }
+    forEachCell(bbox, [&](size_t cell) {
+      for (uint32_t i = cellOffsets_[cell]; i < cellOffsets_[cell + 1]; ++i) {
+        if (bbox.contains(positions_[i])) {
+          results.push_back(elements_[i]);
+        }
+      }
+    });
+  }
+
+  // Elements within radius of center. The grid tests the circle exactly;
+  // the R-tree returns its box candidates.
+  void queryRadius(const Point2D& center, double radius,
+                   std::vector<Pointer>& results) const {
+    if (type_ == PointIndexType::RTREE) {
+      std::vector<Data> found;
+      rtree_.queryRadius(center, radius, found);
+      appendRTreeResults(found, results);
+      return;
+    }
+    const BoundingBox bbox{Point2D(center.x - radius, center.y - radius),
+                           Point2D(center.x + radius, center.y + radius)};
+    const double radiusSquared{radius * radius};
+    forEachCell(bbox, [&](size_t cell) {
+      for (uint32_t i = cellOffsets_[cell]; i < cellOffsets_[cell + 1]; ++i) {
+        const double dx{positions_[i].x - center.x};
+        const double dy{positions_[i].y - center.y};
+        if (dx * dx + dy * dy <= radiusSquared) {
+          results.push_back(elements_[i]);
+        }
+      }
+    });
+  }
+
+  // Same contract as RTree::queryIf: accept(bbox) must hold for any box
+  // containing a match, and every match must lie inside bounds. The grid
+  // only visits the cells bounds overlaps and tests them before their
+  // points.
+  template <typename Predicate>
+  void queryIf(const BoundingBox& bounds, const Predicate& accept,
+               std::vector<Pointer>& results) const {
+    if (type_ == PointIndexType::RTREE) {
+      std::vector<Data> found;
+      rtree_.queryIf(accept, found);
+      appendRTreeResults(found, results);
+      return;
+    }
+    forEachCell(bounds, [&](size_t cell) {
+      if (cellOffsets_[cell] == cellOffsets_[cell + 1] ||
+          !accept(cellBox(cell % cellsX_, cell / cellsX_))) {
+        return;
+      }
+      for (uint32_t i = cellOffsets_[cell]; i < cellOffsets_[cell + 1]; ++i) {
+        if (accept(BoundingBox{positions_[i], positions_[i]})) {
+          results.push_back(elements_[i]);
+        }
+      }
+    });
+  }
+
+ private:
+  void buildGrid(const ElementMap& elements) {
+    if (elements.empty()) {
+      return;
+    }
+
+    bounds_ = BoundingBox{elements.begin()->second->position,
+                          elements.begin()->second->position};
+    for (const auto& [id, element] : elements) {
+      const Point2D& p{element->position};
+      bounds_.min = Point2D(std::min(bounds_.min.x, p.x),
+                            std::min(bounds_.min.y, p.y));
+      bounds_.max = Point2D(std::max(bounds_.max.x, p.x),
+                            std::max(bounds_.max.y, p.y));
+    }
+
+    // Square cells sized for kPointsPerGridCell on average; the second term
+    // keeps long thin extents from exploding the cell count
+    const double width{bounds_.max.x - bounds_.min.x};
+    const double height{bounds_.max.y - bounds_.min.y};
+    const double targetCells{std::max(
+        1.0, static_cast<double>(elements.size()) / kPointsPerGridCell)};
+    cellSize_ = std::max(std::sqrt(width * height / targetCells),
+                         std::max(width, height) / targetCells);
+    if (!(cellSize_ > 0.0)) {
+      cellSize_ = 1.0;
+    }
+    cellsX_ = static_cast<size_t>(width / cellSize_) + 1;
+    cellsY_ = static_cast<size_t>(height / cellSize_) + 1;
+
+    // Counting sort by cell
+    std::vector<uint32_t> cells;
+    cells.reserve(elements.size());
+    cellOffsets_.assign(cellsX_ * cellsY_ + 1, 0);
+    for (const auto& [id, element] : elements) {
+      const size_t cell{cellIndex(element->position)};
+      cells.push_back(static_cast<uint32_t>(cell));
+      cellOffsets_[cell + 1]++;
+    }
+    for (size_t i = 1; i < cellOffsets_.size(); ++i) {
+      cellOffsets_[i] += cellOffsets_[i - 1];
+    }
+
+    positions_.resize(elements.size());
+    elements_.resize(elements.size());
+    std::vector<uint32_t> next(cellOffsets_.begin(), cellOffsets_.end() - 1);
+    size_t i = 0;
+    for (const auto& [id, element] : elements) {
+      const uint32_t slot{next[cells[i++]]++};
+      positions_[slot] = element->position;
+      elements_[slot] = element;
+    }
+  }
+
+  size_t clampCell(double offset, size_t cells) const {
+    if (!(offset > 0.0)) {
+      return 0;
+    }
+    return static_cast<size_t>(
+        std::min(offset / cellSize_, static_cast<double>(cells - 1)));
+  }
+
+  size_t cellIndex(const Point2D& p) const {
+    return clampCell(p.y - bounds_.min.y, cellsY_) * cellsX_ +
+           clampCell(p.x - bounds_.min.x, cellsX_);
+  }
+
+  BoundingBox cellBox(size_t cx, size_t cy) const {
+    const Point2D min{bounds_.min.x + cx * cellSize_,
+                      bounds_.min.y + cy * cellSize_};
+    return BoundingBox{min, Point2D(min.x + cellSize_, min.y + cellSize_)};
+  }
+
+  template <typename Visitor>
+  void forEachCell(const BoundingBox& bbox, const Visitor& visit) const {
+    if (elements_.empty() || !bbox.intersects(bounds_)) {
+      return;
+    }
+    const size_t x0{clampCell(bbox.min.x - bounds_.min.x, cellsX_)};
+    const size_t x1{clampCell(bbox.max.x - bounds_.min.x, cellsX_)};
+    const size_t y0{clampCell(bbox.min.y - bounds_.min.y, cellsY_)};
+    const size_t y1{clampCell(bbox.max.y - bounds_.min.y, cellsY_)};
+    for (size_t cy = y0; cy <= y1; ++cy) {
+      for (size_t cx = x0; cx <= x1; ++cx) {
+        visit(cy * cellsX_ + cx);
+      }
+    }
+  }
+
+  static void appendRTreeResults(const std::vector<Data>& found,
+                                 std::vector<Pointer>& results) {
+    results.reserve(results.size() + found.size());
+    for (const auto& object : found) {
+      results.push_back(std::get<Pointer>(object));
+    }
+  }
+
+  PointIndexType type_;
+  RTree rtree_;
+
+  BoundingBox bounds_;
+  double cellSize_{1.0};
+  size_t cellsX_{0};
+  size_t cellsY_{0};
+  IndexVector<uint32_t> cellOffsets_;  // cellsX_ * cellsY_ + 1 entries
+  IndexVector<Point2D> positions_;     // sorted by cell
+  IndexVector<Pointer> elements_;      // parallel to positions_
+};
+
+}  // namespace hdmap
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+// Projection applied to node coordinates while loading a map
+enum class ProjectionType : uint8_t {
+  NONE,                 // keep raw lon/lat degrees
+  LOCAL_TANGENT_PLANE,  // metres east/north of an origin
+  UTM                   // metres easting/northing in a UTM zone
+};
+
+struct ProjectionConfig {
+  ProjectionType type;
+  double originLat;  // degrees
+  double originLon;  // degrees
+  bool autoOrigin;   // use the centre of the parsed nodes as origin
+  // 1..60 north of the equator, -1..-60 south of it; 0 derives zone and
+  // hemisphere from the origin
+  int utmZone;
+
+  static ProjectionConfig none() {
+    return {ProjectionType::NONE, 0.0, 0.0, false, 0};
+  }
+
+  static ProjectionConfig localTangentPlane(double originLat,
+                                            double originLon) {
+    return {ProjectionType::LOCAL_TANGENT_PLANE, originLat, originLon, false,
+            0};
+  }
+
+  static ProjectionConfig localTangentPlaneAutoOrigin() {
+    return {ProjectionType::LOCAL_TANGENT_PLANE, 0.0, 0.0, true, 0};
+  }
+
+  // zone 0 derives zone and hemisphere from the parsed nodes; a negative
+  // zone is in the southern hemisphere (-56 is zone 56S)
+  static ProjectionConfig utm(int zone = 0) {
+    return {ProjectionType::UTM, 0.0, 0.0, zone == 0, zone};
+  }
+};
+
+// Converts between geodetic lon/lat (Point2D{lon, lat}) and a local metric
+// frame. Bulk transforms run once at load time so queries never do trig.
+class Projector {
+ public:
+  explicit Projector(
+      const ProjectionConfig& config = ProjectionConfig::none());
+
+  const ProjectionConfig& config() const {
+    return config_;
+  }
+
+  // Re-anchor the projection (also fixes the UTM zone when it is derived)
+  void setOrigin(double lat, double lon);
+
+  // In-place bulk transform: xs/ys hold lon/lat on input, x/y on output
+  void forward(std::vector<double>& xs, std::vector<double>& ys) const;
+  void forward(double* xs, double* ys, size_t count) const;
+  Point2D forward(const Point2D& lonLat) const;
+
+  // Local frame back to Point2D{lon, lat}
+  Point2D inverse(const Point2D& local) const;
+  void inverse(std::vector<Point2D>& points) const;
+
+ private:
+  ProjectionConfig config_;
+
+  // Local tangent plane scale factors at the origin
+  double metersPerDegreeLon_{1.0};
+  double metersPerDegreeLat_{1.0};
+
+  // UTM zone parameters
+  bool deriveUtmZone_;
+  double centralMeridian_{0.0};  // degrees
+  double falseNorthing_{0.0};
+
+  Point2D utmForward(double lat, double lon) const;
+  Point2D utmInverse(double easting, double northing) const;
+};
+
+// Zone containing a longitude
+int utmZoneFor(double lon);
+
+}  // namespace hdmap
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+constexpr double kDefaultQueryCacheCellSize = 1.0;  // map units
+constexpr size_t kDefaultQueryCacheCapacity = 64;
+
+// Which query a cached candidate set belongs to
+enum class CachedQuery : uint8_t { NEARBY_LANES, CLOSEST_LANE };
+
+// Quantized query position. The generation is unique per loaded map state
+// across all MapServer instances, so stale entries can never match.
+struct QueryCacheKey {
+  uint64_t generation;
+  int64_t cellX;
+  int64_t cellY;
+  uint32_t radiusBucket;
+  CachedQuery query;
+
+  bool operator==(const QueryCacheKey& other) const {
+    return generation == other.generation && cellX == other.cellX &&
+           cellY == other.cellY && radiusBucket == other.radiusBucket &&
+           query == other.query;
+  }
+};
+
+struct QueryCacheKeyHash {
+  size_t operator()(const QueryCacheKey& key) const;
+};
+
+struct QueryCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+
+  QueryCacheStats() : hits{0}, misses{0} {
+  }
+
+  double hitRate() const {
+    const uint64_t total{hits + misses};
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+  }
+};
+
+// Small LRU of lane candidate sets keyed by grid cell. Not thread-safe:
+// MapServer keeps one per server and thread so lookups never contend.
+class QueryCache {
+ public:
+  using Candidates = std::vector<std::shared_ptr<Lane>>;
+
+  explicit QueryCache(size_t capacity = 0) : capacity_{capacity} {
+  }
+
+  // Returns nullptr on a miss; a hit becomes most recently used
+  const Candidates* find(const QueryCacheKey& key);
+  const Candidates& insert(const QueryCacheKey& key, Candidates candidates);
+
+  void setCapacity(size_t capacity);
+  size_t capacity() const {
+    return capacity_;
+  }
+  size_t size() const {
+    return index_.size();
+  }
+  void clear();
+
+  QueryCacheStats& stats() {
+    return stats_;
+  }
+
+ private:
+  using Entry = std::pair<QueryCacheKey, Candidates>;
+
+  size_t capacity_;
+  std::list<Entry> entries_;  // front is most recently used
+  std::unordered_map<QueryCacheKey, std::list<Entry>::iterator,
+                     QueryCacheKeyHash>
+      index_;
+  QueryCacheStats stats_;
+};
+
+}  // namespace hdmap
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "query_protocol.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// Client of a QueryDaemon. One connection, not thread-safe; use one client
+// per thread. A transport error disconnects the client and is reported by
+// getLastError(); the single-query calls then return std::nullopt just as
+// for an element that does not exist, so check isConnected() to tell them
+// apart.
+class QueryClient {
+ public:
+  QueryClient() = default;
+  ~QueryClient();
+
+  QueryClient(const QueryClient&) = delete;
+  QueryClient& operator=(const QueryClient&) = delete;
+
+  bool connect(const std::string& socketPath);
+  void disconnect();
+  bool isConnected() const {
+    return fd_ >= 0;
+  }
+
+  // Pipelines the requests, a window at a time, and returns one reply per
+  // request in order. False on a transport error.
+  bool execute(const std::vector<QueryRequest>& requests,
+               std::vector<QueryReply>& replies);
+
+  // One round trip each
+  std::optional<QueryIds> queryRegion(const BoundingBox& region);
+  std::optional<QueryIds> queryRadius(const Point2D& center, double radius);
+  std::optional<uint64_t> getClosestLane(const Point2D& position);
+  std::optional<std::shared_ptr<Lane>> getLaneById(uint64_t laneId);
+  std::optional<std::shared_ptr<TrafficLight>> getTrafficLightById(
+      uint64_t lightId);
+  std::optional<std::shared_ptr<TrafficSign>> getTrafficSignById(
+      uint64_t signId);
+
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  std::optional<QueryReply> single(const QueryRequest& request);
+  bool sendAll(const std::string& data);
+  // Reads the next response frame; false on a transport or protocol error
+  bool readReply(QueryType type, uint32_t requestId, QueryReply& reply);
+  bool fail(const std::string& error);
+
+  int fd_{-1};
+  uint32_t nextRequestId_{0};
+  std::string output_;
+  std::string input_;
+  size_t inputOffset_{0};
+  std::string lastError_;
+};
+
+}  // namespace hdmap
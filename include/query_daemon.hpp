@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "map_server.hpp"
+#include "query_protocol.hpp"
+
+namespace hdmap {
+
+struct DaemonConfig {
+  std::string socketPath;
+  size_t workerThreads;  // 0 = one per hardware thread
+  int listenBacklog;
+
+  DaemonConfig() : workerThreads{0}, listenBacklog{128} {
+  }
+};
+
+// Totals since start()
+struct DaemonStats {
+  uint64_t connections;  // accepted
+  uint64_t requests;     // answered, bad ones included
+  uint64_t batches;      // sends of one or more responses
+
+  DaemonStats() : connections{0}, requests{0}, batches{0} {
+  }
+};
+
+// Serves a resident map to other processes over a Unix domain socket (see
+// query_protocol.hpp). The workers all wait on one epoll set; connections
+// are armed one-shot, so a connection is handled by one worker at a time
+// and its replies stay in request order. A wakeup reads everything the
+// client has pipelined, answers every complete request and sends the
+// replies in one write. While replies are waiting for the client to read,
+// the connection is not read, which pushes back on the client.
+class QueryDaemon {
+ public:
+  QueryDaemon(std::shared_ptr<const MapServer> server, DaemonConfig config);
+  ~QueryDaemon();
+
+  QueryDaemon(const QueryDaemon&) = delete;
+  QueryDaemon& operator=(const QueryDaemon&) = delete;
+
+  // Binds the socket, replacing a stale one, and starts the workers
+  bool start();
+  // Stops the workers, closes every connection and removes the socket
+  void stop();
+  bool isRunning() const {
+    return !workers_.empty();
+  }
+
+  // Swaps the served map, e.g. after a double-buffered reload; requests
+  // already being answered finish on the old one
+  void setServer(std::shared_ptr<const MapServer> server);
+
+  DaemonStats getStats() const;
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  struct Connection;
+
+  void workerLoop();
+  void acceptConnections();
+  // Reads, answers and writes; false once the connection should close
+  bool serve(Connection& connection);
+  bool flush(Connection& connection);
+  void rearm(Connection& connection);
+  void closeConnection(Connection& connection);
+
+  std::shared_ptr<const MapServer> server_;
+  DaemonConfig config_;
+  std::string lastError_;
+
+  int listenFd_{-1};
+  int epollFd_{-1};
+  int stopFd_{-1};  // eventfd waking every worker on stop()
+  std::vector<std::thread> workers_;
+
+  std::mutex connectionsMutex_;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+  std::atomic<uint64_t> acceptedCount_{0};
+  std::atomic<uint64_t> requestCount_{0};
+  std::atomic<uint64_t> batchCount_{0};
+};
+
+}  // namespace hdmap
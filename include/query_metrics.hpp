@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Query instrumentation for MapServer, enabled by building with
+// HDMAP_ENABLE_METRICS (CMake option of the same name). Without it the
+// recording hooks are empty inline functions and compile away; snapshots
+// are then always empty.
+
+namespace hdmap {
+
+#ifdef HDMAP_ENABLE_METRICS
+constexpr bool kQueryMetricsEnabled = true;
+#else
+constexpr bool kQueryMetricsEnabled = false;
+#endif
+
+// Instrumented MapServer calls
+enum class QueryApi : uint8_t {
+  QUERY_REGION,
+  QUERY_RADIUS,
+  QUERY_CORRIDOR,
+  QUERY_POLYGON,
+  NEARBY_LANES,
+  CLOSEST_LANE,
+  TRAFFIC_LIGHTS_FOR_LANE,
+  TRAFFIC_SIGNS_FOR_LANE,
+  PROJECT,
+  INTERPOLATE,
+  ROUTE,
+};
+constexpr size_t kQueryApiCount = 11;
+
+const char* queryApiName(QueryApi api);
+
+// Log-linear histogram in the style of HdrHistogram: values below
+// 2^SubBucketBits are exact, every power of two above is split into
+// 2^SubBucketBits buckets, so the relative error is below
+// 2^-SubBucketBits. Fixed size, no allocation while recording.
+template <size_t SubBucketBits>
+class LogHistogram {
+ public:
+  static constexpr size_t kSubBuckets = size_t{1} << SubBucketBits;
+  static constexpr size_t kBucketCount = kSubBuckets * (65 - SubBucketBits);
+
+  static size_t bucketFor(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    const auto exponent{static_cast<size_t>(63 - __builtin_clzll(value))};
+    const size_t shift{exponent - SubBucketBits};
+    return kSubBuckets + shift * kSubBuckets +
+           static_cast<size_t>((value >> shift) & (kSubBuckets - 1));
+  }
+
+  // Smallest value that falls into bucket
+  static uint64_t bucketLowerBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    const size_t shift{(bucket - kSubBuckets) / kSubBuckets};
+    const uint64_t mantissa{kSubBuckets + (bucket - kSubBuckets) % kSubBuckets};
+    return mantissa << shift;
+  }
+
+  void record(uint64_t value, uint64_t count = 1) {
+    counts_[bucketFor(value)] += count;
+    total_ += count;
+    sum_ += static_cast<double>(value) * count;
+    max_ = std::max(max_, value);
+  }
+
+  // Adds counts gathered elsewhere, bucket by bucket, with their sum and
+  // maximum
+  void merge(const std::array<uint64_t, kBucketCount>& counts, double sum,
+             uint64_t max) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      counts_[i] += counts[i];
+      total_ += counts[i];
+    }
+    sum_ += sum;
+    max_ = std::max(max_, max);
+  }
+
+  void merge(const LogHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  uint64_t count() const {
+    return total_;
+  }
+  uint64_t max() const {
+    return max_;
+  }
+  double mean() const {
+    return total_ == 0 ? 0.0 : sum_ / total_;
+  }
+  uint64_t bucketCount(size_t bucket) const {
+    return counts_[bucket];
+  }
+
+  // Lower bound of the bucket holding the value at fraction (0..1) of the
+  // recorded values; the exact maximum for fraction 1
+  uint64_t percentile(double fraction) const {
+    if (total_ == 0) {
+      return 0;
+    }
+    if (fraction >= 1.0) {
+      return max_;
+    }
+    const auto rank{static_cast<uint64_t>(fraction * total_)};
+    uint64_t seen{0};
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      seen += counts_[i];
+      if (seen > rank) {
+        return std::min(bucketLowerBound(i), max_);
+      }
+    }
+    return max_;
+  }
+
+ private:
+  std::array<uint64_t, kBucketCount> counts_{};
+  uint64_t total_{0};
+  double sum_{0.0};
+  uint64_t max_{0};
+};
+
+// Nanoseconds, within 1/16 of the true value
+using LatencyHistogram = LogHistogram<4>;
+// Powers of two
+using SizeHistogram = LogHistogram<0>;
+
+struct ApiMetrics {
+  uint64_t calls{0};
+  LatencyHistogram latency;   // ns
+  SizeHistogram resultSizes;  // elements returned
+  uint64_t rtreeNodesVisited{0};
+};
+
+// Point-in-time merge of all threads' counters
+struct MetricsSnapshot {
+  std::array<ApiMetrics, kQueryApiCount> apis;
+
+  const ApiMetrics& operator[](QueryApi api) const {
+    return apis[static_cast<size_t>(api)];
+  }
+  // One object per API: calls, latency percentiles, result sizes and
+  // R-tree nodes visited per call
+  std::string toJson() const;
+};
+
+#ifdef HDMAP_ENABLE_METRICS
+
+// R-tree nodes visited by queries on this thread
+inline thread_local uint64_t threadRTreeNodesVisited{0};
+
+inline void noteRTreeNodeVisit() {
+  ++threadRTreeNodesVisited;
+}
+inline uint64_t rtreeNodesVisited() {
+  return threadRTreeNodesVisited;
+}
+
+// Per-server metrics. Each thread records into its own shard of relaxed
+// atomics that only it writes, so recording takes no lock and no
+// read-modify-write; snapshot() sums the shards. A reset() racing with
+// recording threads may keep some of their concurrent samples.
+class QueryMetrics {
+ public:
+  QueryMetrics();
+  ~QueryMetrics();
+
+  QueryMetrics(const QueryMetrics&) = delete;
+  QueryMetrics& operator=(const QueryMetrics&) = delete;
+
+  void record(QueryApi api, uint64_t nanoseconds, size_t results,
+              uint64_t nodesVisited);
+  MetricsSnapshot snapshot() const;
+  void reset();
+
+ private:
+  struct Shard;
+  Shard& threadShard();
+
+  uint64_t id_;
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<Shard>> shards_;
+};
+
+// Times one call from construction to destruction
+class QueryTimer {
+ public:
+  QueryTimer(QueryMetrics& metrics, QueryApi api)
+      : metrics_{metrics},
+        api_{api},
+        nodesBefore_{rtreeNodesVisited()},
+        start_{std::chrono::steady_clock::now()} {
+  }
+  ~QueryTimer() {
+    const auto elapsed{std::chrono::steady_clock::now() - start_};
+    metrics_.record(
+        api_,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count()),
+        results_, rtreeNodesVisited() - nodesBefore_);
+  }
+
+  QueryTimer(const QueryTimer&) = delete;
+  QueryTimer& operator=(const QueryTimer&) = delete;
+
+  void setResults(size_t results) {
+    results_ = results;
+  }
+
+ private:
+  QueryMetrics& metrics_;
+  QueryApi api_;
+  size_t results_{0};
+  uint64_t nodesBefore_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+inline void noteRTreeNodeVisit() {
+}
+inline uint64_t rtreeNodesVisited() {
+  return 0;
+}
+
+class QueryMetrics {
+ public:
+  void record(QueryApi, uint64_t, size_t, uint64_t) {
+  }
+  MetricsSnapshot snapshot() const {
+    return {};
+  }
+  void reset() {
+  }
+};
+
+class QueryTimer {
+ public:
+  QueryTimer(QueryMetrics&, QueryApi) {
+  }
+  void setResults(size_t) {
+  }
+};
+
+#endif  // HDMAP_ENABLE_METRICS
+
+}  // namespace hdmap
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+// Binary protocol between QueryDaemon and QueryClient over a Unix domain
+// socket. Both ends run on one host, so values use native byte order and
+// layout, as in tile files. Every message is a frame:
+//
+//   uint32 length of the rest | uint32 request id | uint8 type or status |
+//   body
+//
+// Request bodies by QueryType:
+//   REGION         4 x double  min.x min.y max.x max.y
+//   RADIUS         3 x double  center.x center.y radius
+//   CLOSEST_LANE   2 x double  position.x position.y
+//   LANE, TRAFFIC_LIGHT, TRAFFIC_SIGN   uint64 id
+//
+// Response bodies (status OK only):
+//   REGION, RADIUS  uint64 counts and ids of lanes, lights and signs
+//   CLOSEST_LANE    uint64 lane id
+//   LANE, TRAFFIC_LIGHT, TRAFFIC_SIGN   the element's fields, vectors as
+//                   uint64 count + values, the sign value as a char vector
+//
+// A client may send any number of requests before reading; each
+// connection answers them in order.
+
+namespace hdmap {
+
+class MapServer;
+
+enum class QueryType : uint8_t {
+  REGION,
+  RADIUS,
+  CLOSEST_LANE,
+  LANE,
+  TRAFFIC_LIGHT,
+  TRAFFIC_SIGN,
+};
+constexpr size_t kQueryTypeCount = 6;
+
+enum class ResponseStatus : uint8_t { OK, NOT_FOUND, BAD_REQUEST };
+
+// Frames above this are rejected and the connection closed; real
+// requests are at most 41 bytes
+constexpr uint32_t kMaxRequestBytes = 256;
+constexpr size_t kFrameHeaderBytes = sizeof(uint32_t);
+
+struct QueryRequest {
+  QueryType type;
+  BoundingBox region;  // REGION
+  Point2D point;       // RADIUS center, CLOSEST_LANE position
+  double radius;       // RADIUS
+  uint64_t id;         // LANE, TRAFFIC_LIGHT, TRAFFIC_SIGN
+
+  QueryRequest() : type{QueryType::CLOSEST_LANE}, radius{0.0}, id{0} {
+  }
+
+  static QueryRequest regionQuery(const BoundingBox& region);
+  static QueryRequest radiusQuery(const Point2D& center, double radius);
+  static QueryRequest closestLane(const Point2D& position);
+  static QueryRequest laneById(uint64_t laneId);
+  static QueryRequest trafficLightById(uint64_t lightId);
+  static QueryRequest trafficSignById(uint64_t signId);
+};
+
+// Element ids of a region or radius query
+struct QueryIds {
+  std::vector<uint64_t> laneIds;
+  std::vector<uint64_t> trafficLightIds;
+  std::vector<uint64_t> trafficSignIds;
+
+  size_t totalCount() const {
+    return laneIds.size() + trafficLightIds.size() + trafficSignIds.size();
+  }
+};
+
+// Decoded answer to one request; only the part matching type is set
+struct QueryReply {
+  QueryType type{QueryType::CLOSEST_LANE};
+  ResponseStatus status{ResponseStatus::BAD_REQUEST};
+  QueryIds ids;       // REGION, RADIUS
+  uint64_t laneId{0}; // CLOSEST_LANE
+  std::shared_ptr<Lane> lane;
+  std::shared_ptr<TrafficLight> trafficLight;
+  std::shared_ptr<TrafficSign> trafficSign;
+};
+
+// Appends a whole request frame
+void encodeRequest(std::string& out, uint32_t requestId,
+                   const QueryRequest& request);
+// Parses the payload of a request frame (after the length); false if it
+// is malformed. The id is still set when only the type or body is bad.
+bool decodeRequest(const char* payload, size_t size, uint32_t& requestId,
+                   QueryRequest& request);
+
+// Appends the response frame answering request from server
+void encodeResponse(std::string& out, uint32_t requestId,
+                    const MapServer& server, const QueryRequest& request);
+// Response frame with a status and no body
+void encodeStatus(std::string& out, uint32_t requestId, ResponseStatus status);
+// Parses the payload of a response frame to a request of type
+bool decodeResponse(const char* payload, size_t size, QueryType type,
+                    uint32_t& requestId, QueryReply& reply);
+
+}  // namespace hdmap
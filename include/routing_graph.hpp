@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hdmap {
+
+// Result of a lane-level route search
+struct Route {
+  std::vector<uint64_t> laneIds;  // from start lane to goal lane inclusive
+  double cost;                    // expected travel time in seconds
+  size_t nodesExplored;           // lanes settled by the search
+
+  Route() : cost{0.0}, nodesExplored{0} {
+  }
+};
+
+// Lane connectivity graph in compressed sparse row form.
+// Lanes are renumbered to dense indices; edges out of lane i are
+// targets_[offsets_[i] .. offsets_[i + 1]). Edge u -> v costs the time to
+// reach the end of lane v from the end of lane u.
+class RoutingGraph {
+ public:
+  // Used when a lane has no speed limit set (50 km/h)
+  static constexpr double kDefaultSpeed = 13.89;
+  // Extra cost of a lane change, in seconds
+  static constexpr double kLaneChangePenalty = 5.0;
+
+  RoutingGraph() = default;
+
+  // Build from successor and adjacency lists; unknown lane ids are skipped
+  void build(const LaneMap& lanes);
+  void clear();
+
+  size_t nodeCount() const {
+    return laneIds_.size();
+  }
+  size_t edgeCount() const {
+    return targets_.size();
+  }
+
+  std::optional<uint32_t> indexOf(uint64_t laneId) const;
+  uint64_t laneIdAt(uint32_t index) const {
+    return laneIds_[index];
+  }
+
+  // Raw CSR arrays, used by routing preprocessors
+  const IndexVector<uint32_t>& offsets() const {
+    return offsets_;
+  }
+  const IndexVector<uint32_t>& targets() const {
+    return targets_;
+  }
+  const IndexVector<double>& costs() const {
+    return costs_;
+  }
+  // Travel time along a lane itself
+  double laneCost(uint32_t index) const {
+    return laneCosts_[index];
+  }
+
+  // A* with a straight-line travel time heuristic
+  std::optional<Route> aStar(uint64_t fromLaneId, uint64_t toLaneId) const;
+
+  // Plain Dijkstra, mainly as a reference for A*
+  std::optional<Route> dijkstra(uint64_t fromLaneId, uint64_t toLaneId) const;
+
+ private:
+  IndexVector<uint64_t> laneIds_;
+  TrackedMap<uint64_t, uint32_t, MemoryCategory::INDICES> indices_;
+  IndexVector<uint32_t> offsets_;
+  IndexVector<uint32_t> targets_;
+  IndexVector<double> costs_;
+  IndexVector<double> laneCosts_;
+  IndexVector<Point2D> laneEnds_;  // heuristic anchor per lane
+  double maxSpeed_{kDefaultSpeed};
+
+  std::optional<Route> search(uint64_t fromLaneId, uint64_t toLaneId,
+                              bool useHeuristic) const;
+};
+
+}  // namespace hdmap
@@ -5,6 +5,7 @@
 #include <variant>
 #include <vector>
 
+#include "query_metrics.hpp"
 #include "types.hpp"
 
 namespace hdmap {
@@ -34,8 +35,10 @@ struct RTreeEntry {
 class RTreeNode {
  public:
   NodeType type;
-  std::vector<RTreeEntry> entries;
-  std::shared_ptr<RTreeNode> parent;
+  IndexVector<RTreeEntry> entries;
+  // Non-owning: parents own their children through entries, so an owning
+  // back pointer would make every node a cycle and leak the tree
+  RTreeNode* parent;
 
   RTreeNode(NodeType type) : type{type}, parent{nullptr} {
     entries.reserve(MAX_RTREE_ENTRIES);
@@ -72,6 +75,15 @@ class RTree {
   // Query elements within radius of a point
   void queryRadius(const Point2D& center, double radius, std::vector<Data>& results) const;
 
+  // Query with a custom test on bounding boxes, applied to nodes and
+  // elements alike; accept(bbox) must hold for any box containing a match
+  template <typename Predicate>
+  void queryIf(const Predicate& accept, std::vector<Data>& results) const {
+    if (root_) {
+      queryNodeIf(*root_, accept, results);
+    }
+  }
+
   // Clear all entries
   void clear();
 
@@ -82,16 +94,35 @@ class RTree {
   size_t height() const;
 
  private:
+  // Null until the first insert, so an empty tree allocates nothing
   std::shared_ptr<RTreeNode> root_;
   size_t elementCount_;
 
   // Helper methods
-  std::shared_ptr<RTreeNode> chooseLeaf(const BoundingBox& bbox);
-  void splitNode(std::shared_ptr<RTreeNode>& node, RTreeEntry& newEntry);
-  void adjustTree(std::shared_ptr<RTreeNode>& leaf);
+  RTreeNode* chooseLeaf(const BoundingBox& bbox);
+  void splitNode(RTreeNode* node, const RTreeEntry& newEntry);
+  void adjustTree(RTreeNode* leaf);
   void queryNode(const std::shared_ptr<const RTreeNode>& node, const BoundingBox& bbox,
                  std::vector<Data>& results) const;
   double computeEnlargement(const BoundingBox& existing, const BoundingBox& addition) const;
+
+  template <typename Predicate>
+  void queryNodeIf(const RTreeNode& node, const Predicate& accept,
+                   std::vector<Data>& results) const {
+    noteRTreeNodeVisit();
+    for (const auto& entry : node.entries) {
+      if (!accept(entry.bbox)) {
+        continue;
+      }
+
+      if (node.isLeaf()) {
+        results.push_back(entry.data);
+      } else {
+        queryNodeIf(*std::get<std::shared_ptr<RTreeNode>>(entry.data), accept,
+                    results);
+      }
+    }
+  }
 };
 
 }  // namespace hdmap
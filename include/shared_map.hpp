@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "map_server.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// A map published to POSIX shared memory, queried in place by any number of
+// processes. Publication is two kinds of segment:
+// - the control segment <name> holds the current generation, and
+// - one data segment <name>.<generation> per published map.
+// A data segment is position independent: records refer to each other by
+// index into the segment's arrays and the arrays by byte offset from the
+// segment start, so every process can map it at its own address. Lanes,
+// lights and signs are sorted by id for lookup; each kind has a packed
+// R-tree built at publication. Lane geometry is stored as doubles whatever
+// the server's GeometryMode.
+constexpr uint32_t kSharedMapMagic = 0x4d534448;  // "HDSM"
+constexpr uint32_t kSharedMapVersion = 1;
+
+// Elements [begin, begin + count) of one of the segment's arrays
+struct SharedRange {
+  uint32_t begin;
+  uint32_t count;
+};
+
+struct SharedLane {
+  uint64_t id;
+  BoundingBox bbox;
+  double speedLimit;  // m/s
+  SharedRange centerline;  // points
+  SharedRange leftBoundary;
+  SharedRange rightBoundary;
+  SharedRange predecessorIds;  // ids
+  SharedRange successorIds;
+  SharedRange adjacentLeftIds;
+  SharedRange adjacentRightIds;
+  LaneType type;
+};
+
+struct SharedTrafficLight {
+  uint64_t id;
+  Point2D position;
+  double height;
+  SharedRange controlledLaneIds;
+  TrafficLightState state;
+};
+
+struct SharedTrafficSign {
+  uint64_t id;
+  Point2D position;
+  double height;
+  SharedRange value;  // text
+  SharedRange affectedLaneIds;
+  TrafficSignType type;
+};
+
+// Packed R-tree node. Nodes are stored level by level from the leaves up
+// and the root is the last one; a leaf's children are tree entries, any
+// other node's are nodes.
+struct SharedTreeNode {
+  BoundingBox bbox;
+  uint32_t first;
+  uint32_t count;
+};
+
+struct SharedTreeEntry {
+  BoundingBox bbox;
+  uint32_t element;  // index into the element array
+};
+
+// Byte offset from the segment start and element count of an array
+struct SharedSection {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct SharedTree {
+  SharedSection entries;
+  SharedSection nodes;
+  uint64_t leafCount;
+};
+
+struct SharedMapHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t generation;
+  uint64_t totalBytes;
+  SharedSection lanes;
+  SharedSection trafficLights;
+  SharedSection trafficSigns;
+  SharedSection points;
+  SharedSection ids;
+  SharedSection text;
+  SharedTree laneTree;
+  SharedTree trafficLightTree;
+  SharedTree trafficSignTree;
+};
+
+// Read-only run of elements inside a segment
+template <typename T>
+class SharedArray {
+ public:
+  SharedArray() = default;
+  SharedArray(const T* data, size_t size) : data_{data}, size_{size} {
+  }
+
+  const T* begin() const {
+    return data_;
+  }
+  const T* end() const {
+    return data_ + size_;
+  }
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  const T& operator[](size_t index) const {
+    return data_[index];
+  }
+  const T& front() const {
+    return data_[0];
+  }
+  const T& back() const {
+    return data_[size_ - 1];
+  }
+
+ private:
+  const T* data_{nullptr};
+  size_t size_{0};
+};
+
+// Results point into the view's mapping
+struct SharedQueryResult {
+  std::vector<const SharedLane*> lanes;
+  std::vector<const SharedTrafficLight*> trafficLights;
+  std::vector<const SharedTrafficSign*> trafficSigns;
+
+  void clear() {
+    lanes.clear();
+    trafficLights.clear();
+    trafficSigns.clear();
+  }
+
+  size_t totalCount() const {
+    return lanes.size() + trafficLights.size() + trafficSigns.size();
+  }
+};
+
+// Writes a MapServer into shared memory under a name such as "/hdmap".
+// Each publish() writes a complete new data segment, then bumps the
+// generation, then removes the previous segment. Readers that still map
+// the previous segment keep using it until they refresh. Not thread-safe.
+class SharedMapPublisher {
+ public:
+  explicit SharedMapPublisher(std::string name);
+  // Unpublishes
+  ~SharedMapPublisher();
+
+  SharedMapPublisher(const SharedMapPublisher&) = delete;
+  SharedMapPublisher& operator=(const SharedMapPublisher&) = delete;
+
+  bool publish(const MapServer& server);
+  // Removes the control and data segments; open views stay usable
+  void unpublish();
+
+  const std::string& getName() const {
+    return name_;
+  }
+  // Generation of the last publish(), 0 before the first
+  uint64_t getGeneration() const {
+    return generation_;
+  }
+  // Size of the current data segment
+  size_t getPublishedBytes() const {
+    return publishedBytes_;
+  }
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  bool openControl();
+
+  std::string name_;
+  void* control_{nullptr};
+  uint64_t generation_{0};
+  size_t publishedBytes_{0};
+  std::string lastError_;
+};
+
+// Read-only view of a published map. Queries run directly on the mapped
+// segment: no copies, no IPC, no allocation beyond the result vectors.
+// Returned pointers and arrays stay valid until refresh() switches to a
+// newer generation or the view is closed. One view can be queried from
+// any number of threads; refresh() and close() must not run concurrently
+// with queries.
+class SharedMapView {
+ public:
+  SharedMapView() = default;
+  ~SharedMapView();
+
+  SharedMapView(const SharedMapView&) = delete;
+  SharedMapView& operator=(const SharedMapView&) = delete;
+
+  // Maps the current generation of a published map
+  bool open(const std::string& name);
+  void close();
+  bool isOpen() const {
+    return header_ != nullptr;
+  }
+
+  // Generation of the mapped data
+  uint64_t getGeneration() const;
+  // Generation the publisher has made current; differs from
+  // getGeneration() once a newer map is published
+  uint64_t getPublishedGeneration() const;
+  bool isStale() const {
+    return isOpen() && getPublishedGeneration() != getGeneration();
+  }
+  // Switches to the current generation if it changed. On failure the view
+  // keeps its old mapping.
+  bool refresh();
+
+  size_t getLaneCount() const;
+  size_t getTrafficLightCount() const;
+  size_t getTrafficSignCount() const;
+  size_t getMappedBytes() const {
+    return dataSize_;
+  }
+
+  // Same semantics as the MapServer queries of the same names
+  SharedQueryResult queryRegion(const BoundingBox& region) const;
+  SharedQueryResult queryRadius(const Point2D& center, double radius) const;
+  std::vector<const SharedLane*> getNearbyLanes(const Point2D& position,
+                                                double maxDistance) const;
+  // nullptr when nothing is within kClosestLaneMaxRadius
+  const SharedLane* getClosestLane(const Point2D& position) const;
+
+  // nullptr when the id is unknown
+  const SharedLane* getLaneById(uint64_t laneId) const;
+  const SharedTrafficLight* getTrafficLightById(uint64_t id) const;
+  const SharedTrafficSign* getTrafficSignById(uint64_t id) const;
+
+  // Contents of a record's ranges
+  SharedArray<Point2D> points(SharedRange range) const;
+  SharedArray<uint64_t> ids(SharedRange range) const;
+  std::string_view text(SharedRange range) const;
+
+  // Minimum distance from a point to any centerline vertex
+  double distanceTo(const SharedLane& lane, const Point2D& point) const;
+
+  const std::string& getLastError() const {
+    return lastError_;
+  }
+
+ private:
+  bool mapGeneration(uint64_t generation);
+  void unmapData();
+  template <typename T>
+  SharedArray<T> section(const SharedSection& section) const;
+  template <typename Visit>
+  void queryTree(const SharedTree& tree, const BoundingBox& box,
+                 const Visit& visit) const;
+
+  std::string name_;
+  const void* control_{nullptr};
+  const SharedMapHeader* header_{nullptr};
+  size_t dataSize_{0};
+  std::string lastError_;
+};
+
+}  // namespace hdmap
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tile_store.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+struct PrefetchConfig {
+  double horizonSeconds;  // how far ahead in time to keep tiles resident
+  double minDistance;     // meters; covers standstill and low speeds
+  bool idleIoPriority;    // run disk reads in the idle I/O class (Linux)
+
+  static PrefetchConfig defaultConfig() {
+    return {10.0, 200.0, true};
+  }
+};
+
+// Vehicle state handed to the prefetcher every cycle
+struct VehicleState {
+  Point2D position;
+  double heading;  // radians, counter-clockwise from +x
+  double speed;    // m/s
+  // Optional planned path in map coordinates; preferred over the heading
+  std::vector<Point2D> route;
+
+  VehicleState() : heading{0.0}, speed{0.0} {
+  }
+};
+
+// Background thread that keeps the tiles the vehicle will reach within
+// horizonSeconds resident in a TileStore, so queries find them loaded.
+// update() only records the latest state; the worker coalesces updates
+// that arrive while it is reading. Hit rate is TileStore::getStats().
+class TilePrefetcher {
+ public:
+  explicit TilePrefetcher(
+      const TileStore& store,
+      const PrefetchConfig& config = PrefetchConfig::defaultConfig());
+  ~TilePrefetcher();
+
+  TilePrefetcher(const TilePrefetcher&) = delete;
+  TilePrefetcher& operator=(const TilePrefetcher&) = delete;
+
+  void start();
+  void stop();
+  bool isRunning() const;
+
+  void update(const VehicleState& state);
+  // Block until every update submitted so far has been processed
+  void waitIdle();
+
+  uint64_t getCycleCount() const;
+
+  // Path the vehicle is expected to cover within the horizon
+  static std::vector<Point2D> predictPath(const VehicleState& state,
+                                          const PrefetchConfig& config);
+
+ private:
+  void run();
+
+  const TileStore& store_;
+  PrefetchConfig config_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::thread worker_;
+  VehicleState pending_;
+  bool hasPending_{false};
+  bool busy_{false};
+  bool stopping_{false};
+  uint64_t cycles_{0};
+};
+
+}  // namespace hdmap
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "map_server.hpp"
+#include "point_index.hpp"
+#include "rtree.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// Integer tile coordinates: tile (x, y) covers
+// [x * tileSize, (x + 1) * tileSize) x [y * tileSize, (y + 1) * tileSize)
+struct TileKey {
+  int32_t x;
+  int32_t y;
+
+  bool operator==(const TileKey& other) const {
+    return x == other.x && y == other.y;
+  }
+};
+
+struct TileKeyHash {
+  size_t operator()(const TileKey& key) const {
+    return std::hash<uint64_t>{}(
+        (static_cast<uint64_t>(static_cast<uint32_t>(key.x)) << 32) |
+        static_cast<uint32_t>(key.y));
+  }
+};
+
+// Manifest entry. Elements belong to the tile holding their bounding box
+// centre (lanes) or position (points); bounds covers all of them and may
+// reach past the tile square.
+struct TileInfo {
+  TileKey key;
+  BoundingBox bounds;
+  uint32_t laneCount;
+  uint32_t trafficLightCount;
+  uint32_t trafficSignCount;
+};
+
+struct TileStoreStats {
+  uint64_t hits;        // tile already resident when a query needed it
+  uint64_t loads;       // query waited for the tile to be read from disk
+  uint64_t prefetches;  // tile read from disk ahead of time
+  uint64_t evictions;   // tile dropped to stay within the budget
+
+  TileStoreStats() : hits{0}, loads{0}, prefetches{0}, evictions{0} {
+  }
+
+  // Share of tile lookups by queries that did not wait for disk
+  double hitRate() const {
+    const uint64_t total{hits + loads};
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+  }
+};
+
+// Map partitioned into fixed-size tiles on disk. write() splits a loaded
+// map once; a TileStore opened on the directory then reads only the tiles
+// that queries and prefetches touch, each with its own indices, and evicts
+// the least recently used ones once maxTotalMemory is exceeded. Tiles a
+// query is using are never evicted by that query. The manifest maps every
+// lane id to its tile, so by-id lookups read a single tile; that table
+// stays resident (16 bytes per lane). All methods are thread-safe; tiles
+// are read from disk without holding the store's lock, so a slow read only
+// delays the queries that need that tile.
+class TileStore {
+ public:
+  explicit TileStore(const MemoryConstraints& constraints =
+                         MemoryConstraints::defaultConstraints());
+
+  TileStore(const TileStore&) = delete;
+  TileStore& operator=(const TileStore&) = delete;
+
+  // Offline: write every element of the server's map into tiles under
+  // directory, plus a manifest. Does not change what this store has open.
+  bool write(const MapServer& server, const std::string& directory,
+             double tileSize = kDefaultTileSize);
+
+  // Read the manifest; tiles are loaded on demand
+  bool open(const std::string& directory);
+  // Waits for tile reads in flight
+  void close();
+
+  // Same semantics as the MapServer queries of the same name
+  QueryResult queryRegion(const BoundingBox& region) const;
+  QueryResult queryRadius(const Point2D& center, double radius) const;
+  std::optional<std::shared_ptr<Lane>> getClosestLane(
+      const Point2D& position) const;
+  std::optional<std::shared_ptr<Lane>> getLaneById(uint64_t laneId) const;
+
+  // Load the tiles a vehicle at position will reach within distance when
+  // driving along heading (radians, counter-clockwise from +x)
+  void prefetch(const Point2D& position, double heading,
+                double distance) const;
+  // Load the tiles along a polyline
+  void prefetchPath(const std::vector<Point2D>& path) const;
+
+  double tileSize() const {
+    return tileSize_;
+  }
+  const std::vector<TileInfo>& tiles() const {
+    return tiles_;
+  }
+  size_t getLoadedTileCount() const;
+  bool isTileLoaded(const TileKey& key) const;
+  size_t getMemoryUsage() const;
+  TileStoreStats getStats() const;
+  std::string getLastError() const;
+
+  static TileKey tileKeyFor(const Point2D& point, double tileSize);
+  static std::string manifestPathFor(const std::string& directory) {
+    return directory + "/manifest.bin";
+  }
+  static std::string tilePathFor(const std::string& directory,
+                                 const TileKey& key);
+
+ private:
+  // Manifest entry locating a lane, sorted by laneId
+  struct LaneLocation {
+    uint64_t laneId;
+    uint64_t tileIndex;
+  };
+
+  struct LoadedTile {
+    // Everything below is charged here while the tile is read
+    MemoryAccountHandle account;
+    LaneMap lanes;
+    TrafficLightMap trafficLights;
+    TrafficSignMap trafficSigns;
+    RTree laneIndex;
+    PointIndex<TrafficLight> trafficLightIndex;
+    PointIndex<TrafficSign> trafficSignIndex;
+    size_t memoryUsage{0};
+    std::list<TileKey>::iterator lruPosition;
+    // Queries using the tile; pinned tiles are never evicted
+    size_t pins{0};
+  };
+
+  // Callers hold mutex_
+  std::vector<size_t> tilesOverlapping(const BoundingBox& region) const;
+  // Pins the tiles, reading missing ones with the lock released; tiles
+  // that fail to load are left out. Pair with release().
+  std::vector<LoadedTile*> acquire(
+      const std::vector<size_t>& tileIndices,
+      std::unique_lock<std::mutex>& lock) const;
+  void release(const std::vector<LoadedTile*>& tiles,
+               const std::vector<size_t>& tileIndices) const;
+  LoadedTile& insertTile(const TileKey& key, LoadedTile&& tile) const;
+  static bool readTile(const std::string& path, LoadedTile& tile,
+                       std::string& error);
+  void evictOverBudget(const std::vector<size_t>& pinned) const;
+  // Closest lane with a vertex within radius, or nullptr
+  std::shared_ptr<Lane> closestLaneWithin(const Point2D& position,
+                                          double radius) const;
+
+  MemoryConstraints constraints_;
+  std::string directory_;
+  double tileSize_{kDefaultTileSize};
+  std::vector<TileInfo> tiles_;
+  std::unordered_map<TileKey, size_t, TileKeyHash> tileIndexByKey_;
+  std::vector<LaneLocation> laneLocations_;
+  // How far element bounds reach past their tile square, over all tiles
+  double maxOverhang_{0.0};
+
+  mutable std::mutex mutex_;
+  // Signalled whenever a read finishes or a reader leaves
+  mutable std::condition_variable tileRead_;
+  // Tiles being read by some thread; others wait instead of reading twice
+  mutable std::unordered_set<TileKey, TileKeyHash> loading_;
+  // Queries and prefetches that may drop the lock; close() waits for them
+  mutable size_t activeReaders_{0};
+  mutable std::unordered_map<TileKey, LoadedTile, TileKeyHash> loaded_;
+  mutable std::list<TileKey> lru_;  // front is most recently used
+  mutable size_t memoryUsage_{0};
+  mutable TileStoreStats stats_;
+  mutable std::string lastError_;
+};
+
+}  // namespace hdmap
@@ -7,6 +7,8 @@
 #include <variant>
 #include <vector>
 
+#include "memory_account.hpp"
+
 namespace hdmap {
 
 // Basic geometric types
@@ -22,6 +24,10 @@ struct Point2D {
   double distanceTo(const Point2D& other) const;
 };
 
+// Element containers charged to the owning map's MemoryAccount
+using PointList = TrackedVector<Point2D, MemoryCategory::GEOMETRY>;
+using IdList = TrackedVector<uint64_t, MemoryCategory::LANES>;
+
 struct BoundingBox {
   Point2D min;
   Point2D max;
@@ -36,10 +42,75 @@ struct BoundingBox {
   Point2D center() const;
 };
 
+// Geometry storage mode for lane polylines
+enum class GeometryMode : uint8_t { DOUBLE, COMPACT_FLOAT };
+
+// Edge length of the tiles used as local origins for compact geometry
+constexpr double kDefaultTileSize = 1000.0;
+
+// Snap a point to the lower-left corner of the tile containing it
+Point2D tileOriginFor(const Point2D& point, double tileSize);
+
+// Polyline stored as float offsets relative to a per-tile origin.
+// Coordinates are kept in separate x/y arrays so distance kernels run over
+// contiguous floats (twice the SIMD width of double).
+class CompactPolyline {
+ public:
+  CompactPolyline() = default;
+  CompactPolyline(const std::vector<Point2D>& points, double tileSize);
+
+  size_t size() const {
+    return xs_.size();
+  }
+  bool empty() const {
+    return xs_.empty();
+  }
+  const Point2D& origin() const {
+    return origin_;
+  }
+
+  // Tile-relative coordinates, for kernels that stay in the tile frame
+  const float* xs() const {
+    return xs_.data();
+  }
+  const float* ys() const {
+    return ys_.data();
+  }
+
+  // Conversion back to the double-precision API
+  Point2D at(size_t index) const;
+  std::vector<Point2D> toPoints() const;
+
+  // Minimum distance from a point to any vertex
+  double minVertexDistance(const Point2D& point) const;
+
+  size_t memoryUsage() const {
+    return (xs_.capacity() + ys_.capacity()) * sizeof(float);
+  }
+
+ private:
+  Point2D origin_;
+  TrackedVector<float, MemoryCategory::GEOMETRY> xs_;
+  TrackedVector<float, MemoryCategory::GEOMETRY> ys_;
+};
+
 // Map element types
-enum class LaneType : uint8_t { DRIVING, SIDEWALK, BIKE_LANE, PARKING, SHOULDER, RESTRICTED };
+enum class LaneType : uint8_t {
+  DRIVING,
+  SIDEWALK,
+  BIKE_LANE,
+  PARKING,
+  SHOULDER,
+  RESTRICTED
+};
 
-enum class TrafficLightState : uint8_t { RED, YELLOW, GREEN, RED_YELLOW, UNKNOWN };
+enum class TrafficLightState : uint8_t {
+  RED,
+  YELLOW,
+  GREEN,
+  RED_YELLOW,
+  UNKNOWN
+};
 
 enum class TrafficSignType : uint8_t {
   STOP,
@@ -55,31 +126,55 @@ enum class TrafficSignType : uint8_t {
 struct Lane {
   uint64_t id;
   LaneType type;
-  std::vector<Point2D> centerline;
-  std::vector<Point2D> leftBoundary;
-  std::vector<Point2D> rightBoundary;
-  std::vector<uint64_t> predecessorIds;
-  std::vector<uint64_t> successorIds;
-  std::vector<uint64_t> adjacentLeftIds;
-  std::vector<uint64_t> adjacentRightIds;
+  PointList centerline;
+  PointList leftBoundary;
+  PointList rightBoundary;
+  IdList predecessorIds;
+  IdList successorIds;
+  IdList adjacentLeftIds;
+  IdList adjacentRightIds;
   double speedLimit;  // m/s
   BoundingBox bbox;
+  // Replaces centerline when the map is loaded in GeometryMode::COMPACT_FLOAT
+  CompactPolyline compactCenterline;
 
   Lane() : id{0}, type{LaneType::DRIVING}, speedLimit{0.0} {
   }
 
   void computeBoundingBox();
+
+  // Store the centerline as tile-relative floats and release the doubles
+  void compactGeometry(double tileSize);
+
+  // Centerline access independent of the storage mode
+  size_t centerlineSize() const;
+  std::vector<Point2D> centerlinePoints() const;
+  // One vertex, read in place; index < centerlineSize()
+  Point2D centerlineAt(size_t index) const {
+    return centerline.empty() ? compactCenterline.at(index)
+                              : centerline[index];
+  }
+
+  // Minimum distance from a point to any centerline vertex
+  double distanceTo(const Point2D& point) const;
+
+  // Estimated heap footprint including the struct itself
+  size_t memoryUsage() const;
 };
 
 struct TrafficLight {
   uint64_t id;
   Point2D position;
   TrafficLightState state;
-  std::vector<uint64_t> controlledLaneIds;
+  IdList controlledLaneIds;
   double height;  // meters above ground
 
   TrafficLight() : id{0}, state{TrafficLightState::UNKNOWN}, height{0.0} {
   }
+
+  size_t memoryUsage() const {
+    return sizeof(TrafficLight) + controlledLaneIds.size() * sizeof(uint64_t);
+  }
 };
 
 struct TrafficSign {
@@ -87,13 +182,26 @@ struct TrafficSign {
   Point2D position;
   TrafficSignType type;
   std::string value;  // e.g., "50" for speed limit
-  std::vector<uint64_t> affectedLaneIds;
+  IdList affectedLaneIds;
   double height;  // meters above ground
 
   TrafficSign() : id{0}, type{TrafficSignType::OTHER}, height{0.0} {
   }
+
+  size_t memoryUsage() const {
+    return sizeof(TrafficSign) + value.capacity() +
+           affectedLaneIds.size() * sizeof(uint64_t);
+  }
 };
 
+// Id -> element tables of a map
+using LaneMap =
+    TrackedMap<uint64_t, std::shared_ptr<Lane>, MemoryCategory::LANES>;
+using TrafficLightMap = TrackedMap<uint64_t, std::shared_ptr<TrafficLight>,
+                                   MemoryCategory::TRAFFIC_ELEMENTS>;
+using TrafficSignMap = TrackedMap<uint64_t, std::shared_ptr<TrafficSign>,
+                                  MemoryCategory::TRAFFIC_ELEMENTS>;
+
 // Map query result structures
 struct QueryResult {
   std::vector<std::shared_ptr<Lane>> lanes;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "map_server.hpp"
+#include "types.hpp"
+
+namespace hdmap {
+
+// Elements that changed between two window positions
+struct WindowDelta {
+  QueryResult entered;
+  QueryResult left;
+};
+
+// Tracks the region of interest of a moving vehicle.
+// Each update only queries the strips the window moved into and the band it
+// moved away from, instead of recomputing the full region. Membership
+// follows queryRegion: bounding box overlap. When the server loads a new
+// map, everything tracked is reported as left and the window is rebuilt.
+class WindowTracker {
+ public:
+  explicit WindowTracker(const MapServer& mapServer);
+
+  // Move the window and report what entered and left it
+  WindowDelta update(const BoundingBox& window);
+
+  // Everything currently inside the window
+  QueryResult current() const;
+  size_t currentCount() const {
+    return lanes_.size() + trafficLights_.size() + trafficSigns_.size();
+  }
+
+  // Forget the window; the next update reports a full result
+  void reset();
+
+ private:
+  const MapServer& mapServer_;
+  std::optional<BoundingBox> window_;
+  // Server generation the tracked elements belong to
+  uint64_t generation_{0};
+
+  LaneMap lanes_;
+  TrafficLightMap trafficLights_;
+  TrafficSignMap trafficSigns_;
+
+  // Parts of next not covered by previous (at most four boxes)
+  static std::vector<BoundingBox> uncoveredStrips(const BoundingBox& previous,
+                                                  const BoundingBox& next);
+};
+
+}  // namespace hdmap
@@ -0,0 +1,563 @@
+#include "include/contraction_hierarchy.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+constexpr uint32_t kNoMiddle = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t kNoParent = std::numeric_limits<uint32_t>::max();
+constexpr double kInfinity = std::numeric_limits<double>::max();
+
+// Witness searches give up after settling this many lanes; a missed witness
+// only costs an unnecessary shortcut, never a wrong answer
+constexpr size_t kWitnessSettleLimit = 64;
+
+constexpr uint32_t kFileMagic = 0x48434448;  // "HDCH"
+constexpr uint32_t kFileVersion = 1;
+
+using QueueEntry = std::pair<double, uint32_t>;
+using MinQueue = std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                                     std::greater<QueueEntry>>;
+
+// Arc in the mutable graph used during contraction
+struct Arc {
+  uint32_t node;
+  uint32_t middle;
+  double cost;
+};
+
+// Distance labels reused across queries; stamps avoid clearing O(n) arrays
+struct SearchSpace {
+  std::vector<double> dist;
+  std::vector<uint32_t> parent;
+  std::vector<uint32_t> stamp;
+  uint32_t generation{0};
+
+  void prepare(size_t nodeCount) {
+    if (stamp.size() < nodeCount) {
+      dist.resize(nodeCount);
+      parent.resize(nodeCount);
+      stamp.resize(nodeCount, 0);
+    }
+    if (++generation == 0) {
+      std::fill(stamp.begin(), stamp.end(), 0);
+      generation = 1;
+    }
+  }
+
+  double get(uint32_t node) const {
+    return stamp[node] == generation ? dist[node] : kInfinity;
+  }
+
+  uint32_t parentOf(uint32_t node) const {
+    return stamp[node] == generation ? parent[node] : kNoParent;
+  }
+
+  void set(uint32_t node, double distance, uint32_t parentNode) {
+    stamp[node] = generation;
+    dist[node] = distance;
+    parent[node] = parentNode;
+  }
+};
+
+void addArc(std::vector<std::vector<Arc>>& out,
+            std::vector<std::vector<Arc>>& in, uint32_t from, uint32_t to,
+            double cost, uint32_t middle) {
+  // Keep only the cheapest of parallel arcs
+  for (auto& arc : out[from]) {
+    if (arc.node != to) {
+      continue;
+    }
+    if (cost < arc.cost) {
+      arc.cost = cost;
+      arc.middle = middle;
+      for (auto& reverse : in[to]) {
+        if (reverse.node == from) {
+          reverse.cost = cost;
+          reverse.middle = middle;
+        }
+      }
+    }
+    return;
+  }
+  out[from].push_back({to, middle, cost});
+  in[to].push_back({from, middle, cost});
+}
+
+template <typename T, typename Allocator>
+void writeVector(std::ofstream& file, const std::vector<T, Allocator>& values) {
+  const uint64_t count{values.size()};
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  file.write(reinterpret_cast<const char*>(values.data()),
+             static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+// Counts past the end of a fileSize-byte file fail instead of allocating
+template <typename T, typename Allocator>
+bool readVector(std::ifstream& file, uint64_t fileSize,
+                std::vector<T, Allocator>& values) {
+  uint64_t count = 0;
+  if (!file.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  const auto position{file.tellg()};
+  if (position < 0 || static_cast<uint64_t>(position) > fileSize ||
+      count > (fileSize - static_cast<uint64_t>(position)) / sizeof(T)) {
+    return false;
+  }
+  values.resize(count);
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char*>(values.data()),
+                static_cast<std::streamsize>(count * sizeof(T))));
+}
+
+// Offsets of a CSR array over nodeCount nodes: start at 0, never decrease
+// and end at the edge count; every edge stays within the graph
+template <typename Offsets, typename Edges>
+bool validCsr(const Offsets& offsets, const Edges& edges, size_t nodeCount) {
+  if (offsets.size() != nodeCount + 1 || offsets.front() != 0 ||
+      offsets.back() != edges.size()) {
+    return false;
+  }
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    if (offsets[i] < offsets[i - 1]) {
+      return false;
+    }
+  }
+  return std::all_of(edges.begin(), edges.end(), [&](const auto& edge) {
+    return edge.target < nodeCount &&
+           (edge.middle == kNoMiddle || edge.middle < nodeCount);
+  });
+}
+
+// rank is a permutation of 0..rank.size() - 1
+template <typename Ranks>
+bool validRanks(const Ranks& rank) {
+  std::vector<bool> seen(rank.size(), false);
+  for (const auto r : rank) {
+    if (r >= rank.size() || seen[r]) {
+      return false;
+    }
+    seen[r] = true;
+  }
+  return true;
+}
+
+// Every edge leads to a higher-ranked node than the one storing it, and a
+// shortcut's middle ranks below both ends, so unpacking always terminates.
+// Call after validCsr and validRanks.
+template <typename Offsets, typename Edges, typename Ranks>
+bool validOrder(const Offsets& offsets, const Edges& edges,
+                const Ranks& rank) {
+  for (size_t owner = 0; owner + 1 < offsets.size(); ++owner) {
+    for (uint32_t e = offsets[owner]; e < offsets[owner + 1]; ++e) {
+      const auto& edge{edges[e]};
+      if (rank[edge.target] <= rank[owner]) {
+        return false;
+      }
+      if (edge.middle != kNoMiddle && rank[edge.middle] >= rank[owner]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void ContractionHierarchy::build(const RoutingGraph& graph) {
+  clear();
+
+  const auto nodeCount{static_cast<uint32_t>(graph.nodeCount())};
+  std::vector<std::vector<Arc>> out(nodeCount);
+  std::vector<std::vector<Arc>> in(nodeCount);
+  for (uint32_t u = 0; u < nodeCount; ++u) {
+    for (uint32_t e = graph.offsets()[u]; e < graph.offsets()[u + 1]; ++e) {
+      addArc(out, in, u, graph.targets()[e], graph.costs()[e], kNoMiddle);
+    }
+  }
+
+  std::vector<bool> contracted(nodeCount, false);
+  std::vector<uint32_t> deletedNeighbours(nodeCount, 0);
+  SearchSpace witness;
+
+  // Local Dijkstra from source among uncontracted lanes, avoiding skip
+  const auto witnessSearch = [&](uint32_t source, uint32_t skip,
+                                 double maxCost) {
+    witness.prepare(nodeCount);
+    witness.set(source, 0.0, kNoParent);
+    MinQueue queue;
+    queue.emplace(0.0, source);
+    size_t settled = 0;
+    while (!queue.empty() && settled < kWitnessSettleLimit) {
+      const auto [d, node] = queue.top();
+      queue.pop();
+      if (d > witness.get(node)) {
+        continue;
+      }
+      if (d > maxCost) {
+        break;
+      }
+      settled++;
+      for (const auto& arc : out[node]) {
+        if (contracted[arc.node] || arc.node == skip) {
+          continue;
+        }
+        const double candidate{d + arc.cost};
+        if (candidate < witness.get(arc.node)) {
+          witness.set(arc.node, candidate, node);
+          queue.emplace(candidate, arc.node);
+        }
+      }
+    }
+  };
+
+  // Count (or add) the shortcuts contracting node would need
+  const auto contractNode = [&](uint32_t node, bool apply) {
+    int shortcuts = 0;
+    double maxOut = 0.0;
+    for (const auto& arc : out[node]) {
+      if (!contracted[arc.node]) {
+        maxOut = std::max(maxOut, arc.cost);
+      }
+    }
+
+    // Copy: applying shortcuts may grow in[node] through addArc
+    const std::vector<Arc> incoming{in[node]};
+    const std::vector<Arc> outgoing{out[node]};
+    for (const auto& inArc : incoming) {
+      if (contracted[inArc.node]) {
+        continue;
+      }
+      witnessSearch(inArc.node, node, inArc.cost + maxOut);
+      for (const auto& outArc : outgoing) {
+        if (contracted[outArc.node] || outArc.node == inArc.node) {
+          continue;
+        }
+        const double viaCost{inArc.cost + outArc.cost};
+        if (witness.get(outArc.node) <= viaCost) {
+          continue;
+        }
+        shortcuts++;
+        if (apply) {
+          addArc(out, in, inArc.node, outArc.node, viaCost, node);
+          shortcutCount_++;
+        }
+      }
+    }
+    return shortcuts;
+  };
+
+  const auto priority = [&](uint32_t node) {
+    int removed = 0;
+    for (const auto& arc : in[node]) {
+      removed += contracted[arc.node] ? 0 : 1;
+    }
+    for (const auto& arc : out[node]) {
+      removed += contracted[arc.node] ? 0 : 1;
+    }
+    // Edge difference plus a term that spreads contraction evenly
+    return static_cast<double>(contractNode(node, false) - removed) +
+           static_cast<double>(deletedNeighbours[node]);
+  };
+
+  MinQueue order;
+  for (uint32_t node = 0; node < nodeCount; ++node) {
+    order.emplace(priority(node), node);
+  }
+
+  rank_.assign(nodeCount, 0);
+  uint32_t nextRank = 0;
+  while (!order.empty()) {
+    const uint32_t node{order.top().second};
+    order.pop();
+    if (contracted[node]) {
+      continue;
+    }
+
+    // Lazy update: re-evaluate and postpone if no longer the minimum
+    const double current{priority(node)};
+    if (!order.empty() && current > order.top().first) {
+      order.emplace(current, node);
+      continue;
+    }
+
+    contractNode(node, true);
+    contracted[node] = true;
+    rank_[node] = nextRank++;
+    for (const auto& arc : in[node]) {
+      deletedNeighbours[arc.node]++;
+    }
+    for (const auto& arc : out[node]) {
+      deletedNeighbours[arc.node]++;
+    }
+  }
+
+  // Split every arc into the upward or downward search graph
+  std::vector<std::vector<Edge>> up(nodeCount);
+  std::vector<std::vector<Edge>> down(nodeCount);
+  for (uint32_t u = 0; u < nodeCount; ++u) {
+    for (const auto& arc : out[u]) {
+      if (rank_[u] < rank_[arc.node]) {
+        up[u].push_back({arc.node, arc.middle, arc.cost});
+      } else {
+        down[arc.node].push_back({u, arc.middle, arc.cost});
+      }
+    }
+  }
+
+  const auto flatten = [nodeCount](const std::vector<std::vector<Edge>>& lists,
+                                   IndexVector<uint32_t>& offsets,
+                                   IndexVector<Edge>& edges) {
+    offsets.reserve(nodeCount + 1);
+    offsets.push_back(0);
+    for (const auto& list : lists) {
+      edges.insert(edges.end(), list.begin(), list.end());
+      offsets.push_back(static_cast<uint32_t>(edges.size()));
+    }
+  };
+  flatten(up, upOffsets_, upEdges_);
+  flatten(down, downOffsets_, downEdges_);
+
+  fingerprint_ = fingerprint(graph);
+}
+
+void ContractionHierarchy::clear() {
+  rank_.clear();
+  upOffsets_.clear();
+  upEdges_.clear();
+  downOffsets_.clear();
+  downEdges_.clear();
+  shortcutCount_ = 0;
+  fingerprint_ = 0;
+}
+
+uint64_t ContractionHierarchy::fingerprint(const RoutingGraph& graph) {
+  // FNV-1a over node ids, topology and edge costs
+  uint64_t hash = 14695981039346656037ULL;
+  const auto mix = [&hash](const void* data, size_t size) {
+    const auto* bytes{static_cast<const unsigned char*>(data)};
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  };
+
+  const uint64_t nodeCount{graph.nodeCount()};
+  mix(&nodeCount, sizeof(nodeCount));
+  for (uint32_t i = 0; i < graph.nodeCount(); ++i) {
+    const uint64_t laneId{graph.laneIdAt(i)};
+    mix(&laneId, sizeof(laneId));
+  }
+  mix(graph.offsets().data(), graph.offsets().size() * sizeof(uint32_t));
+  mix(graph.targets().data(), graph.targets().size() * sizeof(uint32_t));
+  mix(graph.costs().data(), graph.costs().size() * sizeof(double));
+  return hash;
+}
+
+bool ContractionHierarchy::save(const std::string& filepath) const {
+  std::ofstream file{filepath, std::ios::binary};
+  if (!file.is_open()) {
+    spdlog::error("Cannot write routing hierarchy: {}", filepath);
+    return false;
+  }
+
+  const uint64_t shortcuts{shortcutCount_};
+  file.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+  file.write(reinterpret_cast<const char*>(&kFileVersion),
+             sizeof(kFileVersion));
+  file.write(reinterpret_cast<const char*>(&fingerprint_),
+             sizeof(fingerprint_));
+  file.write(reinterpret_cast<const char*>(&shortcuts), sizeof(shortcuts));
+  writeVector(file, rank_);
+  writeVector(file, upOffsets_);
+  writeVector(file, upEdges_);
+  writeVector(file, downOffsets_);
+  writeVector(file, downEdges_);
+  return file.good();
+}
+
+bool ContractionHierarchy::load(const std::string& filepath,
+                                const RoutingGraph& graph) {
+  clear();
+
+  std::ifstream file{filepath, std::ios::binary | std::ios::ate};
+  if (!file.is_open()) {
+    lastError_ = "Cannot open file: " + filepath;
+    return false;
+  }
+  const auto fileSize{static_cast<uint64_t>(file.tellg())};
+  file.seekg(0);
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t storedFingerprint = 0;
+  uint64_t shortcuts = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&storedFingerprint),
+            sizeof(storedFingerprint));
+  file.read(reinterpret_cast<char*>(&shortcuts), sizeof(shortcuts));
+  if (!file || magic != kFileMagic || version != kFileVersion) {
+    lastError_ = "Not a routing hierarchy file: " + filepath;
+    return false;
+  }
+  if (storedFingerprint != fingerprint(graph)) {
+    lastError_ = "Routing hierarchy was built for a different map: " + filepath;
+    return false;
+  }
+
+  const bool ok{readVector(file, fileSize, rank_) &&
+                readVector(file, fileSize, upOffsets_) &&
+                readVector(file, fileSize, upEdges_) &&
+                readVector(file, fileSize, downOffsets_) &&
+                readVector(file, fileSize, downEdges_)};
+  const size_t nodeCount{graph.nodeCount()};
+  if (!ok || rank_.size() != nodeCount || !validRanks(rank_) ||
+      !validCsr(upOffsets_, upEdges_, nodeCount) ||
+      !validCsr(downOffsets_, downEdges_, nodeCount) ||
+      !validOrder(upOffsets_, upEdges_, rank_) ||
+      !validOrder(downOffsets_, downEdges_, rank_)) {
+    clear();
+    lastError_ = "Corrupt routing hierarchy file: " + filepath;
+    return false;
+  }
+
+  shortcutCount_ = shortcuts;
+  fingerprint_ = storedFingerprint;
+  return true;
+}
+
+std::optional<Route> ContractionHierarchy::route(const RoutingGraph& graph,
+                                                 uint64_t fromLaneId,
+                                                 uint64_t toLaneId) const {
+  const auto from{graph.indexOf(fromLaneId)};
+  const auto to{graph.indexOf(toLaneId)};
+  if (empty() || !from.has_value() || !to.has_value()) {
+    return std::nullopt;
+  }
+
+  thread_local SearchSpace forward;
+  thread_local SearchSpace backward;
+  forward.prepare(rank_.size());
+  backward.prepare(rank_.size());
+
+  MinQueue forwardQueue;
+  MinQueue backwardQueue;
+  forward.set(*from, 0.0, kNoParent);
+  backward.set(*to, 0.0, kNoParent);
+  forwardQueue.emplace(0.0, *from);
+  backwardQueue.emplace(0.0, *to);
+
+  double best = kInfinity;
+  uint32_t meeting = kNoParent;
+  size_t explored = 0;
+
+  const auto topOf = [](const MinQueue& queue) {
+    return queue.empty() ? kInfinity : queue.top().first;
+  };
+
+  // Upward search in both directions; each side stops once its queue
+  // minimum can no longer improve the best meeting point
+  while (topOf(forwardQueue) < best || topOf(backwardQueue) < best) {
+    const bool forwardStep{topOf(forwardQueue) <= topOf(backwardQueue)};
+    MinQueue& queue{forwardStep ? forwardQueue : backwardQueue};
+    SearchSpace& space{forwardStep ? forward : backward};
+    const SearchSpace& other{forwardStep ? backward : forward};
+    const auto& offsets{forwardStep ? upOffsets_ : downOffsets_};
+    const auto& edges{forwardStep ? upEdges_ : downEdges_};
+
+    const auto [d, node] = queue.top();
+    queue.pop();
+    if (d > space.get(node)) {
+      continue;
+    }
+    explored++;
+
+    const double otherDist{other.get(node)};
+    if (otherDist < kInfinity && d + otherDist < best) {
+      best = d + otherDist;
+      meeting = node;
+    }
+
+    for (uint32_t e = offsets[node]; e < offsets[node + 1]; ++e) {
+      const double candidate{d + edges[e].cost};
+      if (candidate < space.get(edges[e].target)) {
+        space.set(edges[e].target, candidate, node);
+        queue.emplace(candidate, edges[e].target);
+      }
+    }
+  }
+
+  if (meeting == kNoParent) {
+    return std::nullopt;
+  }
+
+  // Hierarchy path: from -> ... -> meeting -> ... -> to
+  std::vector<uint32_t> hierarchyPath;
+  for (uint32_t node = meeting; node != kNoParent;
+       node = forward.parentOf(node)) {
+    hierarchyPath.push_back(node);
+  }
+  std::reverse(hierarchyPath.begin(), hierarchyPath.end());
+  for (uint32_t node = backward.parentOf(meeting); node != kNoParent;
+       node = backward.parentOf(node)) {
+    hierarchyPath.push_back(node);
+  }
+
+  std::vector<uint32_t> path{hierarchyPath.front()};
+  for (size_t i = 1; i < hierarchyPath.size(); ++i) {
+    unpack(hierarchyPath[i - 1], hierarchyPath[i], path);
+  }
+
+  Route route;
+  route.cost = graph.laneCost(*from) + best;
+  route.nodesExplored = explored;
+  route.laneIds.reserve(path.size());
+  for (const auto node : path) {
+    route.laneIds.push_back(graph.laneIdAt(node));
+  }
+  return route;
+}
+
+const ContractionHierarchy::Edge* ContractionHierarchy::findEdge(
+    uint32_t from, uint32_t to) const {
+  // Upward edges are stored at their tail, downward ones at their head
+  const bool upward{rank_[from] < rank_[to]};
+  const uint32_t owner{upward ? from : to};
+  const uint32_t other{upward ? to : from};
+  const auto& offsets{upward ? upOffsets_ : downOffsets_};
+  const auto& edges{upward ? upEdges_ : downEdges_};
+
+  const Edge* best = nullptr;
+  for (uint32_t e = offsets[owner]; e < offsets[owner + 1]; ++e) {
+    if (edges[e].target == other &&
+        (best == nullptr || edges[e].cost < best->cost)) {
+      best = &edges[e];
+    }
+  }
+  return best;
+}
+
+void ContractionHierarchy::unpack(uint32_t from, uint32_t to,
+                                  std::vector<uint32_t>& path) const {
+  const Edge* edge{findEdge(from, to)};
+  if (edge == nullptr || edge->middle == kNoMiddle) {
+    path.push_back(to);
+    return;
+  }
+  unpack(from, edge->middle, path);
+  unpack(edge->middle, to, path);
+}
+
+}  // namespace hdmap
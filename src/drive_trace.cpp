@@ -0,0 +1,330 @@
+#include "include/drive_trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace hdmap {
+
+namespace {
+
+constexpr std::array<const char*, kTraceQueryTypeCount> kQueryNames{
+    "radius", "closest", "nearby", "region",
+    "lane",   "lights",  "signs",  "project"};
+
+std::vector<std::string> splitFields(const std::string& line) {
+  std::vector<std::string> fields;
+  std::stringstream stream{line};
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+// Fields after timestamp and name per query type
+size_t argumentCount(TraceQueryType type) {
+  switch (type) {
+    case TraceQueryType::RADIUS:
+    case TraceQueryType::NEARBY_LANES:
+    case TraceQueryType::PROJECT:
+      return 3;
+    case TraceQueryType::CLOSEST_LANE:
+      return 2;
+    case TraceQueryType::REGION:
+      return 4;
+    case TraceQueryType::LANE:
+    case TraceQueryType::TRAFFIC_LIGHTS:
+    case TraceQueryType::TRAFFIC_SIGNS:
+      return 1;
+  }
+  return 0;
+}
+
+LatencySummary summarize(std::vector<uint64_t>& latencies) {
+  LatencySummary summary;
+  if (latencies.empty()) {
+    return summary;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&latencies](double fraction) {
+    const auto rank{static_cast<size_t>(fraction * latencies.size())};
+    return latencies[std::min(rank, latencies.size() - 1)];
+  };
+  summary.count = latencies.size();
+  summary.p50 = percentile(0.5);
+  summary.p99 = percentile(0.99);
+  summary.p999 = percentile(0.999);
+  summary.max = latencies.back();
+  double total{0.0};
+  for (const auto latency : latencies) {
+    total += static_cast<double>(latency);
+  }
+  summary.mean = total / latencies.size();
+  return summary;
+}
+
+}  // namespace
+
+const char* traceQueryName(TraceQueryType type) {
+  return kQueryNames[static_cast<size_t>(type)];
+}
+
+bool DriveTrace::load(const std::string& filepath) {
+  queries_.clear();
+  std::ifstream file{filepath};
+  if (!file.is_open()) {
+    lastError_ = "Cannot open trace: " + filepath;
+    return false;
+  }
+
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    const auto fields{splitFields(line)};
+    const auto malformed = [&]() {
+      lastError_ = "Malformed trace line " + std::to_string(lineNumber);
+      queries_.clear();
+      return false;
+    };
+    if (fields.size() < 2) {
+      return malformed();
+    }
+    const auto name{std::find(kQueryNames.begin(), kQueryNames.end(),
+                              fields[1])};
+    if (name == kQueryNames.end()) {
+      return malformed();
+    }
+
+    TraceQuery query;
+    query.type =
+        static_cast<TraceQueryType>(std::distance(kQueryNames.begin(), name));
+    if (fields.size() != 2 + argumentCount(query.type)) {
+      return malformed();
+    }
+    try {
+      query.timestamp = std::stod(fields[0]);
+      switch (query.type) {
+        case TraceQueryType::RADIUS:
+        case TraceQueryType::NEARBY_LANES:
+          query.radius = std::stod(fields[4]);
+          [[fallthrough]];
+        case TraceQueryType::CLOSEST_LANE:
+          query.point = Point2D(std::stod(fields[2]), std::stod(fields[3]));
+          break;
+        case TraceQueryType::REGION:
+          query.region =
+              BoundingBox{Point2D(std::stod(fields[2]), std::stod(fields[3])),
+                          Point2D(std::stod(fields[4]), std::stod(fields[5]))};
+          break;
+        case TraceQueryType::PROJECT:
+          query.point = Point2D(std::stod(fields[3]), std::stod(fields[4]));
+          [[fallthrough]];
+        case TraceQueryType::LANE:
+        case TraceQueryType::TRAFFIC_LIGHTS:
+        case TraceQueryType::TRAFFIC_SIGNS:
+          query.laneId = std::stoull(fields[2]);
+          break;
+      }
+    } catch (const std::exception&) {
+      return malformed();
+    }
+    queries_.push_back(query);
+  }
+  return true;
+}
+
+bool DriveTrace::save(const std::string& filepath) const {
+  std::ofstream file{filepath};
+  if (!file.is_open()) {
+    return false;
+  }
+  file << std::setprecision(12);
+  file << "# timestamp,query,arguments\n";
+  for (const auto& query : queries_) {
+    file << query.timestamp << ',' << traceQueryName(query.type);
+    switch (query.type) {
+      case TraceQueryType::RADIUS:
+      case TraceQueryType::NEARBY_LANES:
+        file << ',' << query.point.x << ',' << query.point.y << ','
+             << query.radius;
+        break;
+      case TraceQueryType::CLOSEST_LANE:
+        file << ',' << query.point.x << ',' << query.point.y;
+        break;
+      case TraceQueryType::REGION:
+        file << ',' << query.region.min.x << ',' << query.region.min.y << ','
+             << query.region.max.x << ',' << query.region.max.y;
+        break;
+      case TraceQueryType::LANE:
+      case TraceQueryType::TRAFFIC_LIGHTS:
+      case TraceQueryType::TRAFFIC_SIGNS:
+        file << ',' << query.laneId;
+        break;
+      case TraceQueryType::PROJECT:
+        file << ',' << query.laneId << ',' << query.point.x << ','
+             << query.point.y;
+        break;
+    }
+    file << '\n';
+  }
+  return static_cast<bool>(file);
+}
+
+DriveTrace DriveTrace::synthesize(const MapServer& server,
+                                  const DriveConfig& config) {
+  DriveTrace trace;
+  if (server.getLaneCount() == 0 || config.queryRate <= 0.0) {
+    return trace;
+  }
+
+  // Lane ids in order so the start lane only depends on the seed
+  std::vector<uint64_t> laneIds;
+  laneIds.reserve(server.getLaneCount());
+  for (const auto& [id, lane] : server.getLanes()) {
+    laneIds.push_back(id);
+  }
+  std::sort(laneIds.begin(), laneIds.end());
+
+  std::mt19937_64 random{config.seed};
+  uint64_t laneId{laneIds[random() % laneIds.size()]};
+  double s{0.0};
+  const double step{1.0 / config.queryRate};
+
+  const auto rounds{static_cast<size_t>(
+      std::llround(config.duration * config.queryRate))};
+  for (size_t round = 0; round < rounds; ++round) {
+    const double t{round * step};
+    // Move on to a successor, or jump to a random lane at a dead end
+    double laneLength{server.getLaneLength(laneId).value_or(0.0)};
+    while (s > laneLength && laneLength > 0.0) {
+      const auto& successors{server.getLanes().at(laneId)->successorIds};
+      if (successors.empty()) {
+        laneId = laneIds[random() % laneIds.size()];
+        s = 0.0;
+      } else {
+        laneId = successors[random() % successors.size()];
+        s -= laneLength;
+      }
+      laneLength = server.getLaneLength(laneId).value_or(0.0);
+    }
+    const auto pose{server.interpolate(laneId, s)};
+    if (!pose.has_value()) {
+      break;
+    }
+
+    TraceQuery query;
+    query.timestamp = t;
+    query.point = pose->point;
+    query.type = TraceQueryType::CLOSEST_LANE;
+    trace.queries_.push_back(query);
+
+    query.type = TraceQueryType::PROJECT;
+    query.laneId = laneId;
+    trace.queries_.push_back(query);
+
+    query.type = TraceQueryType::RADIUS;
+    query.radius = config.lookupRadius;
+    trace.queries_.push_back(query);
+
+    query.type = TraceQueryType::TRAFFIC_LIGHTS;
+    trace.queries_.push_back(query);
+
+    query.type = TraceQueryType::TRAFFIC_SIGNS;
+    trace.queries_.push_back(query);
+
+    s += config.speed * step;
+  }
+  return trace;
+}
+
+size_t TraceReplayer::execute(const MapServer& server,
+                             const TraceQuery& query) {
+  switch (query.type) {
+    case TraceQueryType::RADIUS:
+      return server.queryRadius(query.point, query.radius).totalCount();
+    case TraceQueryType::CLOSEST_LANE:
+      return server.getClosestLane(query.point).has_value() ? 1 : 0;
+    case TraceQueryType::NEARBY_LANES:
+      return server.getNearbyLanes(query.point, query.radius).size();
+    case TraceQueryType::REGION:
+      return server.queryRegion(query.region).totalCount();
+    case TraceQueryType::LANE:
+      return server.getLaneById(query.laneId).has_value() ? 1 : 0;
+    case TraceQueryType::TRAFFIC_LIGHTS:
+      return server.getTrafficLightsForLane(query.laneId).size();
+    case TraceQueryType::TRAFFIC_SIGNS:
+      return server.getTrafficSignsForLane(query.laneId).size();
+    case TraceQueryType::PROJECT:
+      return server.project(query.laneId, query.point).has_value() ? 1 : 0;
+  }
+  return 0;
+}
+
+ReplayReport TraceReplayer::replay(const MapServer& server,
+                                   const DriveTrace& trace, bool realTime,
+                                   double speedup) {
+  using Clock = std::chrono::steady_clock;
+  const auto nanoseconds = [](Clock::duration duration) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+  };
+  std::array<std::vector<uint64_t>, kTraceQueryTypeCount> latencies;
+  for (auto& samples : latencies) {
+    samples.reserve(trace.queries().size());
+  }
+  std::vector<uint64_t> queueing;
+  std::vector<uint64_t> response;
+
+  ReplayReport report;
+  const bool scheduled{realTime && speedup > 0.0};
+  const auto start{Clock::now()};
+  const double firstTimestamp{
+      trace.queries().empty() ? 0.0 : trace.queries().front().timestamp};
+  for (const auto& query : trace.queries()) {
+    Clock::time_point due;
+    if (scheduled) {
+      due = start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(
+                            (query.timestamp - firstTimestamp) / speedup));
+      std::this_thread::sleep_until(due);
+    }
+    const auto before{Clock::now()};
+    report.results += execute(server, query);
+    const auto after{Clock::now()};
+    latencies[static_cast<size_t>(query.type)].push_back(
+        nanoseconds(after - before));
+    if (scheduled) {
+      // Includes the wait behind slow predecessors (coordinated omission)
+      // and any oversleep, kept apart from the per-type service times
+      queueing.push_back(
+          nanoseconds(std::max(before - due, Clock::duration::zero())));
+      response.push_back(nanoseconds(after - due));
+    }
+  }
+  report.wallSeconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint64_t> all;
+  for (size_t i = 0; i < kTraceQueryTypeCount; ++i) {
+    all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+    report.byType[i] = summarize(latencies[i]);
+  }
+  report.queueing = summarize(queueing);
+  report.response = summarize(response);
+  report.all = summarize(all);
+  return report;
+}
+
+}  // namespace hdmap
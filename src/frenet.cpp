@@ -0,0 +1,184 @@
+#include "include/frenet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+// Squared distance from (px, py) to each segment of count + 1 vertices.
+// Branch-free so the compiler can vectorize across segments.
+template <typename X, typename Y>
+void segmentDistanceKernel(const X& x, const Y& y, size_t count, double px,
+                           double py, double* out) {
+  for (size_t i = 0; i < count; ++i) {
+    const double dx = x(i + 1) - x(i);
+    const double dy = y(i + 1) - y(i);
+    const double wx = px - x(i);
+    const double wy = py - y(i);
+    const double lengthSquared = dx * dx + dy * dy;
+    const double raw = lengthSquared > 0.0
+                           ? (wx * dx + wy * dy) / lengthSquared
+                           : 0.0;
+    const double t = std::min(1.0, std::max(0.0, raw));
+    const double ex = wx - t * dx;
+    const double ey = wy - t * dy;
+    out[i] = ex * ex + ey * ey;
+  }
+}
+
+// Index of the segment containing arc length s in a cumulative table
+template <typename Table>
+size_t segmentAt(const Table& table, double s, size_t segmentCount) {
+  // First vertex beyond s; the segment before it contains s
+  const auto upper{std::upper_bound(table.begin(), table.end(), s)};
+  const auto segment{static_cast<size_t>(upper - table.begin())};
+  return std::min(std::max<size_t>(segment, 1), segmentCount) - 1;
+}
+
+}  // namespace
+
+ArcLengthTable::ArcLengthTable(std::shared_ptr<const Lane> lane)
+    : lane_{std::move(lane)}, compact_{!lane_->compactCenterline.empty()} {
+  const size_t count{lane_->centerlineSize()};
+  if (compact_) {
+    compactS_.reserve(count);
+  } else {
+    s_.reserve(count);
+  }
+
+  double s = 0.0;
+  Point2D previous;
+  for (size_t i = 0; i < count; ++i) {
+    const Point2D point{vertex(i)};
+    if (i > 0) {
+      s += previous.distanceTo(point);
+    }
+    if (compact_) {
+      compactS_.push_back(static_cast<float>(s));
+    } else {
+      s_.push_back(s);
+    }
+    previous = point;
+  }
+}
+
+void ArcLengthTable::segmentDistances(double px, double py,
+                                      std::vector<double>& distances) const {
+  const size_t count{segmentCount()};
+  distances.resize(count);
+
+  if (compact_) {
+    // Stay in the tile frame, as CompactPolyline does
+    const auto& polyline{lane_->compactCenterline};
+    const float* xs{polyline.xs()};
+    const float* ys{polyline.ys()};
+    segmentDistanceKernel(
+        [xs](size_t i) { return static_cast<double>(xs[i]); },
+        [ys](size_t i) { return static_cast<double>(ys[i]); }, count,
+        px - polyline.origin().x, py - polyline.origin().y, distances.data());
+  } else {
+    const Point2D* points{lane_->centerline.data()};
+    segmentDistanceKernel([points](size_t i) { return points[i].x; },
+                          [points](size_t i) { return points[i].y; }, count,
+                          px, py, distances.data());
+  }
+}
+
+FrenetPoint ArcLengthTable::frenetOnSegment(double px, double py,
+                                            size_t segment) const {
+  FrenetPoint result;
+  result.segment = segment;
+
+  const Point2D start{vertex(segment)};
+  const Point2D end{vertex(segment + 1)};
+  const double dx = end.x - start.x;
+  const double dy = end.y - start.y;
+  const double wx = px - start.x;
+  const double wy = py - start.y;
+  const double length = arcLength(segment + 1) - arcLength(segment);
+  const double lengthSquared = dx * dx + dy * dy;
+  const double t =
+      lengthSquared > 0.0
+          ? std::min(1.0, std::max(0.0, (wx * dx + wy * dy) / lengthSquared))
+          : 0.0;
+
+  const double ex = wx - t * dx;
+  const double ey = wy - t * dy;
+  const double cross = dx * wy - dy * wx;
+  result.s = arcLength(segment) + t * length;
+  result.d = std::copysign(std::sqrt(ex * ex + ey * ey), cross);
+  return result;
+}
+
+FrenetPoint ArcLengthTable::project(const Point2D& point) const {
+  if (segmentCount() == 0) {
+    FrenetPoint result;
+    if (vertexCount() > 0) {
+      result.d = point.distanceTo(vertex(0));
+    }
+    return result;
+  }
+
+  // Reused between calls so single projections do not allocate
+  thread_local std::vector<double> distances;
+  segmentDistances(point.x, point.y, distances);
+  const auto closest{static_cast<size_t>(
+      std::min_element(distances.begin(), distances.end()) -
+      distances.begin())};
+  return frenetOnSegment(point.x, point.y, closest);
+}
+
+void ArcLengthTable::project(const std::vector<Point2D>& points,
+                             std::vector<FrenetPoint>& results) const {
+  results.resize(points.size());
+  if (segmentCount() == 0) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      results[i] = project(points[i]);
+    }
+    return;
+  }
+
+  // One scratch buffer for the whole batch
+  std::vector<double> distances;
+  distances.reserve(segmentCount());
+  for (size_t i = 0; i < points.size(); ++i) {
+    segmentDistances(points[i].x, points[i].y, distances);
+    const auto closest{static_cast<size_t>(
+        std::min_element(distances.begin(), distances.end()) -
+        distances.begin())};
+    results[i] = frenetOnSegment(points[i].x, points[i].y, closest);
+  }
+}
+
+LanePose ArcLengthTable::interpolate(double s) const {
+  LanePose pose;
+  if (vertexCount() == 0) {
+    return pose;
+  }
+  if (segmentCount() == 0) {
+    pose.point = vertex(0);
+    return pose;
+  }
+
+  s = std::min(std::max(s, 0.0), length());
+  const size_t segment{compact_ ? segmentAt(compactS_, s, segmentCount())
+                                : segmentAt(s_, s, segmentCount())};
+
+  const Point2D start{vertex(segment)};
+  const Point2D end{vertex(segment + 1)};
+  const double dx = end.x - start.x;
+  const double dy = end.y - start.y;
+  const double length = arcLength(segment + 1) - arcLength(segment);
+  const double t = length > 0.0 ? (s - arcLength(segment)) / length : 0.0;
+
+  pose.point = Point2D{start.x + t * dx, start.y + t * dy};
+  pose.heading = std::atan2(dy, dx);
+  return pose;
+}
+
+}  // namespace hdmap
@@ -0,0 +1,106 @@
+#include <cstdint>
+#include <iostream>
+#include <spdlog/spdlog.h>
+#include <string>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/tile_store.hpp"
+
+// Writes a synthetic city map, optionally also as a tile directory
+
+namespace {
+
+void printUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "  --output FILE        OSM file to write (default city.osm)\n"
+      << "  --layout grid|radial street layout (default grid)\n"
+      << "  --lanes N            number of lanes (default 1000)\n"
+      << "  --lane-length M      meters between intersections (default 50)\n"
+      << "  --points N           centerline vertices per lane (default 5)\n"
+      << "  --curvature F        max bend as a fraction of lane length\n"
+      << "  --lights F           traffic light chance per lane end\n"
+      << "  --signs F            traffic sign chance per lane start\n"
+      << "  --seed N             random seed (default 42)\n"
+      << "  --tiles DIR          also write a tile store to DIR\n"
+      << "  --tile-size M        tile edge length for --tiles\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  hdmap::CityConfig config;
+  std::string output{"city.osm"};
+  std::string tileDirectory;
+  double tileSize{hdmap::kDefaultTileSize};
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg == "--help" || arg == "-h") {
+      printUsage(argv[0]);
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    const std::string value{argv[++i]};
+    if (arg == "--output") {
+      output = value;
+    } else if (arg == "--layout" && (value == "grid" || value == "radial")) {
+      config.layout = value == "grid" ? hdmap::CityLayout::GRID
+                                      : hdmap::CityLayout::RADIAL;
+    } else if (arg == "--lanes") {
+      config.laneCount = std::stoull(value);
+    } else if (arg == "--lane-length") {
+      config.laneLength = std::stod(value);
+    } else if (arg == "--points") {
+      config.pointsPerLane = std::stoull(value);
+    } else if (arg == "--curvature") {
+      config.curvature = std::stod(value);
+    } else if (arg == "--lights") {
+      config.trafficLightDensity = std::stod(value);
+    } else if (arg == "--signs") {
+      config.trafficSignDensity = std::stod(value);
+    } else if (arg == "--seed") {
+      config.seed = std::stoull(value);
+    } else if (arg == "--tiles") {
+      tileDirectory = value;
+    } else if (arg == "--tile-size") {
+      tileSize = std::stod(value);
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  hdmap::CityGenerator generator{config};
+  if (!generator.writeOsm(output)) {
+    spdlog::error(generator.getLastError());
+    return 1;
+  }
+  const auto& stats{generator.stats()};
+  std::cout << "Wrote " << output << ": " << stats.lanes << " lanes, "
+            << stats.nodes << " nodes, " << stats.trafficLights
+            << " traffic lights, " << stats.trafficSigns
+            << " traffic signs\n";
+
+  if (!tileDirectory.empty()) {
+    // Lift the limits: the whole city is loaded once to be partitioned
+    auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+    constraints.maxTotalMemory = SIZE_MAX;
+    constraints.maxLanes = SIZE_MAX;
+    constraints.maxTrafficLights = SIZE_MAX;
+    constraints.maxTrafficSigns = SIZE_MAX;
+    hdmap::MapServer server{constraints};
+    hdmap::TileStore tileStore;
+    if (!server.loadFromFile(output) ||
+        !tileStore.write(server, tileDirectory, tileSize)) {
+      return 1;
+    }
+    std::cout << "Map tiles written to: " << tileDirectory << "\n";
+  }
+
+  return 0;
+}
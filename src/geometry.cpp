@@ -0,0 +1,285 @@
+#include "include/geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+double clamp01(double value) {
+  return std::min(1.0, std::max(0.0, value));
+}
+
+// Orientation of c relative to a -> b
+double cross(const Point2D& a, const Point2D& b, const Point2D& c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+bool segmentsIntersect(const Point2D& a0, const Point2D& a1, const Point2D& b0,
+                       const Point2D& b1) {
+  const double d1{cross(b0, b1, a0)};
+  const double d2{cross(b0, b1, a1)};
+  const double d3{cross(a0, a1, b0)};
+  const double d4{cross(a0, a1, b1)};
+  return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
+         ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0));
+}
+
+}  // namespace
+
+double pointSegmentDistance(const Point2D& point, const Point2D& a,
+                            const Point2D& b) {
+  const double dx = b.x - a.x;
+  const double dy = b.y - a.y;
+  const double lengthSquared = dx * dx + dy * dy;
+  if (lengthSquared <= 0.0) {
+    return point.distanceTo(a);
+  }
+  const double t =
+      clamp01(((point.x - a.x) * dx + (point.y - a.y) * dy) / lengthSquared);
+  return point.distanceTo(Point2D{a.x + t * dx, a.y + t * dy});
+}
+
+SegmentClosestPoints closestPoints(const Point2D& a0, const Point2D& a1,
+                                   const Point2D& b0, const Point2D& b1) {
+  // Ericson, Real-Time Collision Detection, section 5.1.9
+  const double d1x = a1.x - a0.x;
+  const double d1y = a1.y - a0.y;
+  const double d2x = b1.x - b0.x;
+  const double d2y = b1.y - b0.y;
+  const double rx = a0.x - b0.x;
+  const double ry = a0.y - b0.y;
+  const double a = d1x * d1x + d1y * d1y;
+  const double e = d2x * d2x + d2y * d2y;
+  const double f = d2x * rx + d2y * ry;
+
+  double s = 0.0;
+  double t = 0.0;
+  if (a <= 0.0 && e <= 0.0) {
+    // Both segments are points
+  } else if (a <= 0.0) {
+    t = clamp01(f / e);
+  } else {
+    const double c = d1x * rx + d1y * ry;
+    if (e <= 0.0) {
+      s = clamp01(-c / a);
+    } else {
+      const double b = d1x * d2x + d1y * d2y;
+      const double denom = a * e - b * b;
+      s = denom > 0.0 ? clamp01((b * f - c * e) / denom) : 0.0;
+      t = (b * s + f) / e;
+      if (t < 0.0) {
+        t = 0.0;
+        s = clamp01(-c / a);
+      } else if (t > 1.0) {
+        t = 1.0;
+        s = clamp01((b - c) / a);
+      }
+    }
+  }
+
+  SegmentClosestPoints result;
+  result.onFirst = Point2D{a0.x + s * d1x, a0.y + s * d1y};
+  result.onSecond = Point2D{b0.x + t * d2x, b0.y + t * d2y};
+  result.distance = result.onFirst.distanceTo(result.onSecond);
+  return result;
+}
+
+double pointBoxDistance(const Point2D& point, const BoundingBox& box) {
+  const double dx =
+      std::max({box.min.x - point.x, 0.0, point.x - box.max.x});
+  const double dy =
+      std::max({box.min.y - point.y, 0.0, point.y - box.max.y});
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+double segmentBoxDistance(const Point2D& a, const Point2D& b,
+                          const BoundingBox& box) {
+  if (box.contains(a) || box.contains(b)) {
+    return 0.0;
+  }
+
+  const Point2D corners[4]{box.min, Point2D{box.max.x, box.min.y}, box.max,
+                           Point2D{box.min.x, box.max.y}};
+  double distance =
+      std::min(pointBoxDistance(a, box), pointBoxDistance(b, box));
+  for (int i = 0; i < 4; ++i) {
+    const Point2D& c0{corners[i]};
+    const Point2D& c1{corners[(i + 1) % 4]};
+    if (segmentsIntersect(a, b, c0, c1)) {
+      return 0.0;
+    }
+    distance = std::min(distance, pointSegmentDistance(c0, a, b));
+  }
+  return distance;
+}
+
+BoundingBox polylineBounds(const std::vector<Point2D>& points, double margin) {
+  if (points.empty()) {
+    return BoundingBox{};
+  }
+
+  BoundingBox bounds{points[0], points[0]};
+  for (const auto& point : points) {
+    bounds.min.x = std::min(bounds.min.x, point.x);
+    bounds.min.y = std::min(bounds.min.y, point.y);
+    bounds.max.x = std::max(bounds.max.x, point.x);
+    bounds.max.y = std::max(bounds.max.y, point.y);
+  }
+  bounds.min.x -= margin;
+  bounds.min.y -= margin;
+  bounds.max.x += margin;
+  bounds.max.y += margin;
+  return bounds;
+}
+
+ConvexPolygon::ConvexPolygon(std::vector<Point2D> vertices)
+    : vertices_{std::move(vertices)} {
+  if (vertices_.empty()) {
+    return;
+  }
+
+  // Normalise to counter-clockwise winding (positive signed area)
+  double area = 0.0;
+  for (size_t i = 0; i < vertices_.size(); ++i) {
+    const Point2D& a{vertices_[i]};
+    const Point2D& b{vertices_[(i + 1) % vertices_.size()]};
+    area += a.x * b.y - b.x * a.y;
+  }
+  if (area < 0.0) {
+    std::reverse(vertices_.begin(), vertices_.end());
+  }
+
+  bounds_ = polylineBounds(vertices_, 0.0);
+
+  const size_t count{vertices_.size()};
+  normals_.reserve(count);
+  minProjection_.reserve(count);
+  maxProjection_.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const Point2D& a{vertices_[i]};
+    const Point2D& b{vertices_[(i + 1) % count]};
+    const Point2D normal{b.y - a.y, a.x - b.x};
+    if (normal.x == 0.0 && normal.y == 0.0) {
+      continue;
+    }
+
+    double low = std::numeric_limits<double>::max();
+    double high = std::numeric_limits<double>::lowest();
+    for (const auto& vertex : vertices_) {
+      const double projection{vertex.x * normal.x + vertex.y * normal.y};
+      low = std::min(low, projection);
+      high = std::max(high, projection);
+    }
+    normals_.push_back(normal);
+    minProjection_.push_back(low);
+    maxProjection_.push_back(high);
+  }
+}
+
+ConvexPolygon ConvexPolygon::sector(const Point2D& apex, double radius,
+                                    double heading, double fov,
+                                    size_t arcSegments) {
+  fov = std::min(std::max(fov, 0.0), M_PI);
+  arcSegments = std::max<size_t>(arcSegments, 1);
+
+  // Arc vertices lie outside the true arc so the polygon covers it
+  const double step{fov / static_cast<double>(arcSegments)};
+  const double outer{radius / std::cos(step / 2.0)};
+
+  std::vector<Point2D> vertices{apex};
+  const double start{heading - fov / 2.0};
+  vertices.emplace_back(apex.x + radius * std::cos(start),
+                        apex.y + radius * std::sin(start));
+  for (size_t i = 0; i < arcSegments; ++i) {
+    const double angle{start + step * (static_cast<double>(i) + 0.5)};
+    vertices.emplace_back(apex.x + outer * std::cos(angle),
+                          apex.y + outer * std::sin(angle));
+  }
+  const double end{heading + fov / 2.0};
+  vertices.emplace_back(apex.x + radius * std::cos(end),
+                        apex.y + radius * std::sin(end));
+  return ConvexPolygon{std::move(vertices)};
+}
+
+bool ConvexPolygon::contains(const Point2D& point) const {
+  if (vertices_.empty() || !bounds_.contains(point)) {
+    return false;
+  }
+  for (size_t i = 0; i < normals_.size(); ++i) {
+    if (point.x * normals_[i].x + point.y * normals_[i].y >
+        maxProjection_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ConvexPolygon::intersects(const BoundingBox& box) const {
+  // Box axes first: that is the polygon's bounding box test
+  if (vertices_.empty() || !bounds_.intersects(box)) {
+    return false;
+  }
+
+  const Point2D center{box.center()};
+  const double halfX{(box.max.x - box.min.x) / 2.0};
+  const double halfY{(box.max.y - box.min.y) / 2.0};
+  for (size_t i = 0; i < normals_.size(); ++i) {
+    const Point2D& n{normals_[i]};
+    const double c{center.x * n.x + center.y * n.y};
+    const double r{halfX * std::abs(n.x) + halfY * std::abs(n.y)};
+    if (c - r > maxProjection_[i] || c + r < minProjection_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ConvexPolygon::intersectsSegment(const Point2D& a,
+                                      const Point2D& b) const {
+  if (vertices_.empty() || !bounds_.intersects(polylineBounds({a, b}, 0.0))) {
+    return false;
+  }
+
+  for (size_t i = 0; i < normals_.size(); ++i) {
+    const Point2D& n{normals_[i]};
+    const double pa{a.x * n.x + a.y * n.y};
+    const double pb{b.x * n.x + b.y * n.y};
+    if (std::min(pa, pb) > maxProjection_[i] ||
+        std::max(pa, pb) < minProjection_[i]) {
+      return false;
+    }
+  }
+
+  // Segment normal is the last candidate separating axis
+  const Point2D n{b.y - a.y, a.x - b.x};
+  const double side{a.x * n.x + a.y * n.y};
+  bool below = false;
+  bool above = false;
+  for (const auto& vertex : vertices_) {
+    const double projection{vertex.x * n.x + vertex.y * n.y};
+    below = below || projection <= side;
+    above = above || projection >= side;
+  }
+  return below && above;
+}
+
+ConvexPolygon OrientedBox::toPolygon() const {
+  const double c{std::cos(heading)};
+  const double s{std::sin(heading)};
+  const Point2D along{c * halfLength, s * halfLength};
+  const Point2D across{-s * halfWidth, c * halfWidth};
+
+  return ConvexPolygon{{
+      Point2D{center.x - along.x - across.x, center.y - along.y - across.y},
+      Point2D{center.x + along.x - across.x, center.y + along.y - across.y},
+      Point2D{center.x + along.x + across.x, center.y + along.y + across.y},
+      Point2D{center.x - along.x + across.x, center.y - along.y + across.y},
+  }};
+}
+
+}  // namespace hdmap
@@ -3,28 +3,70 @@
 #include <algorithm>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <spdlog/spdlog.h>
-#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace hdmap {
 
+namespace {
+
+// key="value" attribute or <tag k="key" v="value"/> child
+bool hasTag(const std::string& element, const std::string& key,
+            const std::string& value) {
+  return element.find(key + "=\"" + value + "\"") != std::string::npos ||
+         element.find("k=\"" + key + "\" v=\"" + value + "\"") !=
+             std::string::npos;
+}
+
+// Regulatory element member naming a lane the element applies to
+bool isLaneRole(const std::string& member) {
+  return hasTag(member, "role", "lanelet") ||
+         hasTag(member, "role", "right_of_way") ||
+         hasTag(member, "role", "yield");
+}
+
+}  // namespace
+
 bool Lanelet2Parser::parse(const std::string filepath, MapServer& mapServer) {
-  const std::ifstream file{filepath};
+  stats_ = LoadStats{};
+  if (profileMemory_) {
+    stats_.startMemoryProfile();
+  }
+  std::ifstream file{filepath, std::ios::binary | std::ios::ate};
   if (!file.is_open()) {
     lastError_ = "Cannot open file: " + filepath;
     spdlog::error(lastError_);
     return false;
   }
 
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  const std::string content{buffer.str()};
+  // The raw text is the largest scratch buffer: charge it before it is
+  // allocated and read it in one go rather than through a stringstream copy
+  const auto size{static_cast<size_t>(file.tellg())};
+  stats_.fileBytes = size;
+  const MemoryCharge contentCharge{MemoryAccount::current(),
+                                   MemoryCategory::PARSER_SCRATCH, size};
+  if (!withinBudget(mapServer)) {
+    return false;
+  }
+  std::string content;
+  {
+    const StageTimer timer{stats_, "read", size};
+    content.resize(size);
+    file.seekg(0);
+    if (!file.read(content.data(), static_cast<std::streamsize>(size))) {
+      lastError_ = "Cannot read file: " + filepath;
+      spdlog::error(lastError_);
+      return false;
+    }
+  }
 
   // Parse nodes (points)
-  std::unordered_map<uint64_t, Point2D> nodes;
-  if (!parseNodes(content, nodes)) {
+  NodeTable nodes;
+  if (!parseNodes(content, nodes, mapServer)) {
     return false;
   }
 
@@ -34,18 +76,29 @@ bool Lanelet2Parser::parse(const std::string filepath, MapServer& mapServer) {
   }
 
   // Parse regulatory elements (traffic lights, signs)
-  if (!parseRegulatoryElements(content, mapServer)) {
+  StageTimer timer{stats_, "relation", content.size()};
+  if (!parseRegulatoryElements(content, nodes, mapServer)) {
     return false;
   }
+  timer.setElements(mapServer.getTrafficLightCount() +
+                    mapServer.getTrafficSignCount());
 
   return true;
 }
 
 bool Lanelet2Parser::parseNodes(const std::string& content,
-                                std::unordered_map<uint64_t, Point2D>& nodes) {
+                                NodeTable& nodes, MapServer& mapServer) {
   // Simplified parser - looks for node tags
   // Format: <node id="X" lat="Y" lon="Z"/>
-
+  // Coordinates are gathered into flat arrays first so the projection runs
+  // as one bulk transform instead of per node. Every node is decoded even
+  // with a load region: ways may reference nodes anywhere in the file.
+  TrackedVector<uint64_t, MemoryCategory::PARSER_SCRATCH> ids;
+  TrackedVector<double, MemoryCategory::PARSER_SCRATCH> xs;  // lon
+  TrackedVector<double, MemoryCategory::PARSER_SCRATCH> ys;  // lat
+
+  // Tokenizing and decoding happen in the same pass
+  StageTimer decode{stats_, "node_decode", content.size()};
   size_t pos = 0;
   while ((pos = content.find("<node ", pos)) != std::string::npos) {
     const size_t endPos{content.find("/>", pos)};
@@ -83,19 +136,58 @@ bool Lanelet2Parser::parseNodes(const std::string& content,
     const size_t lonEnd{nodeStr.find("\"", lonPos)};
     const double lon{std::stod(nodeStr.substr(lonPos, lonEnd - lonPos))};
 
-    nodes[id] = Point2D(lon, lat);
+    ids.push_back(id);
+    xs.push_back(lon);
+    ys.push_back(lat);
     pos = endPos;
+    if (!withinBudget(mapServer)) {
+      return false;
+    }
   }
 
-  return !nodes.empty();
+  if (ids.empty()) {
+    return false;
+  }
+  decode.setElements(ids.size());
+  decode.stop();
+
+  StageTimer projection{stats_, "projection"};
+  projection.setElements(ids.size());
+  auto& projector{mapServer.getProjectorMutable()};
+  if (projector.config().autoOrigin) {
+    // Anchor the projection at the centre of the node bounds
+    const auto [minLon, maxLon] = std::minmax_element(xs.begin(), xs.end());
+    const auto [minLat, maxLat] = std::minmax_element(ys.begin(), ys.end());
+    projector.setOrigin((*minLat + *maxLat) / 2.0, (*minLon + *maxLon) / 2.0);
+  }
+  projector.forward(xs.data(), ys.data(), xs.size());
+
+  nodes.reserve(ids.size());
+  if (!withinBudget(mapServer)) {
+    return false;
+  }
+  for (size_t i = 0; i < ids.size(); ++i) {
+    nodes[ids[i]] = Point2D(xs[i], ys[i]);
+  }
+
+  return true;
 }
 
 bool Lanelet2Parser::parseLanelets(
     const std::string& content,
-    const std::unordered_map<uint64_t, Point2D>& nodes, MapServer& mapServer) {
+    const NodeTable& nodes, MapServer& mapServer) {
   // Simplified lanelet parsing
   // Format: <way id="X" ...> with member refs to nodes
 
+  // End node ids per lane, used to derive connectivity afterwards
+  using ScratchIds = TrackedVector<uint64_t, MemoryCategory::PARSER_SCRATCH>;
+  TrackedMap<uint64_t, ScratchIds, MemoryCategory::PARSER_SCRATCH>
+      lanesByFirstNode;
+  TrackedVector<std::pair<uint64_t, uint64_t>, MemoryCategory::PARSER_SCRATCH>
+      lastNodes;  // (lane, node)
+
+  const auto& region{mapServer.getLoadRegion()};
+  StageTimer resolve{stats_, "way_resolve", content.size()};
   size_t pos = 0;
   while ((pos = content.find("<way ", pos)) != std::string::npos) {
     const size_t endPos{content.find("</way>", pos)};
@@ -117,12 +209,14 @@ bool Lanelet2Parser::parseLanelets(
     const bool isCenterline{wayStr.find("subtype") != std::string::npos};
 
     if (isCenterline) {
-      auto lane = std::make_shared<Lane>();
+      auto lane{makeTracked<Lane>()};
       lane->id = wayId;
       lane->type = LaneType::DRIVING;
       lane->speedLimit = 13.89;  // 50 km/h default
 
       // Extract node references
+      uint64_t firstNodeId = 0;
+      uint64_t lastNodeId = 0;
       size_t ndPos = 0;
       while ((ndPos = wayStr.find("<nd ref=\"", ndPos)) != std::string::npos) {
         ndPos += 9;
@@ -131,27 +225,74 @@ bool Lanelet2Parser::parseLanelets(
 
         auto it = nodes.find(nodeId);
         if (it != nodes.end()) {
+          if (lane->centerline.empty()) {
+            firstNodeId = nodeId;
+          }
+          lastNodeId = nodeId;
           lane->centerline.push_back(it->second);
         }
         ndPos = ndEnd;
       }
 
-      if (!lane->centerline.empty()) {
+      bool keep{!lane->centerline.empty()};
+      if (keep && region.has_value()) {
+        lane->computeBoundingBox();
+        keep = lane->bbox.intersects(*region);
+      }
+      if (keep) {
+        if (mapServer.getLaneCount() >= mapServer.getConstraints().maxLanes) {
+          lastError_ = "Lane limit exceeded while parsing";
+          spdlog::error(lastError_);
+          return false;
+        }
         mapServer.getLanesMutable()[lane->id] = lane;
+        lanesByFirstNode[firstNodeId].push_back(lane->id);
+        lastNodes.emplace_back(lane->id, lastNodeId);
+        if (!withinBudget(mapServer)) {
+          return false;
+        }
       }
     }
 
     pos = endPos;
   }
 
+  resolve.setElements(mapServer.getLaneCount());
+  resolve.stop();
+
+  // A lane continues into every lane that starts at its last node
+  StageTimer connectivity{stats_, "connectivity"};
+  connectivity.setElements(lastNodes.size());
+  auto& lanes{mapServer.getLanesMutable()};
+  for (const auto& [laneId, nodeId] : lastNodes) {
+    auto it = lanesByFirstNode.find(nodeId);
+    if (it == lanesByFirstNode.end()) {
+      continue;
+    }
+    for (const auto successorId : it->second) {
+      if (successorId == laneId) {
+        continue;
+      }
+      lanes[laneId]->successorIds.push_back(successorId);
+      lanes[successorId]->predecessorIds.push_back(laneId);
+    }
+  }
+
   return true;
 }
 
 bool Lanelet2Parser::parseRegulatoryElements(const std::string& content,
+                                             const NodeTable& nodes,
                                              MapServer& mapServer) {
   // Simplified parsing of traffic lights and signs
-  // Format: <relation id="X" ...> with type="regulatory_element"
-
+  // Format: <relation id="X" ...> with type="regulatory_element". Members
+  // are told apart by role: "refers" and "ref_line" are the element's own
+  // geometry, "lanelet", "right_of_way" and "yield" the lanes it applies
+  // to. The position is the first "refers" node, or else the first node of
+  // any other geometry role.
+
+  const auto& region{mapServer.getLoadRegion()};
+  const auto& constraints{mapServer.getConstraints()};
   size_t pos = 0;
   while ((pos = content.find("<relation ", pos)) != std::string::npos) {
     const size_t endPos{content.find("</relation>", pos)};
@@ -160,7 +301,7 @@ bool Lanelet2Parser::parseRegulatoryElements(const std::string& content,
     const std::string relStr{content.substr(pos, endPos - pos)};
 
     // Check if regulatory element
-    if (relStr.find("type=\"regulatory_element\"") == std::string::npos) {
+    if (!hasTag(relStr, "type", "regulatory_element")) {
       pos = endPos;
       continue;
     }
@@ -175,27 +316,107 @@ bool Lanelet2Parser::parseRegulatoryElements(const std::string& content,
     const size_t idEnd{relStr.find("\"", idPos)};
     const uint64_t relId{std::stoull(relStr.substr(idPos, idEnd - idPos))};
 
+    // Extract members
+    std::optional<Point2D> refersPosition;
+    std::optional<Point2D> position;
+    IdList laneIds;
+    size_t memberPos = 0;
+    while ((memberPos = relStr.find("<member ", memberPos)) !=
+           std::string::npos) {
+      const size_t memberEnd{relStr.find("/>", memberPos)};
+      if (memberEnd == std::string::npos) break;
+      const std::string memberStr{
+          relStr.substr(memberPos, memberEnd - memberPos)};
+      memberPos = memberEnd;
+
+      size_t refPos = memberStr.find("ref=\"");
+      if (refPos == std::string::npos) {
+        continue;
+      }
+      refPos += 5;
+      const size_t refEnd{memberStr.find("\"", refPos)};
+      const uint64_t ref{
+          std::stoull(memberStr.substr(refPos, refEnd - refPos))};
+
+      if (isLaneRole(memberStr)) {
+        if (memberStr.find("type=\"way\"") != std::string::npos) {
+          laneIds.push_back(ref);
+        }
+      } else if (memberStr.find("type=\"node\"") != std::string::npos) {
+        auto it = nodes.find(ref);
+        if (it == nodes.end()) {
+          continue;
+        }
+        if (hasTag(memberStr, "role", "refers")) {
+          if (!refersPosition.has_value()) {
+            refersPosition = it->second;
+          }
+        } else if (!position.has_value()) {
+          position = it->second;
+        }
+      }
+    }
+    if (refersPosition.has_value()) {
+      position = refersPosition;
+    }
+
     // Check subtype
-    if (relStr.find("subtype=\"traffic_light\"") != std::string::npos) {
-      auto light = std::make_shared<TrafficLight>();
+    if (hasTag(relStr, "subtype", "traffic_light")) {
+      auto light{makeTracked<TrafficLight, MemoryCategory::TRAFFIC_ELEMENTS>()};
       light->id = relId;
-      light->position = Point2D(0, 0);  // Would extract from refers_to
+      light->position = position.value_or(Point2D(0, 0));
       light->state = TrafficLightState::UNKNOWN;
+      light->controlledLaneIds = std::move(laneIds);
       light->height = 5.0;
+      if (region.has_value() && !region->contains(light->position)) {
+        pos = endPos;
+        continue;
+      }
+      if (mapServer.getTrafficLightCount() >= constraints.maxTrafficLights) {
+        lastError_ = "Traffic light limit exceeded while parsing";
+        spdlog::error(lastError_);
+        return false;
+      }
       mapServer.getTrafficLightsMutable()[light->id] = light;
-    } else if (relStr.find("subtype=\"traffic_sign\"") != std::string::npos) {
-      auto sign = std::make_shared<TrafficSign>();
+    } else if (hasTag(relStr, "subtype", "traffic_sign")) {
+      auto sign{makeTracked<TrafficSign, MemoryCategory::TRAFFIC_ELEMENTS>()};
       sign->id = relId;
-      sign->position = Point2D(0, 0);
+      sign->position = position.value_or(Point2D(0, 0));
       sign->type = TrafficSignType::OTHER;
+      sign->affectedLaneIds = std::move(laneIds);
       sign->height = 3.0;
+      if (region.has_value() && !region->contains(sign->position)) {
+        pos = endPos;
+        continue;
+      }
+      if (mapServer.getTrafficSignCount() >= constraints.maxTrafficSigns) {
+        lastError_ = "Traffic sign limit exceeded while parsing";
+        spdlog::error(lastError_);
+        return false;
+      }
       mapServer.getTrafficSignsMutable()[sign->id] = sign;
     }
 
     pos = endPos;
+    if (!withinBudget(mapServer)) {
+      return false;
+    }
   }
 
   return true;
 }
 
+bool Lanelet2Parser::withinBudget(const MapServer& mapServer) {
+  // Everything this load holds right now, scratch included
+  const auto memory{mapServer.getMemoryBreakdown()};
+  const size_t used{memory.total() + memory.parserScratch};
+  if (used <= mapServer.getConstraints().maxTotalMemory) {
+    return true;
+  }
+  lastError_ = "Memory budget exceeded while parsing (" +
+               std::to_string(used) + " bytes)";
+  spdlog::error(lastError_);
+  return false;
+}
+
 }  // namespace hdmap
@@ -0,0 +1,67 @@
+#include "include/load_stats.hpp"
+
+#include <utility>
+
+#include "include/memory_account.hpp"
+
+namespace hdmap {
+
+double LoadStats::totalSeconds() const {
+  double total{0.0};
+  for (const auto& stage : stages) {
+    total += stage.seconds;
+  }
+  return total;
+}
+
+void LoadStats::startMemoryProfile() {
+  profileMemory = true;
+  baseline = MemorySample::take(MemoryAccount::current());
+}
+
+const LoadStage* LoadStats::find(const std::string& name) const {
+  for (const auto& stage : stages) {
+    if (stage.name == name) {
+      return &stage;
+    }
+  }
+  return nullptr;
+}
+
+StageTimer::StageTimer(LoadStats& stats, std::string name, size_t bytes)
+    : stats_{stats} {
+  stage_.name = std::move(name);
+  stage_.bytes = bytes;
+  stage_.trackedBytes = trackedNow();
+  start_ = std::chrono::steady_clock::now();
+}
+
+StageTimer::~StageTimer() {
+  stop();
+}
+
+void StageTimer::stop() {
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  stage_.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_)
+          .count();
+  stage_.trackedBytes = trackedNow() - stage_.trackedBytes;
+  if (stats_.profileMemory) {
+    stage_.memory = MemorySample::take(MemoryAccount::current());
+  }
+  stats_.stages.push_back(std::move(stage_));
+}
+
+int64_t StageTimer::trackedNow() {
+  const auto account{MemoryAccount::current()};
+  if (!account) {
+    return 0;
+  }
+  const auto memory{account->breakdown()};
+  return static_cast<int64_t>(memory.total() + memory.parserScratch);
+}
+
+}  // namespace hdmap
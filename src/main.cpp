@@ -1,12 +1,24 @@
+#include <algorithm>
+#include <fstream>
 #include <iomanip>
+#include <csignal>
 #include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <sys/resource.h>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "include/map_server.hpp"
+#include "include/memory_profile.hpp"
+#include "include/query_daemon.hpp"
+#include "include/shared_map.hpp"
+#include "include/tile_store.hpp"
 
 constexpr double kSpeedConversionFactor = 3.6;
+constexpr double kBytesPerMegabyte = 1024.0 * 1024.0;
 const std::string kDefaultMapFile = "data/sample_map.osm";
 
 void printQueryResult(const hdmap::QueryResult& result) {
@@ -19,7 +31,7 @@ void printQueryResult(const hdmap::QueryResult& result) {
     std::cout << "\n  Lane Details:\n";
     for (const auto& lane : result.lanes) {
       std::cout << "    ID: " << lane->id
-                << ", Points: " << lane->centerline.size() << ", Speed Limit: "
+                << ", Points: " << lane->centerlineSize() << ", Speed Limit: "
                 << (lane->speedLimit * kSpeedConversionFactor) << " km/h\n";
     }
   }
@@ -47,36 +59,257 @@ void printStackLimit() {
   }
 }
 
+// Memory after each load stage, then once more in steady state
+void printMemoryProfile(
+    const std::vector<std::pair<std::string, hdmap::MemorySample>>& samples) {
+  const auto megabytes = [](size_t bytes) { return bytes / kBytesPerMegabyte; };
+  std::cout << "Memory Profile (MB):\n";
+  std::cout << std::left << std::setw(24) << "  stage" << std::right
+            << std::setw(9) << "rss" << std::setw(9) << "pss" << std::setw(9)
+            << "heap" << std::setw(9) << "lanes" << std::setw(10)
+            << "traffic" << std::setw(10) << "geometry" << std::setw(9)
+            << "indices" << std::setw(9) << "scratch" << "\n";
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto& [stage, sample] : samples) {
+    std::cout << "  " << std::left << std::setw(22) << stage << std::right
+              << std::setw(9) << megabytes(sample.process.rss) << std::setw(9)
+              << megabytes(sample.process.pss) << std::setw(9)
+              << megabytes(sample.allocator.inUse) << std::setw(9)
+              << megabytes(sample.tracked.lanes) << std::setw(10)
+              << megabytes(sample.tracked.trafficElements) << std::setw(10)
+              << megabytes(sample.tracked.geometry) << std::setw(9)
+              << megabytes(sample.tracked.indices) << std::setw(9)
+              << megabytes(sample.tracked.parserScratch) << "\n";
+  }
+  std::cout << std::defaultfloat << "\n";
+}
+
+// One object per sample, all sizes in bytes
+bool writeMemoryProfile(
+    const std::string& path,
+    const std::vector<std::pair<std::string, hdmap::MemorySample>>& samples) {
+  std::ofstream file{path};
+  file << "{\n  \"available\": "
+       << (samples.front().second.process.available ? "true" : "false")
+       << ",\n  \"samples\": [";
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const auto& [stage, sample] = samples[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"stage\": \"" << stage
+         << "\", \"rss\": " << sample.process.rss
+         << ", \"pss\": " << sample.process.pss
+         << ", \"anonymous\": " << sample.process.anonymous
+         << ", \"swap\": " << sample.process.swap
+         << ", \"heap_in_use\": " << sample.allocator.inUse
+         << ", \"heap_free\": " << sample.allocator.free
+         << ", \"heap_mmapped\": " << sample.allocator.mmapped
+         << ", \"lanes\": " << sample.tracked.lanes
+         << ", \"traffic_elements\": " << sample.tracked.trafficElements
+         << ", \"geometry\": " << sample.tracked.geometry
+         << ", \"indices\": " << sample.tracked.indices
+         << ", \"parser_scratch\": " << sample.tracked.parserScratch << "}";
+  }
+  file << "\n  ]\n}\n";
+  return static_cast<bool>(file);
+}
+
+// Print and optionally write the load stages plus a final sample taken now
+// under label; false if the file cannot be written or peak RSS exceeds
+// maxRssMegabytes (0 for no budget)
+bool reportMemoryProfile(const hdmap::MapServer& mapServer,
+                         const std::string& label,
+                         const std::string& memoryProfileFile,
+                         double maxRssMegabytes) {
+  const auto& stats{mapServer.getLastLoadStats()};
+  std::vector<std::pair<std::string, hdmap::MemorySample>> samples;
+  samples.emplace_back("start", stats.baseline);
+  for (const auto& stage : stats.stages) {
+    samples.emplace_back(stage.name, stage.memory);
+  }
+  // Parser scratch is gone
+  hdmap::MemorySample last{hdmap::MemorySample::take(nullptr)};
+  last.tracked = mapServer.getMemoryBreakdown();
+  samples.emplace_back(label, last);
+
+  std::cout << "\n";
+  printMemoryProfile(samples);
+  if (!last.process.available) {
+    spdlog::warn("No /proc/self/smaps_rollup: process memory is unknown");
+  }
+  if (!memoryProfileFile.empty() &&
+      !writeMemoryProfile(memoryProfileFile, samples)) {
+    spdlog::error("Cannot write memory profile: {}", memoryProfileFile);
+    return false;
+  }
+  size_t peakRss{0};
+  for (const auto& [stage, sample] : samples) {
+    peakRss = std::max(peakRss, sample.process.rss);
+  }
+  if (maxRssMegabytes > 0.0 && peakRss / kBytesPerMegabyte > maxRssMegabytes) {
+    spdlog::error("Peak RSS {:.1f} MB exceeds the {:.1f} MB budget",
+                  peakRss / kBytesPerMegabyte, maxRssMegabytes);
+    return false;
+  }
+  return true;
+}
+
+// Resident mode: keeps the map loaded, answering QueryClients and/or
+// publishing it to shared memory, until SIGINT or SIGTERM
+int serveQueries(std::shared_ptr<const hdmap::MapServer> mapServer,
+                 const std::string& socketPath, size_t workers,
+                 const std::string& sharedMapName) {
+  // Blocked before the workers start so that only sigwait sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  // Unpublished when it goes out of scope
+  hdmap::SharedMapPublisher publisher{sharedMapName};
+  if (!sharedMapName.empty()) {
+    if (!publisher.publish(*mapServer)) {
+      spdlog::error(publisher.getLastError());
+      return 1;
+    }
+    std::cout << "Published map to shared memory as " << sharedMapName
+              << " (" << (publisher.getPublishedBytes() / 1024.0)
+              << " KB)\n";
+  }
+
+  std::unique_ptr<hdmap::QueryDaemon> daemon;
+  if (!socketPath.empty()) {
+    hdmap::DaemonConfig config;
+    config.socketPath = socketPath;
+    config.workerThreads = workers;
+    daemon = std::make_unique<hdmap::QueryDaemon>(std::move(mapServer), config);
+    if (!daemon->start()) {
+      spdlog::error(daemon->getLastError());
+      return 1;
+    }
+    std::cout << "Serving queries on " << socketPath << "\n";
+  }
+  std::cout << "Press Ctrl+C to stop\n";
+  int received{0};
+  sigwait(&signals, &received);
+
+  if (daemon) {
+    daemon->stop();
+    const auto stats{daemon->getStats()};
+    std::cout << "Served " << stats.requests << " requests in "
+              << stats.batches << " batches over " << stats.connections
+              << " connections\n";
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
   printStackLimit();
   std::cout << "=== HD Map Server Demo ===\n\n";
 
   // Create map server with default constraints
-  auto mapServer{hdmap::MapServer::getInstance(
+  auto mapServer{std::make_shared<hdmap::MapServer>(
       hdmap::MemoryConstraints::defaultConstraints())};
 
   // Load map data
   std::string mapFile = kDefaultMapFile;
-  if (argc > 1) {
-    mapFile = argv[1];
+  bool buildRoutingHierarchy = false;
+  std::string tileDirectory;
+  bool memoryProfile = false;
+  std::string memoryProfileFile;
+  double maxRssMegabytes = 0.0;
+  std::string socketPath;
+  size_t workers = 0;
+  std::string sharedMapName;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    const bool takesValue{arg == "--write-tiles" || arg == "--serve" ||
+                          arg == "--workers" || arg == "--publish-shm" ||
+                          arg == "--memory-profile-json" ||
+                          arg == "--max-rss-mb"};
+    if (takesValue && i + 1 == argc) {
+      spdlog::error("Missing value for {}", arg);
+      return 1;
+    }
+    if (arg == "--build-routing-hierarchy") {
+      buildRoutingHierarchy = true;
+    } else if (arg == "--write-tiles") {
+      tileDirectory = argv[++i];
+    } else if (arg == "--serve") {
+      socketPath = argv[++i];
+    } else if (arg == "--workers") {
+      workers = std::stoul(argv[++i]);
+    } else if (arg == "--publish-shm") {
+      sharedMapName = argv[++i];
+    } else if (arg == "--memory-profile") {
+      memoryProfile = true;
+    } else if (arg == "--memory-profile-json") {
+      memoryProfile = true;
+      memoryProfileFile = argv[++i];
+    } else if (arg == "--max-rss-mb") {
+      // Fails the run when any profiled RSS sample exceeds the budget
+      memoryProfile = true;
+      maxRssMegabytes = std::stod(argv[++i]);
+    } else {
+      mapFile = arg;
+    }
   }
 
   std::cout << "Loading map from: " << mapFile << "\n";
-  if (!mapServer->loadFromFile(std::move(mapFile))) {
+  mapServer->setMemoryProfiling(memoryProfile);
+  if (!mapServer->loadFromFile(mapFile)) {
     spdlog::error("Failed to load map file!\n");
     return 1;
   }
 
   std::cout << "Map loaded successfully!\n\n";
 
+  if (buildRoutingHierarchy) {
+    // Preprocess once; later loads of this map pick the file up
+    const std::string hierarchyPath{
+        hdmap::MapServer::routingHierarchyPathFor(mapFile)};
+    mapServer->buildRoutingHierarchy();
+    if (!mapServer->saveRoutingHierarchy(hierarchyPath)) {
+      return 1;
+    }
+    std::cout << "Routing hierarchy written to: " << hierarchyPath << "\n\n";
+  }
+
+  if (!tileDirectory.empty()) {
+    // Partition for on-demand loading with hdmap::TileStore
+    hdmap::TileStore tileStore;
+    if (!tileStore.write(*mapServer, tileDirectory)) {
+      return 1;
+    }
+    std::cout << "Map tiles written to: " << tileDirectory << "\n\n";
+  }
+
   // Print statistics
   std::cout << "Map Statistics:\n";
   std::cout << "  Lanes: " << mapServer->getLaneCount() << "\n";
   std::cout << "  Traffic Lights: " << mapServer->getTrafficLightCount()
             << "\n";
   std::cout << "  Traffic Signs: " << mapServer->getTrafficSignCount() << "\n";
-  std::cout << "  Memory Usage: "
-            << (mapServer->getMemoryUsage() / 1024.0 / 1024.0) << " MB\n\n";
+  const auto memory{mapServer->getMemoryBreakdown()};
+  std::cout << "  Memory Usage: " << (memory.total() / 1024.0 / 1024.0)
+            << " MB\n";
+  std::cout << "    Lanes: " << (memory.lanes / 1024.0) << " KB\n";
+  std::cout << "    Traffic elements: " << (memory.trafficElements / 1024.0)
+            << " KB\n";
+  std::cout << "    Geometry: " << (memory.geometry / 1024.0) << " KB\n";
+  std::cout << "    Indices: " << (memory.indices / 1024.0) << " KB\n";
+  std::cout << "    Parser scratch (peak): "
+            << (memory.parserScratchPeak / 1024.0) << " KB\n\n";
+
+  if (!socketPath.empty() || !sharedMapName.empty()) {
+    // Resident mode never reaches the end of the demo: profile and check
+    // the RSS budget before serving
+    if (memoryProfile &&
+        !reportMemoryProfile(*mapServer, "loaded", memoryProfileFile,
+                             maxRssMegabytes)) {
+      return 1;
+    }
+    return serveQueries(mapServer, socketPath, workers, sharedMapName);
+  }
 
   // Example queries
   std::cout << "=== Example Queries ===\n\n";
@@ -101,12 +334,18 @@ int main(int argc, char** argv) {
   if (closestLane.has_value()) {
     const auto& lane{closestLane.value()};
     std::cout << "  Found lane ID: " << lane->id << "\n";
-    std::cout << "  Points in centerline: " << lane->centerline.size() << "\n";
+    std::cout << "  Points in centerline: " << lane->centerlineSize() << "\n";
   } else {
     std::cout << "  No lane found nearby\n";
   }
 
   std::cout << "\n=== Demo Complete ===\n";
 
+  if (memoryProfile &&
+      !reportMemoryProfile(*mapServer, "steady", memoryProfileFile,
+                           maxRssMegabytes)) {
+    return 1;
+  }
+
   return 0;
 }
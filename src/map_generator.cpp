@@ -0,0 +1,321 @@
+#include "include/map_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kCoordinatePrecision = 3;  // millimetres
+
+uint64_t splitMix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Stateless random value in [0, 1) for (seed, key), so every pass over the
+// city sees the same choices without storing them
+double unitNoise(uint64_t seed, uint64_t key) {
+  return static_cast<double>(splitMix64(seed ^ splitMix64(key)) >> 11) *
+         (1.0 / 9007199254740992.0);
+}
+
+// One direction of travel along a street
+struct LaneSpec {
+  uint64_t id;
+  uint64_t fromNode;
+  uint64_t toNode;
+  Point2D start;
+  Point2D end;
+  std::vector<Point2D> interior;  // in driving order
+};
+
+// Enumerates intersections and lanes of a layout in a fixed order
+class CityWalker {
+ public:
+  explicit CityWalker(const CityConfig& config)
+      : config_{config},
+        interiorPerLane_{std::max<size_t>(config.pointsPerLane, 2) - 2} {
+    const auto lanes{static_cast<double>(config.laneCount)};
+    if (config.layout == CityLayout::GRID) {
+      // Two streets per intersection, two lanes per street
+      side_ = std::max<size_t>(
+          1, static_cast<size_t>(std::ceil(std::sqrt(lanes / 4.0))));
+      cornerCount_ = (side_ + 1) * (side_ + 1);
+    } else {
+      // A spoke and a ring segment per intersection, two lanes each
+      spokes_ = std::max<size_t>(
+          8, static_cast<size_t>(std::ceil(std::sqrt(lanes / 4.0))));
+      rings_ = std::max<size_t>(
+          1, static_cast<size_t>(std::ceil(lanes / (4.0 * spokes_))));
+      cornerCount_ = 1 + rings_ * spokes_;
+    }
+  }
+
+  size_t cornerCount() const {
+    return cornerCount_;
+  }
+
+  uint64_t interiorNodeId(uint64_t laneId, size_t index) const {
+    return cornerCount_ + 1 + (laneId - 1) * interiorPerLane_ + index;
+  }
+
+  template <typename Visit>
+  void forEachCorner(const Visit& visit) const {
+    if (config_.layout == CityLayout::GRID) {
+      for (size_t y = 0; y <= side_; ++y) {
+        for (size_t x = 0; x <= side_; ++x) {
+          visit(gridCorner(x, y), gridPosition(x, y));
+        }
+      }
+      return;
+    }
+    visit(1, Point2D{});
+    for (size_t r = 1; r <= rings_; ++r) {
+      for (size_t s = 0; s < spokes_; ++s) {
+        visit(radialCorner(r, s), radialPosition(r, s));
+      }
+    }
+  }
+
+  // Stops after config.laneCount lanes
+  template <typename Visit>
+  void forEachLane(const Visit& visit) const {
+    LaneSpec lane;
+    uint64_t nextId = 1;
+    std::vector<Point2D> forward;
+
+    // Both directions of a street; false once enough lanes were produced
+    const auto emitStreet = [&](uint64_t from, uint64_t to, const Point2D& a,
+                                const Point2D& b) {
+      for (int direction = 0; direction < 2; ++direction) {
+        if (nextId > config_.laneCount) {
+          return false;
+        }
+        lane.id = nextId++;
+        lane.fromNode = direction == 0 ? from : to;
+        lane.toNode = direction == 0 ? to : from;
+        lane.start = direction == 0 ? a : b;
+        lane.end = direction == 0 ? b : a;
+        lane.interior.assign(forward.begin(), forward.end());
+        if (direction == 1) {
+          std::reverse(lane.interior.begin(), lane.interior.end());
+        }
+        visit(lane);
+      }
+      return true;
+    };
+
+    if (config_.layout == CityLayout::GRID) {
+      for (size_t y = 0; y <= side_; ++y) {
+        for (size_t x = 0; x <= side_; ++x) {
+          const uint64_t key{(y * (side_ + 1) + x) * 2};
+          if (x < side_) {
+            straight(gridPosition(x, y), gridPosition(x + 1, y), key, forward);
+            if (!emitStreet(gridCorner(x, y), gridCorner(x + 1, y),
+                            gridPosition(x, y), gridPosition(x + 1, y))) {
+              return;
+            }
+          }
+          if (y < side_) {
+            straight(gridPosition(x, y), gridPosition(x, y + 1), key + 1,
+                     forward);
+            if (!emitStreet(gridCorner(x, y), gridCorner(x, y + 1),
+                            gridPosition(x, y), gridPosition(x, y + 1))) {
+              return;
+            }
+          }
+        }
+      }
+      return;
+    }
+
+    for (size_t r = 1; r <= rings_; ++r) {
+      for (size_t s = 0; s < spokes_; ++s) {
+        const uint64_t key{((r - 1) * spokes_ + s) * 2};
+        const uint64_t inner{r == 1 ? 1 : radialCorner(r - 1, s)};
+        const Point2D innerPosition{r == 1 ? Point2D{}
+                                           : radialPosition(r - 1, s)};
+        straight(innerPosition, radialPosition(r, s), key, forward);
+        if (!emitStreet(inner, radialCorner(r, s), innerPosition,
+                        radialPosition(r, s))) {
+          return;
+        }
+
+        const size_t next{(s + 1) % spokes_};
+        arc(r, s, key + 1, forward);
+        if (!emitStreet(radialCorner(r, s), radialCorner(r, next),
+                        radialPosition(r, s), radialPosition(r, next))) {
+          return;
+        }
+      }
+    }
+  }
+
+ private:
+  uint64_t gridCorner(size_t x, size_t y) const {
+    return 1 + y * (side_ + 1) + x;
+  }
+  Point2D gridPosition(size_t x, size_t y) const {
+    return Point2D{x * config_.laneLength, y * config_.laneLength};
+  }
+  uint64_t radialCorner(size_t ring, size_t spoke) const {
+    return 2 + (ring - 1) * spokes_ + spoke;
+  }
+  double spokeAngle(size_t spoke) const {
+    return 2.0 * kPi * static_cast<double>(spoke) / spokes_;
+  }
+  Point2D radialPosition(size_t ring, size_t spoke) const {
+    const double radius{ring * config_.laneLength};
+    return Point2D{radius * std::cos(spokeAngle(spoke)),
+                   radius * std::sin(spokeAngle(spoke))};
+  }
+
+  // Lateral offset at the middle of a street, same for both directions
+  double bend(uint64_t key) const {
+    return config_.curvature * config_.laneLength *
+           (2.0 * unitNoise(config_.seed, key) - 1.0);
+  }
+
+  void straight(const Point2D& a, const Point2D& b, uint64_t key,
+                std::vector<Point2D>& points) const {
+    points.clear();
+    const double length{a.distanceTo(b)};
+    const double nx{length > 0.0 ? -(b.y - a.y) / length : 0.0};
+    const double ny{length > 0.0 ? (b.x - a.x) / length : 0.0};
+    const double offset{bend(key)};
+    for (size_t i = 1; i <= interiorPerLane_; ++i) {
+      const double t{static_cast<double>(i) / (interiorPerLane_ + 1)};
+      const double lateral{offset * std::sin(kPi * t)};
+      points.emplace_back(a.x + t * (b.x - a.x) + lateral * nx,
+                          a.y + t * (b.y - a.y) + lateral * ny);
+    }
+  }
+
+  void arc(size_t ring, size_t spoke, uint64_t key,
+           std::vector<Point2D>& points) const {
+    points.clear();
+    const double start{spokeAngle(spoke)};
+    const double sweep{2.0 * kPi / spokes_};
+    const double offset{bend(key)};
+    for (size_t i = 1; i <= interiorPerLane_; ++i) {
+      const double t{static_cast<double>(i) / (interiorPerLane_ + 1)};
+      const double radius{ring * config_.laneLength +
+                          offset * std::sin(kPi * t)};
+      points.emplace_back(radius * std::cos(start + t * sweep),
+                          radius * std::sin(start + t * sweep));
+    }
+  }
+
+  const CityConfig& config_;
+  size_t interiorPerLane_;
+  size_t side_{0};
+  size_t spokes_{0};
+  size_t rings_{0};
+  size_t cornerCount_{0};
+};
+
+void extend(BoundingBox& bounds, const Point2D& point, bool first) {
+  if (first) {
+    bounds = BoundingBox{point, point};
+    return;
+  }
+  bounds.min = Point2D(std::min(bounds.min.x, point.x),
+                       std::min(bounds.min.y, point.y));
+  bounds.max = Point2D(std::max(bounds.max.x, point.x),
+                       std::max(bounds.max.y, point.y));
+}
+
+}  // namespace
+
+CityGenerator::CityGenerator(const CityConfig& config) : config_{config} {
+}
+
+bool CityGenerator::writeOsm(const std::string& filepath) {
+  stats_ = CityStats{};
+  if (config_.laneCount == 0 || !(config_.laneLength > 0.0)) {
+    lastError_ = "City needs at least one lane of positive length";
+    return false;
+  }
+
+  std::ofstream file{filepath};
+  if (!file.is_open()) {
+    lastError_ = "Cannot open file: " + filepath;
+    return false;
+  }
+  file << std::fixed << std::setprecision(kCoordinatePrecision);
+  file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+       << "<osm version=\"0.6\" generator=\"hdmap_generate\">\n";
+
+  const CityWalker walker{config_};
+  const auto writeNode = [&](uint64_t id, const Point2D& position) {
+    file << "  <node id=\"" << id << "\" lat=\"" << position.y << "\" lon=\""
+         << position.x << "\"/>\n";
+    extend(stats_.bounds, position, stats_.nodes == 0);
+    stats_.nodes++;
+  };
+
+  // Pass 1: intersections, then interior vertices lane by lane
+  walker.forEachCorner(writeNode);
+  walker.forEachLane([&](const LaneSpec& lane) {
+    for (size_t i = 0; i < lane.interior.size(); ++i) {
+      writeNode(walker.interiorNodeId(lane.id, i), lane.interior[i]);
+    }
+  });
+
+  // Pass 2: lanes as centerline ways
+  walker.forEachLane([&](const LaneSpec& lane) {
+    file << "  <way id=\"" << lane.id << "\">\n"
+         << "    <nd ref=\"" << lane.fromNode << "\"/>\n";
+    for (size_t i = 0; i < lane.interior.size(); ++i) {
+      file << "    <nd ref=\"" << walker.interiorNodeId(lane.id, i) << "\"/>\n";
+    }
+    file << "    <nd ref=\"" << lane.toNode << "\"/>\n"
+         << "    <tag k=\"type\" v=\"lanelet\"/>\n"
+         << "    <tag k=\"subtype\" v=\"road\"/>\n"
+         << "  </way>\n";
+    stats_.lanes++;
+  });
+
+  // Pass 3: lights at lane ends and signs at lane starts
+  uint64_t nextRelation = 1;
+  const auto writeRegulatory = [&](const char* subtype, uint64_t node,
+                                   uint64_t lane) {
+    file << "  <relation id=\"" << nextRelation++ << "\">\n"
+         << "    <member type=\"node\" ref=\"" << node
+         << "\" role=\"refers\"/>\n"
+         << "    <member type=\"way\" ref=\"" << lane
+         << "\" role=\"lanelet\"/>\n"
+         << "    <tag k=\"type\" v=\"regulatory_element\"/>\n"
+         << "    <tag k=\"subtype\" v=\"" << subtype << "\"/>\n"
+         << "  </relation>\n";
+  };
+  walker.forEachLane([&](const LaneSpec& lane) {
+    if (unitNoise(config_.seed, lane.id * 2) < config_.trafficLightDensity) {
+      writeRegulatory("traffic_light", lane.toNode, lane.id);
+      stats_.trafficLights++;
+    }
+    if (unitNoise(config_.seed, lane.id * 2 + 1) <
+        config_.trafficSignDensity) {
+      writeRegulatory("traffic_sign", lane.fromNode, lane.id);
+      stats_.trafficSigns++;
+    }
+  });
+
+  file << "</osm>\n";
+  if (!file) {
+    lastError_ = "Cannot write file: " + filepath;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace hdmap
@@ -1,11 +1,18 @@
 #include "include/map_server.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <spdlog/spdlog.h>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "include/geometry.hpp"
 #include "include/lanelet2_parser.hpp"
 
 // yiliang
@@ -14,22 +21,62 @@
 
 namespace hdmap {
 
+namespace {
+
+// Larger radii are not worth caching per cell
+constexpr double kMaxCachedRadiusBuckets = 1 << 20;
+
+// Shared by all servers; generations never repeat, so one server's entries
+// cannot be mistaken for another's
+std::atomic<uint64_t> nextGeneration{1};
+
+// Never reused, so a cache keyed by a destroyed server's id cannot be
+// picked up by a new one
+std::atomic<uint64_t> nextServerId{1};
+
+// One query cache per server on each thread
+struct ServerQueryCache {
+  std::weak_ptr<const void> owner;  // expires with the server
+  uint64_t generation{0};           // map the cached lanes belong to
+  QueryCache cache;
+};
+
+std::unordered_map<uint64_t, ServerQueryCache>& threadQueryCaches() {
+  thread_local std::unordered_map<uint64_t, ServerQueryCache> caches;
+  return caches;
+}
+
+}  // namespace
+
 std::shared_ptr<MapServer> MapServer::instance{};
 std::mutex MapServer::mutex_lock{};
 
 MapServer::MapServer(const MemoryConstraints& constraints)
-    : constraints_(constraints) {
+    : constraints_(constraints),
+      memoryAccount_{MemoryAccount::acquire()},
+      serverId_{nextServerId.fetch_add(1, std::memory_order_relaxed)},
+      queryCacheOwner_{std::make_shared<const bool>(true)} {
+  resetStorage();
+  bumpGeneration();
+}
+
+std::shared_ptr<MapServer> MapServer::getInstance() {
+  const std::scoped_lock lock{mutex_lock};
+  if (instance == nullptr) {
+    instance = std::make_shared<MapServer>();
+  }
+  return instance;
 }
 
 std::shared_ptr<MapServer> MapServer::getInstance(
     const MemoryConstraints& constraints) {
+  const std::scoped_lock lock{mutex_lock};
   if (instance == nullptr) {
-    const std::scoped_lock lock{mutex_lock};
-    if (instance == nullptr) {
-      instance = std::shared_ptr<MapServer>{new MapServer{constraints}};
-    }
+    instance = std::make_shared<MapServer>(constraints);
+  } else if (instance->constraints_ != constraints) {
+    spdlog::warn(
+        "MapServer instance already exists, ignoring new memory constraints");
   }
-
   return instance;
 }
 
@@ -40,20 +87,85 @@ MapServer::~MapServer() {
 bool MapServer::loadFromFile(std::string filepath) {
   clear();
 
+  const MemoryAccount::Scope scope{memoryAccount_.get()};
+  memoryAccount_->resetPeak(MemoryCategory::PARSER_SCRATCH);
   Lanelet2Parser parser;
-  if (!parser.parse(filepath, *this)) {
+  parser.setMemoryProfiling(memoryProfiling_);
+  const bool parsed{parser.parse(filepath, *this)};
+  lastLoadStats_ = parser.getStats();
+  if (!parsed) {
+    clear();
     return false;
   }
 
-  if (!checkMemoryConstraints()) {
-    clear();
-    return false;
+  {
+    const StageTimer timer{lastLoadStats_, "constraint_check"};
+    if (!checkMemoryConstraints()) {
+      clear();
+      return false;
+    }
   }
 
-  buildSpatialIndices();
+  {
+    StageTimer timer{lastLoadStats_, "index_build"};
+    timer.setElements(lanes_.size() + trafficLights_.size() +
+                      trafficSigns_.size());
+    buildSpatialIndices();
+  }
+  {
+    StageTimer timer{lastLoadStats_, "routing_graph"};
+    timer.setElements(lanes_.size());
+    routingGraph_.build(lanes_);
+  }
+
+  const std::string hierarchyPath{routingHierarchyPathFor(filepath)};
+  if (std::ifstream{hierarchyPath}.good()) {
+    const StageTimer timer{lastLoadStats_, "routing_hierarchy"};
+    if (!loadRoutingHierarchy(hierarchyPath)) {
+      spdlog::warn("Ignoring routing hierarchy: {}",
+                   routingHierarchy_.getLastError());
+    }
+  }
+
+  if (geometryMode_ == GeometryMode::COMPACT_FLOAT) {
+    StageTimer timer{lastLoadStats_, "compact_geometry"};
+    timer.setElements(lanes_.size());
+    for (auto& [id, lane] : lanes_) {
+      lane->compactGeometry(tileSize_);
+    }
+  }
+
+  // Tables read vertices from the lanes, so they follow compaction
+  {
+    StageTimer timer{lastLoadStats_, "arc_length"};
+    timer.setElements(lanes_.size());
+    arcLengthTables_.reserve(lanes_.size());
+    for (const auto& [id, lane] : lanes_) {
+      arcLengthTables_.emplace(id, ArcLengthTable{lane});
+    }
+  }
+
+  // Indices and tables are only known once built
+  {
+    const StageTimer timer{lastLoadStats_, "index_constraint_check"};
+    if (!checkMemoryConstraints()) {
+      clear();
+      return false;
+    }
+  }
+  bumpGeneration();
   return true;
 }
 
+void MapServer::setGeometryMode(GeometryMode mode, double tileSize) {
+  geometryMode_ = mode;
+  tileSize_ = tileSize;
+}
+
+void MapServer::setProjection(const ProjectionConfig& config) {
+  projector_ = Projector{config};
+}
+
 void MapServer::buildSpatialIndices() {
   // Build lane index
   laneIndex_.clear();
@@ -62,22 +174,21 @@ void MapServer::buildSpatialIndices() {
     laneIndex_.insert(lane->bbox, lane);
   }
 
-  // Build traffic light index
-  trafficLightIndex_.clear();
-  for (auto& [id, light] : trafficLights_) {
-    const BoundingBox bbox{light->position, light->position};
-    trafficLightIndex_.insert(bbox, light);
-  }
+  // Build point indices for traffic lights and signs
+  trafficLightIndex_.build(trafficLights_);
+  trafficSignIndex_.build(trafficSigns_);
+}
 
-  // Build traffic sign index
-  trafficSignIndex_.clear();
-  for (auto& [id, sign] : trafficSigns_) {
-    const BoundingBox bbox{sign->position, sign->position};
-    trafficSignIndex_.insert(bbox, sign);
-  }
+void MapServer::setPointIndexType(PointIndexType type) {
+  const MemoryAccount::Scope scope{memoryAccount_.get()};
+  trafficLightIndex_.setType(type);
+  trafficSignIndex_.setType(type);
+  trafficLightIndex_.build(trafficLights_);
+  trafficSignIndex_.build(trafficSigns_);
 }
 
 QueryResult MapServer::queryRegion(const BoundingBox& region) const {
+  QueryTimer timer{queryMetrics_, QueryApi::QUERY_REGION};
   QueryResult result;
 
   // Query lanes
@@ -87,27 +198,17 @@ QueryResult MapServer::queryRegion(const BoundingBox& region) const {
     result.lanes.push_back(std::get<std::shared_ptr<Lane>>(object));
   }
 
-  // Query traffic lights
-  std::vector<Data> lightResults;
-  trafficLightIndex_.query(region, lightResults);
-  for (const auto& object : lightResults) {
-    result.trafficLights.push_back(
-        std::get<std::shared_ptr<TrafficLight>>(object));
-  }
-
-  // Query traffic signs
-  std::vector<Data> signResults;
-  trafficSignIndex_.query(region, signResults);
-  for (const auto& object : signResults) {
-    result.trafficSigns.push_back(
-        std::get<std::shared_ptr<TrafficSign>>(object));
-  }
+  // Query traffic lights and signs
+  trafficLightIndex_.query(region, result.trafficLights);
+  trafficSignIndex_.query(region, result.trafficSigns);
 
   // return value optimization
+  timer.setResults(result.totalCount());
   return result;
 }
 
 QueryResult MapServer::queryRadius(const Point2D& center, double radius) const {
+  QueryTimer timer{queryMetrics_, QueryApi::QUERY_RADIUS};
   QueryResult result;
 
   // Query lanes
@@ -115,42 +216,211 @@ QueryResult MapServer::queryRadius(const Point2D& center, double radius) const {
   laneIndex_.queryRadius(center, radius, laneResults);
   for (const auto& object : laneResults) {
     auto lane{std::get<std::shared_ptr<Lane>>(object)};
-    bool withinRadius = false;
-    for (const auto& point : lane->centerline) {
-      if (center.distanceTo(point) <= radius) {
-        withinRadius = true;
-        break;
-      }
-    }
-    if (withinRadius) {
+    if (lane->distanceTo(center) <= radius) {
       result.lanes.push_back(lane);
     }
   }
 
   // Query traffic lights
-  std::vector<Data> lightResults;
-  // here needs to be changed as well
+  std::vector<std::shared_ptr<TrafficLight>> lightResults;
   trafficLightIndex_.queryRadius(center, radius, lightResults);
-  for (const auto& object : lightResults) {
-    auto light{std::get<std::shared_ptr<TrafficLight>>(object)};
+  for (auto& light : lightResults) {
     if (center.distanceTo(light->position) <= radius) {
-      result.trafficLights.push_back(light);
+      result.trafficLights.push_back(std::move(light));
     }
   }
 
   // Query traffic signs
-  std::vector<Data> signResults;
+  std::vector<std::shared_ptr<TrafficSign>> signResults;
   trafficSignIndex_.queryRadius(center, radius, signResults);
-  for (const auto& object : signResults) {
-    auto sign{std::get<std::shared_ptr<TrafficSign>>(object)};
+  for (auto& sign : signResults) {
     if (center.distanceTo(sign->position) <= radius) {
-      result.trafficSigns.push_back(sign);
+      result.trafficSigns.push_back(std::move(sign));
     }
   }
 
+  timer.setResults(result.totalCount());
   return result;
 }
 
+QueryResult MapServer::queryCorridor(const std::vector<Point2D>& polyline,
+                                     double halfWidth) const {
+  QueryTimer timer{queryMetrics_, QueryApi::QUERY_CORRIDOR};
+  QueryResult result;
+  if (polyline.empty()) {
+    return result;
+  }
+
+  // Path segments with their start arc length and grown bounds; a single
+  // point becomes a degenerate segment
+  struct PathSegment {
+    Point2D a;
+    Point2D b;
+    double startS;
+    BoundingBox bounds;
+  };
+  std::vector<PathSegment> path;
+  double s = 0.0;
+  for (size_t i = 0; i + 1 < std::max<size_t>(polyline.size(), 2); ++i) {
+    const Point2D& a{polyline[i]};
+    const Point2D& b{polyline[std::min(i + 1, polyline.size() - 1)]};
+    path.push_back({a, b, s, polylineBounds({a, b}, halfWidth)});
+    s += a.distanceTo(b);
+  }
+  const BoundingBox corridorBounds{polylineBounds(polyline, halfWidth)};
+
+  // Prunes R-tree nodes whose box is farther than halfWidth from the path
+  const auto nearPath = [&](const BoundingBox& box) {
+    if (!box.intersects(corridorBounds)) {
+      return false;
+    }
+    for (const auto& segment : path) {
+      if (box.intersects(segment.bounds) &&
+          segmentBoxDistance(segment.a, segment.b, box) <= halfWidth) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Arc length of the first approach within halfWidth, if any, of the
+  // count vertices pointAt(i) returns; a single vertex is a point
+  const auto corridorS = [&](size_t count, const auto& pointAt) {
+    std::optional<double> first;
+    for (size_t i = 0; i + 1 < std::max<size_t>(count, 2); ++i) {
+      const Point2D a{pointAt(i)};
+      const Point2D b{pointAt(std::min(i + 1, count - 1))};
+      const BoundingBox bounds{
+          Point2D(std::min(a.x, b.x), std::min(a.y, b.y)),
+          Point2D(std::max(a.x, b.x), std::max(a.y, b.y))};
+      for (const auto& segment : path) {
+        if (!bounds.intersects(segment.bounds)) {
+          continue;
+        }
+        const auto closest{closestPoints(a, b, segment.a, segment.b)};
+        if (closest.distance > halfWidth) {
+          continue;
+        }
+        const double along{segment.startS +
+                           segment.a.distanceTo(closest.onSecond)};
+        if (!first.has_value() || along < *first) {
+          first = along;
+        }
+      }
+    }
+    return first;
+  };
+
+  std::vector<Data> candidates;
+  laneIndex_.queryIf(nearPath, candidates);
+  std::vector<std::pair<double, std::shared_ptr<Lane>>> lanes;
+  for (const auto& object : candidates) {
+    auto lane{std::get<std::shared_ptr<Lane>>(object)};
+    if (lane->centerlineSize() == 0) {
+      continue;
+    }
+    const auto along{corridorS(lane->centerlineSize(), [&](size_t i) {
+      return lane->centerlineAt(i);
+    })};
+    if (along.has_value()) {
+      lanes.emplace_back(*along, lane);
+    }
+  }
+
+  std::vector<std::shared_ptr<TrafficLight>> lightCandidates;
+  trafficLightIndex_.queryIf(corridorBounds, nearPath, lightCandidates);
+  std::vector<std::pair<double, std::shared_ptr<TrafficLight>>> lights;
+  for (const auto& light : lightCandidates) {
+    const auto along{
+        corridorS(1, [&](size_t) { return light->position; })};
+    if (along.has_value()) {
+      lights.emplace_back(*along, light);
+    }
+  }
+
+  std::vector<std::shared_ptr<TrafficSign>> signCandidates;
+  trafficSignIndex_.queryIf(corridorBounds, nearPath, signCandidates);
+  std::vector<std::pair<double, std::shared_ptr<TrafficSign>>> signs;
+  for (const auto& sign : signCandidates) {
+    const auto along{corridorS(1, [&](size_t) { return sign->position; })};
+    if (along.has_value()) {
+      signs.emplace_back(*along, sign);
+    }
+  }
+
+  const auto byArcLength = [](const auto& lhs, const auto& rhs) {
+    return lhs.first < rhs.first;
+  };
+  std::stable_sort(lanes.begin(), lanes.end(), byArcLength);
+  std::stable_sort(lights.begin(), lights.end(), byArcLength);
+  std::stable_sort(signs.begin(), signs.end(), byArcLength);
+
+  result.lanes.reserve(lanes.size());
+  for (auto& [along, lane] : lanes) {
+    result.lanes.push_back(std::move(lane));
+  }
+  result.trafficLights.reserve(lights.size());
+  for (auto& [along, light] : lights) {
+    result.trafficLights.push_back(std::move(light));
+  }
+  result.trafficSigns.reserve(signs.size());
+  for (auto& [along, sign] : signs) {
+    result.trafficSigns.push_back(std::move(sign));
+  }
+
+  timer.setResults(result.totalCount());
+  return result;
+}
+
+QueryResult MapServer::queryPolygon(const ConvexPolygon& polygon) const {
+  QueryTimer timer{queryMetrics_, QueryApi::QUERY_POLYGON};
+  QueryResult result;
+  const auto overlaps = [&polygon](const BoundingBox& box) {
+    return polygon.intersects(box);
+  };
+
+  // Query lanes
+  std::vector<Data> laneResults;
+  laneIndex_.queryIf(overlaps, laneResults);
+  for (const auto& object : laneResults) {
+    auto lane{std::get<std::shared_ptr<Lane>>(object)};
+    const size_t count{lane->centerlineSize()};
+    bool inside = count == 1 && polygon.contains(lane->centerlineAt(0));
+    for (size_t i = 1; i < count && !inside; ++i) {
+      inside = polygon.intersectsSegment(lane->centerlineAt(i - 1),
+                                         lane->centerlineAt(i));
+    }
+    if (inside) {
+      result.lanes.push_back(lane);
+    }
+  }
+
+  // Query traffic lights
+  std::vector<std::shared_ptr<TrafficLight>> lightResults;
+  trafficLightIndex_.queryIf(polygon.bounds(), overlaps, lightResults);
+  for (auto& light : lightResults) {
+    if (polygon.contains(light->position)) {
+      result.trafficLights.push_back(std::move(light));
+    }
+  }
+
+  // Query traffic signs
+  std::vector<std::shared_ptr<TrafficSign>> signResults;
+  trafficSignIndex_.queryIf(polygon.bounds(), overlaps, signResults);
+  for (auto& sign : signResults) {
+    if (polygon.contains(sign->position)) {
+      result.trafficSigns.push_back(std::move(sign));
+    }
+  }
+
+  timer.setResults(result.totalCount());
+  return result;
+}
+
+QueryResult MapServer::queryOrientedBox(const OrientedBox& box) const {
+  return queryPolygon(box.toPolygon());
+}
+
 std::optional<std::shared_ptr<Lane>> MapServer::getLaneById(
     uint64_t laneId) const {
   auto it = lanes_.find(laneId);
@@ -180,19 +450,55 @@ std::optional<std::shared_ptr<TrafficSign>> MapServer::getTrafficSignById(
 
 std::vector<std::shared_ptr<Lane>> MapServer::getNearbyLanes(
     const Point2D& position, double maxDistance) const {
+  QueryTimer timer{queryMetrics_, QueryApi::NEARBY_LANES};
+  if (isQueryCacheEnabled() && maxDistance >= 0.0 &&
+      maxDistance / queryCacheCellSize_ < kMaxCachedRadiusBuckets) {
+    std::vector<std::shared_ptr<Lane>> lanes;
+    for (const auto& lane : cachedLaneCandidates(position, maxDistance,
+                                                 CachedQuery::NEARBY_LANES)) {
+      if (lane->distanceTo(position) <= maxDistance) {
+        lanes.push_back(lane);
+      }
+    }
+    timer.setResults(lanes.size());
+    return lanes;
+  }
+
   const QueryResult result{queryRadius(position, maxDistance)};
+  timer.setResults(result.lanes.size());
   return result.lanes;
 }
 
 std::optional<std::shared_ptr<Lane>> MapServer::getClosestLane(
     const Point2D& position) const {
+  QueryTimer timer{queryMetrics_, QueryApi::CLOSEST_LANE};
+  if (isQueryCacheEnabled()) {
+    // Closest within the outer radius; same answer as the staged search
+    // below because a lane inside the inner radius is always closer
+    std::shared_ptr<Lane> closestLane = nullptr;
+    double minDistance = std::numeric_limits<double>::max();
+    for (const auto& lane : cachedLaneCandidates(
+             position, kClosestLaneMaxRadius, CachedQuery::CLOSEST_LANE)) {
+      const auto dist{lane->distanceTo(position)};
+      if (dist < minDistance) {
+        minDistance = dist;
+        closestLane = lane;
+      }
+    }
+    if (minDistance > kClosestLaneMaxRadius) {
+      return std::nullopt;
+    }
+    timer.setResults(1);
+    return closestLane;
+  }
+
   // Start with a reasonable search radius
-  double searchRadius = 50.0;  // meters
+  double searchRadius = kClosestLaneRadius;
   auto candidates{getNearbyLanes(position, searchRadius)};
 
   if (candidates.empty()) {
     // Try larger radius
-    searchRadius = 200.0;
+    searchRadius = kClosestLaneMaxRadius;
     candidates = getNearbyLanes(position, searchRadius);
     if (candidates.empty()) {
       return std::nullopt;
@@ -204,20 +510,20 @@ std::optional<std::shared_ptr<Lane>> MapServer::getClosestLane(
   double minDistance = std::numeric_limits<double>::max();
 
   for (const auto& lane : candidates) {
-    for (const auto& point : lane->centerline) {
-      const auto dist{position.distanceTo(point)};
-      if (dist < minDistance) {
-        minDistance = dist;
-        closestLane = lane;
-      }
+    const auto dist{lane->distanceTo(position)};
+    if (dist < minDistance) {
+      minDistance = dist;
+      closestLane = lane;
     }
   }
 
+  timer.setResults(1);
   return closestLane;
 }
 
 std::vector<std::shared_ptr<TrafficLight>> MapServer::getTrafficLightsForLane(
     uint64_t laneId) const {
+  QueryTimer timer{queryMetrics_, QueryApi::TRAFFIC_LIGHTS_FOR_LANE};
   std::vector<std::shared_ptr<TrafficLight>> result;
 
   for (const auto& [id, light] : trafficLights_) {
@@ -228,11 +534,13 @@ std::vector<std::shared_ptr<TrafficLight>> MapServer::getTrafficLightsForLane(
     }
   }
 
+  timer.setResults(result.size());
   return result;
 }
 
 std::vector<std::shared_ptr<TrafficSign>> MapServer::getTrafficSignsForLane(
     uint64_t laneId) const {
+  QueryTimer timer{queryMetrics_, QueryApi::TRAFFIC_SIGNS_FOR_LANE};
   std::vector<std::shared_ptr<TrafficSign>> result;
 
   for (const auto& [id, sign] : trafficSigns_) {
@@ -243,43 +551,76 @@ std::vector<std::shared_ptr<TrafficSign>> MapServer::getTrafficSignsForLane(
     }
   }
 
+  timer.setResults(result.size());
   return result;
 }
 
-size_t MapServer::getMemoryUsage() const {
-  size_t total = 0;
+std::optional<FrenetPoint> MapServer::project(uint64_t laneId,
+                                              const Point2D& point) const {
+  QueryTimer timer{queryMetrics_, QueryApi::PROJECT};
+  auto it = arcLengthTables_.find(laneId);
+  if (it != arcLengthTables_.end()) {
+    timer.setResults(1);
+    return it->second.project(point);
+  }
+  return std::nullopt;
+}
 
-  // Estimate lane memory
-  for (const auto& [id, lane] : lanes_) {
-    total += sizeof(Lane);
-    total += lane->centerline.size() * sizeof(Point2D);
-    total += lane->leftBoundary.size() * sizeof(Point2D);
-    total += lane->rightBoundary.size() * sizeof(Point2D);
-    total += lane->predecessorIds.size() * sizeof(uint64_t);
-    total += lane->successorIds.size() * sizeof(uint64_t);
-    total += lane->adjacentLeftIds.size() * sizeof(uint64_t);
-    total += lane->adjacentRightIds.size() * sizeof(uint64_t);
+std::optional<LanePose> MapServer::interpolate(uint64_t laneId,
+                                               double s) const {
+  QueryTimer timer{queryMetrics_, QueryApi::INTERPOLATE};
+  auto it = arcLengthTables_.find(laneId);
+  if (it != arcLengthTables_.end()) {
+    timer.setResults(1);
+    return it->second.interpolate(s);
   }
+  return std::nullopt;
+}
 
-  // Traffic lights
-  total += trafficLights_.size() * sizeof(TrafficLight);
-  for (const auto& [id, light] : trafficLights_) {
-    total += light->controlledLaneIds.size() * sizeof(uint64_t);
+bool MapServer::projectBatch(uint64_t laneId,
+                             const std::vector<Point2D>& points,
+                             std::vector<FrenetPoint>& results) const {
+  auto it = arcLengthTables_.find(laneId);
+  if (it == arcLengthTables_.end()) {
+    results.clear();
+    return false;
+  }
+  it->second.project(points, results);
+  return true;
+}
+
+std::optional<double> MapServer::getLaneLength(uint64_t laneId) const {
+  auto it = arcLengthTables_.find(laneId);
+  if (it != arcLengthTables_.end()) {
+    return it->second.length();
   }
+  return std::nullopt;
+}
 
-  // Traffic signs
-  total += trafficSigns_.size() * sizeof(TrafficSign);
-  for (const auto& [id, sign] : trafficSigns_) {
-    total += sign->value.capacity();
-    total += sign->affectedLaneIds.size() * sizeof(uint64_t);
+std::optional<Route> MapServer::route(uint64_t fromLaneId,
+                                     uint64_t toLaneId) const {
+  QueryTimer timer{queryMetrics_, QueryApi::ROUTE};
+  auto result{hasRoutingHierarchy()
+                  ? routingHierarchy_.route(routingGraph_, fromLaneId, toLaneId)
+                  : routingGraph_.aStar(fromLaneId, toLaneId)};
+  if (result.has_value()) {
+    timer.setResults(result->laneIds.size());
   }
+  return result;
+}
 
-  // R-tree overhead (rough estimate)
-  total += (laneIndex_.size() + trafficLightIndex_.size() +
-            trafficSignIndex_.size()) *
-           64;
+void MapServer::buildRoutingHierarchy() {
+  const MemoryAccount::Scope scope{memoryAccount_.get()};
+  routingHierarchy_.build(routingGraph_);
+}
+
+bool MapServer::saveRoutingHierarchy(const std::string& filepath) const {
+  return routingHierarchy_.save(filepath);
+}
 
-  return total;
+bool MapServer::loadRoutingHierarchy(const std::string& filepath) {
+  const MemoryAccount::Scope scope{memoryAccount_.get()};
+  return routingHierarchy_.load(filepath, routingGraph_);
 }
 
 bool MapServer::checkMemoryConstraints() const {
@@ -292,12 +633,102 @@ bool MapServer::checkMemoryConstraints() const {
 }
 
 void MapServer::clear() {
-  lanes_.clear();
-  trafficLights_.clear();
-  trafficSigns_.clear();
-  laneIndex_.clear();
-  trafficLightIndex_.clear();
-  trafficSignIndex_.clear();
+  resetStorage();
+  bumpGeneration();
+}
+
+void MapServer::resetStorage() {
+  // Containers pick their account up when constructed, so fresh ones are
+  // assigned instead of clearing the old
+  const MemoryAccount::Scope scope{memoryAccount_.get()};
+  lanes_ = LaneMap{};
+  trafficLights_ = TrafficLightMap{};
+  trafficSigns_ = TrafficSignMap{};
+  laneIndex_ = RTree{};
+  trafficLightIndex_ = PointIndex<TrafficLight>{trafficLightIndex_.type()};
+  trafficSignIndex_ = PointIndex<TrafficSign>{trafficSignIndex_.type()};
+  arcLengthTables_ = decltype(arcLengthTables_){};
+  routingGraph_ = RoutingGraph{};
+  routingHierarchy_ = ContractionHierarchy{};
+}
+
+void MapServer::bumpGeneration() {
+  generation_.store(nextGeneration.fetch_add(1, std::memory_order_relaxed),
+                    std::memory_order_release);
+}
+
+void MapServer::enableQueryCache(double cellSize, size_t capacity) {
+  queryCacheCellSize_ = cellSize > 0.0 ? cellSize : kDefaultQueryCacheCellSize;
+  queryCacheCapacity_ = std::max<size_t>(capacity, 1);
+  // New cell geometry makes existing entries meaningless
+  bumpGeneration();
+}
+
+void MapServer::disableQueryCache() {
+  queryCacheCapacity_ = 0;
+}
+
+QueryCacheStats MapServer::getQueryCacheStats() const {
+  return threadQueryCache().stats();
+}
+
+void MapServer::resetQueryCacheStats() const {
+  threadQueryCache().stats() = QueryCacheStats{};
+}
+
+QueryCache& MapServer::threadQueryCache() const {
+  auto& caches{threadQueryCaches()};
+  auto it = caches.find(serverId_);
+  if (it == caches.end()) {
+    // Drop the caches of destroyed servers so they stop pinning lanes
+    for (auto stale = caches.begin(); stale != caches.end();) {
+      stale = stale->second.owner.expired() ? caches.erase(stale)
+                                            : std::next(stale);
+    }
+    it = caches.try_emplace(serverId_).first;
+    it->second.owner = queryCacheOwner_;
+  }
+
+  // Entries of a previous map only pin its lanes; purge them
+  auto& entry{it->second};
+  const uint64_t generation{getGeneration()};
+  if (entry.generation != generation) {
+    entry.cache.clear();
+    entry.generation = generation;
+  }
+  if (entry.cache.capacity() != queryCacheCapacity_) {
+    entry.cache.setCapacity(queryCacheCapacity_);
+  }
+  return entry.cache;
+}
+
+const QueryCache::Candidates& MapServer::cachedLaneCandidates(
+    const Point2D& position, double radius, CachedQuery query) const {
+  auto& cache{threadQueryCache()};
+
+  const double cell{queryCacheCellSize_};
+  const auto cellX{static_cast<int64_t>(std::floor(position.x / cell))};
+  const auto cellY{static_cast<int64_t>(std::floor(position.y / cell))};
+  const auto radiusBucket{static_cast<uint32_t>(std::ceil(radius / cell))};
+  const QueryCacheKey key{getGeneration(), cellX, cellY, radiusBucket, query};
+  if (const auto* candidates = cache.find(key)) {
+    return *candidates;
+  }
+
+  // Every lane within the rounded-up radius of any point in the cell
+  const double reach{radiusBucket * cell};
+  const BoundingBox box{
+      Point2D(cellX * cell - reach, cellY * cell - reach),
+      Point2D((cellX + 1) * cell + reach, (cellY + 1) * cell + reach)};
+  std::vector<Data> results;
+  laneIndex_.query(box, results);
+
+  QueryCache::Candidates candidates;
+  candidates.reserve(results.size());
+  for (const auto& object : results) {
+    candidates.push_back(std::get<std::shared_ptr<Lane>>(object));
+  }
+  return cache.insert(key, std::move(candidates));
 }
 
 }  // namespace hdmap
@@ -0,0 +1,130 @@
+#include "include/memory_account.hpp"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+thread_local MemoryAccount* currentAccount{nullptr};
+
+// Every account acquire() ever created. Never destroyed, so accounts stay
+// valid for elements released during static destruction.
+struct AccountPool {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<MemoryAccount>> accounts;
+  std::vector<MemoryAccount*> released;
+};
+
+AccountPool& accountPool() {
+  static auto* pool{new AccountPool};
+  return *pool;
+}
+
+bool isIdle(const MemoryAccount& account) {
+  for (size_t i = 0; i < kMemoryCategoryCount; ++i) {
+    if (account.used(static_cast<MemoryCategory>(i)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void ReleaseMemoryAccount::operator()(MemoryAccount* account) const {
+  auto& pool{accountPool()};
+  const std::scoped_lock lock{pool.mutex};
+  pool.released.push_back(account);
+}
+
+MemoryAccount::MemoryAccount() {
+  for (size_t i = 0; i < kMemoryCategoryCount; ++i) {
+    bytes_[i].store(0, std::memory_order_relaxed);
+    peaks_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+MemoryAccountHandle MemoryAccount::acquire() {
+  auto& pool{accountPool()};
+  const std::scoped_lock lock{pool.mutex};
+  for (auto it = pool.released.begin(); it != pool.released.end(); ++it) {
+    MemoryAccount* account{*it};
+    if (isIdle(*account)) {
+      pool.released.erase(it);
+      for (size_t i = 0; i < kMemoryCategoryCount; ++i) {
+        account->resetPeak(static_cast<MemoryCategory>(i));
+      }
+      return MemoryAccountHandle{account};
+    }
+  }
+  pool.accounts.push_back(std::make_unique<MemoryAccount>());
+  return MemoryAccountHandle{pool.accounts.back().get()};
+}
+
+void MemoryAccount::allocate(MemoryCategory category, size_t bytes) {
+  const size_t i{index(category)};
+  const size_t now{bytes_[i].fetch_add(bytes, std::memory_order_relaxed) +
+                   bytes};
+  size_t peak = peaks_[i].load(std::memory_order_relaxed);
+  while (now > peak &&
+         !peaks_[i].compare_exchange_weak(peak, now,
+                                          std::memory_order_relaxed)) {
+  }
+}
+
+void MemoryAccount::deallocate(MemoryCategory category, size_t bytes) {
+  bytes_[index(category)].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryAccount::resetPeak(MemoryCategory category) {
+  peaks_[index(category)].store(used(category), std::memory_order_relaxed);
+}
+
+MemoryBreakdown MemoryAccount::breakdown() const {
+  MemoryBreakdown result;
+  result.lanes = used(MemoryCategory::LANES);
+  result.trafficElements = used(MemoryCategory::TRAFFIC_ELEMENTS);
+  result.geometry = used(MemoryCategory::GEOMETRY);
+  result.indices = used(MemoryCategory::INDICES);
+  result.parserScratch = used(MemoryCategory::PARSER_SCRATCH);
+  result.parserScratchPeak = peak(MemoryCategory::PARSER_SCRATCH);
+  return result;
+}
+
+MemoryAccount* MemoryAccount::current() {
+  return currentAccount;
+}
+
+MemoryAccount& MemoryAccount::unscoped() {
+  static auto* account{new MemoryAccount};
+  return *account;
+}
+
+MemoryAccount::Scope::Scope(MemoryAccount* account)
+    : previous_{currentAccount} {
+  currentAccount = account;
+}
+
+MemoryAccount::Scope::~Scope() {
+  currentAccount = previous_;
+}
+
+MemoryCharge::MemoryCharge(MemoryAccount* account, MemoryCategory category,
+                           size_t bytes)
+    : account_{account}, category_{category}, bytes_{bytes} {
+  if (account_) {
+    account_->allocate(category_, bytes_);
+  }
+}
+
+MemoryCharge::~MemoryCharge() {
+  if (account_) {
+    account_->deallocate(category_, bytes_);
+  }
+}
+
+}  // namespace hdmap
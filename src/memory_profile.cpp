@@ -0,0 +1,102 @@
+#include "include/memory_profile.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace hdmap {
+
+namespace {
+
+constexpr size_t kBytesPerKilobyte = 1024;
+
+// Calls visit(key, bytes) for every "Key:  123 kB" line of a /proc file
+template <typename Visitor>
+bool readKilobyteFields(const char* path, Visitor visit) {
+  std::ifstream file{path};
+  if (!file.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields{line};
+    std::string key;
+    size_t kilobytes{0};
+    std::string unit;
+    if (fields >> key >> kilobytes >> unit && unit == "kB") {
+      visit(key, kilobytes * kBytesPerKilobyte);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+ProcessMemory ProcessMemory::read() {
+  ProcessMemory memory;
+  memory.available =
+      readKilobyteFields("/proc/self/smaps_rollup",
+                         [&memory](const std::string& key, size_t bytes) {
+                           if (key == "Rss:") {
+                             memory.rss = bytes;
+                           } else if (key == "Pss:") {
+                             memory.pss = bytes;
+                           } else if (key == "Anonymous:") {
+                             memory.anonymous = bytes;
+                           } else if (key == "Swap:") {
+                             memory.swap = bytes;
+                           }
+                         });
+  if (memory.available) {
+    return memory;
+  }
+  memory.available =
+      readKilobyteFields("/proc/self/status",
+                         [&memory](const std::string& key, size_t bytes) {
+                           if (key == "VmRSS:") {
+                             memory.rss = bytes;
+                           } else if (key == "RssAnon:") {
+                             memory.anonymous = bytes;
+                           } else if (key == "VmSwap:") {
+                             memory.swap = bytes;
+                           }
+                         });
+  return memory;
+}
+
+AllocatorStats AllocatorStats::read() {
+  AllocatorStats stats;
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  const auto info{mallinfo2()};
+  stats.inUse = info.uordblks + info.hblkhd;
+  stats.free = info.fordblks;
+  stats.mmapped = info.hblkhd;
+  stats.available = true;
+#elif defined(__GLIBC__)
+  // Older glibc reports int fields that wrap above 2 GiB
+  const auto info{mallinfo()};
+  stats.inUse = static_cast<unsigned>(info.uordblks) +
+                static_cast<unsigned>(info.hblkhd);
+  stats.free = static_cast<unsigned>(info.fordblks);
+  stats.mmapped = static_cast<unsigned>(info.hblkhd);
+  stats.available = true;
+#endif
+  return stats;
+}
+
+MemorySample MemorySample::take(const MemoryAccount* account) {
+  MemorySample sample;
+  sample.process = ProcessMemory::read();
+  sample.allocator = AllocatorStats::read();
+  if (account != nullptr) {
+    sample.tracked = account->breakdown();
+  }
+  return sample;
+}
+
+}  // namespace hdmap
@@ -0,0 +1,149 @@
+#include "include/perf_counters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace hdmap {
+
+namespace {
+
+constexpr std::array<const char*, kPerfEventCount> kEventNames{
+    "cycles",     "instructions",  "l1d_misses",
+    "llc_misses", "branch_misses", "page_faults"};
+
+#ifdef __linux__
+
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr std::array<EventConfig, kPerfEventCount> kEventConfigs{{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+}};
+
+int openEvent(const EventConfig& event) {
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = event.type;
+  attributes.config = event.config;
+  attributes.disabled = 1;
+  // User space only: allowed at the default perf_event_paranoid of 2
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+const char* perfEventName(PerfEvent event) {
+  return kEventNames[static_cast<size_t>(event)];
+}
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+#ifdef __linux__
+  for (size_t i = 0; i < kPerfEventCount; ++i) {
+    fds_[i] = openEvent(kEventConfigs[i]);
+    if (fds_[i] < 0 && lastError_.empty()) {
+      lastError_ = std::string{"Cannot open "} + kEventNames[i] +
+                   " counter: " + std::strerror(errno);
+    }
+  }
+#else
+  lastError_ = "Performance counters need Linux perf_event_open";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+bool PerfCounters::available() const {
+  for (const int fd : fds_) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (const int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (const int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerfCounters::reset() {
+#ifdef __linux__
+  for (const int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    }
+  }
+#endif
+}
+
+PerfSample PerfCounters::read() const {
+  PerfSample sample;
+#ifdef __linux__
+  for (size_t i = 0; i < kPerfEventCount; ++i) {
+    // value, time enabled, time running
+    uint64_t values[3]{};
+    if (fds_[i] < 0 ||
+        ::read(fds_[i], values, sizeof(values)) !=
+            static_cast<ssize_t>(sizeof(values))) {
+      continue;
+    }
+    sample.valid[i] = true;
+    if (values[2] > 0 && values[2] < values[1]) {
+      values[0] = static_cast<uint64_t>(static_cast<double>(values[0]) *
+                                        values[1] / values[2]);
+    }
+    sample.values[i] = values[0];
+  }
+#endif
+  return sample;
+}
+
+}  // namespace hdmap
@@ -0,0 +1,206 @@
+#include "include/projection.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+// WGS84 ellipsoid
+constexpr double kSemiMajorAxis = 6378137.0;
+constexpr double kFlattening = 1.0 / 298.257223563;
+constexpr double kEccentricitySquared = kFlattening * (2.0 - kFlattening);
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+// UTM constants
+constexpr double kUtmScale = 0.9996;
+constexpr double kUtmFalseEasting = 500000.0;
+constexpr double kUtmFalseNorthingSouth = 10000000.0;
+
+// Kruger series coefficients (third order in n), see Karney (2011)
+struct KrugerSeries {
+  double rectifyingRadius;  // A
+  double alpha[3];
+  double beta[3];
+  double delta[3];
+};
+
+KrugerSeries makeKrugerSeries() {
+  const double n = kFlattening / (2.0 - kFlattening);
+  const double n2 = n * n;
+  const double n3 = n2 * n;
+
+  KrugerSeries series{};
+  series.rectifyingRadius =
+      kSemiMajorAxis / (1.0 + n) * (1.0 + n2 / 4.0 + n2 * n2 / 64.0);
+  series.alpha[0] = n / 2.0 - 2.0 * n2 / 3.0 + 5.0 * n3 / 16.0;
+  series.alpha[1] = 13.0 * n2 / 48.0 - 3.0 * n3 / 5.0;
+  series.alpha[2] = 61.0 * n3 / 240.0;
+  series.beta[0] = n / 2.0 - 2.0 * n2 / 3.0 + 37.0 * n3 / 96.0;
+  series.beta[1] = n2 / 48.0 + n3 / 15.0;
+  series.beta[2] = 17.0 * n3 / 480.0;
+  series.delta[0] = 2.0 * n - 2.0 * n2 / 3.0 - 2.0 * n3;
+  series.delta[1] = 7.0 * n2 / 3.0 - 8.0 * n3 / 5.0;
+  series.delta[2] = 56.0 * n3 / 15.0;
+  return series;
+}
+
+const KrugerSeries kKruger{makeKrugerSeries()};
+
+}  // namespace
+
+int utmZoneFor(double lon) {
+  const int zone = static_cast<int>(std::floor((lon + 180.0) / 6.0)) + 1;
+  return std::min(std::max(zone, 1), 60);
+}
+
+Projector::Projector(const ProjectionConfig& config)
+    : config_{config}, deriveUtmZone_{config.utmZone == 0} {
+  setOrigin(config.originLat, config.originLon);
+}
+
+void Projector::setOrigin(double lat, double lon) {
+  config_.originLat = lat;
+  config_.originLon = lon;
+
+  // Meridian and prime-vertical radii of curvature at the origin
+  const double sinLat = std::sin(lat * kDegToRad);
+  const double w = 1.0 - kEccentricitySquared * sinLat * sinLat;
+  const double primeVertical = kSemiMajorAxis / std::sqrt(w);
+  const double meridian =
+      kSemiMajorAxis * (1.0 - kEccentricitySquared) / (w * std::sqrt(w));
+  metersPerDegreeLon_ = primeVertical * std::cos(lat * kDegToRad) * kDegToRad;
+  metersPerDegreeLat_ = meridian * kDegToRad;
+
+  if (config_.type == ProjectionType::UTM) {
+    // The hemisphere comes with the zone: a fixed zone keeps it even when
+    // the origin is left at (0, 0)
+    if (deriveUtmZone_) {
+      config_.utmZone = lat < 0.0 ? -utmZoneFor(lon) : utmZoneFor(lon);
+    }
+    const int zone{std::abs(config_.utmZone)};
+    centralMeridian_ = (zone - 1) * 6.0 - 180.0 + 3.0;
+    falseNorthing_ = config_.utmZone < 0 ? kUtmFalseNorthingSouth : 0.0;
+  }
+}
+
+void Projector::forward(std::vector<double>& xs,
+                        std::vector<double>& ys) const {
+  forward(xs.data(), ys.data(), std::min(xs.size(), ys.size()));
+}
+
+void Projector::forward(double* xs, double* ys, size_t count) const {
+  switch (config_.type) {
+    case ProjectionType::NONE:
+      return;
+    case ProjectionType::LOCAL_TANGENT_PLANE: {
+      // Plain multiply-add over contiguous arrays; vectorizes cleanly
+      const double lon0 = config_.originLon;
+      const double lat0 = config_.originLat;
+      const double sx = metersPerDegreeLon_;
+      const double sy = metersPerDegreeLat_;
+      double* x{xs};
+      double* y{ys};
+      for (size_t i = 0; i < count; ++i) {
+        x[i] = (x[i] - lon0) * sx;
+        y[i] = (y[i] - lat0) * sy;
+      }
+      return;
+    }
+    case ProjectionType::UTM:
+      for (size_t i = 0; i < count; ++i) {
+        const Point2D projected{utmForward(ys[i], xs[i])};
+        xs[i] = projected.x;
+        ys[i] = projected.y;
+      }
+      return;
+  }
+}
+
+Point2D Projector::forward(const Point2D& lonLat) const {
+  switch (config_.type) {
+    case ProjectionType::LOCAL_TANGENT_PLANE:
+      return Point2D{(lonLat.x - config_.originLon) * metersPerDegreeLon_,
+                     (lonLat.y - config_.originLat) * metersPerDegreeLat_};
+    case ProjectionType::UTM:
+      return utmForward(lonLat.y, lonLat.x);
+    case ProjectionType::NONE:
+    default:
+      return lonLat;
+  }
+}
+
+Point2D Projector::inverse(const Point2D& local) const {
+  switch (config_.type) {
+    case ProjectionType::LOCAL_TANGENT_PLANE:
+      return Point2D{config_.originLon + local.x / metersPerDegreeLon_,
+                     config_.originLat + local.y / metersPerDegreeLat_};
+    case ProjectionType::UTM:
+      return utmInverse(local.x, local.y);
+    case ProjectionType::NONE:
+    default:
+      return local;
+  }
+}
+
+void Projector::inverse(std::vector<Point2D>& points) const {
+  for (auto& point : points) {
+    point = inverse(point);
+  }
+}
+
+Point2D Projector::utmForward(double lat, double lon) const {
+  const double phi = lat * kDegToRad;
+  const double dLambda = (lon - centralMeridian_) * kDegToRad;
+
+  const double twoSqrtN = 2.0 * std::sqrt(kFlattening / (2.0 - kFlattening)) /
+                          (1.0 + kFlattening / (2.0 - kFlattening));
+  const double sinPhi = std::sin(phi);
+  const double t =
+      std::sinh(std::atanh(sinPhi) - twoSqrtN * std::atanh(twoSqrtN * sinPhi));
+  const double xiPrime = std::atan2(t, std::cos(dLambda));
+  const double etaPrime =
+      std::atanh(std::sin(dLambda) / std::sqrt(1.0 + t * t));
+
+  double xi = xiPrime;
+  double eta = etaPrime;
+  for (int j = 1; j <= 3; ++j) {
+    const double a = kKruger.alpha[j - 1];
+    xi += a * std::sin(2.0 * j * xiPrime) * std::cosh(2.0 * j * etaPrime);
+    eta += a * std::cos(2.0 * j * xiPrime) * std::sinh(2.0 * j * etaPrime);
+  }
+
+  const double scale = kUtmScale * kKruger.rectifyingRadius;
+  return Point2D{kUtmFalseEasting + scale * eta, falseNorthing_ + scale * xi};
+}
+
+Point2D Projector::utmInverse(double easting, double northing) const {
+  const double scale = kUtmScale * kKruger.rectifyingRadius;
+  const double xi = (northing - falseNorthing_) / scale;
+  const double eta = (easting - kUtmFalseEasting) / scale;
+
+  double xiPrime = xi;
+  double etaPrime = eta;
+  for (int j = 1; j <= 3; ++j) {
+    const double b = kKruger.beta[j - 1];
+    xiPrime -= b * std::sin(2.0 * j * xi) * std::cosh(2.0 * j * eta);
+    etaPrime -= b * std::cos(2.0 * j * xi) * std::sinh(2.0 * j * eta);
+  }
+
+  const double chi = std::asin(std::sin(xiPrime) / std::cosh(etaPrime));
+  double phi = chi;
+  for (int j = 1; j <= 3; ++j) {
+    phi += kKruger.delta[j - 1] * std::sin(2.0 * j * chi);
+  }
+  const double lambda = std::atan2(std::sinh(etaPrime), std::cos(xiPrime));
+
+  return Point2D{centralMeridian_ + lambda * kRadToDeg, phi * kRadToDeg};
+}
+
+}  // namespace hdmap
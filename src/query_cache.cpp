@@ -0,0 +1,62 @@
+#include "include/query_cache.hpp"
+
+#include <utility>
+
+namespace hdmap {
+
+size_t QueryCacheKeyHash::operator()(const QueryCacheKey& key) const {
+  // Boost-style hash_combine over the key fields
+  size_t seed = std::hash<uint64_t>{}(key.generation);
+  const auto combine = [&seed](size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  };
+  combine(std::hash<int64_t>{}(key.cellX));
+  combine(std::hash<int64_t>{}(key.cellY));
+  combine(std::hash<uint32_t>{}(key.radiusBucket));
+  combine(static_cast<size_t>(key.query));
+  return seed;
+}
+
+const QueryCache::Candidates* QueryCache::find(const QueryCacheKey& key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    stats_.misses++;
+    return nullptr;
+  }
+  stats_.hits++;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &it->second->second;
+}
+
+const QueryCache::Candidates& QueryCache::insert(const QueryCacheKey& key,
+                                                 Candidates candidates) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = std::move(candidates);
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+  }
+
+  entries_.emplace_front(key, std::move(candidates));
+  index_[key] = entries_.begin();
+  while (index_.size() > capacity_ && !entries_.empty()) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  return entries_.front().second;
+}
+
+void QueryCache::setCapacity(size_t capacity) {
+  capacity_ = capacity;
+  while (index_.size() > capacity_ && !entries_.empty()) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+void QueryCache::clear() {
+  entries_.clear();
+  index_.clear();
+}
+
+}  // namespace hdmap
@@ -0,0 +1,210 @@
+#include "include/query_client.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace hdmap {
+
+namespace {
+
+// Requests in flight before their replies are read. A window of requests
+// must fit in the socket buffer: the daemon stops reading a connection
+// while replies to it are pending.
+constexpr size_t kPipelineWindow = 256;
+constexpr size_t kReadChunkBytes = 64 * 1024;
+
+}  // namespace
+
+QueryClient::~QueryClient() {
+  disconnect();
+}
+
+bool QueryClient::connect(const std::string& socketPath) {
+  disconnect();
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+    lastError_ = "Invalid socket path: " + socketPath;
+    return false;
+  }
+  std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0 ||
+      ::connect(fd_, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    return fail("Cannot connect to " + socketPath + ": " +
+                std::strerror(errno));
+  }
+  lastError_.clear();
+  return true;
+}
+
+void QueryClient::disconnect() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  input_.clear();
+  inputOffset_ = 0;
+}
+
+bool QueryClient::fail(const std::string& error) {
+  lastError_ = error;
+  disconnect();
+  return false;
+}
+
+bool QueryClient::execute(const std::vector<QueryRequest>& requests,
+                          std::vector<QueryReply>& replies) {
+  replies.clear();
+  replies.resize(requests.size());
+  if (!isConnected()) {
+    lastError_ = "Not connected";
+    return false;
+  }
+  for (size_t first = 0; first < requests.size(); first += kPipelineWindow) {
+    const size_t last{std::min(requests.size(), first + kPipelineWindow)};
+    const uint32_t firstId{nextRequestId_};
+    output_.clear();
+    for (size_t i = first; i < last; ++i) {
+      encodeRequest(output_, nextRequestId_++, requests[i]);
+    }
+    if (!sendAll(output_)) {
+      return false;
+    }
+    for (size_t i = first; i < last; ++i) {
+      const auto requestId{static_cast<uint32_t>(firstId + (i - first))};
+      if (!readReply(requests[i].type, requestId, replies[i])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::optional<QueryReply> QueryClient::single(const QueryRequest& request) {
+  std::vector<QueryReply> replies;
+  if (!execute({request}, replies) ||
+      replies.front().status != ResponseStatus::OK) {
+    return std::nullopt;
+  }
+  return std::move(replies.front());
+}
+
+std::optional<QueryIds> QueryClient::queryRegion(const BoundingBox& region) {
+  auto reply{single(QueryRequest::regionQuery(region))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return std::move(reply->ids);
+}
+
+std::optional<QueryIds> QueryClient::queryRadius(const Point2D& center,
+                                                 double radius) {
+  auto reply{single(QueryRequest::radiusQuery(center, radius))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return std::move(reply->ids);
+}
+
+std::optional<uint64_t> QueryClient::getClosestLane(const Point2D& position) {
+  const auto reply{single(QueryRequest::closestLane(position))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return reply->laneId;
+}
+
+std::optional<std::shared_ptr<Lane>> QueryClient::getLaneById(uint64_t laneId) {
+  const auto reply{single(QueryRequest::laneById(laneId))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return reply->lane;
+}
+
+std::optional<std::shared_ptr<TrafficLight>> QueryClient::getTrafficLightById(
+    uint64_t lightId) {
+  const auto reply{single(QueryRequest::trafficLightById(lightId))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return reply->trafficLight;
+}
+
+std::optional<std::shared_ptr<TrafficSign>> QueryClient::getTrafficSignById(
+    uint64_t signId) {
+  const auto reply{single(QueryRequest::trafficSignById(signId))};
+  if (!reply.has_value()) {
+    return std::nullopt;
+  }
+  return reply->trafficSign;
+}
+
+bool QueryClient::sendAll(const std::string& data) {
+  size_t sent{0};
+  while (sent < data.size()) {
+    const ssize_t written{
+        send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL)};
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return fail(std::string{"Cannot send request: "} +
+                  std::strerror(errno));
+    }
+    sent += static_cast<size_t>(written);
+  }
+  return true;
+}
+
+bool QueryClient::readReply(QueryType type, uint32_t requestId,
+                            QueryReply& reply) {
+  const auto buffered = [this]() { return input_.size() - inputOffset_; };
+  uint32_t length{0};
+  while (true) {
+    if (buffered() >= kFrameHeaderBytes) {
+      std::memcpy(&length, input_.data() + inputOffset_, sizeof(length));
+      if (buffered() - kFrameHeaderBytes >= length) {
+        break;
+      }
+    }
+    // Keep the buffer from growing with consumed frames
+    if (inputOffset_ > 0) {
+      input_.erase(0, inputOffset_);
+      inputOffset_ = 0;
+    }
+    char buffer[kReadChunkBytes];
+    const ssize_t received{recv(fd_, buffer, sizeof(buffer), 0)};
+    if (received == 0) {
+      return fail("Query daemon closed the connection");
+    }
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return fail(std::string{"Cannot read reply: "} + std::strerror(errno));
+    }
+    input_.append(buffer, static_cast<size_t>(received));
+  }
+
+  uint32_t replyId{0};
+  const bool decoded{decodeResponse(
+      input_.data() + inputOffset_ + kFrameHeaderBytes, length, type, replyId,
+      reply)};
+  inputOffset_ += kFrameHeaderBytes + length;
+  if (!decoded || replyId != requestId) {
+    return fail("Malformed reply from query daemon");
+  }
+  return true;
+}
+
+}  // namespace hdmap
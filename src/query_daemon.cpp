@@ -0,0 +1,357 @@
+#include "include/query_daemon.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+namespace hdmap {
+
+namespace {
+
+constexpr int kMaxEvents = 16;
+constexpr size_t kReadChunkBytes = 64 * 1024;
+// Input read per wakeup before other connections get a turn
+constexpr size_t kMaxInputPerWakeup = 1024 * 1024;
+
+bool makeAddress(const std::string& path, sockaddr_un& address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+}  // namespace
+
+struct QueryDaemon::Connection {
+  int fd{-1};
+  std::string input;
+  std::string output;
+  size_t outputSent{0};
+  bool peerClosed{false};  // read side done; close once output is sent
+};
+
+QueryDaemon::QueryDaemon(std::shared_ptr<const MapServer> server,
+                         DaemonConfig config)
+    : server_{std::move(server)}, config_{std::move(config)} {
+}
+
+QueryDaemon::~QueryDaemon() {
+  stop();
+}
+
+bool QueryDaemon::start() {
+  if (isRunning()) {
+    return true;
+  }
+  sockaddr_un address;
+  if (!makeAddress(config_.socketPath, address)) {
+    lastError_ = "Invalid socket path: " + config_.socketPath;
+    return false;
+  }
+  const auto fail = [this](const std::string& what) {
+    lastError_ = what + ": " + std::strerror(errno);
+    stop();
+    return false;
+  };
+
+  listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    return fail("Cannot create socket");
+  }
+  // A socket file nobody accepts on is left over from a crash
+  const int probe{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  const bool inUse{probe >= 0 &&
+                   connect(probe, reinterpret_cast<const sockaddr*>(&address),
+                           sizeof(address)) == 0};
+  if (probe >= 0) {
+    close(probe);
+  }
+  if (inUse) {
+    lastError_ = "Socket already served: " + config_.socketPath;
+    stop();
+    return false;
+  }
+  // Only ever replace a stale socket, never a file that happens to share
+  // the path
+  struct stat existing;
+  if (lstat(config_.socketPath.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      lastError_ = "Not a socket: " + config_.socketPath;
+      stop();
+      return false;
+    }
+    unlink(config_.socketPath.c_str());
+  }
+  if (bind(listenFd_, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0) {
+    return fail("Cannot bind " + config_.socketPath);
+  }
+  if (listen(listenFd_, config_.listenBacklog) != 0) {
+    return fail("Cannot listen on " + config_.socketPath);
+  }
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || stopFd_ < 0) {
+    return fail("Cannot create epoll set");
+  }
+  // The listener is one-shot too so one worker accepts at a time; the stop
+  // event stays level-triggered to wake them all
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = &listenFd_;
+  epoll_event stopEvent{};
+  stopEvent.events = EPOLLIN;
+  stopEvent.data.ptr = &stopFd_;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event) != 0 ||
+      epoll_ctl(epollFd_, EPOLL_CTL_ADD, stopFd_, &stopEvent) != 0) {
+    return fail("Cannot watch sockets");
+  }
+
+  const size_t workerCount{
+      config_.workerThreads > 0
+          ? config_.workerThreads
+          : std::max<size_t>(1, std::thread::hardware_concurrency())};
+  for (size_t i = 0; i < workerCount; ++i) {
+    workers_.emplace_back(&QueryDaemon::workerLoop, this);
+  }
+  spdlog::info("Serving queries on {} with {} workers", config_.socketPath,
+               workerCount);
+  return true;
+}
+
+void QueryDaemon::stop() {
+  if (!workers_.empty()) {
+    const uint64_t wake{1};
+    if (write(stopFd_, &wake, sizeof(wake)) != sizeof(wake)) {
+      spdlog::error("Cannot wake query workers: {}", std::strerror(errno));
+    }
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+    unlink(config_.socketPath.c_str());
+  }
+  {
+    const std::scoped_lock lock{connectionsMutex_};
+    for (const auto& [fd, connection] : connections_) {
+      close(fd);
+    }
+    connections_.clear();
+  }
+  for (int* fd : {&listenFd_, &epollFd_, &stopFd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+void QueryDaemon::setServer(std::shared_ptr<const MapServer> server) {
+  std::atomic_store(&server_, std::move(server));
+}
+
+DaemonStats QueryDaemon::getStats() const {
+  DaemonStats stats;
+  stats.connections = acceptedCount_.load();
+  stats.requests = requestCount_.load();
+  stats.batches = batchCount_.load();
+  return stats;
+}
+
+void QueryDaemon::workerLoop() {
+  epoll_event events[kMaxEvents];
+  while (true) {
+    const int count{epoll_wait(epollFd_, events, kMaxEvents, -1)};
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("epoll_wait failed: {}", std::strerror(errno));
+      return;
+    }
+    for (int i = 0; i < count; ++i) {
+      void* source{events[i].data.ptr};
+      if (source == &stopFd_) {
+        return;
+      }
+      if (source == &listenFd_) {
+        acceptConnections();
+        continue;
+      }
+      auto& connection{*static_cast<Connection*>(source)};
+      if (serve(connection)) {
+        rearm(connection);
+      } else {
+        closeConnection(connection);
+      }
+    }
+  }
+}
+
+void QueryDaemon::acceptConnections() {
+  while (true) {
+    const int fd{accept4(listenFd_, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)};
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        spdlog::warn("Cannot accept query client: {}", std::strerror(errno));
+      }
+      break;
+    }
+    auto connection{std::make_unique<Connection>()};
+    connection->fd = fd;
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = connection.get();
+    {
+      const std::scoped_lock lock{connectionsMutex_};
+      connections_.emplace(fd, std::move(connection));
+    }
+    acceptedCount_.fetch_add(1, std::memory_order_relaxed);
+    // Another worker may own the connection from here on
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      spdlog::warn("Cannot watch query client: {}", std::strerror(errno));
+      const std::scoped_lock lock{connectionsMutex_};
+      close(fd);
+      connections_.erase(fd);
+    }
+  }
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = &listenFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenFd_, &event);
+}
+
+bool QueryDaemon::serve(Connection& connection) {
+  // Replies of the previous batch go out before more requests are read
+  if (!connection.output.empty()) {
+    if (!flush(connection)) {
+      return false;
+    }
+    if (!connection.output.empty()) {
+      return true;
+    }
+  }
+  if (connection.peerClosed) {
+    return false;
+  }
+
+  char buffer[kReadChunkBytes];
+  while (connection.input.size() < kMaxInputPerWakeup) {
+    const ssize_t received{recv(connection.fd, buffer, sizeof(buffer), 0)};
+    if (received > 0) {
+      connection.input.append(buffer, static_cast<size_t>(received));
+      // A short read drained the socket; if more arrives the level-
+      // triggered rearm fires again, so skip the recv that would say EAGAIN
+      if (static_cast<size_t>(received) < sizeof(buffer)) {
+        break;
+      }
+      continue;
+    }
+    if (received == 0) {
+      connection.peerClosed = true;
+      break;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    return false;
+  }
+
+  // Every complete request against one snapshot of the map
+  const auto server{std::atomic_load(&server_)};
+  size_t offset{0};
+  uint64_t answered{0};
+  while (connection.input.size() - offset >= kFrameHeaderBytes) {
+    uint32_t length{0};
+    std::memcpy(&length, connection.input.data() + offset, sizeof(length));
+    if (length > kMaxRequestBytes) {
+      spdlog::warn("Closing query client: {} byte request", length);
+      return false;
+    }
+    if (connection.input.size() - offset - kFrameHeaderBytes < length) {
+      break;
+    }
+    uint32_t requestId{0};
+    QueryRequest request;
+    if (decodeRequest(connection.input.data() + offset + kFrameHeaderBytes,
+                      length, requestId, request)) {
+      encodeResponse(connection.output, requestId, *server, request);
+    } else {
+      encodeStatus(connection.output, requestId, ResponseStatus::BAD_REQUEST);
+    }
+    offset += kFrameHeaderBytes + length;
+    ++answered;
+  }
+  connection.input.erase(0, offset);
+
+  if (answered > 0) {
+    requestCount_.fetch_add(answered, std::memory_order_relaxed);
+    batchCount_.fetch_add(1, std::memory_order_relaxed);
+    if (!flush(connection)) {
+      return false;
+    }
+  }
+  // A half-closed client still gets the replies it is owed
+  return !connection.peerClosed || !connection.output.empty();
+}
+
+bool QueryDaemon::flush(Connection& connection) {
+  while (connection.outputSent < connection.output.size()) {
+    const ssize_t sent{send(connection.fd,
+                            connection.output.data() + connection.outputSent,
+                            connection.output.size() - connection.outputSent,
+                            MSG_NOSIGNAL)};
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The client is not reading; wait for EPOLLOUT
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.outputSent += static_cast<size_t>(sent);
+  }
+  connection.output.clear();
+  connection.outputSent = 0;
+  return true;
+}
+
+void QueryDaemon::rearm(Connection& connection) {
+  epoll_event event{};
+  event.events =
+      (connection.output.empty() ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+  event.data.ptr = &connection;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event) != 0) {
+    closeConnection(connection);
+  }
+}
+
+void QueryDaemon::closeConnection(Connection& connection) {
+  // Under the lock: once closed, accept may hand out the same fd again
+  const int fd{connection.fd};
+  const std::scoped_lock lock{connectionsMutex_};
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections_.erase(fd);
+}
+
+}  // namespace hdmap
@@ -0,0 +1,185 @@
+#include "include/query_metrics.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace hdmap {
+
+namespace {
+
+constexpr std::array<const char*, kQueryApiCount> kApiNames{
+    "query_region",   "query_radius",
+    "query_corridor", "query_polygon",
+    "nearby_lanes",   "closest_lane",
+    "traffic_lights_for_lane", "traffic_signs_for_lane",
+    "project",        "interpolate",
+    "route"};
+
+}  // namespace
+
+const char* queryApiName(QueryApi api) {
+  return kApiNames[static_cast<size_t>(api)];
+}
+
+std::string MetricsSnapshot::toJson() const {
+  std::ostringstream out;
+  out << std::setprecision(9) << "{";
+  for (size_t i = 0; i < kQueryApiCount; ++i) {
+    const auto& api{apis[i]};
+    out << (i == 0 ? "\n" : ",\n") << "  \"" << kApiNames[i]
+        << "\": {\"calls\": " << api.calls << ", \"latency_ns\": {\"p50\": "
+        << api.latency.percentile(0.5)
+        << ", \"p90\": " << api.latency.percentile(0.9)
+        << ", \"p99\": " << api.latency.percentile(0.99)
+        << ", \"p999\": " << api.latency.percentile(0.999)
+        << ", \"max\": " << api.latency.max()
+        << ", \"mean\": " << api.latency.mean() << "}, \"results\": {\"mean\": "
+        << api.resultSizes.mean()
+        << ", \"p99\": " << api.resultSizes.percentile(0.99)
+        << ", \"max\": " << api.resultSizes.max()
+        << "}, \"rtree_nodes_per_call\": "
+        << (api.calls == 0 ? 0.0
+                           : static_cast<double>(api.rtreeNodesVisited) /
+                                 api.calls)
+        << "}";
+  }
+  out << "\n}\n";
+  return out.str();
+}
+
+#ifdef HDMAP_ENABLE_METRICS
+
+namespace {
+
+// Distinguishes servers in the per-thread shard lists
+std::atomic<uint64_t> nextMetricsId{1};
+
+// Only the owning thread writes, so a plain load and store suffice
+void add(std::atomic<uint64_t>& counter, uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+void raise(std::atomic<uint64_t>& maximum, uint64_t value) {
+  if (value > maximum.load(std::memory_order_relaxed)) {
+    maximum.store(value, std::memory_order_relaxed);
+  }
+}
+
+template <size_t N>
+std::array<uint64_t, N> load(const std::array<std::atomic<uint64_t>, N>& from) {
+  std::array<uint64_t, N> values{};
+  for (size_t i = 0; i < N; ++i) {
+    values[i] = from[i].load(std::memory_order_relaxed);
+  }
+  return values;
+}
+
+}  // namespace
+
+struct QueryMetrics::Shard {
+  struct Api {
+    std::atomic<uint64_t> calls{0};
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> latency{};
+    std::atomic<uint64_t> latencySum{0};
+    std::atomic<uint64_t> latencyMax{0};
+    std::array<std::atomic<uint64_t>, SizeHistogram::kBucketCount> sizes{};
+    std::atomic<uint64_t> sizeSum{0};
+    std::atomic<uint64_t> sizeMax{0};
+    std::atomic<uint64_t> nodesVisited{0};
+  };
+
+  std::array<Api, kQueryApiCount> apis;
+};
+
+QueryMetrics::QueryMetrics() : id_{nextMetricsId.fetch_add(1)} {
+}
+
+QueryMetrics::~QueryMetrics() = default;
+
+QueryMetrics::Shard& QueryMetrics::threadShard() {
+  // (metrics id, shard) of every server this thread recorded into. A shard
+  // only this list still holds belongs to a destroyed server.
+  thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Shard>>>
+      shards;
+  for (const auto& [id, shard] : shards) {
+    if (id == id_) {
+      return *shard;
+    }
+  }
+
+  shards.erase(std::remove_if(shards.begin(), shards.end(),
+                              [](const auto& entry) {
+                                return entry.second.use_count() == 1;
+                              }),
+               shards.end());
+  auto shard{std::make_shared<Shard>()};
+  {
+    const std::scoped_lock lock{mutex_};
+    shards_.push_back(shard);
+  }
+  shards.emplace_back(id_, shard);
+  return *shard;
+}
+
+void QueryMetrics::record(QueryApi api, uint64_t nanoseconds, size_t results,
+                          uint64_t nodesVisited) {
+  auto& counters{threadShard().apis[static_cast<size_t>(api)]};
+  add(counters.calls, 1);
+  add(counters.latency[LatencyHistogram::bucketFor(nanoseconds)], 1);
+  add(counters.latencySum, nanoseconds);
+  raise(counters.latencyMax, nanoseconds);
+  add(counters.sizes[SizeHistogram::bucketFor(results)], 1);
+  add(counters.sizeSum, results);
+  raise(counters.sizeMax, results);
+  add(counters.nodesVisited, nodesVisited);
+}
+
+MetricsSnapshot QueryMetrics::snapshot() const {
+  MetricsSnapshot snapshot;
+  const std::scoped_lock lock{mutex_};
+  for (const auto& shard : shards_) {
+    for (size_t i = 0; i < kQueryApiCount; ++i) {
+      const auto& counters{shard->apis[i]};
+      auto& api{snapshot.apis[i]};
+      api.calls += counters.calls.load(std::memory_order_relaxed);
+      api.latency.merge(
+          load(counters.latency),
+          static_cast<double>(
+              counters.latencySum.load(std::memory_order_relaxed)),
+          counters.latencyMax.load(std::memory_order_relaxed));
+      api.resultSizes.merge(
+          load(counters.sizes),
+          static_cast<double>(counters.sizeSum.load(std::memory_order_relaxed)),
+          counters.sizeMax.load(std::memory_order_relaxed));
+      api.rtreeNodesVisited +=
+          counters.nodesVisited.load(std::memory_order_relaxed);
+    }
+  }
+  return snapshot;
+}
+
+void QueryMetrics::reset() {
+  const std::scoped_lock lock{mutex_};
+  for (const auto& shard : shards_) {
+    for (auto& counters : shard->apis) {
+      counters.calls.store(0, std::memory_order_relaxed);
+      for (auto& bucket : counters.latency) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+      counters.latencySum.store(0, std::memory_order_relaxed);
+      counters.latencyMax.store(0, std::memory_order_relaxed);
+      for (auto& bucket : counters.sizes) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+      counters.sizeSum.store(0, std::memory_order_relaxed);
+      counters.sizeMax.store(0, std::memory_order_relaxed);
+      counters.nodesVisited.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+#endif  // HDMAP_ENABLE_METRICS
+
+}  // namespace hdmap
@@ -0,0 +1,383 @@
+#include "include/query_protocol.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+#include "include/map_server.hpp"
+
+namespace hdmap {
+
+namespace {
+
+// Appends to a frame and patches its length on destruction
+class FrameWriter {
+ public:
+  explicit FrameWriter(std::string& out) : out_{out}, start_{out.size()} {
+    out_.append(kFrameHeaderBytes, '\0');
+  }
+  ~FrameWriter() {
+    const auto length{static_cast<uint32_t>(out_.size() - start_ -
+                                            kFrameHeaderBytes)};
+    std::memcpy(&out_[start_], &length, sizeof(length));
+  }
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  template <typename T>
+  void pod(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "POD values only");
+    out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T, typename Allocator>
+  void vector(const std::vector<T, Allocator>& values) {
+    pod(static_cast<uint64_t>(values.size()));
+    out_.append(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(T));
+  }
+
+  void string(const std::string& value) {
+    pod(static_cast<uint64_t>(value.size()));
+    out_.append(value);
+  }
+
+ private:
+  std::string& out_;
+  size_t start_;
+};
+
+// Bounds-checked reads from a frame payload; fails sticky
+class FrameReader {
+ public:
+  FrameReader(const char* data, size_t size) : data_{data}, size_{size} {
+  }
+
+  template <typename T>
+  bool pod(T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "POD values only");
+    if (!ok_ || size_ - offset_ < sizeof(T)) {
+      ok_ = false;
+      return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  template <typename T, typename Allocator>
+  bool vector(std::vector<T, Allocator>& values) {
+    uint64_t count{0};
+    if (!pod(count) || count > (size_ - offset_) / sizeof(T)) {
+      ok_ = false;
+      return false;
+    }
+    values.resize(count);
+    // An empty vector's data() may be null
+    if (count > 0) {
+      std::memcpy(values.data(), data_ + offset_, count * sizeof(T));
+    }
+    offset_ += count * sizeof(T);
+    return true;
+  }
+
+  bool string(std::string& value) {
+    uint64_t count{0};
+    if (!pod(count) || count > size_ - offset_) {
+      ok_ = false;
+      return false;
+    }
+    value.assign(data_ + offset_, count);
+    offset_ += count;
+    return true;
+  }
+
+  // Everything read and nothing left over
+  bool complete() const {
+    return ok_ && offset_ == size_;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_{0};
+  bool ok_{true};
+};
+
+template <typename Element>
+void writeIds(FrameWriter& frame,
+              const std::vector<std::shared_ptr<Element>>& elements) {
+  frame.pod(static_cast<uint64_t>(elements.size()));
+  for (const auto& element : elements) {
+    frame.pod(element->id);
+  }
+}
+
+void writeResult(FrameWriter& frame, const QueryResult& result) {
+  writeIds(frame, result.lanes);
+  writeIds(frame, result.trafficLights);
+  writeIds(frame, result.trafficSigns);
+}
+
+}  // namespace
+
+QueryRequest QueryRequest::regionQuery(const BoundingBox& region) {
+  QueryRequest request;
+  request.type = QueryType::REGION;
+  request.region = region;
+  return request;
+}
+
+QueryRequest QueryRequest::radiusQuery(const Point2D& center, double radius) {
+  QueryRequest request;
+  request.type = QueryType::RADIUS;
+  request.point = center;
+  request.radius = radius;
+  return request;
+}
+
+QueryRequest QueryRequest::closestLane(const Point2D& position) {
+  QueryRequest request;
+  request.type = QueryType::CLOSEST_LANE;
+  request.point = position;
+  return request;
+}
+
+QueryRequest QueryRequest::laneById(uint64_t laneId) {
+  QueryRequest request;
+  request.type = QueryType::LANE;
+  request.id = laneId;
+  return request;
+}
+
+QueryRequest QueryRequest::trafficLightById(uint64_t lightId) {
+  QueryRequest request;
+  request.type = QueryType::TRAFFIC_LIGHT;
+  request.id = lightId;
+  return request;
+}
+
+QueryRequest QueryRequest::trafficSignById(uint64_t signId) {
+  QueryRequest request;
+  request.type = QueryType::TRAFFIC_SIGN;
+  request.id = signId;
+  return request;
+}
+
+void encodeRequest(std::string& out, uint32_t requestId,
+                   const QueryRequest& request) {
+  FrameWriter frame{out};
+  frame.pod(requestId);
+  frame.pod(request.type);
+  switch (request.type) {
+    case QueryType::REGION:
+      frame.pod(request.region.min);
+      frame.pod(request.region.max);
+      break;
+    case QueryType::RADIUS:
+      frame.pod(request.point);
+      frame.pod(request.radius);
+      break;
+    case QueryType::CLOSEST_LANE:
+      frame.pod(request.point);
+      break;
+    case QueryType::LANE:
+    case QueryType::TRAFFIC_LIGHT:
+    case QueryType::TRAFFIC_SIGN:
+      frame.pod(request.id);
+      break;
+  }
+}
+
+bool decodeRequest(const char* payload, size_t size, uint32_t& requestId,
+                   QueryRequest& request) {
+  FrameReader reader{payload, size};
+  uint8_t type{0};
+  if (!reader.pod(requestId) || !reader.pod(type) ||
+      type >= kQueryTypeCount) {
+    return false;
+  }
+  request.type = static_cast<QueryType>(type);
+  switch (request.type) {
+    case QueryType::REGION:
+      reader.pod(request.region.min);
+      reader.pod(request.region.max);
+      break;
+    case QueryType::RADIUS:
+      reader.pod(request.point);
+      reader.pod(request.radius);
+      break;
+    case QueryType::CLOSEST_LANE:
+      reader.pod(request.point);
+      break;
+    case QueryType::LANE:
+    case QueryType::TRAFFIC_LIGHT:
+    case QueryType::TRAFFIC_SIGN:
+      reader.pod(request.id);
+      break;
+  }
+  return reader.complete();
+}
+
+void encodeStatus(std::string& out, uint32_t requestId,
+                  ResponseStatus status) {
+  FrameWriter frame{out};
+  frame.pod(requestId);
+  frame.pod(status);
+}
+
+void encodeResponse(std::string& out, uint32_t requestId,
+                    const MapServer& server, const QueryRequest& request) {
+  switch (request.type) {
+    case QueryType::REGION: {
+      const QueryResult result{server.queryRegion(request.region)};
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      writeResult(frame, result);
+      return;
+    }
+    case QueryType::RADIUS: {
+      const QueryResult result{
+          server.queryRadius(request.point, request.radius)};
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      writeResult(frame, result);
+      return;
+    }
+    case QueryType::CLOSEST_LANE: {
+      const auto lane{server.getClosestLane(request.point)};
+      if (!lane.has_value()) {
+        break;
+      }
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      frame.pod((*lane)->id);
+      return;
+    }
+    case QueryType::LANE: {
+      const auto found{server.getLaneById(request.id)};
+      if (!found.has_value()) {
+        break;
+      }
+      const Lane& lane{**found};
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      frame.pod(lane.id);
+      frame.pod(lane.type);
+      frame.pod(lane.speedLimit);
+      frame.vector(lane.centerlinePoints());
+      frame.vector(lane.leftBoundary);
+      frame.vector(lane.rightBoundary);
+      frame.vector(lane.predecessorIds);
+      frame.vector(lane.successorIds);
+      frame.vector(lane.adjacentLeftIds);
+      frame.vector(lane.adjacentRightIds);
+      return;
+    }
+    case QueryType::TRAFFIC_LIGHT: {
+      const auto found{server.getTrafficLightById(request.id)};
+      if (!found.has_value()) {
+        break;
+      }
+      const TrafficLight& light{**found};
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      frame.pod(light.id);
+      frame.pod(light.position);
+      frame.pod(light.state);
+      frame.pod(light.height);
+      frame.vector(light.controlledLaneIds);
+      return;
+    }
+    case QueryType::TRAFFIC_SIGN: {
+      const auto found{server.getTrafficSignById(request.id)};
+      if (!found.has_value()) {
+        break;
+      }
+      const TrafficSign& sign{**found};
+      FrameWriter frame{out};
+      frame.pod(requestId);
+      frame.pod(ResponseStatus::OK);
+      frame.pod(sign.id);
+      frame.pod(sign.position);
+      frame.pod(sign.type);
+      frame.string(sign.value);
+      frame.vector(sign.affectedLaneIds);
+      frame.pod(sign.height);
+      return;
+    }
+  }
+  encodeStatus(out, requestId, ResponseStatus::NOT_FOUND);
+}
+
+bool decodeResponse(const char* payload, size_t size, QueryType type,
+                    uint32_t& requestId, QueryReply& reply) {
+  FrameReader reader{payload, size};
+  uint8_t status{0};
+  if (!reader.pod(requestId) || !reader.pod(status) ||
+      status > static_cast<uint8_t>(ResponseStatus::BAD_REQUEST)) {
+    return false;
+  }
+  reply.type = type;
+  reply.status = static_cast<ResponseStatus>(status);
+  if (reply.status != ResponseStatus::OK) {
+    return reader.complete();
+  }
+
+  switch (type) {
+    case QueryType::REGION:
+    case QueryType::RADIUS:
+      reader.vector(reply.ids.laneIds);
+      reader.vector(reply.ids.trafficLightIds);
+      reader.vector(reply.ids.trafficSignIds);
+      break;
+    case QueryType::CLOSEST_LANE:
+      reader.pod(reply.laneId);
+      break;
+    case QueryType::LANE: {
+      auto lane{std::make_shared<Lane>()};
+      reader.pod(lane->id);
+      reader.pod(lane->type);
+      reader.pod(lane->speedLimit);
+      reader.vector(lane->centerline);
+      reader.vector(lane->leftBoundary);
+      reader.vector(lane->rightBoundary);
+      reader.vector(lane->predecessorIds);
+      reader.vector(lane->successorIds);
+      reader.vector(lane->adjacentLeftIds);
+      reader.vector(lane->adjacentRightIds);
+      lane->computeBoundingBox();
+      reply.lane = std::move(lane);
+      break;
+    }
+    case QueryType::TRAFFIC_LIGHT: {
+      auto light{std::make_shared<TrafficLight>()};
+      reader.pod(light->id);
+      reader.pod(light->position);
+      reader.pod(light->state);
+      reader.pod(light->height);
+      reader.vector(light->controlledLaneIds);
+      reply.trafficLight = std::move(light);
+      break;
+    }
+    case QueryType::TRAFFIC_SIGN: {
+      auto sign{std::make_shared<TrafficSign>()};
+      reader.pod(sign->id);
+      reader.pod(sign->position);
+      reader.pod(sign->type);
+      reader.string(sign->value);
+      reader.vector(sign->affectedLaneIds);
+      reader.pod(sign->height);
+      reply.trafficSign = std::move(sign);
+      break;
+    }
+  }
+  return reader.complete();
+}
+
+}  // namespace hdmap
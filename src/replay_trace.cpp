@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <spdlog/spdlog.h>
+#include <string>
+
+#include "include/drive_trace.hpp"
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+
+// Replays a drive trace against a map and reports latency percentiles per
+// query type
+
+namespace {
+
+constexpr double kNanosecondsPerMicrosecond = 1e3;
+
+void printUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [map.osm] [options]\n"
+      << "  --lanes N          lanes of the generated city when no map is "
+         "given (default 10000)\n"
+      << "  --trace FILE       trace to replay (default: synthesized drive)\n"
+      << "  --duration S       synthesized drive length (default 60)\n"
+      << "  --speed M/S        synthesized vehicle speed (default 13.89)\n"
+      << "  --rate HZ          synthesized query rounds per second "
+         "(default 10)\n"
+      << "  --seed N           synthesized start lane and turns\n"
+      << "  --save-trace FILE  write the replayed trace as CSV\n"
+      << "  --real-time        keep the trace's timing instead of max speed\n"
+      << "  --speedup X        time scale for --real-time (default 1)\n"
+      << "  --metrics FILE     write MapServer query metrics as JSON (needs "
+         "HDMAP_ENABLE_METRICS)\n";
+}
+
+void printRow(const std::string& name, const hdmap::LatencySummary& latency) {
+  const auto micros = [](uint64_t nanoseconds) {
+    return nanoseconds / kNanosecondsPerMicrosecond;
+  };
+  std::cout << std::left << std::setw(10) << name << std::right
+            << std::setw(10) << latency.count << std::setw(12)
+            << micros(latency.p50) << std::setw(12) << micros(latency.p99)
+            << std::setw(12) << micros(latency.p999) << std::setw(12)
+            << micros(latency.max) << std::setw(12)
+            << latency.mean / kNanosecondsPerMicrosecond << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string mapFile;
+  std::string traceFile;
+  std::string saveTrace;
+  std::string metricsFile;
+  size_t laneCount{10000};
+  hdmap::DriveConfig drive;
+  bool realTime{false};
+  double speedup{1.0};
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg == "--help" || arg == "-h") {
+      printUsage(argv[0]);
+      return 0;
+    }
+    if (arg == "--real-time") {
+      realTime = true;
+      continue;
+    }
+    if (arg.rfind("--", 0) != 0) {
+      mapFile = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    const std::string value{argv[++i]};
+    if (arg == "--lanes") {
+      laneCount = std::stoull(value);
+    } else if (arg == "--trace") {
+      traceFile = value;
+    } else if (arg == "--duration") {
+      drive.duration = std::stod(value);
+    } else if (arg == "--speed") {
+      drive.speed = std::stod(value);
+    } else if (arg == "--rate") {
+      drive.queryRate = std::stod(value);
+    } else if (arg == "--seed") {
+      drive.seed = std::stoull(value);
+    } else if (arg == "--save-trace") {
+      saveTrace = value;
+    } else if (arg == "--speedup") {
+      speedup = std::stod(value);
+    } else if (arg == "--metrics") {
+      metricsFile = value;
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  bool generated{false};
+  if (mapFile.empty()) {
+    hdmap::CityConfig city;
+    city.laneCount = laneCount;
+    mapFile = (std::filesystem::temp_directory_path() /
+               ("hdmap_replay_" + std::to_string(laneCount) + ".osm"))
+                  .string();
+    hdmap::CityGenerator generator{city};
+    if (!generator.writeOsm(mapFile)) {
+      spdlog::error(generator.getLastError());
+      return 1;
+    }
+    generated = true;
+  }
+
+  // Lift the limits: replay measures queries, not admission
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = SIZE_MAX;
+  constraints.maxLanes = SIZE_MAX;
+  constraints.maxTrafficLights = SIZE_MAX;
+  constraints.maxTrafficSigns = SIZE_MAX;
+  hdmap::MapServer server{constraints};
+  const bool loaded{server.loadFromFile(mapFile)};
+  if (generated) {
+    std::filesystem::remove(mapFile);
+  }
+  if (!loaded) {
+    return 1;
+  }
+
+  hdmap::DriveTrace trace;
+  if (!traceFile.empty()) {
+    if (!trace.load(traceFile)) {
+      spdlog::error(trace.getLastError());
+      return 1;
+    }
+  } else {
+    trace = hdmap::DriveTrace::synthesize(server, drive);
+  }
+  if (!saveTrace.empty() && !trace.save(saveTrace)) {
+    spdlog::error("Cannot write trace: {}", saveTrace);
+    return 1;
+  }
+
+  // Only the replay itself is reported, not the trace synthesis
+  server.resetQueryMetrics();
+  const auto report{
+      hdmap::TraceReplayer::replay(server, trace, realTime, speedup)};
+  std::cout << "Replayed " << trace.queries().size() << " queries in "
+            << report.wallSeconds << " s (" << report.results
+            << " results)\n\n";
+  std::cout << std::left << std::setw(10) << "query" << std::right
+            << std::setw(10) << "count" << std::setw(12) << "p50 us"
+            << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us"
+            << std::setw(12) << "max us" << std::setw(12) << "mean us"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(2);
+  for (size_t i = 0; i < hdmap::kTraceQueryTypeCount; ++i) {
+    const auto type{static_cast<hdmap::TraceQueryType>(i)};
+    if (report[type].count > 0) {
+      printRow(hdmap::traceQueryName(type), report[type]);
+    }
+  }
+  printRow("all", report.all);
+  if (report.queueing.count > 0) {
+    // Lateness behind the trace's schedule, kept out of the rows above
+    printRow("queueing", report.queueing);
+    printRow("response", report.response);
+  }
+
+  if (!metricsFile.empty()) {
+    if (!hdmap::kQueryMetricsEnabled) {
+      spdlog::warn("Built without HDMAP_ENABLE_METRICS, metrics are empty");
+    }
+    std::ofstream file{metricsFile};
+    file << server.getQueryMetrics().toJson();
+    if (!file) {
+      spdlog::error("Cannot write metrics: {}", metricsFile);
+      return 1;
+    }
+  }
+  return 0;
+}
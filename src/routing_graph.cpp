@@ -0,0 +1,186 @@
+#include "include/routing_graph.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+constexpr uint32_t kNoParent = std::numeric_limits<uint32_t>::max();
+
+double polylineLength(const std::vector<Point2D>& points) {
+  double length = 0.0;
+  for (size_t i = 1; i < points.size(); ++i) {
+    length += points[i - 1].distanceTo(points[i]);
+  }
+  return length;
+}
+
+}  // namespace
+
+void RoutingGraph::build(const LaneMap& lanes) {
+  clear();
+
+  // Dense renumbering in ascending id order keeps builds deterministic
+  laneIds_.reserve(lanes.size());
+  for (const auto& [id, lane] : lanes) {
+    laneIds_.push_back(id);
+  }
+  std::sort(laneIds_.begin(), laneIds_.end());
+  indices_.reserve(laneIds_.size());
+  for (uint32_t i = 0; i < laneIds_.size(); ++i) {
+    indices_[laneIds_[i]] = i;
+  }
+
+  // Per-lane travel time and end point
+  laneCosts_.resize(laneIds_.size());
+  laneEnds_.resize(laneIds_.size());
+  maxSpeed_ = kDefaultSpeed;
+  for (uint32_t i = 0; i < laneIds_.size(); ++i) {
+    const auto& lane{lanes.at(laneIds_[i])};
+    const auto points{lane->centerlinePoints()};
+    const double speed{lane->speedLimit > 0.0 ? lane->speedLimit
+                                              : kDefaultSpeed};
+    maxSpeed_ = std::max(maxSpeed_, speed);
+    laneCosts_[i] = polylineLength(points) / speed;
+    laneEnds_[i] = points.empty() ? Point2D{} : points.back();
+  }
+
+  // Edges; cost is raised to the straight-line bound where needed so the
+  // A* heuristic stays consistent even for loosely connected geometry
+  offsets_.reserve(laneIds_.size() + 1);
+  offsets_.push_back(0);
+  const auto addEdge = [this](uint32_t from, uint64_t toId, double cost) {
+    auto it = indices_.find(toId);
+    if (it == indices_.end() || it->second == from) {
+      return;
+    }
+    const double bound{laneEnds_[from].distanceTo(laneEnds_[it->second]) /
+                       maxSpeed_};
+    targets_.push_back(it->second);
+    costs_.push_back(std::max(cost, bound));
+  };
+
+  for (uint32_t i = 0; i < laneIds_.size(); ++i) {
+    const auto& lane{lanes.at(laneIds_[i])};
+    for (const auto successorId : lane->successorIds) {
+      auto it = indices_.find(successorId);
+      if (it != indices_.end()) {
+        addEdge(i, successorId, laneCosts_[it->second]);
+      }
+    }
+    for (const auto adjacentId : lane->adjacentLeftIds) {
+      addEdge(i, adjacentId, kLaneChangePenalty);
+    }
+    for (const auto adjacentId : lane->adjacentRightIds) {
+      addEdge(i, adjacentId, kLaneChangePenalty);
+    }
+    offsets_.push_back(static_cast<uint32_t>(targets_.size()));
+  }
+
+  targets_.shrink_to_fit();
+  costs_.shrink_to_fit();
+}
+
+void RoutingGraph::clear() {
+  laneIds_.clear();
+  indices_.clear();
+  offsets_.clear();
+  targets_.clear();
+  costs_.clear();
+  laneCosts_.clear();
+  laneEnds_.clear();
+  maxSpeed_ = kDefaultSpeed;
+}
+
+std::optional<uint32_t> RoutingGraph::indexOf(uint64_t laneId) const {
+  auto it = indices_.find(laneId);
+  if (it != indices_.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+std::optional<Route> RoutingGraph::aStar(uint64_t fromLaneId,
+                                         uint64_t toLaneId) const {
+  return search(fromLaneId, toLaneId, true);
+}
+
+std::optional<Route> RoutingGraph::dijkstra(uint64_t fromLaneId,
+                                            uint64_t toLaneId) const {
+  return search(fromLaneId, toLaneId, false);
+}
+
+std::optional<Route> RoutingGraph::search(uint64_t fromLaneId,
+                                          uint64_t toLaneId,
+                                          bool useHeuristic) const {
+  const auto from{indexOf(fromLaneId)};
+  const auto to{indexOf(toLaneId)};
+  if (!from.has_value() || !to.has_value()) {
+    return std::nullopt;
+  }
+
+  const Point2D goal{laneEnds_[*to]};
+  const auto heuristic = [&](uint32_t node) {
+    return useHeuristic ? laneEnds_[node].distanceTo(goal) / maxSpeed_ : 0.0;
+  };
+
+  std::vector<double> dist(nodeCount(), std::numeric_limits<double>::max());
+  std::vector<uint32_t> parent(nodeCount(), kNoParent);
+  std::vector<bool> settled(nodeCount(), false);
+
+  // (f = g + h, node), smallest f first
+  using QueueEntry = std::pair<double, uint32_t>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      open;
+
+  dist[*from] = 0.0;
+  open.emplace(heuristic(*from), *from);
+  size_t explored = 0;
+
+  while (!open.empty()) {
+    const auto [f, node] = open.top();
+    open.pop();
+    if (settled[node]) {
+      continue;
+    }
+    settled[node] = true;
+    explored++;
+
+    if (node == *to) {
+      break;
+    }
+
+    for (uint32_t e = offsets_[node]; e < offsets_[node + 1]; ++e) {
+      const uint32_t next{targets_[e]};
+      const double candidate{dist[node] + costs_[e]};
+      if (candidate < dist[next]) {
+        dist[next] = candidate;
+        parent[next] = node;
+        open.emplace(candidate + heuristic(next), next);
+      }
+    }
+  }
+
+  if (!settled[*to]) {
+    return std::nullopt;
+  }
+
+  Route route;
+  route.cost = laneCosts_[*from] + dist[*to];
+  route.nodesExplored = explored;
+  for (uint32_t node = *to; node != kNoParent; node = parent[node]) {
+    route.laneIds.push_back(laneIds_[node]);
+  }
+  std::reverse(route.laneIds.begin(), route.laneIds.end());
+  return route;
+}
+
+}  // namespace hdmap
@@ -26,7 +26,7 @@ BoundingBox RTreeNode::getBoundingBox() const {
 }
 
 // use {} to differentiate between initialization and function call!
-RTree::RTree() : root_{new RTreeNode{NodeType::LEAF}}, elementCount_{0} {
+RTree::RTree() : root_{nullptr}, elementCount_{0} {
 }
 
 RTree::~RTree() {
@@ -36,13 +36,16 @@ RTree::~RTree() {
 void RTree::insert(const BoundingBox& bbox, Data data) {
   RTreeEntry entry(bbox, data);
 
+  if (!root_) {
+    root_ = makeTracked<RTreeNode, MemoryCategory::INDICES>(NodeType::LEAF);
+  }
   if (root_->entries.empty()) {
     root_->entries.push_back(entry);
     elementCount_++;
     return;
   }
 
-  auto leaf{chooseLeaf(bbox)};
+  RTreeNode* leaf{chooseLeaf(bbox)};
 
   if (!leaf->isFull()) {
     leaf->entries.push_back(entry);
@@ -54,8 +57,8 @@ void RTree::insert(const BoundingBox& bbox, Data data) {
   elementCount_++;
 }
 
-std::shared_ptr<RTreeNode> RTree::chooseLeaf(const BoundingBox& bbox) {
-  auto current{root_};
+RTreeNode* RTree::chooseLeaf(const BoundingBox& bbox) {
+  RTreeNode* current{root_.get()};
 
   while (!current->isLeaf()) {
     // Find entry with minimum enlargement
@@ -71,8 +74,9 @@ std::shared_ptr<RTreeNode> RTree::chooseLeaf(const BoundingBox& bbox) {
       }
     }
 
-    current =
-        std::get<std::shared_ptr<RTreeNode>>(current->entries[bestIdx].data);
+    current = std::get<std::shared_ptr<RTreeNode>>(
+                  current->entries[bestIdx].data)
+                  .get();
   }
 
   return current;
@@ -89,9 +93,10 @@ double RTree::computeEnlargement(const BoundingBox& existing,
   return combined.area() - existing.area();
 }
 
-void RTree::splitNode(std::shared_ptr<RTreeNode>& node, RTreeEntry& newEntry) {
+void RTree::splitNode(RTreeNode* node, const RTreeEntry& newEntry) {
   // Simple linear split algorithm
-  std::vector<RTreeEntry> allEntries = node->entries;
+  std::vector<RTreeEntry> allEntries(node->entries.begin(),
+                                    node->entries.end());
   allEntries.push_back(newEntry);
 
   // Find seeds (entries that are farthest apart)
@@ -112,7 +117,7 @@ void RTree::splitNode(std::shared_ptr<RTreeNode>& node, RTreeEntry& newEntry) {
   }
 
   // Create new node
-  auto newNode{std::make_shared<RTreeNode>(node->type)};
+  auto newNode{makeTracked<RTreeNode, MemoryCategory::INDICES>(node->type)};
   newNode->parent = node->parent;
 
   // Distribute entries
@@ -136,16 +141,26 @@ void RTree::splitNode(std::shared_ptr<RTreeNode>& node, RTreeEntry& newEntry) {
     }
   }
 
+  // Children may have changed node, including the one in newEntry
+  if (!node->isLeaf()) {
+    for (RTreeNode* owner : {node, newNode.get()}) {
+      for (const auto& entry : owner->entries) {
+        std::get<std::shared_ptr<RTreeNode>>(entry.data)->parent = owner;
+      }
+    }
+  }
+
   // Handle root split
-  if (node == root_) {
-    auto newRoot{std::make_shared<RTreeNode>(NodeType::INTERNAL)};
-    newRoot->entries.emplace_back(node->getBoundingBox(), node);
+  if (node == root_.get()) {
+    auto newRoot{
+        makeTracked<RTreeNode, MemoryCategory::INDICES>(NodeType::INTERNAL)};
+    newRoot->entries.emplace_back(node->getBoundingBox(), root_);
     newRoot->entries.emplace_back(newNode->getBoundingBox(), newNode);
-    node->parent = newRoot;
-    newNode->parent = newRoot;
+    node->parent = newRoot.get();
+    newNode->parent = newRoot.get();
     root_ = newRoot;
   } else {
-    // Insert new node into parent
+    // Insert new node into parent; a split of the parent reparents it
     RTreeEntry parentEntry(newNode->getBoundingBox(), newNode);
     if (!node->parent->isFull()) {
       node->parent->entries.push_back(parentEntry);
@@ -157,15 +172,15 @@ void RTree::splitNode(std::shared_ptr<RTreeNode>& node, RTreeEntry& newEntry) {
   adjustTree(node);
 }
 
-void RTree::adjustTree(std::shared_ptr<RTreeNode>& leaf) {
-  auto current = leaf;
+void RTree::adjustTree(RTreeNode* leaf) {
+  RTreeNode* current{leaf};
 
-  while (current != root_) {
-    auto parent{current->parent};
+  while (current != root_.get()) {
+    RTreeNode* parent{current->parent};
 
     // Update parent's bounding box for this child
     for (auto& entry : parent->entries) {
-      if (std::get<std::shared_ptr<RTreeNode>>(entry.data) == current) {
+      if (std::get<std::shared_ptr<RTreeNode>>(entry.data).get() == current) {
         entry.bbox = current->getBoundingBox();
         break;
       }
@@ -184,6 +199,7 @@ void RTree::query(const BoundingBox& bbox, std::vector<Data>& results) const {
 void RTree::queryNode(const std::shared_ptr<const RTreeNode>& node,
                       const BoundingBox& bbox,
                       std::vector<Data>& results) const {
+  noteRTreeNodeVisit();
   for (const auto& entry : node->entries) {
     if (!entry.bbox.intersects(bbox)) {
       continue;
@@ -206,9 +222,7 @@ void RTree::queryRadius(const Point2D& center, double radius,
 }
 
 void RTree::clear() {
-  if (root_) {
-    root_->entries.clear();
-  }
+  root_.reset();
   elementCount_ = 0;
 }
 
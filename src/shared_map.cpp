@@ -0,0 +1,759 @@
+#include "include/shared_map.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+#include <utility>
+
+namespace hdmap {
+
+namespace {
+
+constexpr uint32_t kControlMagic = 0x43534448;  // "HDSC"
+constexpr size_t kSectionAlignment = 64;
+constexpr size_t kTreeFanout = MAX_RTREE_ENTRIES;
+// Deep enough for 2^32 entries at the fanout above
+constexpr size_t kTreeStackDepth = 128;
+// Tries to map the current generation while the publisher keeps swapping
+constexpr int kOpenAttempts = 8;
+
+// The generation is read and written by different processes through their
+// own mappings, which needs a lock-free (address-free) atomic
+struct SharedMapControl {
+  uint32_t magic{kControlMagic};
+  uint32_t version{kSharedMapVersion};
+  std::atomic<uint64_t> generation{0};
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared generation counter must be lock-free");
+static_assert(std::is_trivially_copyable_v<SharedLane> &&
+                  std::is_trivially_copyable_v<SharedTrafficLight> &&
+                  std::is_trivially_copyable_v<SharedTrafficSign> &&
+                  std::is_trivially_copyable_v<SharedTreeNode> &&
+                  std::is_trivially_copyable_v<SharedTreeEntry> &&
+                  std::is_trivially_copyable_v<SharedMapHeader>,
+              "segment records are copied byte-wise");
+
+// POSIX shared memory names are "/name" without further slashes
+bool isValidName(const std::string& name) {
+  return name.size() > 1 && name.size() < NAME_MAX && name.front() == '/' &&
+         name.find('/', 1) == std::string::npos;
+}
+
+std::string dataSegmentName(const std::string& name, uint64_t generation) {
+  return name + "." + std::to_string(generation);
+}
+
+size_t alignUp(size_t offset) {
+  return (offset + kSectionAlignment - 1) / kSectionAlignment *
+         kSectionAlignment;
+}
+
+const SharedMapControl& controlOf(const void* mapping) {
+  return *static_cast<const SharedMapControl*>(mapping);
+}
+
+// Packed R-tree before it is copied into a segment
+struct PackedTree {
+  std::vector<SharedTreeEntry> entries;
+  std::vector<SharedTreeNode> nodes;
+  size_t leafCount{0};
+};
+
+// Segment arrays before layout
+struct SegmentContents {
+  std::vector<SharedLane> lanes;
+  std::vector<SharedTrafficLight> trafficLights;
+  std::vector<SharedTrafficSign> trafficSigns;
+  std::vector<Point2D> points;
+  std::vector<uint64_t> ids;
+  std::vector<char> text;
+  PackedTree laneTree;
+  PackedTree trafficLightTree;
+  PackedTree trafficSignTree;
+
+  // Ranges and tree links are 32-bit indices
+  bool fitsRanges() const {
+    constexpr size_t limit{std::numeric_limits<uint32_t>::max()};
+    return lanes.size() <= limit && trafficLights.size() <= limit &&
+           trafficSigns.size() <= limit && points.size() <= limit &&
+           ids.size() <= limit && text.size() <= limit &&
+           laneTree.nodes.size() <= limit &&
+           trafficLightTree.nodes.size() <= limit &&
+           trafficSignTree.nodes.size() <= limit;
+  }
+};
+
+template <typename T, typename Values>
+SharedRange append(std::vector<T>& array, const Values& values) {
+  const SharedRange range{static_cast<uint32_t>(array.size()),
+                          static_cast<uint32_t>(values.size())};
+  array.insert(array.end(), values.begin(), values.end());
+  return range;
+}
+
+template <typename Element, typename ElementMap>
+std::vector<const Element*> sortedById(const ElementMap& elements) {
+  std::vector<const Element*> sorted;
+  sorted.reserve(elements.size());
+  for (const auto& [id, element] : elements) {
+    sorted.push_back(element.get());
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Element* a, const Element* b) { return a->id < b->id; });
+  return sorted;
+}
+
+template <typename Item>
+BoundingBox boundsOf(const Item* items, size_t count) {
+  BoundingBox bounds{items[0].bbox};
+  for (size_t i = 1; i < count; ++i) {
+    const auto& box{items[i].bbox};
+    bounds.min = Point2D(std::min(bounds.min.x, box.min.x),
+                         std::min(bounds.min.y, box.min.y));
+    bounds.max = Point2D(std::max(bounds.max.x, box.max.x),
+                         std::max(bounds.max.y, box.max.y));
+  }
+  return bounds;
+}
+
+// Sort-Tile-Recursive order: vertical slices by x, each slice by y, so
+// that consecutive runs of kTreeFanout items make compact nodes
+template <typename Item>
+void sortTileRecursive(std::vector<Item>& items) {
+  const size_t groups{(items.size() + kTreeFanout - 1) / kTreeFanout};
+  const auto slices{static_cast<size_t>(
+      std::ceil(std::sqrt(static_cast<double>(groups))))};
+  const size_t sliceSize{std::max<size_t>(1, slices) * kTreeFanout};
+  const auto byX = [](const Item& a, const Item& b) {
+    return a.bbox.min.x + a.bbox.max.x < b.bbox.min.x + b.bbox.max.x;
+  };
+  const auto byY = [](const Item& a, const Item& b) {
+    return a.bbox.min.y + a.bbox.max.y < b.bbox.min.y + b.bbox.max.y;
+  };
+  std::sort(items.begin(), items.end(), byX);
+  for (size_t start = 0; start < items.size(); start += sliceSize) {
+    const size_t end{std::min(items.size(), start + sliceSize)};
+    std::sort(items.begin() + start, items.begin() + end, byY);
+  }
+}
+
+// Nodes over consecutive runs of items; first counts from base
+template <typename Item>
+std::vector<SharedTreeNode> groupNodes(const std::vector<Item>& items,
+                                       size_t base) {
+  std::vector<SharedTreeNode> nodes;
+  for (size_t first = 0; first < items.size(); first += kTreeFanout) {
+    const size_t count{std::min(kTreeFanout, items.size() - first)};
+    nodes.push_back(SharedTreeNode{boundsOf(items.data() + first, count),
+                                   static_cast<uint32_t>(base + first),
+                                   static_cast<uint32_t>(count)});
+  }
+  return nodes;
+}
+
+void packTree(PackedTree& tree) {
+  if (tree.entries.empty()) {
+    return;
+  }
+  sortTileRecursive(tree.entries);
+  std::vector<SharedTreeNode> level{groupNodes(tree.entries, 0)};
+  tree.leafCount = level.size();
+  while (true) {
+    // Reordering a level keeps each node's own children contiguous
+    sortTileRecursive(level);
+    const size_t base{tree.nodes.size()};
+    tree.nodes.insert(tree.nodes.end(), level.begin(), level.end());
+    if (level.size() == 1) {
+      break;
+    }
+    level = groupNodes(level, base);
+  }
+}
+
+SegmentContents collect(const MapServer& server) {
+  SegmentContents contents;
+  for (const Lane* lane : sortedById<Lane>(server.getLanes())) {
+    SharedLane record{};
+    record.id = lane->id;
+    record.bbox = lane->bbox;
+    record.speedLimit = lane->speedLimit;
+    record.type = lane->type;
+    record.centerline = append(contents.points, lane->centerlinePoints());
+    record.leftBoundary = append(contents.points, lane->leftBoundary);
+    record.rightBoundary = append(contents.points, lane->rightBoundary);
+    record.predecessorIds = append(contents.ids, lane->predecessorIds);
+    record.successorIds = append(contents.ids, lane->successorIds);
+    record.adjacentLeftIds = append(contents.ids, lane->adjacentLeftIds);
+    record.adjacentRightIds = append(contents.ids, lane->adjacentRightIds);
+    contents.laneTree.entries.push_back(SharedTreeEntry{
+        lane->bbox, static_cast<uint32_t>(contents.lanes.size())});
+    contents.lanes.push_back(record);
+  }
+
+  for (const TrafficLight* light :
+       sortedById<TrafficLight>(server.getTrafficLights())) {
+    SharedTrafficLight record{};
+    record.id = light->id;
+    record.position = light->position;
+    record.height = light->height;
+    record.state = light->state;
+    record.controlledLaneIds = append(contents.ids, light->controlledLaneIds);
+    contents.trafficLightTree.entries.push_back(SharedTreeEntry{
+        BoundingBox{light->position, light->position},
+        static_cast<uint32_t>(contents.trafficLights.size())});
+    contents.trafficLights.push_back(record);
+  }
+
+  for (const TrafficSign* sign :
+       sortedById<TrafficSign>(server.getTrafficSigns())) {
+    SharedTrafficSign record{};
+    record.id = sign->id;
+    record.position = sign->position;
+    record.height = sign->height;
+    record.type = sign->type;
+    record.value = append(contents.text, sign->value);
+    record.affectedLaneIds = append(contents.ids, sign->affectedLaneIds);
+    contents.trafficSignTree.entries.push_back(SharedTreeEntry{
+        BoundingBox{sign->position, sign->position},
+        static_cast<uint32_t>(contents.trafficSigns.size())});
+    contents.trafficSigns.push_back(record);
+  }
+
+  packTree(contents.laneTree);
+  packTree(contents.trafficLightTree);
+  packTree(contents.trafficSignTree);
+  return contents;
+}
+
+// Assigns each array its place in the segment
+class SegmentLayout {
+ public:
+  template <typename T>
+  SharedSection place(const std::vector<T>& values) {
+    const SharedSection section{size_, values.size()};
+    size_ = alignUp(size_ + values.size() * sizeof(T));
+    return section;
+  }
+  SharedTree place(const PackedTree& tree) {
+    SharedTree placed{};
+    placed.entries = place(tree.entries);
+    placed.nodes = place(tree.nodes);
+    placed.leafCount = tree.leafCount;
+    return placed;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  size_t size_{alignUp(sizeof(SharedMapHeader))};
+};
+
+template <typename T>
+void copySection(char* base, const SharedSection& section,
+                 const std::vector<T>& values) {
+  if (!values.empty()) {
+    std::memcpy(base + section.offset, values.data(),
+                values.size() * sizeof(T));
+  }
+}
+
+void copyTree(char* base, const SharedTree& placed, const PackedTree& tree) {
+  copySection(base, placed.entries, tree.entries);
+  copySection(base, placed.nodes, tree.nodes);
+}
+
+template <typename T>
+bool sectionFits(const SharedSection& section, size_t size) {
+  return section.offset % alignof(T) == 0 && section.offset <= size &&
+         section.count <= (size - section.offset) / sizeof(T);
+}
+
+bool treeFits(const SharedTree& tree, size_t size) {
+  return sectionFits<SharedTreeEntry>(tree.entries, size) &&
+         sectionFits<SharedTreeNode>(tree.nodes, size) &&
+         tree.leafCount <= tree.nodes.count;
+}
+
+template <typename Record>
+const Record* findById(SharedArray<Record> records, uint64_t id) {
+  const auto it{std::lower_bound(
+      records.begin(), records.end(), id,
+      [](const Record& record, uint64_t key) { return record.id < key; })};
+  return it != records.end() && it->id == id ? it : nullptr;
+}
+
+}  // namespace
+
+SharedMapPublisher::SharedMapPublisher(std::string name)
+    : name_{std::move(name)} {
+}
+
+SharedMapPublisher::~SharedMapPublisher() {
+  unpublish();
+}
+
+bool SharedMapPublisher::openControl() {
+  if (control_ != nullptr) {
+    return true;
+  }
+  if (!isValidName(name_)) {
+    lastError_ = "Invalid shared memory name: " + name_;
+    return false;
+  }
+  const int fd{shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644)};
+  if (fd < 0) {
+    lastError_ = "Cannot open " + name_ + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat status {};
+  bool ok{fstat(fd, &status) == 0};
+  const bool fresh{ok && static_cast<size_t>(status.st_size) <
+                             sizeof(SharedMapControl)};
+  if (fresh) {
+    ok = ftruncate(fd, sizeof(SharedMapControl)) == 0;
+  }
+  void* mapping{ok ? mmap(nullptr, sizeof(SharedMapControl),
+                          PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                   : MAP_FAILED};
+  if (mapping == MAP_FAILED) {
+    lastError_ = "Cannot map " + name_ + ": " + std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  ::close(fd);
+  control_ = mapping;
+
+  auto* control{static_cast<SharedMapControl*>(control_)};
+  if (fresh || control->magic != kControlMagic ||
+      control->version != kSharedMapVersion) {
+    new (control) SharedMapControl{};
+  }
+  // A restarted publisher continues the numbering so that readers of the
+  // previous run see the change
+  generation_ = control->generation.load(std::memory_order_acquire);
+  return true;
+}
+
+bool SharedMapPublisher::publish(const MapServer& server) {
+  if (!openControl()) {
+    return false;
+  }
+  const SegmentContents contents{collect(server)};
+  if (!contents.fitsRanges()) {
+    lastError_ = "Map too large for a shared segment";
+    return false;
+  }
+
+  SegmentLayout layout;
+  SharedMapHeader header{};
+  header.magic = kSharedMapMagic;
+  header.version = kSharedMapVersion;
+  header.generation = generation_ + 1;
+  header.lanes = layout.place(contents.lanes);
+  header.trafficLights = layout.place(contents.trafficLights);
+  header.trafficSigns = layout.place(contents.trafficSigns);
+  header.points = layout.place(contents.points);
+  header.ids = layout.place(contents.ids);
+  header.text = layout.place(contents.text);
+  header.laneTree = layout.place(contents.laneTree);
+  header.trafficLightTree = layout.place(contents.trafficLightTree);
+  header.trafficSignTree = layout.place(contents.trafficSignTree);
+  header.totalBytes = layout.size();
+
+  // Left behind if a previous run died between creating and announcing it
+  const std::string segment{dataSegmentName(name_, header.generation)};
+  shm_unlink(segment.c_str());
+  const int fd{shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644)};
+  if (fd < 0) {
+    lastError_ = "Cannot create " + segment + ": " + std::strerror(errno);
+    return false;
+  }
+  void* mapping{ftruncate(fd, static_cast<off_t>(header.totalBytes)) == 0
+                    ? mmap(nullptr, header.totalBytes, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0)
+                    : MAP_FAILED};
+  const int error{errno};
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    lastError_ = "Cannot map " + segment + ": " + std::strerror(error);
+    shm_unlink(segment.c_str());
+    return false;
+  }
+
+  auto* base{static_cast<char*>(mapping)};
+  std::memcpy(base, &header, sizeof(header));
+  copySection(base, header.lanes, contents.lanes);
+  copySection(base, header.trafficLights, contents.trafficLights);
+  copySection(base, header.trafficSigns, contents.trafficSigns);
+  copySection(base, header.points, contents.points);
+  copySection(base, header.ids, contents.ids);
+  copySection(base, header.text, contents.text);
+  copyTree(base, header.laneTree, contents.laneTree);
+  copyTree(base, header.trafficLightTree, contents.trafficLightTree);
+  copyTree(base, header.trafficSignTree, contents.trafficSignTree);
+  munmap(mapping, header.totalBytes);
+
+  // Announce the complete segment, then retire the previous one; readers
+  // mapping it keep their pages until they unmap
+  static_cast<SharedMapControl*>(control_)->generation.store(
+      header.generation, std::memory_order_release);
+  if (generation_ > 0) {
+    shm_unlink(dataSegmentName(name_, generation_).c_str());
+  }
+  generation_ = header.generation;
+  publishedBytes_ = header.totalBytes;
+  spdlog::info("Published map generation {} to {} ({} bytes)", generation_,
+               name_, publishedBytes_);
+  return true;
+}
+
+void SharedMapPublisher::unpublish() {
+  if (control_ == nullptr) {
+    return;
+  }
+  if (generation_ > 0) {
+    shm_unlink(dataSegmentName(name_, generation_).c_str());
+  }
+  munmap(control_, sizeof(SharedMapControl));
+  control_ = nullptr;
+  shm_unlink(name_.c_str());
+  generation_ = 0;
+  publishedBytes_ = 0;
+}
+
+SharedMapView::~SharedMapView() {
+  close();
+}
+
+bool SharedMapView::open(const std::string& name) {
+  close();
+  if (!isValidName(name)) {
+    lastError_ = "Invalid shared memory name: " + name;
+    return false;
+  }
+  const int fd{shm_open(name.c_str(), O_RDONLY, 0)};
+  if (fd < 0) {
+    lastError_ = "Cannot open " + name + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat status {};
+  const bool sized{fstat(fd, &status) == 0 &&
+                   static_cast<size_t>(status.st_size) >=
+                       sizeof(SharedMapControl)};
+  void* mapping{sized ? mmap(nullptr, sizeof(SharedMapControl), PROT_READ,
+                             MAP_SHARED, fd, 0)
+                      : MAP_FAILED};
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    lastError_ = "Not a published map: " + name;
+    return false;
+  }
+  control_ = mapping;
+  name_ = name;
+  if (controlOf(control_).magic != kControlMagic ||
+      controlOf(control_).version != kSharedMapVersion) {
+    lastError_ = "Not a published map: " + name;
+    close();
+    return false;
+  }
+  if (!refresh()) {
+    close();
+    return false;
+  }
+  lastError_.clear();
+  return true;
+}
+
+void SharedMapView::close() {
+  unmapData();
+  if (control_ != nullptr) {
+    munmap(const_cast<void*>(control_), sizeof(SharedMapControl));
+    control_ = nullptr;
+  }
+  name_.clear();
+}
+
+uint64_t SharedMapView::getGeneration() const {
+  return header_ != nullptr ? header_->generation : 0;
+}
+
+uint64_t SharedMapView::getPublishedGeneration() const {
+  return control_ != nullptr
+             ? controlOf(control_).generation.load(std::memory_order_acquire)
+             : 0;
+}
+
+bool SharedMapView::refresh() {
+  if (control_ == nullptr) {
+    lastError_ = "Not open";
+    return false;
+  }
+  // A generation whose segment is gone has been replaced in the meantime;
+  // failing twice on the same one is a real error
+  uint64_t failed{0};
+  for (int attempt = 0; attempt < kOpenAttempts; ++attempt) {
+    const uint64_t generation{getPublishedGeneration()};
+    if (generation == 0) {
+      lastError_ = "Nothing published as " + name_;
+      return false;
+    }
+    if (generation == getGeneration()) {
+      return true;
+    }
+    if (generation == failed) {
+      return false;
+    }
+    if (mapGeneration(generation)) {
+      return true;
+    }
+    failed = generation;
+  }
+  return false;
+}
+
+bool SharedMapView::mapGeneration(uint64_t generation) {
+  const std::string segment{dataSegmentName(name_, generation)};
+  const int fd{shm_open(segment.c_str(), O_RDONLY, 0)};
+  if (fd < 0) {
+    lastError_ = "Cannot open " + segment + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat status {};
+  const bool sized{fstat(fd, &status) == 0 &&
+                   static_cast<size_t>(status.st_size) >=
+                       sizeof(SharedMapHeader)};
+  const size_t size{sized ? static_cast<size_t>(status.st_size) : 0};
+  void* mapping{sized ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                      : MAP_FAILED};
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    lastError_ = "Cannot map " + segment;
+    return false;
+  }
+
+  // Records are trusted; the header is checked so that every array lies
+  // inside the mapping
+  const auto& header{*static_cast<const SharedMapHeader*>(mapping)};
+  const bool valid{
+      header.magic == kSharedMapMagic && header.version == kSharedMapVersion &&
+      header.generation == generation && header.totalBytes == size &&
+      sectionFits<SharedLane>(header.lanes, size) &&
+      sectionFits<SharedTrafficLight>(header.trafficLights, size) &&
+      sectionFits<SharedTrafficSign>(header.trafficSigns, size) &&
+      sectionFits<Point2D>(header.points, size) &&
+      sectionFits<uint64_t>(header.ids, size) &&
+      sectionFits<char>(header.text, size) && treeFits(header.laneTree, size) &&
+      treeFits(header.trafficLightTree, size) &&
+      treeFits(header.trafficSignTree, size)};
+  if (!valid) {
+    munmap(mapping, size);
+    lastError_ = "Corrupt shared map segment: " + segment;
+    return false;
+  }
+
+  unmapData();
+  header_ = &header;
+  dataSize_ = size;
+  return true;
+}
+
+void SharedMapView::unmapData() {
+  if (header_ != nullptr) {
+    munmap(const_cast<SharedMapHeader*>(header_), dataSize_);
+    header_ = nullptr;
+    dataSize_ = 0;
+  }
+}
+
+template <typename T>
+SharedArray<T> SharedMapView::section(const SharedSection& section) const {
+  const auto* base{reinterpret_cast<const char*>(header_)};
+  return SharedArray<T>{reinterpret_cast<const T*>(base + section.offset),
+                        static_cast<size_t>(section.count)};
+}
+
+size_t SharedMapView::getLaneCount() const {
+  return isOpen() ? header_->lanes.count : 0;
+}
+
+size_t SharedMapView::getTrafficLightCount() const {
+  return isOpen() ? header_->trafficLights.count : 0;
+}
+
+size_t SharedMapView::getTrafficSignCount() const {
+  return isOpen() ? header_->trafficSigns.count : 0;
+}
+
+SharedArray<Point2D> SharedMapView::points(SharedRange range) const {
+  return SharedArray<Point2D>{section<Point2D>(header_->points).begin() +
+                                  range.begin,
+                              range.count};
+}
+
+SharedArray<uint64_t> SharedMapView::ids(SharedRange range) const {
+  return SharedArray<uint64_t>{
+      section<uint64_t>(header_->ids).begin() + range.begin, range.count};
+}
+
+std::string_view SharedMapView::text(SharedRange range) const {
+  return std::string_view{section<char>(header_->text).begin() + range.begin,
+                          range.count};
+}
+
+double SharedMapView::distanceTo(const SharedLane& lane,
+                                 const Point2D& point) const {
+  double minDistance = std::numeric_limits<double>::max();
+  for (const auto& vertex : points(lane.centerline)) {
+    minDistance = std::min(minDistance, point.distanceTo(vertex));
+  }
+  return minDistance;
+}
+
+template <typename Visit>
+void SharedMapView::queryTree(const SharedTree& tree, const BoundingBox& box,
+                              const Visit& visit) const {
+  const auto nodes{section<SharedTreeNode>(tree.nodes)};
+  const auto entries{section<SharedTreeEntry>(tree.entries)};
+  if (nodes.empty()) {
+    return;
+  }
+  std::array<uint32_t, kTreeStackDepth> stack;
+  size_t depth{0};
+  stack[depth++] = static_cast<uint32_t>(nodes.size() - 1);
+  while (depth > 0) {
+    const uint32_t index{stack[--depth]};
+    const auto& node{nodes[index]};
+    if (!node.bbox.intersects(box)) {
+      continue;
+    }
+    if (index < tree.leafCount) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        if (entries[i].bbox.intersects(box)) {
+          visit(entries[i].element);
+        }
+      }
+      continue;
+    }
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      stack[depth++] = i;
+    }
+  }
+}
+
+SharedQueryResult SharedMapView::queryRegion(const BoundingBox& region) const {
+  SharedQueryResult result;
+  if (!isOpen()) {
+    return result;
+  }
+  const auto lanes{section<SharedLane>(header_->lanes)};
+  queryTree(header_->laneTree, region,
+            [&](uint32_t i) { result.lanes.push_back(&lanes[i]); });
+  const auto lights{section<SharedTrafficLight>(header_->trafficLights)};
+  queryTree(header_->trafficLightTree, region,
+            [&](uint32_t i) { result.trafficLights.push_back(&lights[i]); });
+  const auto signs{section<SharedTrafficSign>(header_->trafficSigns)};
+  queryTree(header_->trafficSignTree, region,
+            [&](uint32_t i) { result.trafficSigns.push_back(&signs[i]); });
+  return result;
+}
+
+SharedQueryResult SharedMapView::queryRadius(const Point2D& center,
+                                             double radius) const {
+  SharedQueryResult result;
+  if (!isOpen()) {
+    return result;
+  }
+  const BoundingBox box{Point2D(center.x - radius, center.y - radius),
+                        Point2D(center.x + radius, center.y + radius)};
+  const auto lanes{section<SharedLane>(header_->lanes)};
+  queryTree(header_->laneTree, box, [&](uint32_t i) {
+    if (distanceTo(lanes[i], center) <= radius) {
+      result.lanes.push_back(&lanes[i]);
+    }
+  });
+  const auto lights{section<SharedTrafficLight>(header_->trafficLights)};
+  queryTree(header_->trafficLightTree, box, [&](uint32_t i) {
+    if (center.distanceTo(lights[i].position) <= radius) {
+      result.trafficLights.push_back(&lights[i]);
+    }
+  });
+  const auto signs{section<SharedTrafficSign>(header_->trafficSigns)};
+  queryTree(header_->trafficSignTree, box, [&](uint32_t i) {
+    if (center.distanceTo(signs[i].position) <= radius) {
+      result.trafficSigns.push_back(&signs[i]);
+    }
+  });
+  return result;
+}
+
+std::vector<const SharedLane*> SharedMapView::getNearbyLanes(
+    const Point2D& position, double maxDistance) const {
+  std::vector<const SharedLane*> nearby;
+  if (!isOpen()) {
+    return nearby;
+  }
+  const BoundingBox box{
+      Point2D(position.x - maxDistance, position.y - maxDistance),
+      Point2D(position.x + maxDistance, position.y + maxDistance)};
+  const auto lanes{section<SharedLane>(header_->lanes)};
+  queryTree(header_->laneTree, box, [&](uint32_t i) {
+    if (distanceTo(lanes[i], position) <= maxDistance) {
+      nearby.push_back(&lanes[i]);
+    }
+  });
+  return nearby;
+}
+
+const SharedLane* SharedMapView::getClosestLane(
+    const Point2D& position) const {
+  for (const double radius : {kClosestLaneRadius, kClosestLaneMaxRadius}) {
+    const SharedLane* closest{nullptr};
+    double minDistance = std::numeric_limits<double>::max();
+    for (const SharedLane* lane : getNearbyLanes(position, radius)) {
+      const double distance{distanceTo(*lane, position)};
+      if (distance < minDistance) {
+        minDistance = distance;
+        closest = lane;
+      }
+    }
+    if (closest != nullptr) {
+      return closest;
+    }
+  }
+  return nullptr;
+}
+
+const SharedLane* SharedMapView::getLaneById(uint64_t laneId) const {
+  return isOpen() ? findById(section<SharedLane>(header_->lanes), laneId)
+                  : nullptr;
+}
+
+const SharedTrafficLight* SharedMapView::getTrafficLightById(
+    uint64_t id) const {
+  return isOpen() ? findById(
+                        section<SharedTrafficLight>(header_->trafficLights), id)
+                  : nullptr;
+}
+
+const SharedTrafficSign* SharedMapView::getTrafficSignById(uint64_t id) const {
+  return isOpen() ? findById(section<SharedTrafficSign>(header_->trafficSigns),
+                             id)
+                  : nullptr;
+}
+
+}  // namespace hdmap
@@ -0,0 +1,168 @@
+#include "include/tile_prefetcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include <utility>
+#include <vector>
+
+#include "include/geometry.hpp"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hdmap {
+
+namespace {
+
+// Move the calling thread into the idle I/O scheduling class, so its disk
+// reads only get bandwidth nobody else wants
+void lowerIoPriority() {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+  constexpr int kIoprioWhoProcess = 1;  // with id 0: the calling thread
+  constexpr int kIoprioClassIdle = 3;
+  constexpr int kIoprioClassShift = 13;
+  if (syscall(SYS_ioprio_set, kIoprioWhoProcess, 0,
+              kIoprioClassIdle << kIoprioClassShift) != 0) {
+    spdlog::warn("Could not lower prefetch I/O priority");
+  }
+#endif
+}
+
+}  // namespace
+
+TilePrefetcher::TilePrefetcher(const TileStore& store,
+                               const PrefetchConfig& config)
+    : store_(store), config_(config) {
+}
+
+TilePrefetcher::~TilePrefetcher() {
+  stop();
+}
+
+void TilePrefetcher::start() {
+  const std::scoped_lock lock{mutex_};
+  if (worker_.joinable()) {
+    return;
+  }
+  stopping_ = false;
+  worker_ = std::thread{&TilePrefetcher::run, this};
+}
+
+void TilePrefetcher::stop() {
+  {
+    const std::scoped_lock lock{mutex_};
+    if (!worker_.joinable()) {
+      return;
+    }
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  worker_.join();
+
+  const std::scoped_lock lock{mutex_};
+  worker_ = std::thread{};
+  hasPending_ = false;
+  idle_.notify_all();
+}
+
+bool TilePrefetcher::isRunning() const {
+  const std::scoped_lock lock{mutex_};
+  return worker_.joinable() && !stopping_;
+}
+
+void TilePrefetcher::update(const VehicleState& state) {
+  {
+    const std::scoped_lock lock{mutex_};
+    pending_ = state;
+    hasPending_ = true;
+  }
+  wake_.notify_one();
+}
+
+void TilePrefetcher::waitIdle() {
+  std::unique_lock lock{mutex_};
+  idle_.wait(lock, [this] {
+    return (!hasPending_ && !busy_) || !worker_.joinable() || stopping_;
+  });
+}
+
+uint64_t TilePrefetcher::getCycleCount() const {
+  const std::scoped_lock lock{mutex_};
+  return cycles_;
+}
+
+std::vector<Point2D> TilePrefetcher::predictPath(
+    const VehicleState& state, const PrefetchConfig& config) {
+  const double distance{std::max(config.minDistance,
+                                 std::max(state.speed, 0.0) *
+                                     config.horizonSeconds)};
+  std::vector<Point2D> path{state.position};
+
+  if (state.route.size() < 2) {
+    path.emplace_back(state.position.x + std::cos(state.heading) * distance,
+                      state.position.y + std::sin(state.heading) * distance);
+    return path;
+  }
+
+  // Continue from the route segment nearest to the vehicle
+  size_t nearest = 0;
+  double nearestDistance = std::numeric_limits<double>::max();
+  for (size_t i = 1; i < state.route.size(); ++i) {
+    const double d{pointSegmentDistance(state.position, state.route[i - 1],
+                                        state.route[i])};
+    if (d < nearestDistance) {
+      nearestDistance = d;
+      nearest = i;
+    }
+  }
+
+  double remaining = distance;
+  for (size_t i = nearest; i < state.route.size() && remaining > 0.0; ++i) {
+    const Point2D& from{path.back()};
+    const Point2D& to{state.route[i]};
+    const double length{from.distanceTo(to)};
+    if (length >= remaining) {
+      const double t{remaining / length};
+      path.emplace_back(from.x + (to.x - from.x) * t,
+                        from.y + (to.y - from.y) * t);
+      break;
+    }
+    path.push_back(to);
+    remaining -= length;
+  }
+  return path;
+}
+
+void TilePrefetcher::run() {
+  if (config_.idleIoPriority) {
+    lowerIoPriority();
+  }
+
+  std::unique_lock lock{mutex_};
+  while (true) {
+    wake_.wait(lock, [this] { return hasPending_ || stopping_; });
+    if (stopping_) {
+      break;
+    }
+
+    const VehicleState state{std::move(pending_)};
+    hasPending_ = false;
+    busy_ = true;
+    lock.unlock();
+
+    store_.prefetchPath(predictPath(state, config_));
+
+    lock.lock();
+    busy_ = false;
+    cycles_++;
+    if (!hasPending_) {
+      idle_.notify_all();
+    }
+  }
+}
+
+}  // namespace hdmap
@@ -0,0 +1,797 @@
+#include "include/tile_store.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+constexpr uint32_t kManifestMagic = 0x4d544448;  // "HDTM"
+constexpr uint32_t kTileMagic = 0x4c544448;      // "HDTL"
+// 2: the manifest locates every lane
+constexpr uint32_t kFileVersion = 2;
+
+template <typename T>
+void writePod(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T, typename Allocator>
+void writeVector(std::ofstream& file, const std::vector<T, Allocator>& values) {
+  const uint64_t count{values.size()};
+  writePod(file, count);
+  file.write(reinterpret_cast<const char*>(values.data()),
+             static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+void writeString(std::ofstream& file, const std::string& value) {
+  const std::vector<char> chars(value.begin(), value.end());
+  writeVector(file, chars);
+}
+
+// Whole file in memory; tiles and manifests are read in one go
+bool readFile(const std::string& path, std::string& bytes) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file.is_open()) {
+    return false;
+  }
+  std::error_code error;
+  const auto size{std::filesystem::file_size(path, error)};
+  if (!error) {
+    bytes.reserve(size);
+  }
+  char buffer[1 << 16];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    bytes.append(buffer, static_cast<size_t>(file.gcount()));
+  }
+  return !file.bad();
+}
+
+// Reads counterparts of writePod/writeVector/writeString from a file's
+// bytes. Counts are checked against the bytes left, so a corrupt count
+// fails the read instead of allocating.
+class ByteReader {
+ public:
+  explicit ByteReader(const std::string& bytes)
+      : data_{bytes.data()}, remaining_{bytes.size()} {
+  }
+
+  template <typename T>
+  bool pod(T& value) {
+    if (remaining_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_, sizeof(T));
+    advance(sizeof(T));
+    return true;
+  }
+
+  template <typename T, typename Allocator>
+  bool vector(std::vector<T, Allocator>& values) {
+    uint64_t count = 0;
+    if (!pod(count) || count > remaining_ / sizeof(T)) {
+      return false;
+    }
+    values.resize(count);
+    if (count > 0) {
+      std::memcpy(values.data(), data_, count * sizeof(T));
+    }
+    advance(count * sizeof(T));
+    return true;
+  }
+
+  bool string(std::string& value) {
+    uint64_t count = 0;
+    if (!pod(count) || count > remaining_) {
+      return false;
+    }
+    value.assign(data_, count);
+    advance(count);
+    return true;
+  }
+
+ private:
+  void advance(size_t bytes) {
+    data_ += bytes;
+    remaining_ -= bytes;
+  }
+
+  const char* data_;
+  size_t remaining_;
+};
+
+void expand(BoundingBox& bounds, const BoundingBox& box) {
+  bounds.min = Point2D(std::min(bounds.min.x, box.min.x),
+                       std::min(bounds.min.y, box.min.y));
+  bounds.max = Point2D(std::max(bounds.max.x, box.max.x),
+                       std::max(bounds.max.y, box.max.y));
+}
+
+// Elements of one tile while writing
+struct TileContents {
+  TileInfo info{};
+  std::vector<std::shared_ptr<Lane>> lanes;
+  std::vector<std::shared_ptr<TrafficLight>> trafficLights;
+  std::vector<std::shared_ptr<TrafficSign>> trafficSigns;
+};
+
+void include(TileContents& contents, const BoundingBox& box) {
+  const bool empty{contents.lanes.empty() && contents.trafficLights.empty() &&
+                   contents.trafficSigns.empty()};
+  if (empty) {
+    contents.info.bounds = box;
+  } else {
+    expand(contents.info.bounds, box);
+  }
+}
+
+}  // namespace
+
+TileStore::TileStore(const MemoryConstraints& constraints)
+    : constraints_(constraints) {
+}
+
+TileKey TileStore::tileKeyFor(const Point2D& point, double tileSize) {
+  return {static_cast<int32_t>(std::floor(point.x / tileSize)),
+          static_cast<int32_t>(std::floor(point.y / tileSize))};
+}
+
+std::string TileStore::tilePathFor(const std::string& directory,
+                                   const TileKey& key) {
+  return directory + "/tile_" + std::to_string(key.x) + "_" +
+         std::to_string(key.y) + ".bin";
+}
+
+bool TileStore::write(const MapServer& server, const std::string& directory,
+                      double tileSize) {
+  const std::scoped_lock lock{mutex_};
+  if (!(tileSize > 0.0)) {
+    lastError_ = "Tile size must be positive";
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    lastError_ = "Cannot create tile directory: " + directory;
+    spdlog::error(lastError_);
+    return false;
+  }
+
+  // Assign every element to exactly one tile
+  std::unordered_map<TileKey, TileContents, TileKeyHash> contents;
+  for (const auto& [id, lane] : server.getLanes()) {
+    auto& tile{contents[tileKeyFor(lane->bbox.center(), tileSize)]};
+    include(tile, lane->bbox);
+    tile.lanes.push_back(lane);
+  }
+  for (const auto& [id, light] : server.getTrafficLights()) {
+    auto& tile{contents[tileKeyFor(light->position, tileSize)]};
+    include(tile, BoundingBox{light->position, light->position});
+    tile.trafficLights.push_back(light);
+  }
+  for (const auto& [id, sign] : server.getTrafficSigns()) {
+    auto& tile{contents[tileKeyFor(sign->position, tileSize)]};
+    include(tile, BoundingBox{sign->position, sign->position});
+    tile.trafficSigns.push_back(sign);
+  }
+
+  std::vector<TileInfo> infos;
+  infos.reserve(contents.size());
+  for (auto& [key, tile] : contents) {
+    tile.info.key = key;
+    tile.info.laneCount = static_cast<uint32_t>(tile.lanes.size());
+    tile.info.trafficLightCount =
+        static_cast<uint32_t>(tile.trafficLights.size());
+    tile.info.trafficSignCount =
+        static_cast<uint32_t>(tile.trafficSigns.size());
+
+    const std::string path{tilePathFor(directory, key)};
+    std::ofstream file{path, std::ios::binary};
+    if (!file.is_open()) {
+      lastError_ = "Cannot write tile: " + path;
+      spdlog::error(lastError_);
+      return false;
+    }
+
+    writePod(file, kTileMagic);
+    writePod(file, kFileVersion);
+    writePod(file, tile.info.laneCount);
+    for (const auto& lane : tile.lanes) {
+      writePod(file, lane->id);
+      writePod(file, lane->type);
+      writePod(file, lane->speedLimit);
+      writeVector(file, lane->centerlinePoints());
+      writeVector(file, lane->leftBoundary);
+      writeVector(file, lane->rightBoundary);
+      writeVector(file, lane->predecessorIds);
+      writeVector(file, lane->successorIds);
+      writeVector(file, lane->adjacentLeftIds);
+      writeVector(file, lane->adjacentRightIds);
+    }
+    writePod(file, tile.info.trafficLightCount);
+    for (const auto& light : tile.trafficLights) {
+      writePod(file, light->id);
+      writePod(file, light->position);
+      writePod(file, light->state);
+      writePod(file, light->height);
+      writeVector(file, light->controlledLaneIds);
+    }
+    writePod(file, tile.info.trafficSignCount);
+    for (const auto& sign : tile.trafficSigns) {
+      writePod(file, sign->id);
+      writePod(file, sign->position);
+      writePod(file, sign->type);
+      writeString(file, sign->value);
+      writeVector(file, sign->affectedLaneIds);
+      writePod(file, sign->height);
+    }
+    if (!file.good()) {
+      lastError_ = "Failed writing tile: " + path;
+      spdlog::error(lastError_);
+      return false;
+    }
+    infos.push_back(tile.info);
+  }
+
+  // Deterministic manifest order
+  std::sort(infos.begin(), infos.end(),
+            [](const TileInfo& lhs, const TileInfo& rhs) {
+              return lhs.key.y != rhs.key.y ? lhs.key.y < rhs.key.y
+                                            : lhs.key.x < rhs.key.x;
+            });
+
+  const std::string manifestPath{manifestPathFor(directory)};
+  std::ofstream manifest{manifestPath, std::ios::binary};
+  if (!manifest.is_open()) {
+    lastError_ = "Cannot write tile manifest: " + manifestPath;
+    spdlog::error(lastError_);
+    return false;
+  }
+  std::vector<LaneLocation> locations;
+  locations.reserve(server.getLaneCount());
+  for (size_t i = 0; i < infos.size(); ++i) {
+    for (const auto& lane : contents[infos[i].key].lanes) {
+      locations.push_back(LaneLocation{lane->id, i});
+    }
+  }
+  std::sort(locations.begin(), locations.end(),
+            [](const LaneLocation& lhs, const LaneLocation& rhs) {
+              return lhs.laneId < rhs.laneId;
+            });
+
+  writePod(manifest, kManifestMagic);
+  writePod(manifest, kFileVersion);
+  writePod(manifest, tileSize);
+  writeVector(manifest, infos);
+  writeVector(manifest, locations);
+  return manifest.good();
+}
+
+bool TileStore::open(const std::string& directory) {
+  close();
+
+  const std::scoped_lock lock{mutex_};
+  const std::string manifestPath{manifestPathFor(directory)};
+  std::string bytes;
+  if (!readFile(manifestPath, bytes)) {
+    lastError_ = "Cannot open tile manifest: " + manifestPath;
+    spdlog::error(lastError_);
+    return false;
+  }
+
+  ByteReader manifest{bytes};
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  double tileSize = 0.0;
+  std::vector<TileInfo> tiles;
+  std::vector<LaneLocation> locations;
+  if (!manifest.pod(magic) || !manifest.pod(version) ||
+      magic != kManifestMagic || version != kFileVersion ||
+      !manifest.pod(tileSize) || !(tileSize > 0.0) ||
+      !manifest.vector(tiles) || !manifest.vector(locations)) {
+    lastError_ = "Not a tile manifest: " + manifestPath;
+    spdlog::error(lastError_);
+    return false;
+  }
+  // Binary searched by id and used to index tiles_
+  for (size_t i = 0; i < locations.size(); ++i) {
+    if (locations[i].tileIndex >= tiles.size() ||
+        (i > 0 && locations[i].laneId <= locations[i - 1].laneId)) {
+      lastError_ = "Corrupt tile manifest: " + manifestPath;
+      spdlog::error(lastError_);
+      return false;
+    }
+  }
+
+  directory_ = directory;
+  tileSize_ = tileSize;
+  tiles_ = std::move(tiles);
+  laneLocations_ = std::move(locations);
+  tileIndexByKey_.reserve(tiles_.size());
+  maxOverhang_ = 0.0;
+  for (size_t i = 0; i < tiles_.size(); ++i) {
+    const TileInfo& info{tiles_[i]};
+    tileIndexByKey_[info.key] = i;
+    const double minX{info.key.x * tileSize_};
+    const double minY{info.key.y * tileSize_};
+    maxOverhang_ = std::max(
+        {maxOverhang_, minX - info.bounds.min.x, minY - info.bounds.min.y,
+         info.bounds.max.x - (minX + tileSize_),
+         info.bounds.max.y - (minY + tileSize_)});
+  }
+  return true;
+}
+
+void TileStore::close() {
+  std::unique_lock lock{mutex_};
+  // Readers hold pointers into loaded_ while the lock is dropped
+  tileRead_.wait(lock, [this]() { return activeReaders_ == 0; });
+  directory_.clear();
+  tiles_.clear();
+  tileIndexByKey_.clear();
+  laneLocations_.clear();
+  maxOverhang_ = 0.0;
+  loaded_.clear();
+  lru_.clear();
+  memoryUsage_ = 0;
+  stats_ = TileStoreStats{};
+}
+
+std::vector<size_t> TileStore::tilesOverlapping(
+    const BoundingBox& region) const {
+  std::vector<size_t> result;
+  if (tiles_.empty()) {
+    return result;
+  }
+
+  // Tiles whose square lies within maxOverhang_ of the region can hold
+  // elements reaching into it
+  const TileKey low{tileKeyFor(
+      Point2D(region.min.x - maxOverhang_, region.min.y - maxOverhang_),
+      tileSize_)};
+  const TileKey high{tileKeyFor(
+      Point2D(region.max.x + maxOverhang_, region.max.y + maxOverhang_),
+      tileSize_)};
+  const auto span{static_cast<uint64_t>(high.x - low.x + 1) *
+                  static_cast<uint64_t>(high.y - low.y + 1)};
+
+  if (span > tiles_.size()) {
+    // Region larger than the map: scanning the manifest is cheaper
+    for (size_t i = 0; i < tiles_.size(); ++i) {
+      if (tiles_[i].bounds.intersects(region)) {
+        result.push_back(i);
+      }
+    }
+    return result;
+  }
+
+  for (int32_t y = low.y; y <= high.y; ++y) {
+    for (int32_t x = low.x; x <= high.x; ++x) {
+      auto it = tileIndexByKey_.find(TileKey{x, y});
+      if (it != tileIndexByKey_.end() &&
+          tiles_[it->second].bounds.intersects(region)) {
+        result.push_back(it->second);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<TileStore::LoadedTile*> TileStore::acquire(
+    const std::vector<size_t>& tileIndices,
+    std::unique_lock<std::mutex>& lock) const {
+  activeReaders_++;
+  std::vector<LoadedTile*> acquired;
+  acquired.reserve(tileIndices.size());
+  for (const auto index : tileIndices) {
+    const TileKey key{tiles_[index].key};
+    bool waited{false};
+    while (true) {
+      auto it = loaded_.find(key);
+      if (it != loaded_.end()) {
+        waited ? stats_.loads++ : stats_.hits++;
+        lru_.splice(lru_.begin(), lru_, it->second.lruPosition);
+        it->second.pins++;
+        acquired.push_back(&it->second);
+        break;
+      }
+      waited = true;
+      if (loading_.count(key) > 0) {
+        // Another query or a prefetch is reading it
+        tileRead_.wait(lock);
+        continue;
+      }
+
+      // Miss: read without the lock, tiles acquired so far stay pinned
+      loading_.insert(key);
+      const std::string path{tilePathFor(directory_, key)};
+      lock.unlock();
+      LoadedTile tile;
+      std::string error;
+      const bool read{readTile(path, tile, error)};
+      lock.lock();
+      loading_.erase(key);
+      tileRead_.notify_all();
+      if (!read) {
+        lastError_ = error;
+        spdlog::error(lastError_);
+        break;
+      }
+      stats_.loads++;
+      LoadedTile& inserted{insertTile(key, std::move(tile))};
+      inserted.pins++;
+      acquired.push_back(&inserted);
+      break;
+    }
+  }
+  return acquired;
+}
+
+void TileStore::release(const std::vector<LoadedTile*>& tiles,
+                        const std::vector<size_t>& tileIndices) const {
+  for (LoadedTile* tile : tiles) {
+    tile->pins--;
+  }
+  evictOverBudget(tileIndices);
+  if (--activeReaders_ == 0) {
+    tileRead_.notify_all();
+  }
+}
+
+TileStore::LoadedTile& TileStore::insertTile(const TileKey& key,
+                                             LoadedTile&& tile) const {
+  memoryUsage_ += tile.memoryUsage;
+  lru_.push_front(key);
+  tile.lruPosition = lru_.begin();
+  return loaded_.emplace(key, std::move(tile)).first->second;
+}
+
+bool TileStore::readTile(const std::string& path, LoadedTile& tile,
+                         std::string& error) {
+  tile.account = MemoryAccount::acquire();
+  std::string bytes;
+  if (!readFile(path, bytes)) {
+    error = "Cannot open tile: " + path;
+    return false;
+  }
+  const MemoryCharge bytesCharge{tile.account.get(),
+                                 MemoryCategory::PARSER_SCRATCH, bytes.size()};
+
+  ByteReader file{bytes};
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t count = 0;
+  if (!file.pod(magic) || !file.pod(version) || magic != kTileMagic ||
+      version != kFileVersion || !file.pod(count)) {
+    error = "Not a map tile: " + path;
+    return false;
+  }
+
+  // Fresh containers so they bind to the tile's account
+  const MemoryAccount::Scope scope{tile.account.get()};
+  tile.lanes = LaneMap{};
+  tile.trafficLights = TrafficLightMap{};
+  tile.trafficSigns = TrafficSignMap{};
+  tile.laneIndex = RTree{};
+  tile.trafficLightIndex = PointIndex<TrafficLight>{};
+  tile.trafficSignIndex = PointIndex<TrafficSign>{};
+
+  bool ok = true;
+  for (uint32_t i = 0; i < count && ok; ++i) {
+    auto lane{makeTracked<Lane>()};
+    ok = file.pod(lane->id) && file.pod(lane->type) &&
+         file.pod(lane->speedLimit) &&
+         file.vector(lane->centerline) &&
+         file.vector(lane->leftBoundary) &&
+         file.vector(lane->rightBoundary) &&
+         file.vector(lane->predecessorIds) &&
+         file.vector(lane->successorIds) &&
+         file.vector(lane->adjacentLeftIds) &&
+         file.vector(lane->adjacentRightIds);
+    if (ok) {
+      lane->computeBoundingBox();
+      tile.laneIndex.insert(lane->bbox, lane);
+      tile.lanes[lane->id] = std::move(lane);
+    }
+  }
+
+  ok = ok && file.pod(count);
+  for (uint32_t i = 0; i < count && ok; ++i) {
+    auto light{makeTracked<TrafficLight, MemoryCategory::TRAFFIC_ELEMENTS>()};
+    ok = file.pod(light->id) && file.pod(light->position) &&
+         file.pod(light->state) && file.pod(light->height) &&
+         file.vector(light->controlledLaneIds);
+    if (ok) {
+      tile.trafficLights[light->id] = std::move(light);
+    }
+  }
+
+  ok = ok && file.pod(count);
+  for (uint32_t i = 0; i < count && ok; ++i) {
+    auto sign{makeTracked<TrafficSign, MemoryCategory::TRAFFIC_ELEMENTS>()};
+    ok = file.pod(sign->id) && file.pod(sign->position) &&
+         file.pod(sign->type) && file.string(sign->value) &&
+         file.vector(sign->affectedLaneIds) &&
+         file.pod(sign->height);
+    if (ok) {
+      tile.trafficSigns[sign->id] = std::move(sign);
+    }
+  }
+
+  if (!ok) {
+    error = "Corrupt map tile: " + path;
+    return false;
+  }
+
+  tile.trafficLightIndex.build(tile.trafficLights);
+  tile.trafficSignIndex.build(tile.trafficSigns);
+  tile.memoryUsage = sizeof(LoadedTile) + tile.account->breakdown().total();
+  return true;
+}
+
+void TileStore::evictOverBudget(const std::vector<size_t>& pinned) const {
+  auto candidate = lru_.end();
+  while (memoryUsage_ > constraints_.maxTotalMemory &&
+         candidate != lru_.begin()) {
+    --candidate;
+    const TileKey key{*candidate};
+    auto it = loaded_.find(key);
+    const bool isPinned{
+        it->second.pins > 0 ||
+        std::any_of(pinned.begin(), pinned.end(),
+                    [&](size_t index) { return tiles_[index].key == key; })};
+    if (isPinned) {
+      continue;
+    }
+
+    memoryUsage_ -= it->second.memoryUsage;
+    loaded_.erase(it);
+    candidate = lru_.erase(candidate);
+    stats_.evictions++;
+  }
+}
+
+QueryResult TileStore::queryRegion(const BoundingBox& region) const {
+  QueryResult result;
+  std::unique_lock lock{mutex_};
+
+  const auto tileIndices{tilesOverlapping(region)};
+  const auto tiles{acquire(tileIndices, lock)};
+  for (const LoadedTile* tile : tiles) {
+    std::vector<Data> laneResults;
+    tile->laneIndex.query(region, laneResults);
+    for (const auto& object : laneResults) {
+      result.lanes.push_back(std::get<std::shared_ptr<Lane>>(object));
+    }
+    tile->trafficLightIndex.query(region, result.trafficLights);
+    tile->trafficSignIndex.query(region, result.trafficSigns);
+  }
+
+  release(tiles, tileIndices);
+  return result;
+}
+
+QueryResult TileStore::queryRadius(const Point2D& center,
+                                   double radius) const {
+  QueryResult result;
+  std::unique_lock lock{mutex_};
+
+  const BoundingBox region{Point2D(center.x - radius, center.y - radius),
+                           Point2D(center.x + radius, center.y + radius)};
+  const auto tileIndices{tilesOverlapping(region)};
+  const auto tiles{acquire(tileIndices, lock)};
+  for (const LoadedTile* tile : tiles) {
+    std::vector<Data> laneResults;
+    tile->laneIndex.queryRadius(center, radius, laneResults);
+    for (const auto& object : laneResults) {
+      auto lane{std::get<std::shared_ptr<Lane>>(object)};
+      if (lane->distanceTo(center) <= radius) {
+        result.lanes.push_back(std::move(lane));
+      }
+    }
+
+    std::vector<std::shared_ptr<TrafficLight>> lights;
+    tile->trafficLightIndex.queryRadius(center, radius, lights);
+    for (auto& light : lights) {
+      if (center.distanceTo(light->position) <= radius) {
+        result.trafficLights.push_back(std::move(light));
+      }
+    }
+
+    std::vector<std::shared_ptr<TrafficSign>> signs;
+    tile->trafficSignIndex.queryRadius(center, radius, signs);
+    for (auto& sign : signs) {
+      if (center.distanceTo(sign->position) <= radius) {
+        result.trafficSigns.push_back(std::move(sign));
+      }
+    }
+  }
+
+  release(tiles, tileIndices);
+  return result;
+}
+
+std::optional<std::shared_ptr<Lane>> TileStore::getClosestLane(
+    const Point2D& position) const {
+  // Same staged search as MapServer::getClosestLane
+  auto closest{closestLaneWithin(position, kClosestLaneRadius)};
+  if (closest == nullptr) {
+    closest = closestLaneWithin(position, kClosestLaneMaxRadius);
+  }
+  if (closest == nullptr) {
+    return std::nullopt;
+  }
+  return closest;
+}
+
+std::shared_ptr<Lane> TileStore::closestLaneWithin(const Point2D& position,
+                                                   double radius) const {
+  std::unique_lock lock{mutex_};
+  const BoundingBox region{
+      Point2D(position.x - radius, position.y - radius),
+      Point2D(position.x + radius, position.y + radius)};
+  const auto tileIndices{tilesOverlapping(region)};
+  const auto tiles{acquire(tileIndices, lock)};
+
+  std::shared_ptr<Lane> closest;
+  double minDistance{std::numeric_limits<double>::max()};
+  for (const LoadedTile* tile : tiles) {
+    std::vector<Data> laneResults;
+    tile->laneIndex.queryRadius(position, radius, laneResults);
+    for (const auto& object : laneResults) {
+      const auto& lane{std::get<std::shared_ptr<Lane>>(object)};
+      const double distance{lane->distanceTo(position)};
+      if (distance <= radius && distance < minDistance) {
+        minDistance = distance;
+        closest = lane;
+      }
+    }
+  }
+
+  release(tiles, tileIndices);
+  return closest;
+}
+
+std::optional<std::shared_ptr<Lane>> TileStore::getLaneById(
+    uint64_t laneId) const {
+  std::unique_lock lock{mutex_};
+  const auto location{std::lower_bound(
+      laneLocations_.begin(), laneLocations_.end(), laneId,
+      [](const LaneLocation& entry, uint64_t id) {
+        return entry.laneId < id;
+      })};
+  if (location == laneLocations_.end() || location->laneId != laneId) {
+    return std::nullopt;
+  }
+
+  const std::vector<size_t> tileIndices{
+      static_cast<size_t>(location->tileIndex)};
+  const auto tiles{acquire(tileIndices, lock)};
+  std::optional<std::shared_ptr<Lane>> lane;
+  for (const LoadedTile* tile : tiles) {
+    auto it = tile->lanes.find(laneId);
+    if (it != tile->lanes.end()) {
+      lane = it->second;
+    }
+  }
+  release(tiles, tileIndices);
+  return lane;
+}
+
+void TileStore::prefetch(const Point2D& position, double heading,
+                         double distance) const {
+  distance = std::max(distance, 0.0);
+  const Point2D ahead{position.x + std::cos(heading) * distance,
+                      position.y + std::sin(heading) * distance};
+  prefetchPath({position, ahead});
+}
+
+void TileStore::prefetchPath(const std::vector<Point2D>& path) const {
+  std::string directory;
+  std::vector<size_t> wanted;
+  std::vector<TileKey> missing;
+  {
+    const std::scoped_lock lock{mutex_};
+    if (tiles_.empty() || path.empty()) {
+      return;
+    }
+    directory = directory_;
+
+    // Sample at half-tile steps so no crossed tile is skipped
+    const double step{tileSize_ / 2.0};
+    const auto want = [&](const Point2D& sample) {
+      for (const auto index : tilesOverlapping(BoundingBox{sample, sample})) {
+        if (std::find(wanted.begin(), wanted.end(), index) == wanted.end()) {
+          wanted.push_back(index);
+        }
+      }
+    };
+    want(path.front());
+    for (size_t i = 1; i < path.size(); ++i) {
+      const Point2D& a{path[i - 1]};
+      const Point2D& b{path[i]};
+      const double length{a.distanceTo(b)};
+      for (double along = step; along < length; along += step) {
+        const double t{along / length};
+        want(Point2D(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t));
+      }
+      want(b);
+    }
+
+    // Tiles already being read are left to their reader
+    for (const auto index : wanted) {
+      const TileKey& key{tiles_[index].key};
+      if (loaded_.count(key) == 0 && loading_.insert(key).second) {
+        missing.push_back(key);
+      }
+    }
+    activeReaders_++;
+  }
+
+  // Disk reads happen without the lock so queries keep running
+  for (const auto& key : missing) {
+    LoadedTile tile;
+    std::string error;
+    const bool read{readTile(tilePathFor(directory, key), tile, error)};
+    const std::scoped_lock lock{mutex_};
+    loading_.erase(key);
+    if (read) {
+      stats_.prefetches++;
+      insertTile(key, std::move(tile));
+    } else {
+      spdlog::error(error);
+      lastError_ = error;
+    }
+    tileRead_.notify_all();
+  }
+
+  const std::scoped_lock lock{mutex_};
+  if (--activeReaders_ == 0) {
+    tileRead_.notify_all();
+  }
+  // Farthest first, so the nearest tiles end up most recently used
+  for (auto it = wanted.rbegin(); it != wanted.rend(); ++it) {
+    auto tile = loaded_.find(tiles_[*it].key);
+    if (tile != loaded_.end()) {
+      lru_.splice(lru_.begin(), lru_, tile->second.lruPosition);
+    }
+  }
+  evictOverBudget(wanted);
+}
+
+size_t TileStore::getLoadedTileCount() const {
+  const std::scoped_lock lock{mutex_};
+  return loaded_.size();
+}
+
+bool TileStore::isTileLoaded(const TileKey& key) const {
+  const std::scoped_lock lock{mutex_};
+  return loaded_.count(key) > 0;
+}
+
+size_t TileStore::getMemoryUsage() const {
+  const std::scoped_lock lock{mutex_};
+  return memoryUsage_;
+}
+
+TileStoreStats TileStore::getStats() const {
+  const std::scoped_lock lock{mutex_};
+  return stats_;
+}
+
+std::string TileStore::getLastError() const {
+  const std::scoped_lock lock{mutex_};
+  return lastError_;
+}
+
+}  // namespace hdmap
@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <vector>
 
 namespace hdmap {
 
@@ -29,39 +31,142 @@ Point2D BoundingBox::center() const {
   return Point2D{(min.x + max.x) / 2.0, (min.y + max.y) / 2.0};
 }
 
+Point2D tileOriginFor(const Point2D& point, double tileSize) {
+  return Point2D{std::floor(point.x / tileSize) * tileSize,
+                 std::floor(point.y / tileSize) * tileSize};
+}
+
+CompactPolyline::CompactPolyline(const std::vector<Point2D>& points,
+                                 double tileSize) {
+  if (points.empty()) {
+    return;
+  }
+
+  origin_ = tileOriginFor(points[0], tileSize);
+  xs_.reserve(points.size());
+  ys_.reserve(points.size());
+  for (const auto& point : points) {
+    xs_.push_back(static_cast<float>(point.x - origin_.x));
+    ys_.push_back(static_cast<float>(point.y - origin_.y));
+  }
+}
+
+Point2D CompactPolyline::at(size_t index) const {
+  return Point2D{origin_.x + static_cast<double>(xs_[index]),
+                 origin_.y + static_cast<double>(ys_[index])};
+}
+
+std::vector<Point2D> CompactPolyline::toPoints() const {
+  std::vector<Point2D> points;
+  points.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    points.push_back(at(i));
+  }
+  return points;
+}
+
+double CompactPolyline::minVertexDistance(const Point2D& point) const {
+  // Move the query into the tile frame once, then stay in float
+  const auto qx{static_cast<float>(point.x - origin_.x)};
+  const auto qy{static_cast<float>(point.y - origin_.y)};
+
+  float minSquared = std::numeric_limits<float>::max();
+  const size_t count{xs_.size()};
+  const float* xs{xs_.data()};
+  const float* ys{ys_.data()};
+  for (size_t i = 0; i < count; ++i) {
+    const float dx = xs[i] - qx;
+    const float dy = ys[i] - qy;
+    const float squared = dx * dx + dy * dy;
+    minSquared = squared < minSquared ? squared : minSquared;
+  }
+
+  return std::sqrt(static_cast<double>(minSquared));
+}
+
 void Lane::computeBoundingBox() {
-  if (centerline.empty()) {
+  // Reads whichever centerline is stored instead of copying it
+  const size_t count{centerlineSize()};
+  if (count == 0) {
     bbox = BoundingBox();
     return;
   }
 
-  double minX = centerline[0].x;
-  double maxX = centerline[0].x;
-  double minY = centerline[0].y;
-  double maxY = centerline[0].y;
-
-  for (const auto& point : centerline) {
+  const Point2D first{centerline.empty() ? compactCenterline.at(0)
+                                         : centerline.front()};
+  double minX = first.x;
+  double maxX = first.x;
+  double minY = first.y;
+  double maxY = first.y;
+  const auto extend = [&](const Point2D& point) {
     minX = std::min(minX, point.x);
     maxX = std::max(maxX, point.x);
     minY = std::min(minY, point.y);
     maxY = std::max(maxY, point.y);
-  }
+  };
 
+  if (centerline.empty()) {
+    for (size_t i = 0; i < count; ++i) {
+      extend(compactCenterline.at(i));
+    }
+  } else {
+    for (const auto& point : centerline) {
+      extend(point);
+    }
+  }
   for (const auto& point : leftBoundary) {
-    minX = std::min(minX, point.x);
-    maxX = std::max(maxX, point.x);
-    minY = std::min(minY, point.y);
-    maxY = std::max(maxY, point.y);
+    extend(point);
   }
-
   for (const auto& point : rightBoundary) {
-    minX = std::min(minX, point.x);
-    maxX = std::max(maxX, point.x);
-    minY = std::min(minY, point.y);
-    maxY = std::max(maxY, point.y);
+    extend(point);
   }
 
   bbox = BoundingBox(Point2D(minX, minY), Point2D(maxX, maxY));
 }
 
+void Lane::compactGeometry(double tileSize) {
+  if (centerline.empty()) {
+    return;
+  }
+  compactCenterline = CompactPolyline{centerlinePoints(), tileSize};
+  centerline.clear();
+  centerline.shrink_to_fit();
+}
+
+size_t Lane::centerlineSize() const {
+  return centerline.empty() ? compactCenterline.size() : centerline.size();
+}
+
+std::vector<Point2D> Lane::centerlinePoints() const {
+  if (centerline.empty()) {
+    return compactCenterline.toPoints();
+  }
+  return {centerline.begin(), centerline.end()};
+}
+
+double Lane::distanceTo(const Point2D& point) const {
+  if (centerline.empty()) {
+    if (compactCenterline.empty()) {
+      return std::numeric_limits<double>::max();
+    }
+    return compactCenterline.minVertexDistance(point);
+  }
+
+  double minDistance = std::numeric_limits<double>::max();
+  for (const auto& vertex : centerline) {
+    minDistance = std::min(minDistance, point.distanceTo(vertex));
+  }
+  return minDistance;
+}
+
+size_t Lane::memoryUsage() const {
+  return sizeof(Lane) + centerline.size() * sizeof(Point2D) +
+         compactCenterline.memoryUsage() +
+         leftBoundary.size() * sizeof(Point2D) +
+         rightBoundary.size() * sizeof(Point2D) +
+         (predecessorIds.size() + successorIds.size() +
+          adjacentLeftIds.size() + adjacentRightIds.size()) *
+             sizeof(uint64_t);
+}
+
 }  // namespace hdmap
@@ -0,0 +1,170 @@
+#include "include/window_tracker.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace hdmap {
+
+namespace {
+
+BoundingBox pointBox(const Point2D& point) {
+  return BoundingBox{point, point};
+}
+
+// Move tracked candidates no longer overlapping window from current into
+// left. Candidates come from the band the window moved away from; nothing
+// outside it can have been tracked and left.
+template <typename T, typename BoxOf, typename ElementMap>
+void collectLeft(const std::vector<std::shared_ptr<T>>& candidates,
+                 const BoundingBox& window, const BoxOf& boxOf,
+                 ElementMap& current,
+                 std::vector<std::shared_ptr<T>>& left) {
+  for (const auto& candidate : candidates) {
+    if (boxOf(*candidate).intersects(window)) {
+      continue;
+    }
+    const auto it = current.find(candidate->id);
+    if (it != current.end()) {
+      left.push_back(it->second);
+      current.erase(it);
+    }
+  }
+}
+
+// Move every member of current into left
+template <typename ElementMap, typename T>
+void collectAll(ElementMap& current, std::vector<std::shared_ptr<T>>& left) {
+  left.reserve(left.size() + current.size());
+  for (const auto& [id, element] : current) {
+    left.push_back(element);
+  }
+  current.clear();
+}
+
+// Add candidates overlapping window that are not tracked yet
+template <typename T, typename BoxOf, typename ElementMap>
+void collectEntered(const std::vector<std::shared_ptr<T>>& candidates,
+                    const BoundingBox& window, const BoxOf& boxOf,
+                    ElementMap& current,
+                    std::vector<std::shared_ptr<T>>& entered) {
+  for (const auto& candidate : candidates) {
+    if (!boxOf(*candidate).intersects(window)) {
+      continue;
+    }
+    if (current.emplace(candidate->id, candidate).second) {
+      entered.push_back(candidate);
+    }
+  }
+}
+
+}  // namespace
+
+WindowTracker::WindowTracker(const MapServer& mapServer)
+    : mapServer_{mapServer} {
+}
+
+WindowDelta WindowTracker::update(const BoundingBox& window) {
+  WindowDelta delta;
+
+  const auto laneBox = [](const Lane& lane) { return lane.bbox; };
+  const auto lightBox = [](const TrafficLight& light) {
+    return pointBox(light.position);
+  };
+  const auto signBox = [](const TrafficSign& sign) {
+    return pointBox(sign.position);
+  };
+
+  // A reloaded map invalidates everything tracked: report it all as left
+  // and rebuild from a full query
+  const uint64_t generation{mapServer_.getGeneration()};
+  const bool rebuild{!window_.has_value() || generation != generation_ ||
+                     !window_->intersects(window)};
+
+  std::vector<BoundingBox> strips;
+  if (rebuild) {
+    collectAll(lanes_, delta.left.lanes);
+    collectAll(trafficLights_, delta.left.trafficLights);
+    collectAll(trafficSigns_, delta.left.trafficSigns);
+    strips.push_back(window);
+  } else {
+    // Only the band the window moved away from can hold elements that left
+    for (const auto& band : uncoveredStrips(window, *window_)) {
+      const QueryResult found{mapServer_.queryRegion(band)};
+      collectLeft(found.lanes, window, laneBox, lanes_, delta.left.lanes);
+      collectLeft(found.trafficLights, window, lightBox, trafficLights_,
+                  delta.left.trafficLights);
+      collectLeft(found.trafficSigns, window, signBox, trafficSigns_,
+                  delta.left.trafficSigns);
+    }
+    // Only the newly uncovered strips can contain new elements
+    strips = uncoveredStrips(*window_, window);
+  }
+
+  for (const auto& strip : strips) {
+    const QueryResult found{mapServer_.queryRegion(strip)};
+    collectEntered(found.lanes, window, laneBox, lanes_,
+                   delta.entered.lanes);
+    collectEntered(found.trafficLights, window, lightBox, trafficLights_,
+                   delta.entered.trafficLights);
+    collectEntered(found.trafficSigns, window, signBox, trafficSigns_,
+                   delta.entered.trafficSigns);
+  }
+
+  window_ = window;
+  generation_ = generation;
+  return delta;
+}
+
+QueryResult WindowTracker::current() const {
+  QueryResult result;
+  result.lanes.reserve(lanes_.size());
+  for (const auto& [id, lane] : lanes_) {
+    result.lanes.push_back(lane);
+  }
+  result.trafficLights.reserve(trafficLights_.size());
+  for (const auto& [id, light] : trafficLights_) {
+    result.trafficLights.push_back(light);
+  }
+  result.trafficSigns.reserve(trafficSigns_.size());
+  for (const auto& [id, sign] : trafficSigns_) {
+    result.trafficSigns.push_back(sign);
+  }
+  return result;
+}
+
+void WindowTracker::reset() {
+  window_.reset();
+  lanes_.clear();
+  trafficLights_.clear();
+  trafficSigns_.clear();
+}
+
+std::vector<BoundingBox> WindowTracker::uncoveredStrips(
+    const BoundingBox& previous, const BoundingBox& next) {
+  std::vector<BoundingBox> strips;
+
+  // Full-height strips left and right of the previous window
+  if (next.min.x < previous.min.x) {
+    strips.emplace_back(next.min,
+                        Point2D{previous.min.x, next.max.y});
+  }
+  if (next.max.x > previous.max.x) {
+    strips.emplace_back(Point2D{previous.max.x, next.min.y}, next.max);
+  }
+
+  // Below and above, limited to the shared x range
+  const double minX{std::max(next.min.x, previous.min.x)};
+  const double maxX{std::min(next.max.x, previous.max.x)};
+  if (next.min.y < previous.min.y) {
+    strips.emplace_back(Point2D{minX, next.min.y},
+                        Point2D{maxX, previous.min.y});
+  }
+  if (next.max.y > previous.max.y) {
+    strips.emplace_back(Point2D{minX, previous.max.y},
+                        Point2D{maxX, next.max.y});
+  }
+
+  return strips;
+}
+
+}  // namespace hdmap
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/drive_trace.hpp"
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/query_metrics.hpp"
+
+// Concurrent reader benchmark. 1, 2, 4, ... up to --threads readers replay
+// synthesized drives against one shared MapServer for a fixed time each;
+// the report shows aggregate throughput, speedup and efficiency against a
+// single reader, and tail latency overall and for the slowest thread. A
+// flat speedup curve points at shared cache lines: element refcounts bumped
+// by every result, the live-map pointer, shared counters. --reload adds a
+// writer that keeps loading the map into a fresh server and swapping it in
+// the way a double-buffered deployment does.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kNanosecondsPerMicrosecond = 1e3;
+// Queries per load of the live-map pointer: one localization round of a
+// synthesized drive
+constexpr size_t kQueriesPerSnapshot = 5;
+
+struct Options {
+  std::string mapFile;  // generated when empty
+  hdmap::CityConfig city;
+  size_t maxThreads{std::max(1U, std::thread::hardware_concurrency())};
+  double seconds{2.0};
+  bool reload{false};
+  std::array<bool, hdmap::kTraceQueryTypeCount> types{};
+  std::string jsonFile;
+};
+
+// Padded so that readers never share a cache line through the benchmark's
+// own bookkeeping
+struct alignas(64) ReaderResult {
+  size_t queries{0};
+  size_t results{0};
+  hdmap::LatencyHistogram latency;
+};
+
+struct Step {
+  size_t threads{0};
+  double seconds{0.0};
+  size_t reloads{0};
+  std::vector<ReaderResult> readers;
+  hdmap::LatencyHistogram latency;  // all readers
+
+  size_t queries() const {
+    size_t total{0};
+    for (const auto& reader : readers) {
+      total += reader.queries;
+    }
+    return total;
+  }
+  double throughput() const {
+    return seconds > 0.0 ? queries() / seconds : 0.0;
+  }
+  uint64_t worstThreadP99() const {
+    uint64_t worst{0};
+    for (const auto& reader : readers) {
+      worst = std::max(worst, reader.latency.percentile(0.99));
+    }
+    return worst;
+  }
+};
+
+hdmap::MemoryConstraints unlimited() {
+  // Lift the limits: the benchmark measures queries, not admission
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = SIZE_MAX;
+  constraints.maxLanes = SIZE_MAX;
+  constraints.maxTrafficLights = SIZE_MAX;
+  constraints.maxTrafficSigns = SIZE_MAX;
+  return constraints;
+}
+
+void printUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [map.osm] [options]\n"
+      << "  --lanes N          lanes of the generated city (default 20000)\n"
+      << "  --threads N        most reader threads (default: hardware "
+         "threads)\n"
+      << "  --seconds S        run time per thread count (default 2)\n"
+      << "  --types a,b,...    query types to issue (default all of a drive: "
+         "closest,project,radius,lights,signs)\n"
+      << "  --reload           reload the map concurrently and swap it in\n"
+      << "  --json FILE        also write the report as JSON\n";
+}
+
+bool parseTypes(const std::string& list, Options& options) {
+  options.types.fill(false);
+  std::stringstream stream{list};
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    bool known{false};
+    for (size_t i = 0; i < hdmap::kTraceQueryTypeCount; ++i) {
+      const auto type{static_cast<hdmap::TraceQueryType>(i)};
+      if (name == hdmap::traceQueryName(type)) {
+        options.types[i] = true;
+        known = true;
+      }
+    }
+    if (!known) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  options.city.laneCount = 20000;
+  options.types.fill(true);
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg == "--reload") {
+      options.reload = true;
+      continue;
+    }
+    if (arg.rfind("--", 0) != 0) {
+      options.mapFile = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const std::string value{argv[++i]};
+    if (arg == "--lanes") {
+      options.city.laneCount = std::stoull(value);
+    } else if (arg == "--threads") {
+      options.maxThreads = std::max<size_t>(1, std::stoull(value));
+    } else if (arg == "--seconds") {
+      options.seconds = std::stod(value);
+    } else if (arg == "--types") {
+      if (!parseTypes(value, options)) {
+        return false;
+      }
+    } else if (arg == "--json") {
+      options.jsonFile = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 1, 2, 4, ... and the maximum itself
+std::vector<size_t> threadCounts(size_t maxThreads) {
+  std::vector<size_t> counts;
+  for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(maxThreads);
+  return counts;
+}
+
+// One drive per reader so threads do not walk the same lanes in lockstep
+std::vector<hdmap::DriveTrace> synthesizeDrives(const hdmap::MapServer& server,
+                                                const Options& options) {
+  std::vector<hdmap::DriveTrace> drives;
+  for (size_t i = 0; i < options.maxThreads; ++i) {
+    hdmap::DriveConfig config;
+    config.seed = 42 + i;
+    auto drive{hdmap::DriveTrace::synthesize(server, config)};
+    auto& queries{drive.queries()};
+    queries.erase(std::remove_if(queries.begin(), queries.end(),
+                                 [&options](const hdmap::TraceQuery& query) {
+                                   return !options.types[static_cast<size_t>(
+                                       query.type)];
+                                 }),
+                  queries.end());
+    drives.push_back(std::move(drive));
+  }
+  return drives;
+}
+
+Step runStep(size_t threads, const Options& options,
+             std::shared_ptr<const hdmap::MapServer> initial,
+             const std::vector<hdmap::DriveTrace>& drives) {
+  Step step;
+  step.threads = threads;
+  step.readers.resize(threads);
+
+  std::shared_ptr<const hdmap::MapServer> live{std::move(initial)};
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < threads; ++i) {
+    readers.emplace_back([&, i]() {
+      auto& result{step.readers[i]};
+      const auto& queries{drives[i].queries()};
+      ready.fetch_add(1);
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      size_t next{0};
+      while (!stop.load(std::memory_order_relaxed)) {
+        const auto server{std::atomic_load(&live)};
+        for (size_t k = 0; k < kQueriesPerSnapshot; ++k) {
+          const auto& query{queries[next]};
+          next = next + 1 == queries.size() ? 0 : next + 1;
+          const auto before{Clock::now()};
+          result.results += hdmap::TraceReplayer::execute(*server, query);
+          const auto elapsed{Clock::now() - before};
+          result.latency.record(static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                  .count()));
+          ++result.queries;
+        }
+      }
+    });
+  }
+
+  std::atomic<size_t> reloads{0};
+  std::thread writer;
+  if (options.reload) {
+    writer = std::thread([&]() {
+      while (!stop.load()) {
+        auto next{std::make_shared<hdmap::MapServer>(unlimited())};
+        if (next->loadFromFile(options.mapFile)) {
+          std::atomic_store(&live,
+                            std::shared_ptr<const hdmap::MapServer>{next});
+          reloads.fetch_add(1);
+        }
+      }
+    });
+  }
+
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  const auto start{Clock::now()};
+  go.store(true);
+  std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  step.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  if (writer.joinable()) {
+    writer.join();
+  }
+  step.reloads = reloads.load();
+
+  for (const auto& reader : step.readers) {
+    step.latency.merge(reader.latency);
+  }
+  return step;
+}
+
+double micros(uint64_t nanoseconds) {
+  return nanoseconds / kNanosecondsPerMicrosecond;
+}
+
+void printReport(const std::vector<Step>& steps, const Options& options) {
+  std::cout << std::left << std::setw(9) << "threads" << std::right
+            << std::setw(13) << "queries/s" << std::setw(9) << "speedup"
+            << std::setw(12) << "efficiency" << std::setw(10) << "p50 us"
+            << std::setw(10) << "p99 us" << std::setw(11) << "p99.9 us"
+            << std::setw(11) << "max us" << std::setw(17) << "worst p99 us";
+  if (options.reload) {
+    std::cout << std::setw(9) << "reloads";
+  }
+  std::cout << "\n" << std::fixed;
+  const double single{steps.front().throughput()};
+  for (const auto& step : steps) {
+    const double speedup{single > 0.0 ? step.throughput() / single : 0.0};
+    std::cout << std::left << std::setw(9) << step.threads << std::right
+              << std::setprecision(0) << std::setw(13) << step.throughput()
+              << std::setprecision(2) << std::setw(9) << speedup
+              << std::setw(11) << 100.0 * speedup / step.threads << "%"
+              << std::setw(10) << micros(step.latency.percentile(0.5))
+              << std::setw(10) << micros(step.latency.percentile(0.99))
+              << std::setw(11) << micros(step.latency.percentile(0.999))
+              << std::setw(11) << micros(step.latency.max()) << std::setw(17)
+              << micros(step.worstThreadP99());
+    if (options.reload) {
+      std::cout << std::setw(9) << step.reloads;
+    }
+    std::cout << "\n";
+  }
+}
+
+void writeJson(const std::vector<Step>& steps, const Options& options,
+               size_t lanes, std::ostream& out) {
+  out << std::setprecision(9);
+  out << "{\n"
+      << "  \"map\": \"" << options.mapFile << "\",\n"
+      << "  \"lanes\": " << lanes << ",\n"
+      << "  \"seconds_per_step\": " << options.seconds << ",\n"
+      << "  \"reload\": " << (options.reload ? "true" : "false") << ",\n"
+      << "  \"steps\": [";
+  for (size_t i = 0; i < steps.size(); ++i) {
+    const auto& step{steps[i]};
+    out << (i == 0 ? "\n" : ",\n") << "    {\"threads\": " << step.threads
+        << ", \"queries\": " << step.queries()
+        << ", \"queries_per_second\": " << step.throughput()
+        << ", \"p50_ns\": " << step.latency.percentile(0.5)
+        << ", \"p99_ns\": " << step.latency.percentile(0.99)
+        << ", \"p999_ns\": " << step.latency.percentile(0.999)
+        << ", \"max_ns\": " << step.latency.max()
+        << ", \"reloads\": " << step.reloads << ", \"thread_p99_ns\": [";
+    for (size_t t = 0; t < step.readers.size(); ++t) {
+      out << (t == 0 ? "" : ", ") << step.readers[t].latency.percentile(0.99);
+    }
+    out << "]}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  bool generated{false};
+  if (options.mapFile.empty()) {
+    options.mapFile = (std::filesystem::temp_directory_path() /
+                       ("hdmap_concurrency_benchmark_" +
+                        std::to_string(options.city.laneCount) + ".osm"))
+                          .string();
+    hdmap::CityGenerator generator{options.city};
+    if (!generator.writeOsm(options.mapFile)) {
+      std::cerr << generator.getLastError() << "\n";
+      return 1;
+    }
+    generated = true;
+  }
+
+  auto server{std::make_shared<hdmap::MapServer>(unlimited())};
+  if (!server->loadFromFile(options.mapFile)) {
+    std::cerr << "Failed to load " << options.mapFile << "\n";
+    if (generated) {
+      std::filesystem::remove(options.mapFile);
+    }
+    return 1;
+  }
+  const auto drives{synthesizeDrives(*server, options)};
+  // Every reader replays its own drive, so none may be left empty
+  if (std::any_of(drives.begin(), drives.end(),
+                  [](const hdmap::DriveTrace& drive) {
+                    return drive.queries().empty();
+                  })) {
+    std::cerr << "No queries of the selected types in some drives\n";
+    if (generated) {
+      std::filesystem::remove(options.mapFile);
+    }
+    return 1;
+  }
+
+  std::cout << "Map: " << options.mapFile << " (" << server->getLaneCount()
+            << " lanes), " << options.seconds << " s per step"
+            << (options.reload ? ", reloading concurrently" : "") << "\n\n";
+  std::vector<Step> steps;
+  for (const size_t threads : threadCounts(options.maxThreads)) {
+    steps.push_back(runStep(threads, options, server, drives));
+  }
+  if (generated) {
+    std::filesystem::remove(options.mapFile);
+  }
+
+  printReport(steps, options);
+  if (!options.jsonFile.empty()) {
+    std::ofstream json{options.jsonFile};
+    writeJson(steps, options, server->getLaneCount(), json);
+    if (!json) {
+      std::cerr << "Cannot write " << options.jsonFile << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
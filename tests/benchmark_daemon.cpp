@@ -0,0 +1,204 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/query_client.hpp"
+#include "include/query_daemon.hpp"
+
+// Round-trip cost of the query daemon. A client sends closest-lane queries
+// in batches of 1, 4, 16, ... up to --max-batch and reports the time per
+// query next to the same query answered in process; the difference is the
+// IPC overhead the batching amortizes.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string mapFile;  // generated when empty
+  hdmap::CityConfig city;
+  size_t workers{2};
+  size_t maxBatch{256};
+  double seconds{1.0};
+};
+
+hdmap::MemoryConstraints unlimited() {
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = SIZE_MAX;
+  constraints.maxLanes = SIZE_MAX;
+  constraints.maxTrafficLights = SIZE_MAX;
+  constraints.maxTrafficSigns = SIZE_MAX;
+  return constraints;
+}
+
+void printUsage(const char* program) {
+  std::cout << "Usage: " << program << " [map.osm] [options]\n"
+            << "  --lanes N       lanes of the generated city (default 5000)\n"
+            << "  --workers N     daemon worker threads (default 2)\n"
+            << "  --max-batch N   largest batch (default 256)\n"
+            << "  --seconds S     run time per batch size (default 1)\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  options.city.laneCount = 5000;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg.rfind("--", 0) != 0) {
+      options.mapFile = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const std::string value{argv[++i]};
+    if (arg == "--lanes") {
+      options.city.laneCount = std::stoull(value);
+    } else if (arg == "--workers") {
+      options.workers = std::max<size_t>(1, std::stoull(value));
+    } else if (arg == "--max-batch") {
+      options.maxBatch = std::max<size_t>(1, std::stoull(value));
+    } else if (arg == "--seconds") {
+      options.seconds = std::stod(value);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Positions spread over the map so the R-tree is not answered from cache
+std::vector<hdmap::Point2D> samplePositions(const hdmap::MapServer& server,
+                                            size_t count) {
+  std::vector<hdmap::Point2D> positions;
+  for (const auto& [id, lane] : server.getLanes()) {
+    if (positions.size() == count) {
+      break;
+    }
+    positions.push_back(lane->centerlinePoints().front());
+  }
+  return positions;
+}
+
+double nanosecondsPerQuery(Clock::duration elapsed, size_t queries) {
+  return queries > 0
+             ? std::chrono::duration<double, std::nano>(elapsed).count() /
+                   queries
+             : 0.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  bool generated{false};
+  if (options.mapFile.empty()) {
+    options.mapFile = (std::filesystem::temp_directory_path() /
+                       ("hdmap_daemon_benchmark_" +
+                        std::to_string(options.city.laneCount) + ".osm"))
+                          .string();
+    hdmap::CityGenerator generator{options.city};
+    if (!generator.writeOsm(options.mapFile)) {
+      std::cerr << generator.getLastError() << "\n";
+      return 1;
+    }
+    generated = true;
+  }
+  auto server{std::make_shared<hdmap::MapServer>(unlimited())};
+  const bool loaded{server->loadFromFile(options.mapFile)};
+  if (generated) {
+    std::filesystem::remove(options.mapFile);
+  }
+  if (!loaded) {
+    std::cerr << "Failed to load " << options.mapFile << "\n";
+    return 1;
+  }
+
+  hdmap::DaemonConfig config;
+  config.socketPath = (std::filesystem::temp_directory_path() /
+                       ("hdmap_daemon_benchmark_" +
+                        std::to_string(getpid()) + ".sock"))
+                          .string();
+  config.workerThreads = options.workers;
+  hdmap::QueryDaemon daemon{server, config};
+  hdmap::QueryClient client;
+  if (!daemon.start()) {
+    std::cerr << daemon.getLastError() << "\n";
+    return 1;
+  }
+  if (!client.connect(config.socketPath)) {
+    std::cerr << client.getLastError() << "\n";
+    return 1;
+  }
+
+  const auto positions{samplePositions(*server, 4096)};
+  size_t next{0};
+  const auto nextPosition = [&]() -> const hdmap::Point2D& {
+    next = next + 1 == positions.size() ? 0 : next + 1;
+    return positions[next];
+  };
+
+  // In-process baseline
+  size_t direct{0};
+  volatile size_t found{0};
+  const auto directStart{Clock::now()};
+  const auto directEnd{directStart +
+                       std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(options.seconds))};
+  while (Clock::now() < directEnd) {
+    for (int i = 0; i < 64; ++i) {
+      found += server->getClosestLane(nextPosition()).has_value();
+    }
+    direct += 64;
+  }
+  const double directNs{
+      nanosecondsPerQuery(Clock::now() - directStart, direct)};
+
+  std::cout << "Map: " << server->getLaneCount() << " lanes, "
+            << options.workers << " daemon workers, " << options.seconds
+            << " s per batch size\n\n"
+            << std::left << std::setw(8) << "batch" << std::right
+            << std::setw(14) << "queries/s" << std::setw(12) << "ns/query"
+            << std::setw(14) << "overhead ns" << "\n"
+            << std::fixed << std::setprecision(0) << std::left << std::setw(8)
+            << "direct" << std::right << std::setw(14) << 1e9 / directNs
+            << std::setw(12) << directNs << std::setw(14) << 0.0 << "\n";
+
+  std::vector<hdmap::QueryRequest> requests;
+  std::vector<hdmap::QueryReply> replies;
+  for (size_t batch = 1; batch <= options.maxBatch; batch *= 4) {
+    size_t queries{0};
+    const auto start{Clock::now()};
+    const auto end{start + std::chrono::duration_cast<Clock::duration>(
+                               std::chrono::duration<double>(options.seconds))};
+    while (Clock::now() < end) {
+      requests.clear();
+      for (size_t i = 0; i < batch; ++i) {
+        requests.push_back(hdmap::QueryRequest::closestLane(nextPosition()));
+      }
+      if (!client.execute(requests, replies)) {
+        std::cerr << client.getLastError() << "\n";
+        return 1;
+      }
+      queries += batch;
+    }
+    const double ns{nanosecondsPerQuery(Clock::now() - start, queries)};
+    std::cout << std::left << std::setw(8) << batch << std::right
+              << std::setw(14) << 1e9 / ns << std::setw(12) << ns
+              << std::setw(14) << ns - directNs << "\n";
+  }
+  return 0;
+}
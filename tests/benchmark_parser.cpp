@@ -0,0 +1,402 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "include/load_stats.hpp"
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/perf_counters.hpp"
+
+// In-process map load benchmark. Loads one map repeatedly and reports the
+// median time of every load stage (read, node decode, way resolve,
+// relations, index build, constraint checks, ...) as MB/s and elements/s,
+// plus heap allocations per load and peak RSS. Without a map file a grid
+// city is generated first. --perf adds perf_event_open counters per load
+// and --json writes the same numbers for regression tracking.
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocatedBytes{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+constexpr double kBytesPerMegabyte = 1e6;
+
+struct Options {
+  std::string mapFile;  // generated when empty
+  hdmap::CityConfig city;
+  size_t repetitions{5};
+  bool perf{false};
+  std::string jsonFile;
+};
+
+double medianOf(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values.empty() ? 0.0 : values[values.size() / 2];
+}
+
+// One stage over all repetitions
+struct StageSummary {
+  std::string name;
+  std::vector<double> seconds;
+  size_t bytes{0};
+  size_t elements{0};
+  int64_t trackedBytes{0};
+
+  double median() const {
+    return medianOf(seconds);
+  }
+};
+
+struct Report {
+  std::string mapFile;
+  size_t fileBytes{0};
+  size_t repetitions{0};
+  size_t lanes{0};
+  size_t trafficLights{0};
+  size_t trafficSigns{0};
+  std::vector<double> totalSeconds;
+  std::vector<StageSummary> stages;
+  size_t allocationsPerLoad{0};
+  size_t allocatedBytesPerLoad{0};
+  size_t trackedBytes{0};
+  size_t parserScratchPeak{0};
+  size_t peakRssKilobytes{0};
+  hdmap::PerfSample perfPerLoad;  // mean over repetitions, with --perf
+};
+
+double rate(double amount, double seconds) {
+  return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+void printUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [map.osm] [options]\n"
+      << "  --lanes N          lanes of the generated city (default 100000)\n"
+      << "  --layout grid|radial\n"
+      << "  --repetitions N    loads to take the median over (default 5)\n"
+      << "  --perf             count cycles, instructions, cache and branch "
+         "misses per load\n"
+      << "  --json FILE        also write the report as JSON\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  options.city.laneCount = 100000;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    if (arg == "--perf") {
+      options.perf = true;
+      continue;
+    }
+    if (arg.rfind("--", 0) != 0) {
+      options.mapFile = arg;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const std::string value{argv[++i]};
+    if (arg == "--lanes") {
+      options.city.laneCount = std::stoull(value);
+    } else if (arg == "--layout" && (value == "grid" || value == "radial")) {
+      options.city.layout = value == "grid" ? hdmap::CityLayout::GRID
+                                            : hdmap::CityLayout::RADIAL;
+    } else if (arg == "--repetitions") {
+      options.repetitions = std::max<size_t>(1, std::stoull(value));
+    } else if (arg == "--json") {
+      options.jsonFile = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t peakRssKilobytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return static_cast<size_t>(usage.ru_maxrss);  // kilobytes on Linux
+}
+
+void addStages(const hdmap::LoadStats& stats, Report& report) {
+  for (const auto& stage : stats.stages) {
+    auto it = std::find_if(
+        report.stages.begin(), report.stages.end(),
+        [&stage](const StageSummary& s) { return s.name == stage.name; });
+    if (it == report.stages.end()) {
+      report.stages.push_back(StageSummary{});
+      it = std::prev(report.stages.end());
+      it->name = stage.name;
+      it->bytes = stage.bytes;
+      it->elements = stage.elements;
+      it->trackedBytes = stage.trackedBytes;
+    }
+    it->seconds.push_back(stage.seconds);
+  }
+}
+
+bool run(const Options& options, Report& report) {
+  // Lift the limits: the benchmark measures loading, not rejection
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = SIZE_MAX;
+  constraints.maxLanes = SIZE_MAX;
+  constraints.maxTrafficLights = SIZE_MAX;
+  constraints.maxTrafficSigns = SIZE_MAX;
+
+  report.mapFile = options.mapFile;
+  report.repetitions = options.repetitions;
+  hdmap::PerfCounters perf;
+  if (options.perf && !perf.available()) {
+    std::cerr << "No performance counters: " << perf.getLastError() << "\n";
+  }
+  for (size_t i = 0; i < options.repetitions; ++i) {
+    // A fresh server each time so no load reuses the previous one's memory
+    hdmap::MapServer server{constraints};
+    const size_t allocationsBefore{allocationCount.load()};
+    const size_t bytesBefore{allocatedBytes.load()};
+    if (options.perf) {
+      perf.start();
+    }
+    const bool loaded{server.loadFromFile(options.mapFile)};
+    perf.stop();
+    if (!loaded) {
+      return false;
+    }
+    const size_t allocations{allocationCount.load() - allocationsBefore};
+    const size_t bytes{allocatedBytes.load() - bytesBefore};
+
+    const auto& stats{server.getLastLoadStats()};
+    addStages(stats, report);
+    report.totalSeconds.push_back(stats.totalSeconds());
+    if (i == 0) {
+      report.fileBytes = stats.fileBytes;
+      report.lanes = server.getLaneCount();
+      report.trafficLights = server.getTrafficLightCount();
+      report.trafficSigns = server.getTrafficSignCount();
+      report.allocationsPerLoad = allocations;
+      report.allocatedBytesPerLoad = bytes;
+      const auto memory{server.getMemoryBreakdown()};
+      report.trackedBytes = memory.total();
+      report.parserScratchPeak = memory.parserScratchPeak;
+    }
+  }
+  if (options.perf) {
+    report.perfPerLoad = perf.read();
+    for (auto& value : report.perfPerLoad.values) {
+      value /= options.repetitions;
+    }
+  }
+  report.peakRssKilobytes = peakRssKilobytes();
+  return true;
+}
+
+void printReport(const Report& report) {
+  const double total{medianOf(report.totalSeconds)};
+  std::cout << "Map: " << report.mapFile << " ("
+            << report.fileBytes / kBytesPerMegabyte << " MB, " << report.lanes
+            << " lanes, " << report.trafficLights << " lights, "
+            << report.trafficSigns << " signs)\n"
+            << "Median of " << report.repetitions << " loads: " << total
+            << " s, " << rate(report.fileBytes / kBytesPerMegabyte, total)
+            << " MB/s\n\n";
+
+  std::cout << std::left << std::setw(24) << "stage" << std::right
+            << std::setw(12) << "ms" << std::setw(8) << "%" << std::setw(12)
+            << "MB/s" << std::setw(14) << "elements/s" << std::setw(14)
+            << "tracked KB" << "\n";
+  std::cout << std::fixed;
+  for (const auto& stage : report.stages) {
+    const double seconds{stage.median()};
+    std::cout << std::left << std::setw(24) << stage.name << std::right
+              << std::setprecision(3) << std::setw(12) << seconds * 1e3
+              << std::setprecision(1) << std::setw(8)
+              << rate(100.0 * seconds, total) << std::setw(12);
+    if (stage.bytes > 0) {
+      std::cout << rate(stage.bytes / kBytesPerMegabyte, seconds);
+    } else {
+      std::cout << "-";
+    }
+    std::cout << std::setw(14);
+    if (stage.elements > 0) {
+      std::cout << std::setprecision(0) << rate(stage.elements, seconds);
+    } else {
+      std::cout << "-";
+    }
+    std::cout << std::setprecision(1) << std::setw(14)
+              << stage.trackedBytes / 1024.0 << "\n";
+  }
+  std::cout << "\nAllocations per load: "
+            << report.allocationsPerLoad << " ("
+            << report.allocatedBytesPerLoad / kBytesPerMegabyte << " MB)\n"
+            << "Tracked map memory: " << report.trackedBytes / 1024.0
+            << " KB, parser scratch peak: "
+            << report.parserScratchPeak / 1024.0 << " KB\n"
+            << "Peak RSS: " << report.peakRssKilobytes << " KB\n";
+
+  const auto& perf{report.perfPerLoad};
+  for (size_t i = 0; i < hdmap::kPerfEventCount; ++i) {
+    const auto event{static_cast<hdmap::PerfEvent>(i)};
+    if (perf.has(event)) {
+      std::cout << "Per load " << hdmap::perfEventName(event) << ": "
+                << std::setprecision(0) << static_cast<double>(perf[event])
+                << std::setprecision(1) << " ("
+                << rate(static_cast<double>(perf[event]), report.lanes)
+                << " per lane)\n";
+    }
+  }
+  if (perf.has(hdmap::PerfEvent::CYCLES) &&
+      perf[hdmap::PerfEvent::CYCLES] > 0) {
+    std::cout << "IPC: " << std::setprecision(2)
+              << static_cast<double>(perf[hdmap::PerfEvent::INSTRUCTIONS]) /
+                     perf[hdmap::PerfEvent::CYCLES]
+              << "\n";
+  }
+}
+
+std::string jsonEscape(const std::string& text) {
+  std::string escaped;
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void writeJson(const Report& report, std::ostream& out) {
+  const double total{medianOf(report.totalSeconds)};
+  out << std::setprecision(9);
+  out << "{\n"
+      << "  \"map\": \"" << jsonEscape(report.mapFile) << "\",\n"
+      << "  \"file_bytes\": " << report.fileBytes << ",\n"
+      << "  \"repetitions\": " << report.repetitions << ",\n"
+      << "  \"lanes\": " << report.lanes << ",\n"
+      << "  \"traffic_lights\": " << report.trafficLights << ",\n"
+      << "  \"traffic_signs\": " << report.trafficSigns << ",\n"
+      << "  \"total_seconds\": " << total << ",\n"
+      << "  \"mb_per_second\": "
+      << rate(report.fileBytes / kBytesPerMegabyte, total) << ",\n"
+      << "  \"allocations_per_load\": " << report.allocationsPerLoad << ",\n"
+      << "  \"allocated_bytes_per_load\": " << report.allocatedBytesPerLoad
+      << ",\n"
+      << "  \"tracked_bytes\": " << report.trackedBytes << ",\n"
+      << "  \"parser_scratch_peak_bytes\": " << report.parserScratchPeak
+      << ",\n"
+      << "  \"peak_rss_kb\": " << report.peakRssKilobytes << ",\n"
+      << "  \"perf_per_load\": {";
+  bool firstEvent{true};
+  for (size_t i = 0; i < hdmap::kPerfEventCount; ++i) {
+    const auto event{static_cast<hdmap::PerfEvent>(i)};
+    if (report.perfPerLoad.has(event)) {
+      out << (firstEvent ? "" : ", ") << "\"" << hdmap::perfEventName(event)
+          << "\": " << report.perfPerLoad[event];
+      firstEvent = false;
+    }
+  }
+  out << "},\n"
+      << "  \"stages\": [";
+  for (size_t i = 0; i < report.stages.size(); ++i) {
+    const auto& stage{report.stages[i]};
+    const double seconds{stage.median()};
+    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+        << jsonEscape(stage.name) << "\", \"seconds\": " << seconds
+        << ", \"bytes\": " << stage.bytes
+        << ", \"mb_per_second\": "
+        << rate(stage.bytes / kBytesPerMegabyte, seconds)
+        << ", \"elements\": " << stage.elements
+        << ", \"elements_per_second\": " << rate(stage.elements, seconds)
+        << ", \"tracked_bytes\": " << stage.trackedBytes << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  bool generated{false};
+  if (options.mapFile.empty()) {
+    options.mapFile = (std::filesystem::temp_directory_path() /
+                       ("hdmap_parser_benchmark_" +
+                        std::to_string(options.city.laneCount) + ".osm"))
+                          .string();
+    hdmap::CityGenerator generator{options.city};
+    if (!generator.writeOsm(options.mapFile)) {
+      std::cerr << generator.getLastError() << "\n";
+      return 1;
+    }
+    generated = true;
+  }
+
+  Report report;
+  const bool ok{run(options, report)};
+  if (generated) {
+    std::filesystem::remove(options.mapFile);
+  }
+  if (!ok) {
+    std::cerr << "Failed to load " << options.mapFile << "\n";
+    return 1;
+  }
+
+  printReport(report);
+  if (!options.jsonFile.empty()) {
+    std::ofstream json{options.jsonFile};
+    writeJson(report, json);
+    if (!json) {
+      std::cerr << "Cannot write " << options.jsonFile << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,340 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/perf_counters.hpp"
+#include "include/point_index.hpp"
+#include "include/rtree.hpp"
+
+// Query micro-benchmarks over synthetic grid cities (see CityGenerator).
+// Every benchmark runs on small/medium/large maps (Arg = lane count) and
+// reports ns/op, items/s and heap allocations per iteration (allocs/op).
+// With --perf_counters it also reports perf_event_open counters per
+// iteration (cycles/op, instructions/op, IPC, cache and branch misses).
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+constexpr double kLightDensity = 0.25;    // chance of a light per lane end
+constexpr size_t kQueryPoints = 4096;     // precomputed query positions
+constexpr uint32_t kSeed = 42;
+
+// Heap allocations made while alive, reported per benchmark iteration
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_{allocationCount.load()} {
+  }
+
+  void report(benchmark::State& state) const {
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(allocationCount.load() - start_),
+        benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  size_t start_;
+};
+
+// Set by --perf_counters
+bool perfCountersEnabled{false};
+
+// Counters of this thread from construction to report(), per iteration
+class PerfCounterScope {
+ public:
+  PerfCounterScope() {
+    if (perfCountersEnabled) {
+      counters().reset();
+      counters().start();
+    }
+  }
+
+  void report(benchmark::State& state) const {
+    if (!perfCountersEnabled) {
+      return;
+    }
+    counters().stop();
+    const auto sample{counters().read()};
+    for (size_t i = 0; i < hdmap::kPerfEventCount; ++i) {
+      const auto event{static_cast<hdmap::PerfEvent>(i)};
+      if (sample.has(event)) {
+        state.counters[std::string{hdmap::perfEventName(event)} + "/op"] =
+            benchmark::Counter(static_cast<double>(sample[event]),
+                               benchmark::Counter::kAvgIterations);
+      }
+    }
+    if (sample.has(hdmap::PerfEvent::CYCLES) &&
+        sample[hdmap::PerfEvent::CYCLES] > 0) {
+      state.counters["IPC"] =
+          static_cast<double>(sample[hdmap::PerfEvent::INSTRUCTIONS]) /
+          sample[hdmap::PerfEvent::CYCLES];
+    }
+  }
+
+  // Opened once; benchmarks run on the main thread
+  static hdmap::PerfCounters& counters() {
+    static hdmap::PerfCounters instance;
+    return instance;
+  }
+};
+
+struct SyntheticMap {
+  std::shared_ptr<hdmap::MapServer> server;
+  std::vector<uint64_t> laneIds;
+  std::vector<hdmap::Point2D> queryPoints;
+  hdmap::BoundingBox bounds;
+};
+
+// Built once per size and shared by all benchmarks
+const SyntheticMap& syntheticMap(size_t laneCount) {
+  static std::map<size_t, SyntheticMap> maps;
+  auto it = maps.find(laneCount);
+  if (it != maps.end()) {
+    return it->second;
+  }
+
+  SyntheticMap map;
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = size_t{4} << 30;
+  constraints.maxLanes = laneCount;
+  constraints.maxTrafficLights = laneCount;
+  constraints.maxTrafficSigns = laneCount;
+  map.server = std::make_shared<hdmap::MapServer>(constraints);
+
+  // Grid city with a light at the end of roughly every fourth lane
+  hdmap::CityConfig city;
+  city.laneCount = laneCount;
+  city.trafficLightDensity = kLightDensity;
+  city.seed = kSeed;
+  hdmap::CityGenerator generator{city};
+  const std::string path{(std::filesystem::temp_directory_path() /
+                          ("hdmap_benchmark_" + std::to_string(laneCount) +
+                           ".osm"))
+                             .string()};
+  if (!generator.writeOsm(path) || !map.server->loadFromFile(path)) {
+    std::abort();
+  }
+  std::filesystem::remove(path);
+  map.bounds = generator.stats().bounds;
+
+  for (const auto& [id, lane] : map.server->getLanes()) {
+    map.laneIds.push_back(id);
+  }
+  std::sort(map.laneIds.begin(), map.laneIds.end());
+
+  map.server->setPointIndexType(hdmap::PointIndexType::GRID);
+
+  std::mt19937 random{kSeed};
+  std::uniform_real_distribution<double> x{map.bounds.min.x, map.bounds.max.x};
+  std::uniform_real_distribution<double> y{map.bounds.min.y, map.bounds.max.y};
+  map.queryPoints.reserve(kQueryPoints);
+  for (size_t i = 0; i < kQueryPoints; ++i) {
+    map.queryPoints.emplace_back(x(random), y(random));
+  }
+
+  return maps.emplace(laneCount, std::move(map)).first->second;
+}
+
+void mapSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("lanes")->Arg(1000)->Arg(10000)->Arg(100000);
+}
+
+void BM_QueryRegion(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  constexpr double kHalfSize = 100.0;
+  size_t i = 0;
+  size_t found = 0;
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    const auto& p{map.queryPoints[i++ % map.queryPoints.size()]};
+    const hdmap::BoundingBox box{
+        hdmap::Point2D(p.x - kHalfSize, p.y - kHalfSize),
+        hdmap::Point2D(p.x + kHalfSize, p.y + kHalfSize)};
+    auto result{map.server->queryRegion(box)};
+    found += result.totalCount();
+    benchmark::DoNotOptimize(result);
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["results/op"] = benchmark::Counter(
+      static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_QueryRegion)->Apply(mapSizes);
+
+void BM_QueryRadius(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  constexpr double kRadius = 50.0;
+  size_t i = 0;
+  size_t found = 0;
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    auto result{map.server->queryRadius(
+        map.queryPoints[i++ % map.queryPoints.size()], kRadius)};
+    found += result.totalCount();
+    benchmark::DoNotOptimize(result);
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["results/op"] = benchmark::Counter(
+      static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_QueryRadius)->Apply(mapSizes);
+
+void BM_GetClosestLane(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  size_t i = 0;
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    auto lane{map.server->getClosestLane(
+        map.queryPoints[i++ % map.queryPoints.size()])};
+    benchmark::DoNotOptimize(lane);
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_GetClosestLane)->Apply(mapSizes);
+
+void BM_GetTrafficLightsForLane(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  size_t i = 0;
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    auto lights{map.server->getTrafficLightsForLane(
+        map.laneIds[(i++ * 7919) % map.laneIds.size()])};
+    benchmark::DoNotOptimize(lights);
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_GetTrafficLightsForLane)->Apply(mapSizes);
+
+// One item is one inserted lane; the tree grows to the full map each
+// iteration
+void BM_RTreeInsert(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  std::vector<std::shared_ptr<hdmap::Lane>> lanes;
+  for (const auto id : map.laneIds) {
+    lanes.push_back(map.server->getLanes().at(id));
+  }
+
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    hdmap::RTree tree;
+    for (const auto& lane : lanes) {
+      tree.insert(lane->bbox, lane);
+    }
+    benchmark::DoNotOptimize(tree.size());
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * lanes.size()));
+}
+BENCHMARK(BM_RTreeInsert)->Apply(mapSizes)->Unit(benchmark::kMillisecond);
+
+// Point index over all traffic lights, grid and R-tree backing
+void BM_PointIndexBuild(benchmark::State& state) {
+  const auto& map{syntheticMap(static_cast<size_t>(state.range(0)))};
+  const auto type{static_cast<hdmap::PointIndexType>(state.range(1))};
+  const auto& lights{map.server->getTrafficLights()};
+
+  const AllocationCounter allocations;
+  const PerfCounterScope perf;
+  for (auto _ : state) {
+    hdmap::PointIndex<hdmap::TrafficLight> index{type};
+    index.build(lights);
+    benchmark::DoNotOptimize(index.size());
+  }
+  perf.report(state);
+  allocations.report(state);
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * lights.size()));
+}
+// type: 0 = R-tree, 1 = grid
+BENCHMARK(BM_PointIndexBuild)
+    ->ArgNames({"lanes", "type"})
+    ->ArgsProduct({{1000, 10000, 100000},
+                   {static_cast<int64_t>(hdmap::PointIndexType::GRID),
+                    static_cast<int64_t>(hdmap::PointIndexType::RTREE)}})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+// BENCHMARK_MAIN plus --perf_counters, removed before Google Benchmark
+// parses the remaining flags
+int main(int argc, char** argv) {
+  int kept{1};
+  for (int i = 1; i < argc; ++i) {
+    if (std::string{argv[i]} == "--perf_counters") {
+      perfCountersEnabled = true;
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+  if (perfCountersEnabled && !PerfCounterScope::counters().available()) {
+    std::cerr << "No performance counters: "
+              << PerfCounterScope::counters().getLastError() << "\n";
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/contraction_hierarchy.hpp"
+
+namespace {
+
+using hdmap::LaneMap;
+
+// Grid of one-way lanes running east and north, plus a few random lane
+// changes, so there are many equal-length alternatives
+LaneMap makeGrid(int size) {
+  LaneMap lanes;
+  const auto idOf = [size](int x, int y, int dir) {
+    return static_cast<uint64_t>((y * size + x) * 2 + dir + 1);
+  };
+
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      for (int dir = 0; dir < 2; ++dir) {
+        auto lane{std::make_shared<hdmap::Lane>()};
+        lane->id = idOf(x, y, dir);
+        lane->speedLimit = 10.0 + (x + y) % 3;
+        const hdmap::Point2D start{x * 100.0, y * 100.0};
+        const hdmap::Point2D end{dir == 0 ? start.x + 100.0 : start.x,
+                                 dir == 0 ? start.y : start.y + 100.0};
+        lane->centerline = {start, end};
+        lanes[lane->id] = lane;
+      }
+    }
+  }
+
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      // East lane ends at (x + 1, y), north lane ends at (x, y + 1)
+      for (int dir = 0; dir < 2; ++dir) {
+        const int nx = dir == 0 ? x + 1 : x;
+        const int ny = dir == 0 ? y : y + 1;
+        if (nx >= size || ny >= size) {
+          continue;
+        }
+        auto& lane{lanes[idOf(x, y, dir)]};
+        lane->successorIds = {idOf(nx, ny, 0), idOf(nx, ny, 1)};
+      }
+    }
+  }
+
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<int> pick{0, size - 1};
+  for (int i = 0; i < size; ++i) {
+    lanes[idOf(pick(rng), pick(rng), 0)]->adjacentLeftIds = {
+        idOf(pick(rng), pick(rng), 1)};
+  }
+  return lanes;
+}
+
+}  // namespace
+
+TEST(ContractionHierarchyTest, MatchesDijkstra) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeGrid(8));
+  hdmap::ContractionHierarchy hierarchy;
+  hierarchy.build(graph);
+  ASSERT_FALSE(hierarchy.empty());
+
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<uint64_t> pick{1, graph.nodeCount()};
+  for (int i = 0; i < 200; ++i) {
+    const uint64_t from{pick(rng)};
+    const uint64_t to{pick(rng)};
+    const auto expected{graph.dijkstra(from, to)};
+    const auto actual{hierarchy.route(graph, from, to)};
+
+    ASSERT_EQ(expected.has_value(), actual.has_value());
+    if (!expected.has_value()) {
+      continue;
+    }
+    EXPECT_NEAR(actual->cost, expected->cost, 1e-9);
+    ASSERT_FALSE(actual->laneIds.empty());
+    EXPECT_EQ(actual->laneIds.front(), from);
+    EXPECT_EQ(actual->laneIds.back(), to);
+
+    // Unpacked route must follow real graph edges
+    for (size_t j = 1; j < actual->laneIds.size(); ++j) {
+      const auto u{*graph.indexOf(actual->laneIds[j - 1])};
+      const auto v{*graph.indexOf(actual->laneIds[j])};
+      bool connected = false;
+      for (auto e = graph.offsets()[u]; e < graph.offsets()[u + 1]; ++e) {
+        connected = connected || graph.targets()[e] == v;
+      }
+      EXPECT_TRUE(connected);
+    }
+  }
+}
+
+TEST(ContractionHierarchyTest, SameLane) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeGrid(3));
+  hdmap::ContractionHierarchy hierarchy;
+  hierarchy.build(graph);
+
+  const auto route{hierarchy.route(graph, 1, 1)};
+  ASSERT_TRUE(route.has_value());
+  EXPECT_EQ(route->laneIds.size(), 1);
+  EXPECT_FALSE(hierarchy.route(graph, 1, 99999).has_value());
+}
+
+TEST(ContractionHierarchyTest, SaveAndLoad) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeGrid(5));
+  hdmap::ContractionHierarchy hierarchy;
+  hierarchy.build(graph);
+
+  const std::string path{"/tmp/test_routing.ch"};
+  ASSERT_TRUE(hierarchy.save(path));
+
+  hdmap::ContractionHierarchy loaded;
+  ASSERT_TRUE(loaded.load(path, graph));
+  EXPECT_EQ(loaded.shortcutCount(), hierarchy.shortcutCount());
+
+  const auto expected{hierarchy.route(graph, 1, 40)};
+  const auto actual{loaded.route(graph, 1, 40)};
+  ASSERT_TRUE(expected.has_value());
+  ASSERT_TRUE(actual.has_value());
+  EXPECT_EQ(actual->laneIds, expected->laneIds);
+
+  // A hierarchy from another graph is rejected
+  hdmap::RoutingGraph other;
+  other.build(makeGrid(4));
+  EXPECT_FALSE(loaded.load(path, other));
+  EXPECT_TRUE(loaded.empty());
+
+  std::remove(path.c_str());
+}
+
+TEST(ContractionHierarchyTest, RejectsCorruptFiles) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeGrid(4));
+  hdmap::ContractionHierarchy hierarchy;
+  hierarchy.build(graph);
+  const std::string path{"/tmp/test_routing_corrupt.ch"};
+  ASSERT_TRUE(hierarchy.save(path));
+  std::string original;
+  {
+    std::ifstream file{path, std::ios::binary};
+    original.assign(std::istreambuf_iterator<char>{file}, {});
+  }
+
+  // Header: magic, version, fingerprint, shortcut count; then the rank,
+  // up offsets and up edges arrays, each after its count
+  const size_t nodes{graph.nodeCount()};
+  const size_t rankCount{4 + 4 + 8 + 8};
+  const size_t upOffsets{rankCount + 8 + 4 * nodes + 8};
+  const size_t upEdges{upOffsets + 4 * (nodes + 1) + 8};
+  const auto loadPatched = [&](size_t offset, auto value) {
+    std::string bytes{original};
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+    std::ofstream{path, std::ios::binary} << bytes;
+    hdmap::ContractionHierarchy loaded;
+    const bool ok{loaded.load(path, graph)};
+    EXPECT_EQ(ok, !loaded.empty());
+    return ok;
+  };
+
+  EXPECT_TRUE(loadPatched(0, uint32_t{0x48434448}));
+  // Count larger than the file
+  EXPECT_FALSE(loadPatched(rankCount, uint64_t{1} << 60));
+  // Offsets that decrease or overshoot the edges
+  EXPECT_FALSE(loadPatched(upOffsets + 4, uint32_t{1} << 30));
+  // Edge target outside the graph
+  EXPECT_FALSE(loadPatched(upEdges, static_cast<uint32_t>(nodes)));
+
+  // Ranks that are not a permutation
+  uint32_t firstRank{0};
+  std::memcpy(&firstRank, &original[rankCount + 8], sizeof(firstRank));
+  EXPECT_FALSE(loadPatched(rankCount + 8 + 4, firstRank));
+
+  // A shortcut whose middle is the top-ranked lane would unpack forever
+  std::vector<uint32_t> rank(nodes);
+  std::memcpy(rank.data(), &original[rankCount + 8], 4 * nodes);
+  const auto top{static_cast<uint32_t>(
+      std::max_element(rank.begin(), rank.end()) - rank.begin())};
+  uint64_t upEdgeCount{0};
+  std::memcpy(&upEdgeCount, &original[upEdges - 8], sizeof(upEdgeCount));
+  // Edges are {target, middle, cost}, 16 bytes each
+  bool patchedShortcut{false};
+  for (size_t e = 0; e < upEdgeCount && !patchedShortcut; ++e) {
+    uint32_t middle{0};
+    std::memcpy(&middle, &original[upEdges + 16 * e + 4], sizeof(middle));
+    if (middle != std::numeric_limits<uint32_t>::max()) {
+      EXPECT_FALSE(loadPatched(upEdges + 16 * e + 4, top));
+      patchedShortcut = true;
+    }
+  }
+  EXPECT_TRUE(patchedShortcut);
+
+  std::remove(path.c_str());
+}
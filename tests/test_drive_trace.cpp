@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "include/drive_trace.hpp"
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+
+class DriveTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    hdmap::CityConfig city;
+    city.laneCount = 200;
+    ASSERT_TRUE(hdmap::CityGenerator{city}.writeOsm(mapPath));
+    ASSERT_TRUE(server.loadFromFile(mapPath));
+  }
+
+  void TearDown() override {
+    std::remove(mapPath.c_str());
+    std::remove(tracePath.c_str());
+  }
+
+  std::string mapPath{std::string{"/tmp/test_drive_map_"} +
+                      ::testing::UnitTest::GetInstance()
+                          ->current_test_info()
+                          ->name() +
+                      ".osm"};
+  std::string tracePath{std::string{"/tmp/test_drive_trace_"} +
+                        ::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name() +
+                        ".csv"};
+  hdmap::MapServer server;
+};
+
+TEST_F(DriveTraceTest, SynthesizedDriveStaysOnTheMap) {
+  hdmap::DriveConfig config;
+  config.duration = 30.0;
+  const auto trace{hdmap::DriveTrace::synthesize(server, config)};
+
+  // Five queries per round at 10 Hz
+  ASSERT_EQ(trace.queries().size(), 300 * 5);
+  for (const auto& query : trace.queries()) {
+    if (query.type == hdmap::TraceQueryType::PROJECT) {
+      const auto frenet{server.project(query.laneId, query.point)};
+      ASSERT_TRUE(frenet.has_value());
+      EXPECT_NEAR(frenet->d, 0.0, 1e-6);
+    }
+  }
+
+  // Deterministic for a seed
+  const auto again{hdmap::DriveTrace::synthesize(server, config)};
+  EXPECT_EQ(again.queries().back().laneId, trace.queries().back().laneId);
+}
+
+TEST_F(DriveTraceTest, CsvRoundTrip) {
+  hdmap::DriveTrace trace;
+  hdmap::TraceQuery query;
+  query.timestamp = 0.5;
+  query.type = hdmap::TraceQueryType::REGION;
+  query.region = hdmap::BoundingBox{hdmap::Point2D(1, 2), hdmap::Point2D(3, 4)};
+  trace.queries().push_back(query);
+  query.type = hdmap::TraceQueryType::PROJECT;
+  query.laneId = 7;
+  query.point = hdmap::Point2D(10.25, -3.5);
+  trace.queries().push_back(query);
+  query.type = hdmap::TraceQueryType::NEARBY_LANES;
+  query.radius = 25.0;
+  trace.queries().push_back(query);
+  ASSERT_TRUE(trace.save(tracePath));
+
+  hdmap::DriveTrace loaded;
+  ASSERT_TRUE(loaded.load(tracePath));
+  ASSERT_EQ(loaded.queries().size(), 3);
+  EXPECT_EQ(loaded.queries()[0].type, hdmap::TraceQueryType::REGION);
+  EXPECT_DOUBLE_EQ(loaded.queries()[0].region.max.y, 4.0);
+  EXPECT_EQ(loaded.queries()[1].laneId, 7);
+  EXPECT_DOUBLE_EQ(loaded.queries()[1].point.x, 10.25);
+  EXPECT_DOUBLE_EQ(loaded.queries()[2].radius, 25.0);
+  EXPECT_DOUBLE_EQ(loaded.queries()[2].timestamp, 0.5);
+}
+
+TEST_F(DriveTraceTest, RejectsMalformedLines) {
+  std::ofstream file(tracePath);
+  file << "# comment\n0.0,closest,1,2\n0.1,teleport,1,2\n";
+  file.close();
+
+  hdmap::DriveTrace trace;
+  EXPECT_FALSE(trace.load(tracePath));
+  EXPECT_NE(trace.getLastError().find("line 3"), std::string::npos);
+  EXPECT_TRUE(trace.queries().empty());
+}
+
+TEST_F(DriveTraceTest, ReplayReportsPercentiles) {
+  hdmap::DriveConfig config;
+  config.duration = 10.0;
+  const auto trace{hdmap::DriveTrace::synthesize(server, config)};
+  const auto report{hdmap::TraceReplayer::replay(server, trace)};
+
+  EXPECT_EQ(report.all.count, trace.queries().size());
+  const auto& closest{report[hdmap::TraceQueryType::CLOSEST_LANE]};
+  EXPECT_EQ(closest.count, 100);
+  EXPECT_LE(closest.p50, closest.p99);
+  EXPECT_LE(closest.p99, closest.p999);
+  EXPECT_LE(closest.p999, closest.max);
+  EXPECT_EQ(report[hdmap::TraceQueryType::REGION].count, 0);
+  EXPECT_GT(report.results, 0);
+}
+
+TEST_F(DriveTraceTest, RealTimeReportsQueueingApart) {
+  // Every query is due at once: in real time each one waits for all before
+  // it. That wait shows up as queueing and response time, not as service
+  // time of the type that happened to wait.
+  hdmap::DriveConfig config;
+  config.duration = 10.0;
+  auto trace{hdmap::DriveTrace::synthesize(server, config)};
+  for (auto& query : trace.queries()) {
+    query.timestamp = 0.0;
+  }
+  const auto report{hdmap::TraceReplayer::replay(server, trace, true)};
+
+  ASSERT_EQ(report.all.count, trace.queries().size());
+  ASSERT_EQ(report.queueing.count, trace.queries().size());
+  ASSERT_EQ(report.response.count, trace.queries().size());
+  const double wallNanoseconds{report.wallSeconds * 1e9};
+  EXPECT_GT(static_cast<double>(report.response.max), 0.5 * wallNanoseconds);
+  EXPECT_GT(static_cast<double>(report.queueing.max), 0.5 * wallNanoseconds);
+  EXPECT_LT(static_cast<double>(report.all.max), 0.5 * wallNanoseconds);
+
+  // Back to back there is no schedule to fall behind
+  const auto fast{hdmap::TraceReplayer::replay(server, trace)};
+  EXPECT_EQ(fast.queueing.count, 0);
+  EXPECT_EQ(fast.response.count, 0);
+}
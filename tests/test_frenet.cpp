@@ -0,0 +1,111 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "include/frenet.hpp"
+
+namespace {
+
+// L-shaped centerline: 10 m east, then 10 m north
+std::shared_ptr<hdmap::Lane> makeLane() {
+  auto lane{std::make_shared<hdmap::Lane>()};
+  lane->centerline = {hdmap::Point2D(0, 0), hdmap::Point2D(10, 0),
+                      hdmap::Point2D(10, 10)};
+  return lane;
+}
+
+hdmap::ArcLengthTable makeTable() {
+  return hdmap::ArcLengthTable{makeLane()};
+}
+
+}  // namespace
+
+TEST(ArcLengthTableTest, Length) {
+  const auto table{makeTable()};
+
+  EXPECT_DOUBLE_EQ(table.length(), 20.0);
+  EXPECT_EQ(table.segmentCount(), 2);
+}
+
+TEST(ArcLengthTableTest, ProjectLeftAndRight) {
+  const auto table{makeTable()};
+
+  const auto left{table.project(hdmap::Point2D(4, 2))};
+  EXPECT_DOUBLE_EQ(left.s, 4.0);
+  EXPECT_DOUBLE_EQ(left.d, 2.0);
+  EXPECT_EQ(left.segment, 0);
+
+  const auto right{table.project(hdmap::Point2D(13, 6))};
+  EXPECT_DOUBLE_EQ(right.s, 16.0);
+  EXPECT_DOUBLE_EQ(right.d, -3.0);
+  EXPECT_EQ(right.segment, 1);
+}
+
+TEST(ArcLengthTableTest, ProjectBatchMatchesSingle) {
+  const auto table{makeTable()};
+  const std::vector<hdmap::Point2D> points{
+      hdmap::Point2D(4, 2), hdmap::Point2D(13, 6), hdmap::Point2D(-5, 0),
+      hdmap::Point2D(10, 30)};
+
+  std::vector<hdmap::FrenetPoint> results;
+  table.project(points, results);
+  ASSERT_EQ(results.size(), points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    const auto single{table.project(points[i])};
+    EXPECT_DOUBLE_EQ(results[i].s, single.s);
+    EXPECT_DOUBLE_EQ(results[i].d, single.d);
+  }
+
+  // Beyond the ends s clamps to the centerline extent
+  EXPECT_DOUBLE_EQ(results[2].s, 0.0);
+  EXPECT_DOUBLE_EQ(results[3].s, 20.0);
+}
+
+TEST(ArcLengthTableTest, Interpolate) {
+  const auto table{makeTable()};
+
+  const auto first{table.interpolate(5.0)};
+  EXPECT_DOUBLE_EQ(first.point.x, 5.0);
+  EXPECT_DOUBLE_EQ(first.point.y, 0.0);
+  EXPECT_DOUBLE_EQ(first.heading, 0.0);
+
+  const auto second{table.interpolate(15.0)};
+  EXPECT_DOUBLE_EQ(second.point.x, 10.0);
+  EXPECT_DOUBLE_EQ(second.point.y, 5.0);
+  EXPECT_DOUBLE_EQ(second.heading, M_PI / 2.0);
+
+  const auto clamped{table.interpolate(100.0)};
+  EXPECT_DOUBLE_EQ(clamped.point.y, 10.0);
+}
+
+TEST(ArcLengthTableTest, RoundTrip) {
+  const auto table{makeTable()};
+
+  for (double s = 0.0; s <= 20.0; s += 2.5) {
+    const auto pose{table.interpolate(s)};
+    const auto frenet{table.project(pose.point)};
+    EXPECT_NEAR(frenet.s, s, 1e-9);
+    EXPECT_NEAR(frenet.d, 0.0, 1e-9);
+  }
+}
+
+TEST(ArcLengthTableTest, CompactGeometry) {
+  // Far from the origin, where the lane is stored as tile-relative floats
+  auto lane{std::make_shared<hdmap::Lane>()};
+  lane->centerline = {hdmap::Point2D(5000, 7000), hdmap::Point2D(5010, 7000),
+                      hdmap::Point2D(5010, 7010)};
+  lane->compactGeometry(hdmap::kDefaultTileSize);
+  ASSERT_TRUE(lane->centerline.empty());
+  const hdmap::ArcLengthTable table{lane};
+
+  EXPECT_NEAR(table.length(), 20.0, 1e-4);
+  const auto right{table.project(hdmap::Point2D(5013, 7006))};
+  EXPECT_NEAR(right.s, 16.0, 1e-4);
+  EXPECT_NEAR(right.d, -3.0, 1e-4);
+  EXPECT_EQ(right.segment, 1);
+
+  const auto pose{table.interpolate(15.0)};
+  EXPECT_NEAR(pose.point.x, 5010.0, 1e-4);
+  EXPECT_NEAR(pose.point.y, 7005.0, 1e-4);
+}
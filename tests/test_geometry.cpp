@@ -0,0 +1,124 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "include/geometry.hpp"
+
+TEST(GeometryTest, PointSegmentDistance) {
+  const hdmap::Point2D a{0, 0};
+  const hdmap::Point2D b{10, 0};
+
+  EXPECT_DOUBLE_EQ(hdmap::pointSegmentDistance(hdmap::Point2D(5, 3), a, b),
+                   3.0);
+  EXPECT_DOUBLE_EQ(hdmap::pointSegmentDistance(hdmap::Point2D(13, 4), a, b),
+                   5.0);
+  EXPECT_DOUBLE_EQ(hdmap::pointSegmentDistance(hdmap::Point2D(3, 4), a, a),
+                   5.0);
+}
+
+TEST(GeometryTest, ClosestPointsParallel) {
+  const auto closest{hdmap::closestPoints(
+      hdmap::Point2D(0, 0), hdmap::Point2D(10, 0), hdmap::Point2D(2, 3),
+      hdmap::Point2D(8, 3))};
+
+  EXPECT_DOUBLE_EQ(closest.distance, 3.0);
+}
+
+TEST(GeometryTest, ClosestPointsCrossing) {
+  const auto closest{hdmap::closestPoints(
+      hdmap::Point2D(0, 0), hdmap::Point2D(10, 10), hdmap::Point2D(0, 10),
+      hdmap::Point2D(10, 0))};
+
+  EXPECT_NEAR(closest.distance, 0.0, 1e-12);
+  EXPECT_NEAR(closest.onFirst.x, 5.0, 1e-12);
+  EXPECT_NEAR(closest.onSecond.y, 5.0, 1e-12);
+}
+
+TEST(GeometryTest, SegmentBoxDistance) {
+  const hdmap::BoundingBox box{hdmap::Point2D(0, 0), hdmap::Point2D(10, 10)};
+
+  // Passes straight through without endpoints inside
+  EXPECT_DOUBLE_EQ(hdmap::segmentBoxDistance(hdmap::Point2D(-5, 5),
+                                             hdmap::Point2D(15, 5), box),
+                   0.0);
+  // Runs parallel above the box
+  EXPECT_DOUBLE_EQ(hdmap::segmentBoxDistance(hdmap::Point2D(-5, 12),
+                                             hdmap::Point2D(15, 12), box),
+                   2.0);
+  // Diagonal past a corner
+  EXPECT_NEAR(hdmap::segmentBoxDistance(hdmap::Point2D(12, 10),
+                                        hdmap::Point2D(10, 12), box),
+              std::sqrt(2.0), 1e-12);
+}
+
+TEST(GeometryTest, PolylineBounds) {
+  const auto bounds{hdmap::polylineBounds(
+      {hdmap::Point2D(0, 5), hdmap::Point2D(10, -5)}, 1.0)};
+
+  EXPECT_DOUBLE_EQ(bounds.min.x, -1.0);
+  EXPECT_DOUBLE_EQ(bounds.min.y, -6.0);
+  EXPECT_DOUBLE_EQ(bounds.max.x, 11.0);
+  EXPECT_DOUBLE_EQ(bounds.max.y, 6.0);
+}
+
+TEST(ConvexPolygonTest, ContainsEitherWinding) {
+  const hdmap::ConvexPolygon ccw{{hdmap::Point2D(0, 0), hdmap::Point2D(10, 0),
+                                  hdmap::Point2D(0, 10)}};
+  const hdmap::ConvexPolygon cw{{hdmap::Point2D(0, 0), hdmap::Point2D(0, 10),
+                                 hdmap::Point2D(10, 0)}};
+
+  for (const auto* polygon : {&ccw, &cw}) {
+    EXPECT_TRUE(polygon->contains(hdmap::Point2D(2, 2)));
+    EXPECT_FALSE(polygon->contains(hdmap::Point2D(6, 6)));
+  }
+}
+
+TEST(ConvexPolygonTest, IntersectsBox) {
+  // Diamond centred on the origin
+  const hdmap::ConvexPolygon diamond{{hdmap::Point2D(10, 0),
+                                      hdmap::Point2D(0, 10),
+                                      hdmap::Point2D(-10, 0),
+                                      hdmap::Point2D(0, -10)}};
+
+  // Inside the diamond's AABB but cut off by the diagonal edge
+  EXPECT_FALSE(diamond.intersects(
+      hdmap::BoundingBox(hdmap::Point2D(7, 7), hdmap::Point2D(9, 9))));
+  EXPECT_TRUE(diamond.intersects(
+      hdmap::BoundingBox(hdmap::Point2D(4, 4), hdmap::Point2D(9, 9))));
+  EXPECT_FALSE(diamond.intersects(
+      hdmap::BoundingBox(hdmap::Point2D(20, 20), hdmap::Point2D(30, 30))));
+}
+
+TEST(ConvexPolygonTest, IntersectsSegment) {
+  const hdmap::ConvexPolygon square{{hdmap::Point2D(0, 0),
+                                     hdmap::Point2D(10, 0),
+                                     hdmap::Point2D(10, 10),
+                                     hdmap::Point2D(0, 10)}};
+
+  EXPECT_TRUE(square.intersectsSegment(hdmap::Point2D(-5, 5),
+                                       hdmap::Point2D(15, 5)));
+  // Diagonal that only crosses the bounding boxes
+  EXPECT_FALSE(square.intersectsSegment(hdmap::Point2D(8, 15),
+                                        hdmap::Point2D(15, 8)));
+}
+
+TEST(ConvexPolygonTest, Sector) {
+  // 90 degree field of view looking along +x
+  const auto sector{hdmap::ConvexPolygon::sector(hdmap::Point2D(0, 0), 50.0,
+                                                 0.0, M_PI / 2.0)};
+
+  EXPECT_TRUE(sector.contains(hdmap::Point2D(40, 0)));
+  EXPECT_TRUE(sector.contains(hdmap::Point2D(30, 25)));
+  EXPECT_TRUE(sector.contains(hdmap::Point2D(49.9, 0)));
+  EXPECT_FALSE(sector.contains(hdmap::Point2D(-5, 0)));
+  EXPECT_FALSE(sector.contains(hdmap::Point2D(10, 30)));
+}
+
+TEST(OrientedBoxTest, ToPolygon) {
+  // 20 x 4 box rotated by 45 degrees
+  const hdmap::OrientedBox box{hdmap::Point2D(0, 0), 10.0, 2.0, M_PI / 4.0};
+  const auto polygon{box.toPolygon()};
+
+  EXPECT_TRUE(polygon.contains(hdmap::Point2D(6, 6)));
+  EXPECT_FALSE(polygon.contains(hdmap::Point2D(6, -6)));
+  EXPECT_FALSE(polygon.contains(hdmap::Point2D(8, 8)));
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+
+class MapGeneratorTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    std::remove(firstPath.c_str());
+    std::remove(secondPath.c_str());
+  }
+
+  static std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    return {std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>()};
+  }
+
+  std::string firstPath{std::string{"/tmp/test_city_a_"} +
+                        ::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name() +
+                        ".osm"};
+  std::string secondPath{std::string{"/tmp/test_city_b_"} +
+                         ::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name() +
+                         ".osm"};
+};
+
+TEST_F(MapGeneratorTest, SameSeedSameBytes) {
+  hdmap::CityConfig config;
+  config.laneCount = 200;
+  ASSERT_TRUE(hdmap::CityGenerator{config}.writeOsm(firstPath));
+  ASSERT_TRUE(hdmap::CityGenerator{config}.writeOsm(secondPath));
+  EXPECT_EQ(readFile(firstPath), readFile(secondPath));
+
+  config.seed = 7;
+  ASSERT_TRUE(hdmap::CityGenerator{config}.writeOsm(secondPath));
+  EXPECT_NE(readFile(firstPath), readFile(secondPath));
+}
+
+TEST_F(MapGeneratorTest, LoadsWithExactCounts) {
+  hdmap::CityConfig config;
+  config.laneCount = 250;  // not a whole number of grid streets
+  config.trafficLightDensity = 0.5;
+  config.trafficSignDensity = 0.25;
+  hdmap::CityGenerator generator{config};
+  ASSERT_TRUE(generator.writeOsm(firstPath));
+  const auto& stats{generator.stats()};
+  EXPECT_EQ(stats.lanes, 250);
+  EXPECT_GT(stats.trafficLights, 0);
+  EXPECT_GT(stats.trafficSigns, 0);
+
+  hdmap::MapServer server;
+  ASSERT_TRUE(server.loadFromFile(firstPath));
+  EXPECT_EQ(server.getLaneCount(), stats.lanes);
+  EXPECT_EQ(server.getTrafficLightCount(), stats.trafficLights);
+  EXPECT_EQ(server.getTrafficSignCount(), stats.trafficSigns);
+
+  // Lanes share intersection nodes, so every lane continues somewhere
+  // and every light sits at the end of the lane it controls
+  const auto lane{server.getLaneById(1)};
+  ASSERT_TRUE(lane.has_value());
+  EXPECT_EQ((*lane)->centerlineSize(), config.pointsPerLane);
+  EXPECT_FALSE((*lane)->successorIds.empty());
+  for (const auto& [id, light] : server.getTrafficLights()) {
+    ASSERT_EQ(light->controlledLaneIds.size(), 1);
+    const auto controlled{
+        server.getLaneById(light->controlledLaneIds.front())};
+    ASSERT_TRUE(controlled.has_value());
+    EXPECT_NEAR(
+        (*controlled)->centerlinePoints().back().distanceTo(light->position),
+        0.0, 1e-3);
+  }
+}
+
+TEST_F(MapGeneratorTest, RadialLayout) {
+  hdmap::CityConfig config;
+  config.layout = hdmap::CityLayout::RADIAL;
+  config.laneCount = 300;
+  config.laneLength = 100.0;
+  hdmap::CityGenerator generator{config};
+  ASSERT_TRUE(generator.writeOsm(firstPath));
+
+  hdmap::MapServer server;
+  ASSERT_TRUE(server.loadFromFile(firstPath));
+  EXPECT_EQ(server.getLaneCount(), 300);
+
+  // Spokes meet at the origin
+  const auto& bounds{generator.stats().bounds};
+  EXPECT_TRUE(bounds.contains(hdmap::Point2D(0, 0)));
+  EXPECT_LT(bounds.min.x, 0.0);
+  const auto closest{server.getClosestLane(hdmap::Point2D(1, 1))};
+  ASSERT_TRUE(closest.has_value());
+  const auto points{(*closest)->centerlinePoints()};
+  const hdmap::Point2D origin{0, 0};
+  EXPECT_NEAR(std::min(points.front().distanceTo(origin),
+                       points.back().distanceTo(origin)),
+              0.0, 1e-3);
+}
+
+TEST_F(MapGeneratorTest, RejectsEmptyCity) {
+  hdmap::CityConfig config;
+  config.laneCount = 0;
+  hdmap::CityGenerator generator{config};
+  EXPECT_FALSE(generator.writeOsm(firstPath));
+  EXPECT_FALSE(generator.getLastError().empty());
+}
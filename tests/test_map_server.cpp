@@ -1,7 +1,11 @@
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "include/map_server.hpp"
 
@@ -18,7 +22,11 @@ class MapServerTest : public ::testing::Test {
   }
 
   void createTestMapFile() {
-    testMapPath = "/tmp/test_map.osm";
+    // One file per test so tests can run in parallel processes
+    testMapPath =
+        std::string{"/tmp/test_map_"} +
+        ::testing::UnitTest::GetInstance()->current_test_info()->name() +
+        ".osm";
     std::ofstream file(testMapPath);
     file << R"(<?xml version="1.0" encoding="UTF-8"?>
 <osm version="0.6">
@@ -40,6 +48,13 @@ class MapServerTest : public ::testing::Test {
     <tag k="type" v="lanelet"/>
     <tag k="subtype" v="road"/>
   </way>
+
+  <way id="102">
+    <nd ref="2"/>
+    <nd ref="4"/>
+    <tag k="type" v="lanelet"/>
+    <tag k="subtype" v="road"/>
+  </way>
   
   <relation id="200">
     <tag k="type" v="regulatory_element"/>
@@ -54,14 +69,14 @@ class MapServerTest : public ::testing::Test {
 };
 
 TEST_F(MapServerTest, LoadMap) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
 
   EXPECT_TRUE(server->loadFromFile(std::move(testMapPath)));
   EXPECT_GT(server->getLaneCount(), 0);
 }
 
 TEST_F(MapServerTest, QueryRegion) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
   server->loadFromFile(std::move(testMapPath));
 
   const hdmap::BoundingBox region{hdmap::Point2D(0, 0), hdmap::Point2D(50, 50)};
@@ -70,7 +85,7 @@ TEST_F(MapServerTest, QueryRegion) {
 }
 
 TEST_F(MapServerTest, QueryRadius) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
   server->loadFromFile(std::move(testMapPath));
 
   const hdmap::Point2D center{50, 50};
@@ -79,7 +94,7 @@ TEST_F(MapServerTest, QueryRadius) {
 }
 
 TEST_F(MapServerTest, GetLaneById) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
   server->loadFromFile(std::move(testMapPath));
 
   auto lane = server->getLaneById(100);
@@ -95,7 +110,7 @@ TEST_F(MapServerTest, GetLaneById) {
 }
 
 TEST_F(MapServerTest, GetClosestLane) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
   server->loadFromFile(std::move(testMapPath));
 
   const hdmap::Point2D position{10, 10};
@@ -105,7 +120,7 @@ TEST_F(MapServerTest, GetClosestLane) {
 }
 
 TEST_F(MapServerTest, Clear) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
 
   server->loadFromFile(std::move(testMapPath));
 
@@ -119,7 +134,7 @@ TEST_F(MapServerTest, Clear) {
 }
 
 TEST_F(MapServerTest, MemoryUsage) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
   server->loadFromFile(testMapPath);
 
   const auto memUsage{server->getMemoryUsage()};
@@ -129,9 +144,433 @@ TEST_F(MapServerTest, MemoryUsage) {
   EXPECT_LT(memUsage, 10 * 1024 * 1024);  // Less than 10 MB
 }
 
+TEST_F(MapServerTest, MemoryBreakdown) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  const auto memory{server->getMemoryBreakdown()};
+  EXPECT_GT(memory.lanes, 0);
+  EXPECT_GT(memory.geometry, 0);
+  EXPECT_GT(memory.indices, 0);
+  EXPECT_GT(memory.parserScratchPeak, 0);
+  // Parser temporaries are gone once the load returns
+  EXPECT_EQ(memory.parserScratch, 0);
+  EXPECT_EQ(server->getMemoryUsage(), memory.total());
+
+  server->clear();
+  EXPECT_LT(server->getMemoryBreakdown().geometry, memory.geometry);
+}
+
+TEST_F(MapServerTest, TrafficElementsHaveTheirOwnCategory) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  ASSERT_GT(server->getTrafficLightCount(), 0);
+  const size_t withLights{server->getMemoryBreakdown().trafficElements};
+  EXPECT_GT(withLights, 0);
+
+  server->getTrafficLightsMutable().clear();
+  EXPECT_LT(server->getMemoryBreakdown().trafficElements, withLights);
+}
+
+TEST_F(MapServerTest, ReloadThenClearReleasesEverything) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  EXPECT_EQ(server->getMemoryUsage(), 0);
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  const size_t loaded{server->getMemoryUsage()};
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(server->loadFromFile(testMapPath));
+    EXPECT_EQ(server->getMemoryUsage(), loaded);
+  }
+  server->clear();
+  EXPECT_EQ(server->getMemoryUsage(), 0);
+}
+
+TEST_F(MapServerTest, LoadRegionSkipsElementsOutside) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  const size_t fullGeometry{server->getMemoryBreakdown().geometry};
+
+  // Lane 101 runs along y = 100, lanes 100 and 102 touch y < 10
+  server->setLoadRegion(
+      hdmap::BoundingBox{hdmap::Point2D(-1, -1), hdmap::Point2D(101, 10)});
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  EXPECT_EQ(server->getLaneCount(), 2);
+  EXPECT_FALSE(server->getLaneById(101).has_value());
+  EXPECT_TRUE(server->getLaneById(102).has_value());
+  EXPECT_LT(server->getMemoryBreakdown().geometry, fullGeometry);
+}
+
 TEST_F(MapServerTest, InvalidFile) {
-  auto server{hdmap::MapServer::getInstance()};
+  auto server{std::make_shared<hdmap::MapServer>()};
 
   EXPECT_FALSE(server->loadFromFile("/nonexistent/path/map.osm"));
   EXPECT_EQ(server->getLaneCount(), 0);
 }
+
+TEST_F(MapServerTest, CompactGeometryMode) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  server->setGeometryMode(hdmap::GeometryMode::COMPACT_FLOAT);
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  auto lane = server->getLaneById(100);
+  ASSERT_TRUE(lane.has_value());
+  EXPECT_TRUE((*lane)->centerline.empty());
+  EXPECT_EQ((*lane)->centerlinePoints().size(), 2);
+
+  const auto closestLane{server->getClosestLane(hdmap::Point2D(10, 10))};
+  EXPECT_TRUE(closestLane.has_value());
+}
+
+TEST_F(MapServerTest, LocalTangentPlaneProjection) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  server->setProjection(
+      hdmap::ProjectionConfig::localTangentPlaneAutoOrigin());
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Lane 100 spans 100 degrees of longitude along the equator
+  auto lane = server->getLaneById(100);
+  ASSERT_TRUE(lane.has_value());
+  const auto points{(*lane)->centerlinePoints()};
+  ASSERT_EQ(points.size(), 2);
+  EXPECT_GT(points[0].distanceTo(points[1]), 1e6);
+
+  const auto geodetic{server->toGeodetic(points[1])};
+  EXPECT_NEAR(geodetic.x, 100.0, 1e-9);
+  EXPECT_NEAR(geodetic.y, 0.0, 1e-9);
+}
+
+TEST_F(MapServerTest, Route) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Lane 100 ends at node 2 where lane 102 starts
+  auto lane = server->getLaneById(100);
+  ASSERT_TRUE(lane.has_value());
+  ASSERT_EQ((*lane)->successorIds.size(), 1);
+  EXPECT_EQ((*lane)->successorIds[0], 102);
+
+  const auto route{server->route(100, 102)};
+  ASSERT_TRUE(route.has_value());
+  ASSERT_EQ(route->laneIds.size(), 2);
+  EXPECT_EQ(route->laneIds[0], 100);
+  EXPECT_EQ(route->laneIds[1], 102);
+  EXPECT_GT(route->cost, 0.0);
+
+  EXPECT_FALSE(server->route(102, 100).has_value());
+  EXPECT_FALSE(server->route(100, 99999).has_value());
+}
+
+TEST_F(MapServerTest, RoutingHierarchyNextToMap) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  EXPECT_FALSE(server->hasRoutingHierarchy());
+
+  server->buildRoutingHierarchy();
+  const std::string hierarchyPath{
+      hdmap::MapServer::routingHierarchyPathFor(testMapPath)};
+  ASSERT_TRUE(server->saveRoutingHierarchy(hierarchyPath));
+
+  // Reloading the same map picks the hierarchy up automatically
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  EXPECT_TRUE(server->hasRoutingHierarchy());
+  const auto route{server->route(100, 102)};
+  ASSERT_TRUE(route.has_value());
+  EXPECT_EQ(route->laneIds.size(), 2);
+
+  std::remove(hierarchyPath.c_str());
+  server->clear();
+  EXPECT_FALSE(server->hasRoutingHierarchy());
+}
+
+TEST_F(MapServerTest, FrenetProjection) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Lane 100 runs from (0, 0) to (100, 0)
+  const auto length{server->getLaneLength(100)};
+  ASSERT_TRUE(length.has_value());
+  EXPECT_DOUBLE_EQ(*length, 100.0);
+
+  const auto frenet{server->project(100, hdmap::Point2D(30, 5))};
+  ASSERT_TRUE(frenet.has_value());
+  EXPECT_DOUBLE_EQ(frenet->s, 30.0);
+  EXPECT_DOUBLE_EQ(frenet->d, 5.0);
+
+  const auto pose{server->interpolate(100, 30.0)};
+  ASSERT_TRUE(pose.has_value());
+  EXPECT_DOUBLE_EQ(pose->point.x, 30.0);
+
+  std::vector<hdmap::FrenetPoint> results;
+  EXPECT_TRUE(server->projectBatch(
+      100, {hdmap::Point2D(30, 5), hdmap::Point2D(60, -2)}, results));
+  EXPECT_EQ(results.size(), 2);
+
+  EXPECT_FALSE(server->project(99999, hdmap::Point2D(0, 0)).has_value());
+  EXPECT_FALSE(server->projectBatch(99999, {}, results));
+}
+
+TEST_F(MapServerTest, QueryCorridor) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Path heading south-west over the end of lane 101, then crossing
+  // lane 102, then over the end of lane 100
+  const std::vector<hdmap::Point2D> path{hdmap::Point2D(90, 110),
+                                         hdmap::Point2D(110, 50),
+                                         hdmap::Point2D(90, -10)};
+  const auto result{server->queryCorridor(path, 5.0)};
+  ASSERT_EQ(result.lanes.size(), 3);
+  EXPECT_EQ(result.lanes[0]->id, 101);
+  EXPECT_EQ(result.lanes[1]->id, 102);
+  EXPECT_EQ(result.lanes[2]->id, 100);
+
+  // Narrow corridor away from everything
+  const std::vector<hdmap::Point2D> farPath{hdmap::Point2D(50, 40),
+                                            hdmap::Point2D(60, 40)};
+  EXPECT_EQ(server->queryCorridor(farPath, 5.0).totalCount(), 0);
+  EXPECT_EQ(server->queryCorridor({}, 5.0).totalCount(), 0);
+}
+
+TEST_F(MapServerTest, QueryOrientedBox) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Thin box along the diagonal from (0, 0) to (100, 100): its AABB covers
+  // all lanes but the box itself only touches the corners at both ends
+  const hdmap::OrientedBox diagonal{hdmap::Point2D(50, 50), 75.0, 2.0,
+                                    M_PI / 4.0};
+  const auto result{server->queryOrientedBox(diagonal)};
+  EXPECT_EQ(result.lanes.size(), 3);
+
+  const hdmap::OrientedBox middle{hdmap::Point2D(50, 50), 20.0, 2.0,
+                                  M_PI / 4.0};
+  EXPECT_EQ(server->queryOrientedBox(middle).lanes.size(), 0);
+
+  // Sector looking north from (50, 50) sees only lane 101 at y = 100
+  const auto sector{hdmap::ConvexPolygon::sector(hdmap::Point2D(50, 50), 60.0,
+                                                 M_PI / 2.0, M_PI / 3.0)};
+  const auto seen{server->queryPolygon(sector)};
+  ASSERT_EQ(seen.lanes.size(), 1);
+  EXPECT_EQ(seen.lanes[0]->id, 101);
+}
+
+TEST_F(MapServerTest, QueryCache) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  const hdmap::Point2D position{2.0, 1.0};
+  const auto uncachedNearby{server->getNearbyLanes(position, 10.0)};
+  const auto uncachedClosest{server->getClosestLane(position)};
+
+  server->enableQueryCache(5.0, 8);
+  server->resetQueryCacheStats();
+
+  // Same cell: the second call of each kind is served from the cache
+  EXPECT_EQ(server->getNearbyLanes(position, 10.0), uncachedNearby);
+  EXPECT_EQ(server->getNearbyLanes(hdmap::Point2D(2.5, 1.5), 10.0),
+            uncachedNearby);
+  ASSERT_TRUE(server->getClosestLane(position).has_value());
+  EXPECT_EQ(server->getClosestLane(position).value(), uncachedClosest.value());
+  auto stats{server->getQueryCacheStats()};
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 2);
+
+  // Results stay exact inside a cell
+  EXPECT_TRUE(server->getNearbyLanes(hdmap::Point2D(4.9, 4.9), 1.0).empty());
+  EXPECT_FALSE(server->getClosestLane(hdmap::Point2D(500, 500)).has_value());
+
+  // A reload invalidates every entry
+  const uint64_t generation{server->getGeneration()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  EXPECT_NE(server->getGeneration(), generation);
+  server->resetQueryCacheStats();
+  server->getNearbyLanes(position, 10.0);
+  stats = server->getQueryCacheStats();
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.misses, 1);
+
+  server->disableQueryCache();
+  EXPECT_FALSE(server->isQueryCacheEnabled());
+}
+
+TEST_F(MapServerTest, QueryCachePerServer) {
+  auto first{std::make_shared<hdmap::MapServer>()};
+  auto second{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(first->loadFromFile(testMapPath));
+  ASSERT_TRUE(second->loadFromFile(testMapPath));
+  first->enableQueryCache(5.0, 1);
+  second->enableQueryCache(5.0, 4);
+
+  // Different capacities and alternating queries do not evict each other
+  const hdmap::Point2D position{2.0, 1.0};
+  first->getNearbyLanes(position, 10.0);
+  second->getNearbyLanes(position, 10.0);
+  first->resetQueryCacheStats();
+  second->resetQueryCacheStats();
+  first->getNearbyLanes(position, 10.0);
+  second->getNearbyLanes(position, 10.0);
+  EXPECT_EQ(first->getQueryCacheStats().hits, 1);
+  EXPECT_EQ(second->getQueryCacheStats().hits, 1);
+
+  // Cached lanes of a replaced map are released on the next lookup
+  const std::weak_ptr<hdmap::Lane> oldLane{
+      first->getNearbyLanes(position, 10.0).front()};
+  ASSERT_TRUE(first->loadFromFile(testMapPath));
+  first->getNearbyLanes(position, 10.0);
+  EXPECT_TRUE(oldLane.expired());
+
+  // So are those of a destroyed server once the thread caches another
+  const std::weak_ptr<hdmap::Lane> secondLane{
+      second->getNearbyLanes(position, 10.0).front()};
+  second.reset();
+  hdmap::MapServer third;
+  ASSERT_TRUE(third.loadFromFile(testMapPath));
+  third.enableQueryCache(5.0, 4);
+  third.getNearbyLanes(position, 10.0);
+  EXPECT_TRUE(secondLane.expired());
+}
+
+TEST_F(MapServerTest, RegulatoryElementPosition) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  // Tag-style relation, positioned at its node member
+  const auto light{server->getTrafficLightById(200)};
+  ASSERT_TRUE(light.has_value());
+  EXPECT_DOUBLE_EQ((*light)->position.x, 100.0);
+  EXPECT_DOUBLE_EQ((*light)->position.y, 0.0);
+  EXPECT_TRUE((*light)->controlledLaneIds.empty());
+}
+
+TEST_F(MapServerTest, RegulatoryElementMemberRoles) {
+  // Stop line first, then the light itself: only the lanelet member is a
+  // controlled lane and the position comes from the refers node
+  std::ofstream file(testMapPath);
+  file << R"(<osm version="0.6">
+  <node id="1" lat="0" lon="0"/>
+  <node id="2" lat="0" lon="10"/>
+  <node id="3" lat="5" lon="10"/>
+  <node id="4" lat="8" lon="12"/>
+  <way id="100">
+    <nd ref="1"/>
+    <nd ref="2"/>
+    <tag k="type" v="lanelet"/>
+  </way>
+  <way id="101">
+    <nd ref="2"/>
+    <nd ref="3"/>
+  </way>
+  <relation id="200">
+    <member type="node" ref="3" role="ref_line"/>
+    <member type="way" ref="101" role="ref_line"/>
+    <member type="node" ref="4" role="refers"/>
+    <member type="way" ref="100" role="lanelet"/>
+    <tag k="type" v="regulatory_element"/>
+    <tag k="subtype" v="traffic_light"/>
+  </relation>
+</osm>)";
+  file.close();
+
+  hdmap::MapServer server;
+  ASSERT_TRUE(server.loadFromFile(testMapPath));
+  const auto light{server.getTrafficLightById(200)};
+  ASSERT_TRUE(light.has_value());
+  EXPECT_DOUBLE_EQ((*light)->position.x, 12.0);
+  EXPECT_DOUBLE_EQ((*light)->position.y, 8.0);
+  EXPECT_EQ((*light)->controlledLaneIds, hdmap::IdList{100});
+}
+
+TEST_F(MapServerTest, LoadStats) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+
+  const auto& stats{server->getLastLoadStats()};
+  EXPECT_GT(stats.fileBytes, 0);
+  ASSERT_FALSE(stats.stages.empty());
+  EXPECT_EQ(stats.stages.front().name, "read");
+  EXPECT_EQ(stats.stages.front().bytes, stats.fileBytes);
+
+  const auto* nodes{stats.find("node_decode")};
+  ASSERT_NE(nodes, nullptr);
+  EXPECT_EQ(nodes->elements, 4);
+  const auto* ways{stats.find("way_resolve")};
+  ASSERT_NE(ways, nullptr);
+  EXPECT_EQ(ways->elements, 3);
+  EXPECT_GT(ways->trackedBytes, 0);
+  EXPECT_NE(stats.find("index_build"), nullptr);
+  EXPECT_NE(stats.find("index_constraint_check"), nullptr);
+  EXPECT_EQ(stats.find("compact_geometry"), nullptr);
+  EXPECT_GE(stats.totalSeconds(), stats.stages.front().seconds);
+
+  // A load that cannot open its file has no stages
+  std::remove(testMapPath.c_str());
+  EXPECT_FALSE(server->loadFromFile(testMapPath));
+  EXPECT_TRUE(server->getLastLoadStats().stages.empty());
+}
+
+TEST_F(MapServerTest, PointIndexType) {
+  auto server{std::make_shared<hdmap::MapServer>()};
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  EXPECT_EQ(server->getPointIndexType(), hdmap::PointIndexType::GRID);
+
+  // The test map's only light is at (100, 0); add one at the origin and
+  // rebuild the indices
+  auto light{std::make_shared<hdmap::TrafficLight>()};
+  light->id = 300;
+  light->position = hdmap::Point2D(0, 0);
+  server->getTrafficLightsMutable()[light->id] = light;
+  server->setPointIndexType(hdmap::PointIndexType::GRID);
+
+  const hdmap::BoundingBox region{hdmap::Point2D(-1, -1), hdmap::Point2D(1, 1)};
+  EXPECT_EQ(server->queryRegion(region).trafficLights.size(), 1);
+
+  server->setPointIndexType(hdmap::PointIndexType::RTREE);
+  EXPECT_EQ(server->queryRegion(region).trafficLights.size(), 1);
+  EXPECT_EQ(server->queryRadius(hdmap::Point2D(0, 0), 1.0).trafficLights.size(),
+            1);
+}
+
+TEST_F(MapServerTest, IndependentInstances) {
+  hdmap::MapServer current;
+  hdmap::MapServer next;
+  ASSERT_TRUE(current.loadFromFile(testMapPath));
+
+  // Loading and clearing one instance leaves the other untouched
+  next.setLoadRegion(
+      hdmap::BoundingBox{hdmap::Point2D(-1, -1), hdmap::Point2D(101, 10)});
+  ASSERT_TRUE(next.loadFromFile(testMapPath));
+  EXPECT_EQ(current.getLaneCount(), 3);
+  EXPECT_EQ(next.getLaneCount(), 2);
+  EXPECT_NE(current.getGeneration(), next.getGeneration());
+
+  next.clear();
+  EXPECT_EQ(current.getLaneCount(), 3);
+  EXPECT_TRUE(current.getLaneById(101).has_value());
+}
+
+TEST_F(MapServerTest, InstancesKeepTheirConstraints) {
+  auto tight{hdmap::MemoryConstraints::defaultConstraints()};
+  tight.maxLanes = 2;
+  hdmap::MapServer limited{tight};
+  EXPECT_FALSE(limited.loadFromFile(testMapPath));
+  EXPECT_EQ(limited.getLaneCount(), 0);
+
+  tight.maxLanes = 10;
+  tight.maxTotalMemory = 1024;
+  hdmap::MapServer small{tight};
+  EXPECT_FALSE(small.loadFromFile(testMapPath));
+  EXPECT_EQ(small.getLaneCount(), 0);
+
+  hdmap::MapServer unlimited;
+  EXPECT_TRUE(unlimited.loadFromFile(testMapPath));
+}
+
+TEST_F(MapServerTest, SingletonIsOptional) {
+  auto shared{hdmap::MapServer::getInstance()};
+  EXPECT_EQ(shared, hdmap::MapServer::getInstance());
+  EXPECT_EQ(shared, hdmap::MapServer::getInstance(
+                        hdmap::MemoryConstraints::raspberryPi()));
+  EXPECT_EQ(shared->getConstraints(),
+            hdmap::MemoryConstraints::defaultConstraints());
+}
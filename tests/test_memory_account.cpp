@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "include/memory_account.hpp"
+#include "include/types.hpp"
+
+TEST(MemoryAccountTest, CountsContainerAllocationsPerCategory) {
+  hdmap::MemoryAccount account;
+  {
+    hdmap::IndexVector<double> values{
+        hdmap::TrackingAllocator<double, hdmap::MemoryCategory::INDICES>{
+            &account}};
+    values.reserve(100);
+    EXPECT_EQ(account.used(hdmap::MemoryCategory::INDICES),
+              100 * sizeof(double));
+    EXPECT_EQ(account.used(hdmap::MemoryCategory::GEOMETRY), 0);
+  }
+  EXPECT_EQ(account.used(hdmap::MemoryCategory::INDICES), 0);
+  EXPECT_EQ(account.peak(hdmap::MemoryCategory::INDICES),
+            100 * sizeof(double));
+}
+
+TEST(MemoryAccountTest, ScopeBindsNestedElementContainers) {
+  hdmap::MemoryAccount account;
+  std::shared_ptr<hdmap::Lane> lane;
+  {
+    const hdmap::MemoryAccount::Scope scope{&account};
+    lane = hdmap::makeTracked<hdmap::Lane>();
+  }
+  EXPECT_EQ(hdmap::MemoryAccount::current(), nullptr);
+
+  // Element and control block in one allocation
+  EXPECT_GE(account.used(hdmap::MemoryCategory::LANES), sizeof(hdmap::Lane));
+
+  // Containers inside the element keep charging after the scope ends
+  lane->centerline.reserve(10);
+  EXPECT_EQ(account.used(hdmap::MemoryCategory::GEOMETRY),
+            10 * sizeof(hdmap::Point2D));
+
+  lane.reset();
+  EXPECT_EQ(account.breakdown().total(), 0);
+}
+
+TEST(MemoryAccountTest, UnscopedAccountOutsideScope) {
+  auto& unscoped{hdmap::MemoryAccount::unscoped()};
+  const size_t before{unscoped.used(hdmap::MemoryCategory::GEOMETRY)};
+  auto lane{hdmap::makeTracked<hdmap::Lane>()};
+  lane->centerline.reserve(4);
+  EXPECT_EQ(lane->centerline.get_allocator().account(), &unscoped);
+  EXPECT_EQ(unscoped.used(hdmap::MemoryCategory::GEOMETRY),
+            before + 4 * sizeof(hdmap::Point2D));
+}
+
+TEST(MemoryAccountTest, ReleasedAccountsAreReusedOnceIdle) {
+  auto account{hdmap::MemoryAccount::acquire()};
+  hdmap::MemoryAccount* const raw{account.get()};
+  std::shared_ptr<hdmap::Lane> kept;
+  {
+    const hdmap::MemoryAccount::Scope scope{raw};
+    kept = hdmap::makeTracked<hdmap::Lane>();
+  }
+  account.reset();
+
+  // Still charged by the kept lane, so a new owner gets another account
+  auto busy{hdmap::MemoryAccount::acquire()};
+  EXPECT_NE(busy.get(), raw);
+
+  kept.reset();
+  EXPECT_EQ(raw->breakdown().total(), 0);
+  auto reused{hdmap::MemoryAccount::acquire()};
+  EXPECT_EQ(reused.get(), raw);
+  EXPECT_EQ(reused->peak(hdmap::MemoryCategory::LANES), 0);
+}
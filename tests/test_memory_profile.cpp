@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/memory_profile.hpp"
+
+namespace {
+
+constexpr size_t kBlockBytes = 64 * 1024 * 1024;
+
+// Keeps the compiler from eliding allocations the test never reads
+char* volatile escapedBlock{nullptr};
+
+}  // namespace
+
+TEST(MemoryProfileTest, ProcessMemoryFollowsTouchedPages) {
+#ifndef __linux__
+  GTEST_SKIP() << "process memory is read from /proc";
+#endif
+  const auto before{hdmap::ProcessMemory::read()};
+  ASSERT_TRUE(before.available);
+  EXPECT_GT(before.rss, 0);
+  EXPECT_LE(before.anonymous, before.rss);
+
+  // Resident only once written
+  std::unique_ptr<char[]> block{new char[kBlockBytes]};
+  std::memset(block.get(), 1, kBlockBytes);
+  const auto after{hdmap::ProcessMemory::read()};
+  EXPECT_GE(after.rss, before.rss + kBlockBytes / 2);
+  EXPECT_GE(after.anonymous, before.anonymous + kBlockBytes / 2);
+  EXPECT_EQ(block[kBlockBytes - 1], 1);
+}
+
+TEST(MemoryProfileTest, AllocatorStatsCountLiveBlocks) {
+#ifdef __SANITIZE_ADDRESS__
+  GTEST_SKIP() << "AddressSanitizer replaces the glibc heap";
+#endif
+  const auto before{hdmap::AllocatorStats::read()};
+  // A replaced malloc leaves mallinfo2 reporting nothing in use
+  if (!before.available || before.inUse == 0) {
+    GTEST_SKIP() << "allocator statistics need the glibc heap";
+  }
+  std::unique_ptr<char[]> block{new char[kBlockBytes]};
+  escapedBlock = block.get();
+  const auto during{hdmap::AllocatorStats::read()};
+  EXPECT_GE(during.inUse, before.inUse + kBlockBytes);
+  block.reset();
+  EXPECT_LT(hdmap::AllocatorStats::read().inUse, during.inUse);
+}
+
+TEST(MemoryProfileTest, LoadStagesCarrySamples) {
+  const std::string path{"/tmp/test_memory_profile.osm"};
+  hdmap::CityConfig city;
+  city.laneCount = 500;
+  ASSERT_TRUE(hdmap::CityGenerator{city}.writeOsm(path));
+
+  hdmap::MapServer server;
+  ASSERT_TRUE(server.loadFromFile(path));
+  EXPECT_FALSE(server.getLastLoadStats().profileMemory);
+  EXPECT_EQ(
+      server.getLastLoadStats().find("index_build")->memory.tracked.total(),
+      0);
+
+  server.setMemoryProfiling(true);
+  ASSERT_TRUE(server.loadFromFile(path));
+  std::remove(path.c_str());
+  const auto& stats{server.getLastLoadStats()};
+  ASSERT_TRUE(stats.profileMemory);
+
+  // Scratch peaks while parsing and is released before the indices exist
+  const auto* read{stats.find("read")};
+  ASSERT_NE(read, nullptr);
+  EXPECT_GE(read->memory.tracked.parserScratch, stats.fileBytes);
+  const auto* indices{stats.find("index_build")};
+  ASSERT_NE(indices, nullptr);
+  EXPECT_EQ(indices->memory.tracked.parserScratch, 0);
+  EXPECT_GT(indices->memory.tracked.lanes, 0);
+  EXPECT_GT(indices->memory.tracked.geometry, 0);
+  EXPECT_GT(indices->memory.tracked.indices, 0);
+  EXPECT_LT(stats.baseline.tracked.total(), indices->memory.tracked.total());
+  EXPECT_EQ(stats.stages.back().memory.tracked.total(),
+            server.getMemoryBreakdown().total());
+#ifdef __linux__
+  EXPECT_GT(indices->memory.process.rss, 0);
+#endif
+}
@@ -0,0 +1,57 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "include/perf_counters.hpp"
+
+namespace {
+
+constexpr size_t kBlockBytes = 16 * 1024 * 1024;
+constexpr size_t kPageBytes = 4096;
+
+// Keeps the compiler from eliding the touched block
+char* volatile escapedBlock{nullptr};
+
+}  // namespace
+
+TEST(PerfCountersTest, EventNames) {
+  EXPECT_STREQ(hdmap::perfEventName(hdmap::PerfEvent::CYCLES), "cycles");
+  EXPECT_STREQ(hdmap::perfEventName(hdmap::PerfEvent::PAGE_FAULTS),
+               "page_faults");
+}
+
+TEST(PerfCountersTest, CountsOnlyWhileRunning) {
+  hdmap::PerfCounters counters;
+  if (!counters.available()) {
+    GTEST_SKIP() << counters.getLastError();
+  }
+  const auto idle{counters.read()};
+  if (!idle.has(hdmap::PerfEvent::PAGE_FAULTS)) {
+    GTEST_SKIP() << "no page fault counter";
+  }
+  EXPECT_EQ(idle[hdmap::PerfEvent::PAGE_FAULTS], 0);
+
+  // First touch of fresh pages faults them in
+  counters.start();
+  std::unique_ptr<char[]> block{new char[kBlockBytes]};
+  escapedBlock = block.get();
+  std::memset(block.get(), 1, kBlockBytes);
+  counters.stop();
+  const auto touched{counters.read()};
+  EXPECT_GE(touched[hdmap::PerfEvent::PAGE_FAULTS],
+            kBlockBytes / kPageBytes / 2);
+  if (touched.has(hdmap::PerfEvent::INSTRUCTIONS)) {
+    EXPECT_GT(touched[hdmap::PerfEvent::INSTRUCTIONS], 0);
+  }
+
+  // Stopped counters ignore further work
+  std::unique_ptr<char[]> other{new char[kBlockBytes]};
+  escapedBlock = other.get();
+  std::memset(other.get(), 1, kBlockBytes);
+  EXPECT_EQ(counters.read()[hdmap::PerfEvent::PAGE_FAULTS],
+            touched[hdmap::PerfEvent::PAGE_FAULTS]);
+
+  counters.reset();
+  EXPECT_EQ(counters.read()[hdmap::PerfEvent::PAGE_FAULTS], 0);
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "include/point_index.hpp"
+
+namespace {
+
+// Lights on a 10 x 10 lattice with 10 m spacing, ids 0..99
+hdmap::TrafficLightMap
+latticeLights() {
+  hdmap::TrafficLightMap lights;
+  for (uint64_t i = 0; i < 100; ++i) {
+    auto light{std::make_shared<hdmap::TrafficLight>()};
+    light->id = i;
+    light->position = hdmap::Point2D((i % 10) * 10.0, (i / 10) * 10.0);
+    lights[i] = light;
+  }
+  return lights;
+}
+
+std::vector<uint64_t> idsOf(
+    const std::vector<std::shared_ptr<hdmap::TrafficLight>>& lights) {
+  std::vector<uint64_t> ids;
+  for (const auto& light : lights) {
+    ids.push_back(light->id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+}  // namespace
+
+class PointIndexTest
+    : public ::testing::TestWithParam<hdmap::PointIndexType> {};
+
+TEST_P(PointIndexTest, BoxQuery) {
+  hdmap::PointIndex<hdmap::TrafficLight> index{GetParam()};
+  index.build(latticeLights());
+  EXPECT_EQ(index.size(), 100);
+
+  std::vector<std::shared_ptr<hdmap::TrafficLight>> results;
+  index.query(
+      hdmap::BoundingBox{hdmap::Point2D(15, 15), hdmap::Point2D(30, 20)},
+      results);
+  EXPECT_EQ(idsOf(results), (std::vector<uint64_t>{22, 23}));
+
+  results.clear();
+  index.query(hdmap::BoundingBox{hdmap::Point2D(200, 200),
+                                 hdmap::Point2D(300, 300)},
+              results);
+  EXPECT_TRUE(results.empty());
+}
+
+TEST_P(PointIndexTest, RadiusAndPredicateQueries) {
+  hdmap::PointIndex<hdmap::TrafficLight> index{GetParam()};
+  index.build(latticeLights());
+
+  // Box candidates for the R-tree, exact circle for the grid; both must
+  // include the centre and its four neighbours
+  std::vector<std::shared_ptr<hdmap::TrafficLight>> results;
+  index.queryRadius(hdmap::Point2D(50, 50), 10.0, results);
+  const auto ids{idsOf(results)};
+  for (const uint64_t id : {45, 54, 55, 56, 65}) {
+    EXPECT_TRUE(std::binary_search(ids.begin(), ids.end(), id)) << id;
+  }
+
+  results.clear();
+  const hdmap::BoundingBox column{hdmap::Point2D(89, -1),
+                                  hdmap::Point2D(91, 1000)};
+  index.queryIf(
+      column,
+      [&column](const hdmap::BoundingBox& box) {
+        return box.intersects(column);
+      },
+      results);
+  EXPECT_EQ(results.size(), 10);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllTypes, PointIndexTest,
+                         ::testing::Values(hdmap::PointIndexType::RTREE,
+                                           hdmap::PointIndexType::GRID));
+
+TEST(PointIndexGridTest, ExactRadiusAndDegenerateExtent) {
+  hdmap::PointIndex<hdmap::TrafficLight> index;
+  index.build(latticeLights());
+  std::vector<std::shared_ptr<hdmap::TrafficLight>> results;
+  index.queryRadius(hdmap::Point2D(50, 50), 10.0, results);
+  EXPECT_EQ(idsOf(results), (std::vector<uint64_t>{45, 54, 55, 56, 65}));
+
+  // All points on one line, and all points at one spot
+  hdmap::TrafficLightMap row;
+  for (uint64_t i = 0; i < 5; ++i) {
+    row[i] = std::make_shared<hdmap::TrafficLight>();
+    row[i]->position = hdmap::Point2D(i * 1000.0, 7.0);
+  }
+  index.build(row);
+  results.clear();
+  index.query(hdmap::BoundingBox{hdmap::Point2D(900, 0),
+                                 hdmap::Point2D(2100, 10)},
+              results);
+  EXPECT_EQ(results.size(), 2);
+
+  for (auto& [id, light] : row) {
+    light->position = hdmap::Point2D(3, 3);
+  }
+  index.build(row);
+  results.clear();
+  index.queryRadius(hdmap::Point2D(3, 3), 0.0, results);
+  EXPECT_EQ(results.size(), 5);
+}
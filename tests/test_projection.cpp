@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "include/projection.hpp"
+
+TEST(ProjectionTest, NoneIsIdentity) {
+  const hdmap::Projector projector{};
+  const auto projected{projector.forward(hdmap::Point2D(139.7, 35.6))};
+
+  EXPECT_DOUBLE_EQ(projected.x, 139.7);
+  EXPECT_DOUBLE_EQ(projected.y, 35.6);
+}
+
+TEST(ProjectionTest, LocalTangentPlaneScale) {
+  const hdmap::Projector projector{
+      hdmap::ProjectionConfig::localTangentPlane(0.0, 0.0)};
+
+  // One degree of latitude at the equator is ~110.57 km
+  const auto north{projector.forward(hdmap::Point2D(0.0, 1.0))};
+  EXPECT_NEAR(north.x, 0.0, 1e-9);
+  EXPECT_NEAR(north.y, 110574.0, 5.0);
+
+  // One degree of longitude at the equator is ~111.32 km
+  const auto east{projector.forward(hdmap::Point2D(1.0, 0.0))};
+  EXPECT_NEAR(east.x, 111319.0, 5.0);
+}
+
+TEST(ProjectionTest, LocalTangentPlaneBulkRoundTrip) {
+  const hdmap::Projector projector{
+      hdmap::ProjectionConfig::localTangentPlane(35.68, 139.76)};
+
+  std::vector<double> xs{139.767125, 139.770000};
+  std::vector<double> ys{35.681236, 35.679000};
+  projector.forward(xs, ys);
+
+  // The two nodes are a few hundred metres apart
+  const hdmap::Point2D a{xs[0], ys[0]};
+  const hdmap::Point2D b{xs[1], ys[1]};
+  EXPECT_GT(a.distanceTo(b), 200.0);
+  EXPECT_LT(a.distanceTo(b), 500.0);
+
+  const auto back{projector.inverse(a)};
+  EXPECT_NEAR(back.x, 139.767125, 1e-9);
+  EXPECT_NEAR(back.y, 35.681236, 1e-9);
+}
+
+TEST(ProjectionTest, PointMatchesBulkTransform) {
+  for (const auto& config : {hdmap::ProjectionConfig::none(),
+                             hdmap::ProjectionConfig::localTangentPlane(
+                                 35.68, 139.76),
+                             hdmap::ProjectionConfig::utm(-56)}) {
+    const hdmap::Projector projector{config};
+    const hdmap::Point2D lonLat{151.2093, -33.8688};
+    std::vector<double> xs{lonLat.x};
+    std::vector<double> ys{lonLat.y};
+    projector.forward(xs, ys);
+    const auto projected{projector.forward(lonLat)};
+    EXPECT_DOUBLE_EQ(projected.x, xs[0]);
+    EXPECT_DOUBLE_EQ(projected.y, ys[0]);
+  }
+}
+
+TEST(ProjectionTest, UtmCentralMeridian) {
+  const hdmap::Projector projector{hdmap::ProjectionConfig::utm(31)};
+
+  // Equator on the central meridian of zone 31 (3 degrees east)
+  const auto projected{projector.forward(hdmap::Point2D(3.0, 0.0))};
+  EXPECT_NEAR(projected.x, 500000.0, 1e-6);
+  EXPECT_NEAR(projected.y, 0.0, 1e-6);
+}
+
+TEST(ProjectionTest, UtmSouthernZone) {
+  // Sydney in a fixed zone 56S; the origin stays at (0, 0)
+  const hdmap::Projector projector{hdmap::ProjectionConfig::utm(-56)};
+  const auto projected{
+      projector.forward(hdmap::Point2D(151.2093, -33.8688))};
+  EXPECT_NEAR(projected.x, 334400.0, 500.0);
+  EXPECT_NEAR(projected.y, 6250900.0, 500.0);
+  const auto back{projector.inverse(projected)};
+  EXPECT_NEAR(back.y, -33.8688, 1e-8);
+
+  // A derived zone takes the hemisphere from the origin
+  hdmap::Projector derived{hdmap::ProjectionConfig::utm()};
+  derived.setOrigin(-33.8688, 151.2093);
+  EXPECT_EQ(derived.config().utmZone, -56);
+  EXPECT_NEAR(derived.forward(hdmap::Point2D(151.2093, -33.8688)).y,
+              projected.y, 1e-6);
+}
+
+TEST(ProjectionTest, UtmRoundTrip) {
+  hdmap::Projector projector{hdmap::ProjectionConfig::utm()};
+  projector.setOrigin(35.681236, 139.767125);
+  EXPECT_EQ(projector.config().utmZone, 54);
+
+  const auto projected{
+      projector.forward(hdmap::Point2D(139.767125, 35.681236))};
+  // Tokyo station, zone 54N
+  EXPECT_NEAR(projected.x, 388400.0, 500.0);
+  EXPECT_NEAR(projected.y, 3949400.0, 500.0);
+
+  const auto back{projector.inverse(projected)};
+  EXPECT_NEAR(back.x, 139.767125, 1e-8);
+  EXPECT_NEAR(back.y, 35.681236, 1e-8);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "include/query_cache.hpp"
+
+namespace {
+
+hdmap::QueryCacheKey keyFor(int64_t cellX) {
+  return {1, cellX, 0, 1, hdmap::CachedQuery::NEARBY_LANES};
+}
+
+hdmap::QueryCache::Candidates candidatesWith(uint64_t laneId) {
+  auto lane{std::make_shared<hdmap::Lane>()};
+  lane->id = laneId;
+  return {lane};
+}
+
+}  // namespace
+
+TEST(QueryCacheTest, EvictsLeastRecentlyUsed) {
+  hdmap::QueryCache cache{2};
+  cache.insert(keyFor(0), candidatesWith(10));
+  cache.insert(keyFor(1), candidatesWith(11));
+
+  // Touch cell 0 so cell 1 becomes the eviction victim
+  ASSERT_NE(cache.find(keyFor(0)), nullptr);
+  cache.insert(keyFor(2), candidatesWith(12));
+
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.find(keyFor(1)), nullptr);
+  const auto* kept{cache.find(keyFor(0))};
+  ASSERT_NE(kept, nullptr);
+  EXPECT_EQ(kept->front()->id, 10);
+  EXPECT_EQ(cache.stats().hits, 2);
+  EXPECT_EQ(cache.stats().misses, 1);
+}
+
+TEST(QueryCacheTest, KeyIncludesGenerationAndQuery) {
+  hdmap::QueryCache cache{4};
+  cache.insert(keyFor(0), candidatesWith(10));
+
+  auto otherGeneration{keyFor(0)};
+  otherGeneration.generation = 2;
+  EXPECT_EQ(cache.find(otherGeneration), nullptr);
+
+  auto otherQuery{keyFor(0)};
+  otherQuery.query = hdmap::CachedQuery::CLOSEST_LANE;
+  EXPECT_EQ(cache.find(otherQuery), nullptr);
+
+  cache.setCapacity(0);
+  EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,310 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/query_client.hpp"
+#include "include/query_daemon.hpp"
+#include "include/query_protocol.hpp"
+
+namespace {
+
+template <typename Element>
+std::vector<uint64_t> sortedIds(
+    const std::vector<std::shared_ptr<Element>>& elements) {
+  std::vector<uint64_t> ids;
+  for (const auto& element : elements) {
+    ids.push_back(element->id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+std::vector<uint64_t> sorted(std::vector<uint64_t> ids) {
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+}  // namespace
+
+class QueryDaemonTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    hdmap::CityConfig city;
+    city.laneCount = 400;
+    city.trafficLightDensity = 0.5;
+    city.trafficSignDensity = 0.5;
+    ASSERT_TRUE(hdmap::CityGenerator{city}.writeOsm(mapPath));
+    ASSERT_TRUE(server->loadFromFile(mapPath));
+
+    hdmap::DaemonConfig config;
+    config.socketPath = socketPath;
+    config.workerThreads = 2;
+    daemon = std::make_unique<hdmap::QueryDaemon>(server, config);
+    ASSERT_TRUE(daemon->start()) << daemon->getLastError();
+    ASSERT_TRUE(client.connect(socketPath)) << client.getLastError();
+  }
+
+  void TearDown() override {
+    client.disconnect();
+    daemon.reset();
+    std::remove(mapPath.c_str());
+  }
+
+  // Raw connection for malformed traffic
+  int connectRaw() const {
+    const int fd{socket(AF_UNIX, SOCK_STREAM, 0)};
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(),
+                 sizeof(address.sun_path) - 1);
+    EXPECT_EQ(connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                      sizeof(address)),
+              0);
+    return fd;
+  }
+
+  std::string mapPath{"/tmp/test_query_daemon_" + std::to_string(getpid()) +
+                      ".osm"};
+  std::string socketPath{"/tmp/test_query_daemon_" +
+                         std::to_string(getpid()) + ".sock"};
+  std::shared_ptr<hdmap::MapServer> server{
+      std::make_shared<hdmap::MapServer>()};
+  std::unique_ptr<hdmap::QueryDaemon> daemon;
+  hdmap::QueryClient client;
+};
+
+TEST_F(QueryDaemonTest, SpatialQueriesMatchTheServer) {
+  const hdmap::BoundingBox region{hdmap::Point2D(0, 0),
+                                  hdmap::Point2D(300, 300)};
+  const auto ids{client.queryRegion(region)};
+  ASSERT_TRUE(ids.has_value()) << client.getLastError();
+  const auto expected{server->queryRegion(region)};
+  EXPECT_GT(ids->laneIds.size(), 0);
+  EXPECT_EQ(sorted(ids->laneIds), sortedIds(expected.lanes));
+  EXPECT_EQ(sorted(ids->trafficLightIds), sortedIds(expected.trafficLights));
+  EXPECT_EQ(sorted(ids->trafficSignIds), sortedIds(expected.trafficSigns));
+
+  const hdmap::Point2D center{150, 150};
+  const auto nearby{client.queryRadius(center, 80.0)};
+  ASSERT_TRUE(nearby.has_value());
+  EXPECT_EQ(nearby->totalCount(),
+            server->queryRadius(center, 80.0).totalCount());
+
+  const auto closest{client.getClosestLane(hdmap::Point2D(12, 3))};
+  ASSERT_TRUE(closest.has_value());
+  EXPECT_EQ(*closest, (*server->getClosestLane(hdmap::Point2D(12, 3)))->id);
+}
+
+TEST_F(QueryDaemonTest, ElementsById) {
+  const auto& [laneId, expected] = *server->getLanes().begin();
+  const auto lane{client.getLaneById(laneId)};
+  ASSERT_TRUE(lane.has_value());
+  EXPECT_EQ((*lane)->id, laneId);
+  EXPECT_DOUBLE_EQ((*lane)->speedLimit, expected->speedLimit);
+  EXPECT_EQ((*lane)->centerline.size(), expected->centerlineSize());
+  EXPECT_DOUBLE_EQ((*lane)->centerline.back().x,
+                   expected->centerlinePoints().back().x);
+  EXPECT_EQ(
+      sorted({(*lane)->successorIds.begin(), (*lane)->successorIds.end()}),
+      sorted({expected->successorIds.begin(), expected->successorIds.end()}));
+  EXPECT_DOUBLE_EQ((*lane)->bbox.max.y, expected->bbox.max.y);
+
+  ASSERT_FALSE(server->getTrafficLights().empty());
+  const auto& [lightId, light] = *server->getTrafficLights().begin();
+  const auto remoteLight{client.getTrafficLightById(lightId)};
+  ASSERT_TRUE(remoteLight.has_value());
+  EXPECT_DOUBLE_EQ((*remoteLight)->position.x, light->position.x);
+  EXPECT_EQ((*remoteLight)->controlledLaneIds.size(),
+            light->controlledLaneIds.size());
+
+  ASSERT_FALSE(server->getTrafficSigns().empty());
+  const auto& [signId, sign] = *server->getTrafficSigns().begin();
+  const auto remoteSign{client.getTrafficSignById(signId)};
+  ASSERT_TRUE(remoteSign.has_value());
+  EXPECT_EQ((*remoteSign)->value, sign->value);
+  EXPECT_EQ((*remoteSign)->type, sign->type);
+
+  EXPECT_FALSE(client.getLaneById(999999999).has_value());
+  EXPECT_TRUE(client.isConnected());
+}
+
+TEST_F(QueryDaemonTest, PipelinedRequestsAreAnsweredInOrder) {
+  std::vector<hdmap::QueryRequest> requests;
+  std::vector<uint64_t> laneIds;
+  for (const auto& [id, lane] : server->getLanes()) {
+    laneIds.push_back(id);
+  }
+  for (size_t i = 0; i < 1000; ++i) {
+    if (i % 2 == 0) {
+      requests.push_back(
+          hdmap::QueryRequest::laneById(laneIds[i % laneIds.size()]));
+    } else {
+      requests.push_back(hdmap::QueryRequest::closestLane(
+          hdmap::Point2D(static_cast<double>(i % 300), 10.0)));
+    }
+  }
+  requests.push_back(hdmap::QueryRequest::laneById(999999999));
+
+  std::vector<hdmap::QueryReply> replies;
+  ASSERT_TRUE(client.execute(requests, replies)) << client.getLastError();
+  ASSERT_EQ(replies.size(), requests.size());
+  for (size_t i = 0; i + 1 < requests.size(); ++i) {
+    ASSERT_EQ(replies[i].status, hdmap::ResponseStatus::OK);
+    if (i % 2 == 0) {
+      EXPECT_EQ(replies[i].lane->id, laneIds[i % laneIds.size()]);
+    }
+  }
+  EXPECT_EQ(replies.back().status, hdmap::ResponseStatus::NOT_FOUND);
+
+  // Requests arrive in windows, each answered with a few large writes
+  const auto stats{daemon->getStats()};
+  EXPECT_EQ(stats.requests, requests.size());
+  EXPECT_LT(stats.batches, requests.size() / 10);
+}
+
+TEST_F(QueryDaemonTest, ConcurrentClients) {
+  std::vector<std::thread> threads;
+  std::vector<size_t> found(4, 0);
+  for (size_t t = 0; t < found.size(); ++t) {
+    threads.emplace_back([this, t, &found]() {
+      hdmap::QueryClient own;
+      if (!own.connect(socketPath)) {
+        return;
+      }
+      for (int i = 0; i < 200; ++i) {
+        found[t] += own.getClosestLane(hdmap::Point2D(i, t * 10.0)).has_value();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const size_t count : found) {
+    EXPECT_EQ(count, 200);
+  }
+  EXPECT_GE(daemon->getStats().connections, 5);
+}
+
+TEST_F(QueryDaemonTest, RejectsMalformedRequests) {
+  // Unknown query type: answered with BAD_REQUEST, connection stays open
+  const int fd{connectRaw()};
+  std::string frame;
+  const uint32_t length{5};
+  const uint32_t requestId{7};
+  frame.append(reinterpret_cast<const char*>(&length), sizeof(length));
+  frame.append(reinterpret_cast<const char*>(&requestId), sizeof(requestId));
+  frame.push_back(static_cast<char>(42));
+  ASSERT_EQ(send(fd, frame.data(), frame.size(), 0),
+            static_cast<ssize_t>(frame.size()));
+  char reply[16];
+  ASSERT_EQ(recv(fd, reply, sizeof(reply), 0), 9);
+  uint32_t replyId{0};
+  std::memcpy(&replyId, reply + 4, sizeof(replyId));
+  EXPECT_EQ(replyId, requestId);
+  EXPECT_EQ(reply[8], static_cast<char>(hdmap::ResponseStatus::BAD_REQUEST));
+
+  // Oversized frame: the daemon hangs up
+  const uint32_t huge{1 << 20};
+  ASSERT_EQ(send(fd, &huge, sizeof(huge), 0), 4);
+  EXPECT_EQ(recv(fd, reply, sizeof(reply), 0), 0);
+  close(fd);
+
+  // Other clients are unaffected
+  EXPECT_TRUE(client.getClosestLane(hdmap::Point2D(0, 0)).has_value());
+}
+
+TEST_F(QueryDaemonTest, HalfClosedClientGetsEveryReply) {
+  // Exactly one 64 KiB read of requests, so the daemon sees end of file in
+  // the wakeup that queues far more replies than the socket buffers
+  const int fd{connectRaw()};
+  const size_t requestBytes{64 * 1024};
+  std::string frames;
+  uint32_t requestCount{0};
+  const auto everything{hdmap::QueryRequest::regionQuery(hdmap::BoundingBox{
+      hdmap::Point2D(-1e4, -1e4), hdmap::Point2D(1e4, 1e4)})};
+  std::string frame;
+  hdmap::encodeRequest(frame, 0, everything);
+  while (requestBytes - frames.size() >= 2 * frame.size()) {
+    hdmap::encodeRequest(frames, requestCount++, everything);
+  }
+  // Pad with one unknown query type, answered with BAD_REQUEST
+  const auto padding{static_cast<uint32_t>(requestBytes - frames.size() -
+                                           hdmap::kFrameHeaderBytes)};
+  frames.append(reinterpret_cast<const char*>(&padding), sizeof(padding));
+  frames.append(reinterpret_cast<const char*>(&requestCount),
+                sizeof(requestCount));
+  frames.append(padding - sizeof(requestCount), static_cast<char>(42));
+  ++requestCount;
+  ASSERT_EQ(frames.size(), requestBytes);
+  ASSERT_EQ(send(fd, frames.data(), frames.size(), 0),
+            static_cast<ssize_t>(frames.size()));
+  ASSERT_EQ(shutdown(fd, SHUT_WR), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::string replies;
+  char buffer[65536];
+  ssize_t received{0};
+  while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    replies.append(buffer, static_cast<size_t>(received));
+  }
+  close(fd);
+  EXPECT_EQ(received, 0);
+
+  size_t offset{0};
+  uint32_t count{0};
+  while (offset + hdmap::kFrameHeaderBytes <= replies.size()) {
+    uint32_t length{0};
+    std::memcpy(&length, replies.data() + offset, sizeof(length));
+    offset += hdmap::kFrameHeaderBytes + length;
+    ++count;
+  }
+  EXPECT_EQ(offset, replies.size());
+  EXPECT_EQ(count, requestCount);
+}
+
+TEST_F(QueryDaemonTest, ServesSwappedMap) {
+  const hdmap::BoundingBox region{hdmap::Point2D(0, 0),
+                                  hdmap::Point2D(300, 300)};
+  daemon->setServer(std::make_shared<hdmap::MapServer>());
+  const auto ids{client.queryRegion(region)};
+  ASSERT_TRUE(ids.has_value());
+  EXPECT_EQ(ids->totalCount(), 0);
+  EXPECT_FALSE(client.getClosestLane(hdmap::Point2D(0, 0)).has_value());
+  EXPECT_TRUE(client.isConnected());
+}
+
+TEST_F(QueryDaemonTest, RefusesSocketInUse) {
+  hdmap::DaemonConfig config;
+  config.socketPath = socketPath;
+  hdmap::QueryDaemon second{server, config};
+  EXPECT_FALSE(second.start());
+  EXPECT_NE(second.getLastError().find("already served"), std::string::npos);
+  // The first daemon still serves
+  EXPECT_TRUE(client.getClosestLane(hdmap::Point2D(0, 0)).has_value());
+}
+
+TEST_F(QueryDaemonTest, RefusesToReplaceOtherFiles) {
+  const std::string path{"/tmp/test_query_daemon_" +
+                         std::to_string(getpid()) + ".txt"};
+  std::ofstream{path} << "not a socket";
+  hdmap::DaemonConfig config;
+  config.socketPath = path;
+  hdmap::QueryDaemon second{server, config};
+  EXPECT_FALSE(second.start());
+  EXPECT_NE(second.getLastError().find("Not a socket"), std::string::npos);
+  EXPECT_TRUE(std::ifstream{path}.good());
+  std::remove(path.c_str());
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/map_server.hpp"
+#include "include/query_metrics.hpp"
+
+TEST(LogHistogramTest, BucketsBoundRelativeError) {
+  for (uint64_t value = 0; value < 16; ++value) {
+    EXPECT_EQ(hdmap::LatencyHistogram::bucketLowerBound(
+                  hdmap::LatencyHistogram::bucketFor(value)),
+              value);
+  }
+  for (uint64_t value = 16; value < (uint64_t{1} << 62);
+       value = value * 3 + 7) {
+    const size_t bucket{hdmap::LatencyHistogram::bucketFor(value)};
+    ASSERT_LT(bucket, hdmap::LatencyHistogram::kBucketCount);
+    const uint64_t lower{hdmap::LatencyHistogram::bucketLowerBound(bucket)};
+    EXPECT_LE(lower, value);
+    EXPECT_LT(static_cast<double>(value - lower) / value, 1.0 / 16);
+  }
+  EXPECT_LT(hdmap::LatencyHistogram::bucketFor(UINT64_MAX),
+            hdmap::LatencyHistogram::kBucketCount);
+
+  // Size histograms bucket by powers of two
+  EXPECT_EQ(hdmap::SizeHistogram::bucketFor(0), 0);
+  EXPECT_EQ(hdmap::SizeHistogram::bucketFor(1), 1);
+  EXPECT_EQ(hdmap::SizeHistogram::bucketFor(5), 3);
+  EXPECT_EQ(hdmap::SizeHistogram::bucketLowerBound(3), 4);
+}
+
+TEST(LogHistogramTest, Percentiles) {
+  hdmap::LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.count(), 1000);
+  EXPECT_EQ(histogram.max(), 1000);
+  EXPECT_DOUBLE_EQ(histogram.mean(), 500.5);
+  EXPECT_NEAR(histogram.percentile(0.5), 500, 500 / 16);
+  EXPECT_NEAR(histogram.percentile(0.99), 990, 990 / 16);
+  EXPECT_EQ(histogram.percentile(1.0), 1000);
+
+  hdmap::LatencyHistogram other;
+  other.record(100000);
+  histogram.merge(other);
+  EXPECT_EQ(histogram.count(), 1001);
+  EXPECT_EQ(histogram.max(), 100000);
+}
+
+TEST(QueryMetricsTest, ThreadsRecordIntoOneSnapshot) {
+  if (!hdmap::kQueryMetricsEnabled) {
+    GTEST_SKIP() << "built without HDMAP_ENABLE_METRICS";
+  }
+  hdmap::QueryMetrics metrics;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&metrics]() {
+      for (uint64_t i = 0; i < 1000; ++i) {
+        metrics.record(hdmap::QueryApi::QUERY_RADIUS, 100 + i, 3, 2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto snapshot{metrics.snapshot()};
+  const auto& radius{snapshot[hdmap::QueryApi::QUERY_RADIUS]};
+  EXPECT_EQ(radius.calls, 4000);
+  EXPECT_EQ(radius.latency.count(), 4000);
+  EXPECT_EQ(radius.latency.max(), 1099);
+  EXPECT_DOUBLE_EQ(radius.resultSizes.mean(), 3.0);
+  EXPECT_EQ(radius.rtreeNodesVisited, 8000);
+  EXPECT_EQ(snapshot[hdmap::QueryApi::ROUTE].calls, 0);
+
+  metrics.reset();
+  snapshot = metrics.snapshot();
+  EXPECT_EQ(snapshot[hdmap::QueryApi::QUERY_RADIUS].calls, 0);
+}
+
+TEST(QueryMetricsTest, MapServerRecordsQueries) {
+  const std::string path{"/tmp/test_query_metrics.osm"};
+  {
+    std::ofstream file(path);
+    file << R"(<osm>
+  <node id="1" lat="0.0" lon="0.0"/>
+  <node id="2" lat="0.0" lon="100.0"/>
+  <way id="100">
+    <nd ref="1"/>
+    <nd ref="2"/>
+    <tag k="subtype" v="road"/>
+  </way>
+</osm>)";
+  }
+  hdmap::MapServer server;
+  ASSERT_TRUE(server.loadFromFile(path));
+  std::remove(path.c_str());
+
+  server.queryRadius(hdmap::Point2D(50, 0), 10.0);
+  server.getClosestLane(hdmap::Point2D(50, 5));
+  server.project(100, hdmap::Point2D(50, 5));
+  server.project(999, hdmap::Point2D(50, 5));
+
+  const auto snapshot{server.getQueryMetrics()};
+  if (!hdmap::kQueryMetricsEnabled) {
+    EXPECT_EQ(snapshot[hdmap::QueryApi::QUERY_RADIUS].calls, 0);
+    GTEST_SKIP() << "built without HDMAP_ENABLE_METRICS";
+  }
+  // getClosestLane goes through getNearbyLanes and queryRadius, widening
+  // the search radius until it finds a candidate
+  EXPECT_GE(snapshot[hdmap::QueryApi::QUERY_RADIUS].calls, 2);
+  EXPECT_EQ(snapshot[hdmap::QueryApi::CLOSEST_LANE].calls, 1);
+  EXPECT_GE(snapshot[hdmap::QueryApi::NEARBY_LANES].calls, 1);
+  EXPECT_EQ(snapshot[hdmap::QueryApi::NEARBY_LANES].calls + 1,
+            snapshot[hdmap::QueryApi::QUERY_RADIUS].calls);
+  EXPECT_EQ(snapshot[hdmap::QueryApi::PROJECT].calls, 2);
+  EXPECT_DOUBLE_EQ(snapshot[hdmap::QueryApi::PROJECT].resultSizes.mean(), 0.5);
+  EXPECT_GT(snapshot[hdmap::QueryApi::QUERY_RADIUS].rtreeNodesVisited, 0);
+  EXPECT_GT(snapshot[hdmap::QueryApi::CLOSEST_LANE].latency.max(), 0);
+
+  const std::string json{snapshot.toJson()};
+  EXPECT_NE(json.find("\"closest_lane\": {\"calls\": 1"), std::string::npos);
+
+  server.resetQueryMetrics();
+  EXPECT_EQ(server.getQueryMetrics()[hdmap::QueryApi::PROJECT].calls, 0);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <unordered_map>
+
+#include "include/routing_graph.hpp"
+
+namespace {
+
+std::shared_ptr<hdmap::Lane> makeLane(uint64_t id, hdmap::Point2D start,
+                                      hdmap::Point2D end) {
+  auto lane{std::make_shared<hdmap::Lane>()};
+  lane->id = id;
+  lane->speedLimit = 10.0;
+  lane->centerline = {start, end};
+  return lane;
+}
+
+// 1 -> 2 -> 4 is short, 1 -> 3 -> 4 is a long detour, 5 is disconnected
+hdmap::LaneMap makeNetwork() {
+  hdmap::LaneMap lanes;
+  lanes[1] = makeLane(1, hdmap::Point2D(0, 0), hdmap::Point2D(100, 0));
+  lanes[2] = makeLane(2, hdmap::Point2D(100, 0), hdmap::Point2D(200, 0));
+  lanes[3] = makeLane(3, hdmap::Point2D(100, 0), hdmap::Point2D(100, 500));
+  lanes[4] = makeLane(4, hdmap::Point2D(200, 0), hdmap::Point2D(300, 0));
+  lanes[5] = makeLane(5, hdmap::Point2D(0, 900), hdmap::Point2D(100, 900));
+  lanes[1]->successorIds = {2, 3};
+  lanes[2]->successorIds = {4};
+  lanes[3]->successorIds = {4};
+  return lanes;
+}
+
+}  // namespace
+
+TEST(RoutingGraphTest, BuildCsr) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeNetwork());
+
+  EXPECT_EQ(graph.nodeCount(), 5);
+  EXPECT_EQ(graph.edgeCount(), 4);
+  ASSERT_TRUE(graph.indexOf(1).has_value());
+  EXPECT_EQ(graph.laneIdAt(*graph.indexOf(1)), 1);
+  EXPECT_FALSE(graph.indexOf(42).has_value());
+  EXPECT_DOUBLE_EQ(graph.laneCost(*graph.indexOf(1)), 10.0);
+}
+
+TEST(RoutingGraphTest, AStarFindsShortestRoute) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeNetwork());
+
+  const auto route{graph.aStar(1, 4)};
+  ASSERT_TRUE(route.has_value());
+  ASSERT_EQ(route->laneIds.size(), 3);
+  EXPECT_EQ(route->laneIds[1], 2);
+  EXPECT_DOUBLE_EQ(route->cost, 30.0);
+}
+
+TEST(RoutingGraphTest, AStarMatchesDijkstra) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeNetwork());
+
+  const auto aStar{graph.aStar(1, 4)};
+  const auto dijkstra{graph.dijkstra(1, 4)};
+  ASSERT_TRUE(aStar.has_value());
+  ASSERT_TRUE(dijkstra.has_value());
+  EXPECT_DOUBLE_EQ(aStar->cost, dijkstra->cost);
+  EXPECT_LE(aStar->nodesExplored, dijkstra->nodesExplored);
+}
+
+TEST(RoutingGraphTest, SameLane) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeNetwork());
+
+  const auto route{graph.aStar(2, 2)};
+  ASSERT_TRUE(route.has_value());
+  ASSERT_EQ(route->laneIds.size(), 1);
+  EXPECT_DOUBLE_EQ(route->cost, 10.0);
+}
+
+TEST(RoutingGraphTest, Unreachable) {
+  hdmap::RoutingGraph graph;
+  graph.build(makeNetwork());
+
+  EXPECT_FALSE(graph.aStar(1, 5).has_value());
+  EXPECT_FALSE(graph.aStar(4, 1).has_value());
+}
+
+TEST(RoutingGraphTest, LaneChange) {
+  auto lanes{makeNetwork()};
+  lanes[5]->adjacentRightIds = {1};
+
+  hdmap::RoutingGraph graph;
+  graph.build(lanes);
+
+  const auto route{graph.aStar(5, 2)};
+  ASSERT_TRUE(route.has_value());
+  ASSERT_EQ(route->laneIds.size(), 3);
+  EXPECT_EQ(route->laneIds[1], 1);
+}
@@ -97,3 +97,19 @@ TEST(RTreeTest, ManyInsertions) {
              results);
   EXPECT_GT(results.size(), 0);
 }
+
+TEST(RTreeTest, QueryIf) {
+  hdmap::RTree tree;
+
+  for (int i = 0; i < 50; ++i) {
+    const hdmap::BoundingBox bbox{hdmap::Point2D(i * 10.0, 0.0),
+                                  hdmap::Point2D(i * 10.0 + 1.0, 1.0)};
+    tree.insert(bbox, hdmap::Data{});
+  }
+
+  // Only boxes reaching past x = 400
+  std::vector<hdmap::Data> results;
+  tree.queryIf([](const hdmap::BoundingBox& bbox) { return bbox.max.x > 400; },
+               results);
+  EXPECT_EQ(results.size(), 10);
+}
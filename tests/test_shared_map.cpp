@@ -0,0 +1,256 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/map_generator.hpp"
+#include "include/map_server.hpp"
+#include "include/shared_map.hpp"
+
+namespace {
+
+template <typename Record>
+std::vector<uint64_t> sortedIds(const std::vector<const Record*>& records) {
+  std::vector<uint64_t> ids;
+  for (const Record* record : records) {
+    ids.push_back(record->id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+template <typename Values>
+std::vector<uint64_t> sorted(const Values& values) {
+  std::vector<uint64_t> ids(values.begin(), values.end());
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+}  // namespace
+
+class SharedMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(load(*server, 400));
+  }
+
+  void TearDown() override {
+    std::remove(mapPath.c_str());
+  }
+
+  bool load(hdmap::MapServer& target, size_t lanes) const {
+    hdmap::CityConfig city;
+    city.laneCount = lanes;
+    city.trafficLightDensity = 0.5;
+    city.trafficSignDensity = 0.5;
+    return hdmap::CityGenerator{city}.writeOsm(mapPath) &&
+           target.loadFromFile(mapPath);
+  }
+
+  std::string mapPath{"/tmp/test_shared_map_" + std::to_string(getpid()) +
+                      ".osm"};
+  std::string name{"/hdmap_test_" + std::to_string(getpid())};
+  std::shared_ptr<hdmap::MapServer> server{
+      std::make_shared<hdmap::MapServer>()};
+};
+
+TEST_F(SharedMapTest, QueriesFindEveryMatchingElement) {
+  hdmap::SharedMapPublisher publisher{name};
+  ASSERT_TRUE(publisher.publish(*server)) << publisher.getLastError();
+  hdmap::SharedMapView view;
+  ASSERT_TRUE(view.open(name)) << view.getLastError();
+
+  EXPECT_EQ(view.getLaneCount(), server->getLaneCount());
+  EXPECT_EQ(view.getTrafficLightCount(), server->getTrafficLightCount());
+  EXPECT_EQ(view.getTrafficSignCount(), server->getTrafficSignCount());
+  EXPECT_EQ(view.getMappedBytes(), publisher.getPublishedBytes());
+
+  // Checked against every element: the packed trees must not miss any
+  const auto inRegion = [](const auto& elements, const auto& keep) {
+    std::vector<uint64_t> ids;
+    for (const auto& [id, element] : elements) {
+      if (keep(*element)) {
+        ids.push_back(id);
+      }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  };
+  for (const auto& region :
+       {hdmap::BoundingBox{hdmap::Point2D(0, 0), hdmap::Point2D(300, 300)},
+        hdmap::BoundingBox{hdmap::Point2D(-50, 120), hdmap::Point2D(90, 400)},
+        hdmap::BoundingBox{hdmap::Point2D(-1e6, -1e6),
+                           hdmap::Point2D(1e6, 1e6)}}) {
+    const auto shared{view.queryRegion(region)};
+    EXPECT_EQ(sortedIds(shared.lanes),
+              inRegion(server->getLanes(), [&](const hdmap::Lane& lane) {
+                return lane.bbox.intersects(region);
+              }));
+    EXPECT_EQ(sortedIds(shared.trafficLights),
+              inRegion(server->getTrafficLights(),
+                       [&](const hdmap::TrafficLight& light) {
+                         return region.contains(light.position);
+                       }));
+    EXPECT_EQ(sortedIds(shared.trafficSigns),
+              inRegion(server->getTrafficSigns(),
+                       [&](const hdmap::TrafficSign& sign) {
+                         return region.contains(sign.position);
+                       }));
+  }
+
+  const hdmap::Point2D center{150, 150};
+  const double radius{80.0};
+  const auto shared{view.queryRadius(center, radius)};
+  EXPECT_EQ(sortedIds(shared.lanes),
+            inRegion(server->getLanes(), [&](const hdmap::Lane& lane) {
+              return lane.distanceTo(center) <= radius;
+            }));
+  EXPECT_EQ(sortedIds(shared.trafficLights),
+            inRegion(server->getTrafficLights(),
+                     [&](const hdmap::TrafficLight& light) {
+                       return center.distanceTo(light.position) <= radius;
+                     }));
+  EXPECT_EQ(sortedIds(shared.trafficSigns),
+            inRegion(server->getTrafficSigns(),
+                     [&](const hdmap::TrafficSign& sign) {
+                       return center.distanceTo(sign.position) <= radius;
+                     }));
+  EXPECT_EQ(sortedIds(view.getNearbyLanes(center, radius)),
+            sortedIds(shared.lanes));
+
+  for (const auto& position :
+       {hdmap::Point2D(12, 3), hdmap::Point2D(160, 75),
+        hdmap::Point2D(-120, -40)}) {
+    const auto* closest{view.getClosestLane(position)};
+    const auto reference{server->getClosestLane(position)};
+    ASSERT_EQ(closest != nullptr, reference.has_value());
+    if (closest != nullptr) {
+      EXPECT_DOUBLE_EQ(view.distanceTo(*closest, position),
+                       (*reference)->distanceTo(position));
+    }
+  }
+  EXPECT_EQ(view.getClosestLane(hdmap::Point2D(1e6, 1e6)), nullptr);
+}
+
+TEST_F(SharedMapTest, ElementsById) {
+  hdmap::SharedMapPublisher publisher{name};
+  ASSERT_TRUE(publisher.publish(*server));
+  hdmap::SharedMapView view;
+  ASSERT_TRUE(view.open(name));
+
+  for (const auto& [id, lane] : server->getLanes()) {
+    const auto* record{view.getLaneById(id)};
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->type, lane->type);
+    EXPECT_DOUBLE_EQ(record->speedLimit, lane->speedLimit);
+    EXPECT_DOUBLE_EQ(record->bbox.max.x, lane->bbox.max.x);
+    const auto centerline{view.points(record->centerline)};
+    const auto expected{lane->centerlinePoints()};
+    ASSERT_EQ(centerline.size(), expected.size());
+    EXPECT_DOUBLE_EQ(centerline.back().y, expected.back().y);
+    EXPECT_EQ(view.points(record->leftBoundary).size(),
+              lane->leftBoundary.size());
+    EXPECT_EQ(sorted(view.ids(record->successorIds)),
+              sorted(lane->successorIds));
+    EXPECT_EQ(sorted(view.ids(record->predecessorIds)),
+              sorted(lane->predecessorIds));
+  }
+  for (const auto& [id, light] : server->getTrafficLights()) {
+    const auto* record{view.getTrafficLightById(id)};
+    ASSERT_NE(record, nullptr);
+    EXPECT_DOUBLE_EQ(record->position.x, light->position.x);
+    EXPECT_EQ(record->state, light->state);
+    EXPECT_EQ(sorted(view.ids(record->controlledLaneIds)),
+              sorted(light->controlledLaneIds));
+  }
+  for (const auto& [id, sign] : server->getTrafficSigns()) {
+    const auto* record{view.getTrafficSignById(id)};
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->type, sign->type);
+    EXPECT_EQ(view.text(record->value), sign->value);
+  }
+  EXPECT_EQ(view.getLaneById(999999999), nullptr);
+  EXPECT_EQ(view.getTrafficLightById(999999999), nullptr);
+  EXPECT_EQ(view.getTrafficSignById(999999999), nullptr);
+}
+
+TEST_F(SharedMapTest, GenerationTracksMapSwaps) {
+  hdmap::SharedMapPublisher publisher{name};
+  ASSERT_TRUE(publisher.publish(*server));
+  hdmap::SharedMapView view;
+  ASSERT_TRUE(view.open(name));
+  EXPECT_EQ(view.getGeneration(), publisher.getGeneration());
+  EXPECT_FALSE(view.isStale());
+  const auto* oldLane{view.getLaneById(server->getLanes().begin()->first)};
+  ASSERT_NE(oldLane, nullptr);
+  const uint64_t oldLaneId{oldLane->id};
+
+  hdmap::MapServer smaller;
+  ASSERT_TRUE(load(smaller, 100));
+  ASSERT_TRUE(publisher.publish(smaller));
+  EXPECT_TRUE(view.isStale());
+  EXPECT_EQ(view.getPublishedGeneration(), publisher.getGeneration());
+  // The old segment is unlinked but stays mapped until refresh
+  EXPECT_EQ(oldLane->id, oldLaneId);
+  EXPECT_EQ(view.getLaneCount(), server->getLaneCount());
+
+  ASSERT_TRUE(view.refresh()) << view.getLastError();
+  EXPECT_FALSE(view.isStale());
+  EXPECT_EQ(view.getGeneration(), publisher.getGeneration());
+  EXPECT_EQ(view.getLaneCount(), smaller.getLaneCount());
+
+  // A new view only ever sees the current generation
+  hdmap::SharedMapView late;
+  ASSERT_TRUE(late.open(name));
+  EXPECT_EQ(late.getLaneCount(), smaller.getLaneCount());
+}
+
+TEST_F(SharedMapTest, SharedAcrossProcesses) {
+  hdmap::SharedMapPublisher publisher{name};
+  ASSERT_TRUE(publisher.publish(*server));
+  const size_t lanes{server->getLaneCount()};
+  const auto firstLaneId{server->getLanes().begin()->first};
+
+  const pid_t child{fork()};
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    hdmap::SharedMapView view;
+    const bool ok{view.open(name) && view.getLaneCount() == lanes &&
+                  view.getLaneById(firstLaneId) != nullptr &&
+                  view.getClosestLane(hdmap::Point2D(0, 0)) != nullptr};
+    _exit(ok ? 0 : 1);
+  }
+  int status{0};
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST_F(SharedMapTest, EmptyMapAndErrors) {
+  hdmap::SharedMapView view;
+  EXPECT_FALSE(view.open(name));
+  EXPECT_FALSE(view.isOpen());
+  EXPECT_EQ(view.queryRegion(hdmap::BoundingBox{}).totalCount(), 0);
+
+  hdmap::SharedMapPublisher invalid{"no_leading_slash"};
+  EXPECT_FALSE(invalid.publish(*server));
+  EXPECT_NE(invalid.getLastError().find("Invalid"), std::string::npos);
+
+  hdmap::SharedMapPublisher publisher{name};
+  ASSERT_TRUE(publisher.publish(hdmap::MapServer{}));
+  ASSERT_TRUE(view.open(name)) << view.getLastError();
+  EXPECT_EQ(view.getLaneCount(), 0);
+  EXPECT_EQ(view.getClosestLane(hdmap::Point2D(0, 0)), nullptr);
+  EXPECT_EQ(view.queryRadius(hdmap::Point2D(0, 0), 1e6).totalCount(), 0);
+
+  // Views keep their mapping after the publisher goes away
+  publisher.unpublish();
+  EXPECT_TRUE(view.isOpen());
+  hdmap::SharedMapView late;
+  EXPECT_FALSE(late.open(name));
+}
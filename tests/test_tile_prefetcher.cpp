@@ -0,0 +1,100 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "include/map_server.hpp"
+#include "include/tile_prefetcher.hpp"
+#include "include/tile_store.hpp"
+
+class TilePrefetcherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Ten 100 m lanes along y = 0 and ten along x = 0, 100 m tiles
+    std::ofstream file(mapPath);
+    file << "<osm>\n";
+    for (int i = 0; i <= 10; ++i) {
+      file << "<node id=\"" << i + 1 << "\" lat=\"0.0\" lon=\"" << i * 100
+           << ".0\"/>\n";
+      file << "<node id=\"" << i + 101 << "\" lat=\"" << i * 100
+           << ".0\" lon=\"0.0\"/>\n";
+    }
+    for (int i = 0; i < 10; ++i) {
+      file << "<way id=\"" << 1000 + i << "\">\n<nd ref=\"" << i + 1
+           << "\"/>\n<nd ref=\"" << i + 2
+           << "\"/>\n<tag k=\"subtype\" v=\"road\"/>\n</way>\n";
+      file << "<way id=\"" << 2000 + i << "\">\n<nd ref=\"" << i + 101
+           << "\"/>\n<nd ref=\"" << i + 102
+           << "\"/>\n<tag k=\"subtype\" v=\"road\"/>\n</way>\n";
+    }
+    file << "</osm>\n";
+    file.close();
+
+    auto server{std::make_shared<hdmap::MapServer>()};
+    ASSERT_TRUE(server->loadFromFile(mapPath));
+    hdmap::TileStore writer;
+    ASSERT_TRUE(writer.write(*server, tileDirectory, 100.0));
+    ASSERT_TRUE(store.open(tileDirectory));
+  }
+
+  void TearDown() override {
+    std::remove(mapPath.c_str());
+    std::filesystem::remove_all(tileDirectory);
+  }
+
+  std::string mapPath{"/tmp/test_prefetch_map.osm"};
+  std::string tileDirectory{"/tmp/test_prefetch_tiles"};
+  hdmap::TileStore store;
+};
+
+TEST_F(TilePrefetcherTest, PredictPathFollowsHeadingOrRoute) {
+  const hdmap::PrefetchConfig config{10.0, 100.0, false};
+  hdmap::VehicleState state;
+  state.position = hdmap::Point2D(0, 0);
+  state.heading = M_PI / 2.0;
+  state.speed = 30.0;  // 300 m within the horizon
+
+  auto path{hdmap::TilePrefetcher::predictPath(state, config)};
+  ASSERT_EQ(path.size(), 2);
+  EXPECT_NEAR(path[1].x, 0.0, 1e-9);
+  EXPECT_NEAR(path[1].y, 300.0, 1e-9);
+
+  // Route turns right after 100 m; the path follows it for 300 m total
+  state.position = hdmap::Point2D(1, 0);
+  state.route = {hdmap::Point2D(0, 0), hdmap::Point2D(0, 100),
+                 hdmap::Point2D(500, 100)};
+  path = hdmap::TilePrefetcher::predictPath(state, config);
+  ASSERT_EQ(path.size(), 3);
+  EXPECT_NEAR(path[1].y, 100.0, 1e-9);
+  EXPECT_NEAR(path.back().y, 100.0, 1e-9);
+  EXPECT_NEAR(path.back().x, 300.0 - path[0].distanceTo(path[1]), 1e-9);
+}
+
+TEST_F(TilePrefetcherTest, QueriesHitPrefetchedTiles) {
+  hdmap::TilePrefetcher prefetcher{store, {10.0, 100.0, true}};
+  prefetcher.start();
+  EXPECT_TRUE(prefetcher.isRunning());
+
+  // Drive east at 20 m/s, querying where the vehicle will be
+  for (int step = 0; step < 4; ++step) {
+    hdmap::VehicleState state;
+    state.position = hdmap::Point2D(step * 200.0 + 10.0, 0);
+    state.speed = 20.0;
+    prefetcher.update(state);
+    prefetcher.waitIdle();
+    store.queryRadius(hdmap::Point2D(step * 200.0 + 150.0, 0), 20.0);
+  }
+
+  const auto stats{store.getStats()};
+  EXPECT_EQ(stats.loads, 0);
+  EXPECT_GT(stats.hits, 0);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 1.0);
+  EXPECT_GT(stats.prefetches, 0);
+  EXPECT_GE(prefetcher.getCycleCount(), 1);
+
+  prefetcher.stop();
+  EXPECT_FALSE(prefetcher.isRunning());
+}
@@ -0,0 +1,252 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include "include/map_server.hpp"
+#include "include/tile_store.hpp"
+
+class TileStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Five 100 m lanes in a row along y = 0, one per 100 m tile
+    std::ofstream file(mapPath);
+    file << "<osm>\n";
+    for (int i = 0; i <= 5; ++i) {
+      file << "<node id=\"" << i + 1 << "\" lat=\"0.0\" lon=\"" << i * 100
+           << ".0\"/>\n";
+    }
+    for (int i = 0; i < 5; ++i) {
+      file << "<way id=\"" << 100 + i << "\">\n"
+           << "<nd ref=\"" << i + 1 << "\"/>\n"
+           << "<nd ref=\"" << i + 2 << "\"/>\n"
+           << "<tag k=\"subtype\" v=\"road\"/>\n</way>\n";
+    }
+    file << "</osm>\n";
+    file.close();
+
+    server = std::make_shared<hdmap::MapServer>();
+    ASSERT_TRUE(server->loadFromFile(mapPath));
+    hdmap::TileStore writer;
+    ASSERT_TRUE(writer.write(*server, tileDirectory, 100.0));
+  }
+
+  void TearDown() override {
+    std::remove(mapPath.c_str());
+    std::filesystem::remove_all(tileDirectory);
+  }
+
+  // Replaces a tile with a pipe, so reading it blocks until finishRead()
+  std::string blockTile(const hdmap::TileKey& key) const {
+    const std::string path{hdmap::TileStore::tilePathFor(tileDirectory, key)};
+    std::string contents;
+    {
+      std::ifstream tile{path, std::ios::binary};
+      contents.assign(std::istreambuf_iterator<char>{tile}, {});
+    }
+    std::filesystem::remove(path);
+    EXPECT_EQ(mkfifo(path.c_str(), 0600), 0);
+    return contents;
+  }
+
+  // Write end of a blocked tile, opened once a reader has it open
+  int waitForReader(const hdmap::TileKey& key) const {
+    const std::string path{hdmap::TileStore::tilePathFor(tileDirectory, key)};
+    for (int i = 0; i < 5000; ++i) {
+      const int fd{open(path.c_str(), O_WRONLY | O_NONBLOCK)};
+      if (fd >= 0) {
+        fcntl(fd, F_SETFL, 0);
+        return fd;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ADD_FAILURE() << "nobody is reading " << path;
+    return open(path.c_str(), O_WRONLY);
+  }
+
+  static void finishRead(int fd, const std::string& contents) {
+    EXPECT_EQ(write(fd, contents.data(), contents.size()),
+              static_cast<ssize_t>(contents.size()));
+    close(fd);
+  }
+
+  std::string mapPath{"/tmp/test_tile_map.osm"};
+  std::string tileDirectory{"/tmp/test_tiles"};
+  std::shared_ptr<hdmap::MapServer> server;
+};
+
+TEST_F(TileStoreTest, QueriesMatchFullMap) {
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+  EXPECT_EQ(store.tiles().size(), 5);
+  EXPECT_EQ(store.getLoadedTileCount(), 0);
+
+  const hdmap::BoundingBox region{hdmap::Point2D(120, -10),
+                                  hdmap::Point2D(260, 10)};
+  EXPECT_EQ(store.queryRegion(region).lanes.size(),
+            server->queryRegion(region).lanes.size());
+  EXPECT_EQ(store.queryRadius(hdmap::Point2D(300, 0), 1.0).lanes.size(),
+            server->queryRadius(hdmap::Point2D(300, 0), 1.0).lanes.size());
+
+  // Only the tiles around the queries were read
+  EXPECT_LT(store.getLoadedTileCount(), 5);
+  EXPECT_GT(store.getStats().loads, 0);
+}
+
+TEST_F(TileStoreTest, LocalizationQueries) {
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+
+  // By id: only the lane's own tile is read
+  const auto lane{store.getLaneById(103)};
+  ASSERT_TRUE(lane.has_value());
+  EXPECT_EQ((*lane)->id, 103);
+  EXPECT_EQ(store.getLoadedTileCount(), 1);
+  EXPECT_TRUE(store.isTileLoaded(hdmap::TileKey{3, 0}));
+  EXPECT_FALSE(store.getLaneById(999).has_value());
+
+  for (const auto& position :
+       {hdmap::Point2D(210, 3), hdmap::Point2D(480, -40),
+        hdmap::Point2D(-150, 0), hdmap::Point2D(2000, 0)}) {
+    const auto tiled{store.getClosestLane(position)};
+    const auto full{server->getClosestLane(position)};
+    ASSERT_EQ(tiled.has_value(), full.has_value());
+    if (full.has_value()) {
+      EXPECT_DOUBLE_EQ((*tiled)->distanceTo(position),
+                       (*full)->distanceTo(position));
+    }
+  }
+}
+
+TEST_F(TileStoreTest, EvictsLeastRecentlyUsedOverBudget) {
+  auto constraints{hdmap::MemoryConstraints::defaultConstraints()};
+  constraints.maxTotalMemory = 1;  // keep only what a query pins
+  hdmap::TileStore store{constraints};
+  ASSERT_TRUE(store.open(tileDirectory));
+
+  const auto first{store.queryRadius(hdmap::Point2D(5, 0), 10.0)};
+  ASSERT_EQ(first.lanes.size(), 1);
+  EXPECT_EQ(store.getLoadedTileCount(), 1);
+
+  store.queryRadius(hdmap::Point2D(495, 0), 10.0);
+  EXPECT_EQ(store.getLoadedTileCount(), 1);
+  EXPECT_FALSE(store.isTileLoaded(hdmap::TileKey{0, 0}));
+  EXPECT_TRUE(store.isTileLoaded(hdmap::TileKey{4, 0}));
+  EXPECT_EQ(store.getStats().evictions, 1);
+
+  // Results outlive eviction of their tile
+  EXPECT_EQ(first.lanes[0]->id, 100);
+}
+
+TEST_F(TileStoreTest, PrefetchAlongHeading) {
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+
+  // Driving east from x = 10: the next two tiles are read ahead
+  store.prefetch(hdmap::Point2D(10, 0), 0.0, 200.0);
+  EXPECT_TRUE(store.isTileLoaded(hdmap::TileKey{1, 0}));
+  EXPECT_TRUE(store.isTileLoaded(hdmap::TileKey{2, 0}));
+  EXPECT_FALSE(store.isTileLoaded(hdmap::TileKey{4, 0}));
+  EXPECT_GT(store.getStats().prefetches, 0);
+
+  store.queryRadius(hdmap::Point2D(250, 0), 10.0);
+  const auto stats{store.getStats()};
+  EXPECT_EQ(stats.loads, 0);
+  EXPECT_GT(stats.hits, 0);
+}
+
+TEST_F(TileStoreTest, MissingManifest) {
+  hdmap::TileStore store;
+  EXPECT_FALSE(store.open("/tmp/does_not_exist_tiles"));
+  EXPECT_FALSE(store.getLastError().empty());
+}
+
+TEST_F(TileStoreTest, QueriesDoNotWaitForSlowPrefetch) {
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+  ASSERT_EQ(store.queryRadius(hdmap::Point2D(5, 0), 10.0).lanes.size(), 1);
+
+  const std::string contents{blockTile(hdmap::TileKey{4, 0})};
+  std::thread prefetcher{
+      [&store]() { store.prefetch(hdmap::Point2D(450, 0), 0.0, 10.0); }};
+  const int fd{waitForReader(hdmap::TileKey{4, 0})};
+
+  // Resident tiles answer while the read is stuck
+  auto query{std::async(std::launch::async, [&store]() {
+    return store.queryRadius(hdmap::Point2D(5, 0), 10.0).lanes.size();
+  })};
+  EXPECT_EQ(query.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  EXPECT_FALSE(store.isTileLoaded(hdmap::TileKey{4, 0}));
+
+  finishRead(fd, contents);
+  prefetcher.join();
+  EXPECT_EQ(query.get(), 1);
+  EXPECT_TRUE(store.isTileLoaded(hdmap::TileKey{4, 0}));
+  EXPECT_EQ(store.getStats().prefetches, 1);
+}
+
+TEST_F(TileStoreTest, QueriesDoNotWaitForAnotherQuerysRead) {
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+  ASSERT_EQ(store.queryRadius(hdmap::Point2D(5, 0), 10.0).lanes.size(), 1);
+
+  const std::string contents{blockTile(hdmap::TileKey{4, 0})};
+  auto slow{std::async(std::launch::async, [&store]() {
+    return store
+        .queryRegion(hdmap::BoundingBox{hdmap::Point2D(440, -5),
+                                        hdmap::Point2D(460, 5)})
+        .lanes.size();
+  })};
+  const int fd{waitForReader(hdmap::TileKey{4, 0})};
+
+  auto fast{std::async(std::launch::async, [&store]() {
+    return store.queryRadius(hdmap::Point2D(5, 0), 10.0).lanes.size();
+  })};
+  EXPECT_EQ(fast.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  // A second query for the tile being read waits for that read
+  auto waiting{std::async(std::launch::async, [&store]() {
+    return store
+        .queryRegion(hdmap::BoundingBox{hdmap::Point2D(455, -5),
+                                        hdmap::Point2D(465, 5)})
+        .lanes.size();
+  })};
+
+  finishRead(fd, contents);
+  EXPECT_EQ(slow.get(), 1);
+  EXPECT_EQ(waiting.get(), 1);
+  EXPECT_EQ(fast.get(), 1);
+  EXPECT_EQ(store.getLoadedTileCount(), 2);
+}
+
+TEST_F(TileStoreTest, RejectsCountsPastEndOfTile) {
+  // The first lane's centerline count follows the header, id, type and
+  // speed limit
+  const std::string path{
+      hdmap::TileStore::tilePathFor(tileDirectory, hdmap::TileKey{0, 0})};
+  {
+    std::fstream tile{path, std::ios::binary | std::ios::in | std::ios::out};
+    tile.seekp(3 * sizeof(uint32_t) + sizeof(uint64_t) +
+               sizeof(hdmap::LaneType) + sizeof(double));
+    const uint64_t huge{uint64_t{1} << 60};
+    tile.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+  }
+
+  hdmap::TileStore store;
+  ASSERT_TRUE(store.open(tileDirectory));
+  EXPECT_TRUE(store.queryRadius(hdmap::Point2D(5, 0), 10.0).lanes.empty());
+  EXPECT_NE(store.getLastError().find("Corrupt"), std::string::npos);
+  EXPECT_FALSE(store.isTileLoaded(hdmap::TileKey{0, 0}));
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <memory>
+#include <vector>
 
 #include "include/types.hpp"
 
@@ -85,3 +86,48 @@ TEST(QueryResultTest, TotalCount) {
 
   EXPECT_EQ(result.totalCount(), 6);
 }
+
+TEST(CompactPolylineTest, TileOrigin) {
+  const auto origin{hdmap::tileOriginFor(hdmap::Point2D(1234.5, -10.0), 1000)};
+
+  EXPECT_DOUBLE_EQ(origin.x, 1000.0);
+  EXPECT_DOUBLE_EQ(origin.y, -1000.0);
+}
+
+TEST(CompactPolylineTest, RoundTrip) {
+  const std::vector<hdmap::Point2D> points{hdmap::Point2D(5000.25, 7000.5),
+                                           hdmap::Point2D(5100.75, 7050.125)};
+  const hdmap::CompactPolyline compact{points, 1000.0};
+
+  ASSERT_EQ(compact.size(), 2);
+  EXPECT_DOUBLE_EQ(compact.origin().x, 5000.0);
+  EXPECT_DOUBLE_EQ(compact.origin().y, 7000.0);
+  EXPECT_NEAR(compact.at(1).x, 5100.75, 1e-3);
+  EXPECT_NEAR(compact.at(1).y, 7050.125, 1e-3);
+  EXPECT_EQ(compact.memoryUsage(), 2 * 2 * sizeof(float));
+}
+
+TEST(CompactPolylineTest, MinVertexDistance) {
+  const hdmap::CompactPolyline compact{
+      {hdmap::Point2D(0, 0), hdmap::Point2D(3, 4), hdmap::Point2D(10, 10)},
+      1000.0};
+
+  EXPECT_NEAR(compact.minVertexDistance(hdmap::Point2D(3, 0)), 3.0, 1e-6);
+  EXPECT_NEAR(compact.minVertexDistance(hdmap::Point2D(10, 10)), 0.0, 1e-6);
+}
+
+TEST(LaneTest, CompactGeometry) {
+  hdmap::Lane lane{};
+  lane.centerline = {hdmap::Point2D(0, 0), hdmap::Point2D(10, 10)};
+  const double before{lane.distanceTo(hdmap::Point2D(10, 13))};
+
+  lane.compactGeometry(hdmap::kDefaultTileSize);
+
+  EXPECT_TRUE(lane.centerline.empty());
+  EXPECT_EQ(lane.centerlineSize(), 2);
+  EXPECT_NEAR(lane.distanceTo(hdmap::Point2D(10, 13)), before, 1e-6);
+
+  lane.computeBoundingBox();
+  EXPECT_NEAR(lane.bbox.max.x, 10.0, 1e-6);
+  EXPECT_NEAR(lane.bbox.max.y, 10.0, 1e-6);
+}
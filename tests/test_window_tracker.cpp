@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+
+#include "include/window_tracker.hpp"
+
+namespace {
+
+std::set<uint64_t> laneIds(const hdmap::QueryResult& result) {
+  std::set<uint64_t> ids;
+  for (const auto& lane : result.lanes) {
+    ids.insert(lane->id);
+  }
+  return ids;
+}
+
+}  // namespace
+
+class WindowTrackerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // 10 x 10 grid of short east-bound lanes, 20 m apart
+    testMapPath = "/tmp/test_window_tracker.osm";
+    std::ofstream file(testMapPath);
+    file << "<osm version=\"0.6\">\n";
+    uint64_t nodeId = 1;
+    for (int y = 0; y < 10; ++y) {
+      for (int x = 0; x < 10; ++x) {
+        file << "<node id=\"" << nodeId << "\" lat=\"" << y * 20
+             << "\" lon=\"" << x * 20 << "\"/>\n";
+        file << "<node id=\"" << nodeId + 1 << "\" lat=\"" << y * 20
+             << "\" lon=\"" << x * 20 + 10 << "\"/>\n";
+        file << "<way id=\"" << 1000 + y * 10 + x << "\">\n<nd ref=\""
+             << nodeId << "\"/>\n<nd ref=\"" << nodeId + 1
+             << "\"/>\n<tag k=\"subtype\" v=\"road\"/>\n</way>\n";
+        nodeId += 2;
+      }
+    }
+    file << "</osm>\n";
+    file.close();
+
+    server = std::make_shared<hdmap::MapServer>();
+    ASSERT_TRUE(server->loadFromFile(testMapPath));
+  }
+
+  void TearDown() override {
+    server->clear();
+    std::remove(testMapPath.c_str());
+  }
+
+  std::string testMapPath;
+  std::shared_ptr<hdmap::MapServer> server;
+};
+
+TEST_F(WindowTrackerTest, FirstUpdateIsFullQuery) {
+  hdmap::WindowTracker tracker{*server};
+  const hdmap::BoundingBox window{hdmap::Point2D(0, 0),
+                                  hdmap::Point2D(50, 50)};
+
+  const auto delta{tracker.update(window)};
+  EXPECT_EQ(laneIds(delta.entered), laneIds(server->queryRegion(window)));
+  EXPECT_EQ(delta.left.totalCount(), 0);
+  EXPECT_EQ(tracker.currentCount(), delta.entered.totalCount());
+}
+
+TEST_F(WindowTrackerTest, MovingWindowMatchesFullQuery) {
+  hdmap::WindowTracker tracker{*server};
+  std::set<uint64_t> tracked;
+
+  // Drive diagonally through the map in 3 m steps
+  for (int step = 0; step < 40; ++step) {
+    const double offset{step * 3.0};
+    const hdmap::BoundingBox window{hdmap::Point2D(offset, offset * 0.5),
+                                    hdmap::Point2D(offset + 45.0,
+                                                   offset * 0.5 + 45.0)};
+    const auto delta{tracker.update(window)};
+
+    for (const auto& lane : delta.left.lanes) {
+      EXPECT_EQ(tracked.erase(lane->id), 1);
+    }
+    for (const auto& lane : delta.entered.lanes) {
+      EXPECT_TRUE(tracked.insert(lane->id).second);
+    }
+
+    const auto expected{laneIds(server->queryRegion(window))};
+    EXPECT_EQ(tracked, expected);
+    EXPECT_EQ(laneIds(tracker.current()), expected);
+  }
+}
+
+TEST_F(WindowTrackerTest, JumpAndReset) {
+  hdmap::WindowTracker tracker{*server};
+  tracker.update(
+      hdmap::BoundingBox(hdmap::Point2D(0, 0), hdmap::Point2D(30, 30)));
+  const size_t before{tracker.currentCount()};
+  ASSERT_GT(before, 0);
+
+  // Non-overlapping jump: everything leaves, the new area enters
+  const auto delta{tracker.update(
+      hdmap::BoundingBox(hdmap::Point2D(120, 120), hdmap::Point2D(150, 150)))};
+  EXPECT_EQ(delta.left.totalCount(), before);
+  EXPECT_GT(delta.entered.totalCount(), 0);
+
+  tracker.reset();
+  EXPECT_EQ(tracker.currentCount(), 0);
+}
+
+TEST_F(WindowTrackerTest, ReloadRebuildsWindow) {
+  hdmap::WindowTracker tracker{*server};
+  const hdmap::BoundingBox window(hdmap::Point2D(0, 0),
+                                  hdmap::Point2D(50, 50));
+  tracker.update(window);
+  const size_t before{tracker.currentCount()};
+  ASSERT_GT(before, 0);
+
+  // Same ids, new objects: the tracker must not keep the old ones
+  ASSERT_TRUE(server->loadFromFile(testMapPath));
+  const auto delta{tracker.update(window)};
+  EXPECT_EQ(delta.left.totalCount(), before);
+  EXPECT_EQ(delta.entered.totalCount(), before);
+  for (const auto& lane : tracker.current().lanes) {
+    EXPECT_EQ(lane, server->getLaneById(lane->id).value_or(nullptr));
+  }
+}